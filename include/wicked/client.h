@@ -12,6 +12,7 @@
 
 typedef struct ni_call_error_context ni_call_error_context_t;
 typedef int			ni_call_error_handler_t(ni_call_error_context_t *, const DBusError *);
+typedef void			ni_call_async_callback_t(int, ni_objectmodel_callback_info_t *, void *);
 
 extern xml_node_t *		ni_call_error_context_get_node(ni_call_error_context_t *, const char *);
 extern int			ni_call_error_context_get_retries(ni_call_error_context_t *, const DBusError *);
@@ -28,6 +29,10 @@ extern int			ni_call_common_xml(ni_dbus_object_t *,
 					const ni_dbus_service_t *, const ni_dbus_method_t *,
 					xml_node_t *, ni_objectmodel_callback_info_t **,
 					ni_call_error_handler_t *error_func);
+extern int			ni_call_common_xml_async(ni_dbus_object_t *,
+					const ni_dbus_service_t *, const ni_dbus_method_t *,
+					xml_node_t *, ni_call_error_handler_t *error_func,
+					ni_call_async_callback_t *callback, void *user_data);
 extern int			ni_call_set_client_state_control(ni_dbus_object_t *, const ni_client_state_control_t *);
 extern int			ni_call_set_client_state_config(ni_dbus_object_t *, const ni_client_state_config_t *);
 extern int			ni_call_set_client_state_scripts(ni_dbus_object_t *, const ni_client_state_scripts_t *);
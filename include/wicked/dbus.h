@@ -61,6 +61,9 @@ struct ni_dbus_variant {
 	};
 
 	ni_dbus_message_t *	__message;
+
+	/* Lazily built key index of large dicts */
+	struct ni_dbus_dict_index *__index;
 };
 
 #define NI_DBUS_VARIANT_MAGIC	0x1234babe
@@ -145,6 +148,7 @@ struct ni_dbus_object {
 	char *			path;		/* absolute path */
 	void *			handle;		/* local object */
 	ni_dbus_object_t *	children;
+	struct ni_dbus_object_children *child_index;	/* children by name */
 	const ni_dbus_service_t **interfaces;
 
 	ni_dbus_server_object_t *server_object;
@@ -152,7 +156,7 @@ struct ni_dbus_object {
 };
 
 typedef void			ni_dbus_async_callback_t(ni_dbus_object_t *proxy,
-					ni_dbus_message_t *reply);
+					ni_dbus_message_t *reply, void *user_data);
 typedef void			ni_dbus_signal_handler_t(ni_dbus_connection_t *connection,
 					ni_dbus_message_t *signal_msg,
 					void *user_data);
@@ -167,6 +171,10 @@ extern ni_dbus_object_t *	ni_dbus_server_find_object_by_handle(ni_dbus_server_t
 extern dbus_bool_t		ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 					const char *interface, const char *signal_name,
 					unsigned int nargs, const ni_dbus_variant_t *args);
+extern void			ni_dbus_server_invalidate_properties(ni_dbus_server_t *);
+extern dbus_bool_t		ni_dbus_server_send_properties_changed(ni_dbus_server_t *,
+					ni_dbus_object_t *);
+extern void			ni_dbus_object_invalidate_properties(ni_dbus_object_t *);
 
 extern dbus_bool_t		ni_dbus_class_is_subclass(const ni_dbus_class_t *sub, const ni_dbus_class_t *super);
 
@@ -383,6 +391,10 @@ extern int			ni_dbus_object_call_simple(const ni_dbus_object_t *,
 					int res_type, void *res_ptr);
 extern int			ni_dbus_object_call_async(ni_dbus_object_t *obj,
 					ni_dbus_async_callback_t *callback, const char *method, ...);
+extern int			ni_dbus_object_call_variant_async(ni_dbus_object_t *,
+					const char *interface, const char *method,
+					unsigned int nargs, const ni_dbus_variant_t *args,
+					ni_dbus_async_callback_t *callback, void *user_data);
 
 extern ni_dbus_message_t *	ni_dbus_object_call_new(const ni_dbus_object_t *, const char *method, ...);
 extern ni_dbus_message_t *	ni_dbus_object_call_new_va(const ni_dbus_object_t *obj,
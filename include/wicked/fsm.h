@@ -52,6 +52,7 @@ typedef struct ni_fsm			ni_fsm_t;
 typedef struct ni_ifworker		ni_ifworker_t;
 typedef struct ni_fsm_event		ni_fsm_event_t;
 typedef struct ni_fsm_require		ni_fsm_require_t;
+typedef struct ni_fsm_async_call	ni_fsm_async_call_t;
 typedef struct ni_fsm_policy		ni_fsm_policy_t;
 typedef int				ni_fsm_policy_compare_fn_t(const ni_fsm_policy_t *, const ni_fsm_policy_t *);
 
@@ -203,6 +204,7 @@ struct ni_ifworker {
 
 		ni_fsm_require_t *check_state_req_list;
 
+		ni_fsm_async_call_t *call;
 	} fsm;
 	unsigned int		extra_waittime;
 
@@ -257,6 +259,7 @@ struct ni_fsm_event {
 struct ni_fsm {
 	ni_ifworker_array_t	pending;
 	ni_ifworker_array_t	workers;
+	struct ni_fsm_worker_index *worker_index;
 	ni_timeout_t		worker_timeout;
 	ni_bool_t		readonly;
 
@@ -265,6 +268,13 @@ struct ni_fsm {
 	unsigned int		last_event_seq[__NI_EVENT_MAX];
 	unsigned int		block_events;
 	ni_fsm_event_t *	events;
+
+	struct {
+		unsigned int		max;		/* max calls in flight */
+		unsigned int		calls;		/* calls in flight     */
+		unsigned int		replies;	/* received replies    */
+	} async;
+
 	struct {
 		void            (*callback)(ni_fsm_t *, ni_ifworker_t *, ni_fsm_event_t *);
 		void *          user_data;
@@ -273,6 +283,15 @@ struct ni_fsm {
 	ni_fsm_policy_t *	policies;
 
 	ni_dbus_object_t *	client_root_object;
+
+	struct {
+		ni_bool_t		incremental;	/* refresh changed objects only */
+		ni_bool_t		check;		/* verify against a full refresh */
+		ni_bool_t		loaded;		/* initial full refresh done    */
+		ni_string_array_t	dirty;		/* object paths signaled changed */
+		struct ni_hashmap *	dirty_index;	/* dirty object path hashes      */
+		unsigned int		mismatches;	/* check mode mismatch counter   */
+	} refresh;
 };
 
 typedef struct ni_ifmatcher {
@@ -334,9 +353,11 @@ extern unsigned int		ni_fsm_policy_array_index(const ni_fsm_policy_array_t *, co
 
 extern ni_dbus_client_t *	ni_fsm_create_client(ni_fsm_t *);
 extern ni_bool_t		ni_fsm_refresh_state(ni_fsm_t *);
+extern void			ni_fsm_refresh_mark_changed(ni_fsm_t *, const char *);
 extern unsigned int		ni_fsm_schedule(ni_fsm_t *);
 extern ni_bool_t		ni_fsm_do(ni_fsm_t *, ni_timeout_t *);
 extern void			ni_fsm_mainloop(ni_fsm_t *);
+extern void			ni_fsm_set_max_async_calls(ni_fsm_t *, unsigned int);
 extern void			ni_fsm_set_process_event_callback(ni_fsm_t *, void (*)(ni_fsm_t *, ni_ifworker_t *, ni_fsm_event_t *), void *);
 extern unsigned int		ni_fsm_get_matching_workers(ni_fsm_t *, ni_ifmatcher_t *, ni_ifworker_array_t *);
 extern unsigned int		ni_fsm_mark_matching_workers(ni_fsm_t *, ni_ifworker_array_t *, const ni_ifmarker_t *);
@@ -360,6 +381,7 @@ extern ni_ifworker_t *		ni_fsm_recv_new_modem(ni_fsm_t *fsm, ni_dbus_object_t *o
 extern ni_ifworker_t *		ni_fsm_recv_new_modem_path(ni_fsm_t *fsm, const char *path);
 extern ni_ifworker_t *		ni_fsm_ifworker_new(ni_fsm_t *, ni_ifworker_type_t, const char *);
 extern void			ni_fsm_destroy_worker(ni_fsm_t *fsm, ni_ifworker_t *w);
+extern ni_bool_t		ni_fsm_remove_worker_at(ni_fsm_t *, unsigned int);
 extern void			ni_fsm_pull_in_children(ni_ifworker_array_t *, ni_fsm_t *);
 extern void			ni_fsm_wait_tentative_addrs(ni_fsm_t *);
 
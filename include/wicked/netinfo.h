@@ -99,6 +99,8 @@ struct ni_netdev {
 	ni_ethtool_t *		ethtool;
 
 	ni_event_filter_t *	event_filter;
+
+	struct ni_netdev_index_entry *	index_entry;	/* netconfig lookup index */
 };
 
 typedef struct ni_netdev_port_req	ni_netdev_port_req_t;
@@ -181,6 +183,8 @@ extern ni_netdev_t *	ni_netdev_new(const char *name, unsigned int ifindex);
 extern ni_netdev_t *	ni_netdev_get(ni_netdev_t *dev);
 extern unsigned int	ni_netdev_put(ni_netdev_t *dev);
 extern void		ni_netdev_reset(ni_netdev_t *dev);
+extern ni_bool_t	ni_netdev_set_name(ni_netdev_t *, const char *);
+extern ni_bool_t	ni_netdev_refresh_name(ni_netdev_t *);
 extern int		ni_netdev_guess_type(ni_netdev_t *dev);
 
 extern int		ni_netdev_set_lease(ni_netdev_t *, ni_addrconf_lease_t *);
@@ -146,6 +146,7 @@ extern ni_netdev_t *		ni_objectmodel_unwrap_netif(const ni_dbus_object_t *, DBus
 extern ni_dbus_object_t *	ni_objectmodel_get_netif_object(ni_dbus_server_t *, const ni_netdev_t *);
 extern dbus_bool_t		ni_objectmodel_send_netif_event(ni_dbus_server_t *, ni_dbus_object_t *,
 					ni_event_t, const ni_uuid_t *);
+extern void			ni_objectmodel_netif_properties_changed(ni_dbus_server_t *, const ni_netdev_t *);
 extern dbus_bool_t		ni_objectmodel_addrconf_send_event(ni_netdev_t *, ni_event_t, ni_uuid_t *);
 extern void			ni_objectmodel_addrconf_fallback_action(ni_netdev_t *, ni_event_t,
 					unsigned int, ni_addrconf_lease_t *);
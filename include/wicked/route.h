@@ -91,6 +91,7 @@ struct ni_route_table {
 
 	unsigned int		tid;
 	ni_route_array_t	routes;
+	struct ni_route_index *	index;		/* private lookup index */
 };
 
 enum {
@@ -258,6 +259,8 @@ extern void			ni_route_array_sort_rev(ni_route_array_t *);
 extern ni_route_table_t *	ni_route_table_new(unsigned int);
 extern void			ni_route_table_free(ni_route_table_t *);
 extern void			ni_route_table_clear(ni_route_table_t *);
+extern unsigned int		ni_route_table_remove_stale(ni_route_table_t *, unsigned int,
+						ni_route_array_t *);
 
 extern void			ni_route_tables_copy(ni_route_table_t **, const ni_route_table_t *);
 extern ni_bool_t		ni_route_tables_add_route(ni_route_table_t **, ni_route_t *);
@@ -289,6 +292,7 @@ extern ni_bool_t		ni_rule_equal(const ni_rule_t *, const ni_rule_t *);
 extern ni_bool_t		ni_rule_equal_ref(const ni_rule_t *, const ni_rule_t *);
 extern ni_bool_t		ni_rule_equal_match(const ni_rule_t *, const ni_rule_t *);
 extern ni_bool_t		ni_rule_equal_action(const ni_rule_t *, const ni_rule_t *);
+extern unsigned int		ni_rule_hash(const ni_rule_t *);
 extern const char *		ni_rule_print(ni_stringbuf_t *, const ni_rule_t *);
 extern const char *		ni_rule_action_type_to_name(unsigned int);
 extern ni_bool_t		ni_rule_action_name_to_type(const char *, unsigned int *);
@@ -33,6 +33,7 @@ extern ni_socket_t *	ni_socket_wrap(int fd, int sotype);
 extern ni_bool_t	ni_socket_activate(ni_socket_t *);
 extern ni_bool_t	ni_socket_deactivate(ni_socket_t *);
 extern void		ni_socket_deactivate_all(void);
+extern void		ni_socket_update_timeout(ni_socket_t *);
 extern int		ni_socket_wait(ni_timeout_t timeout);
 
 extern void		ni_socket_close(ni_socket_t *);
@@ -32,6 +32,7 @@
 struct xml_document {
 	char *			dtd;
 	struct xml_node *	root;
+	struct xml_arena *	arena;
 };
 
 struct xml_document_array {
@@ -65,6 +66,13 @@ struct xml_node {
 	struct xml_node *	children;
 
 	xml_location_t *	location;
+
+	/* Set when the node, its name and cdata live in a document
+	 * arena; use the xml_node_set_* functions to modify them. */
+	struct xml_arena *	arena;
+
+	/* Lookup index of nodes with many children or attributes */
+	struct xml_node_index *	index;
 };
 
 typedef struct xml_node_array	xml_node_array_t;
@@ -86,6 +94,7 @@ extern int		xml_document_uuid(const xml_document_t *, unsigned int, const ni_uui
 extern const char *	xml_document_dtd(const xml_document_t *);
 
 extern xml_document_t *	xml_document_new();
+extern xml_document_t *	xml_document_new_arena(void);
 extern xml_node_t *	xml_document_root(xml_document_t *);
 extern void		xml_document_set_root(xml_document_t *, xml_node_t *);
 extern xml_node_t *	xml_document_take_root(xml_document_t *);
@@ -110,6 +119,7 @@ extern int		xml_node_content_uuid(const xml_node_t *, unsigned int, const ni_uui
 extern int		xml_node_print_fn(const xml_node_t *, void (*)(const char *, void *), void *);
 extern int		xml_node_print_debug(const xml_node_t *, unsigned int facility);
 extern xml_node_t *	xml_node_scan(FILE *fp, const char *location);
+extern void		xml_node_set_name(xml_node_t *, const char *);
 extern void		xml_node_set_cdata(xml_node_t *, const char *);
 extern void		xml_node_set_int(xml_node_t *, int);
 extern void		xml_node_set_int64(xml_node_t *, int64_t);
@@ -137,7 +147,7 @@ extern ni_bool_t	xml_node_delete_child(xml_node_t *, const char *);
 extern ni_bool_t	xml_node_delete_child_node(xml_node_t *, xml_node_t *);
 extern void		xml_node_detach(xml_node_t *);
 extern xml_node_t *	xml_node_find_parent(const xml_node_t *, const char *);
-extern void		xml_node_reparent(xml_node_t *parent, xml_node_t *child);
+extern xml_node_t *	xml_node_reparent(xml_node_t *parent, xml_node_t *child);
 extern void		xml_node_add_child(xml_node_t *, xml_node_t *);
 extern xml_node_t *	xml_node_get_next_named(xml_node_t *, const char *, xml_node_t *);
 
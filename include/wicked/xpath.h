@@ -60,10 +60,34 @@ typedef struct xpath_result {
 	xpath_node_t *		node;
 } xpath_result_t;
 
+/*
+ * Compiled (parsed) expression shared via the expression cache
+ */
+typedef struct xpath_compiled	xpath_compiled_t;
+
+typedef struct xpath_cache_stats {
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		evictions;
+	unsigned int		count;
+	unsigned int		limit;
+} xpath_cache_stats_t;
+
 extern xpath_enode_t *	xpath_expression_parse(const char *);
 extern void		xpath_expression_free(xpath_enode_t *);
 extern xpath_result_t *	xpath_expression_eval(const xpath_enode_t *, xml_node_t *);
 
+extern xpath_compiled_t *	xpath_compiled_get(const char *);
+extern xpath_compiled_t *	xpath_compiled_ref(xpath_compiled_t *);
+extern void			xpath_compiled_put(xpath_compiled_t *);
+extern const char *		xpath_compiled_expression(const xpath_compiled_t *);
+extern xpath_result_t *		xpath_compiled_eval(const xpath_compiled_t *, xml_node_t *);
+extern xpath_result_t *		xpath_expression_eval_cached(const char *, xml_node_t *);
+
+extern void			xpath_cache_get_stats(xpath_cache_stats_t *);
+extern void			xpath_cache_set_limit(unsigned int);
+extern void			xpath_cache_flush(void);
+
 extern xpath_format_t *	xpath_format_parse(const char *);
 extern int		xpath_format_eval(xpath_format_t *, xml_node_t *, ni_string_array_t *);
 extern void		xpath_format_free(xpath_format_t *);
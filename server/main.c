@@ -460,6 +460,7 @@ handle_interface_addr_events(ni_netdev_t *dev, ni_event_t event, const ni_addres
 	ni_addrconf_lease_t *lease, *next;
 
 	ni_server_trace_interface_addr_events(dev, event, ap);
+	ni_objectmodel_netif_properties_changed(dbus_server, dev);
 
 	if (ap->family != AF_INET6)
 		return;
@@ -496,6 +497,7 @@ static void
 handle_interface_prefix_events(ni_netdev_t *dev, ni_event_t event, const ni_ipv6_ra_pinfo_t *pi)
 {
 	ni_server_trace_interface_prefix_events(dev, event, pi);
+	ni_objectmodel_netif_properties_changed(dbus_server, dev);
 	ni_auto6_on_prefix_event(dev, event, pi);
 }
 
@@ -503,6 +505,7 @@ static void
 handle_interface_nduseropt_events(ni_netdev_t *dev, ni_event_t event)
 {
 	ni_server_trace_interface_nduseropt_events(dev, event);
+	ni_objectmodel_netif_properties_changed(dbus_server, dev);
 	ni_auto6_on_nduseropt_events(dev, event);
 }
 
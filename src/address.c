@@ -125,6 +125,7 @@ ni_address_copy(ni_address_t *dst, const ni_address_t *src)
 		dst->anycast_addr    = src->anycast_addr;
 		dst->cache_info = src->cache_info;
 		ni_string_dup(&dst->label, src->label);
+		return TRUE;
 	}
 	return FALSE;
 }
@@ -51,6 +51,7 @@ static ni_bool_t	ni_config_parse_objectmodel_firmware_discovery(ni_extension_t *
 static ni_bool_t	ni_config_parse_system_updater(ni_extension_t **, xml_node_t *);
 static ni_bool_t	ni_config_parse_sources(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_rtnl_event(ni_config_rtnl_event_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_fsm(ni_config_fsm_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_bonding(ni_config_bonding_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_teamd(ni_config_teamd_t *, const xml_node_t *);
 static const char *	ni_config_build_include(char *, size_t, const char *, const char *);
@@ -106,6 +107,9 @@ ni_config_new()
 	conf->rtnl_event.recv_buff_length = 1024 * 1024;
 	conf->rtnl_event.mesg_buff_length = 0;
 
+	conf->fsm.max_async_calls = NI_CONFIG_FSM_MAX_ASYNC_CALLS;
+	conf->fsm.refresh = NI_CONFIG_FSM_REFRESH_FULL;
+
 	/* we enable it explicitly in wickedd only */
 	conf->teamd.enabled = FALSE;
 
@@ -436,6 +440,10 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			if (!ni_config_parse_rtnl_event(&conf->rtnl_event, child))
 				goto failed;
 		} else
+		if (strcmp(child->name, "fsm") == 0) {
+			if (!ni_config_parse_fsm(&conf->fsm, child))
+				goto failed;
+		} else
 		if (strcmp(child->name, "bonding") == 0) {
 			if (!ni_config_parse_bonding(&conf->bonding, child))
 				goto failed;
@@ -2182,6 +2190,39 @@ ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 	return TRUE;
 }
 
+static const ni_intmap_t	config_fsm_refresh_names[] = {
+	{ "incremental",	NI_CONFIG_FSM_REFRESH_INCREMENTAL	},
+	{ "full",		NI_CONFIG_FSM_REFRESH_FULL		},
+	{ "check",		NI_CONFIG_FSM_REFRESH_CHECK		},
+	{ NULL,			-1U					}
+};
+
+ni_bool_t
+ni_config_parse_fsm(ni_config_fsm_t *conf, xml_node_t *node)
+{
+	xml_node_t *child;
+	unsigned int mode;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "max-async-calls")) {
+			if (ni_parse_uint(child->cdata, &conf->max_async_calls, 0))
+				return FALSE;
+		} else
+		if (ni_string_eq(child->name, "refresh")) {
+			if (ni_parse_uint_mapped(child->cdata, config_fsm_refresh_names, &mode)) {
+				ni_error("%s: invalid <fsm><refresh>%s</refresh></fsm> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->refresh = mode;
+		}
+	}
+	return TRUE;
+}
+
 /*
  * bonding support config options
  */
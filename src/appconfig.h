@@ -77,6 +77,22 @@ typedef struct ni_config_rtnl_event {
 	unsigned int	mesg_buff_length;
 } ni_config_rtnl_event_t;
 
+#define NI_CONFIG_FSM_MAX_ASYNC_CALLS	32
+
+typedef enum {
+	NI_CONFIG_FSM_REFRESH_FULL = 0,
+	NI_CONFIG_FSM_REFRESH_INCREMENTAL,
+	NI_CONFIG_FSM_REFRESH_CHECK,
+} ni_config_fsm_refresh_t;
+
+typedef struct ni_config_fsm {
+	/*
+	 * client fsm related tunables
+	 */
+	unsigned int	max_async_calls;
+	ni_config_fsm_refresh_t	refresh;
+} ni_config_fsm_t;
+
 typedef enum {
 	NI_CONFIG_BONDING_CTL_NETLINK = 0,
 	NI_CONFIG_BONDING_CTL_SYSFS,
@@ -217,6 +233,7 @@ typedef struct ni_config {
 	char *			dbus_type;
 
 	ni_config_rtnl_event_t	rtnl_event;
+	ni_config_fsm_t		fsm;
 
 	ni_config_bonding_t	bonding;
 	ni_config_teamd_t	teamd;
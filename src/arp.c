@@ -40,6 +40,7 @@ ni_arp_socket_open(const ni_capture_devinfo_t *dev_info, ni_arp_callback_t *call
 
 	memset(&prot_info, 0, sizeof(prot_info));
 	prot_info.eth_protocol = ETHERTYPE_ARP;
+	prot_info.ring = TRUE;
 
 	arph->capture = ni_capture_open(dev_info, &prot_info, ni_arp_socket_recv, "arp");
 	if (!arph->capture) {
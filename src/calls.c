@@ -22,6 +22,7 @@
 #include <wicked/dbus-service.h>
 
 #include "client/wicked-client.h"
+#include "util_priv.h"
 
 /*
  * Error context - this is an opaque type.
@@ -332,6 +333,30 @@ ni_call_device_new_xml(const ni_dbus_service_t *service,
 	return result;
 }
 
+/*
+ * Map the error of a failed device call to an error code, giving
+ * the error context handler a chance to fix it up.
+ */
+static int
+ni_call_device_method_error(const ni_dbus_service_t *service, const ni_dbus_method_t *method,
+				const DBusError *error, ni_call_error_context_t *error_ctx)
+{
+	int rv;
+
+	if (error_ctx && error_ctx->handler) {
+		rv = error_ctx->handler(error_ctx, error);
+		if (rv > 0) {
+			ni_warn("Whaaah. Error context handler returns positive code. "
+				"Assuming programmer mistake");
+			rv = -rv;
+		}
+	} else {
+		ni_dbus_print_error(error, "%s.%s() failed", service->name, method->name);
+		rv = ni_dbus_get_error(error, NULL);
+	}
+	return rv;
+}
+
 /*
  * Place a generic call to a device. This call will optionally return a
  * callback list.
@@ -351,18 +376,7 @@ ni_call_device_method_common(ni_dbus_object_t *object,
 				argc, argv,
 				1, &result,
 				&error)) {
-
-		if (error_ctx && error_ctx->handler) {
-			rv = error_ctx->handler(error_ctx, &error);
-			if (rv > 0) {
-				ni_warn("Whaaah. Error context handler returns positive code. "
-					"Assuming programmer mistake");
-				rv = -rv;
-			}
-		} else {
-			ni_dbus_print_error(&error, "%s.%s() failed", service->name, method->name);
-			rv = ni_dbus_get_error(&error, NULL);
-		}
+		rv = ni_call_device_method_error(service, method, &error, error_ctx);
 	} else {
 		if (callback_list)
 			*callback_list = ni_objectmodel_callback_info_from_dict(&result);
@@ -374,6 +388,28 @@ ni_call_device_method_common(ni_dbus_object_t *object,
 	return rv;
 }
 
+/*
+ * Query the xml schema whether the call expects an argument or not.
+ * All calls that end up here always take at most one argument, which
+ * would be a dict built from the xml node passed in by the caller.
+ */
+static int
+ni_call_common_xml_args(const ni_dbus_service_t *service, const ni_dbus_method_t *method,
+			xml_node_t *config, ni_dbus_variant_t *argv, int *argc)
+{
+	*argc = 0;
+	if (ni_dbus_xml_method_num_args(method)) {
+		ni_dbus_variant_t *dict = &argv[(*argc)++];
+
+		ni_dbus_variant_init_dict(dict);
+		if (config && !ni_dbus_xml_serialize_arg(method, 0, dict, config)) {
+			ni_error("%s.%s: error serializing argument", service->name, method->name);
+			return -NI_ERROR_CANNOT_MARSHAL;
+		}
+	}
+	return 0;
+}
+
 int
 ni_call_common_xml(ni_dbus_object_t *object, const ni_dbus_service_t *service, const ni_dbus_method_t *method,
 			xml_node_t *config, ni_objectmodel_callback_info_t **callback_list,
@@ -385,25 +421,11 @@ ni_call_common_xml(ni_dbus_object_t *object, const ni_dbus_service_t *service, c
 
 retry_operation:
 	memset(argv, 0, sizeof(argv));
-	argc = 0;
 
-	/* Query the xml schema whether the call expects an argument or not.
-	 * All calls that end up here always take at most one argument, which
-	 * would be a dict built from the xml node passed in by the caller. */
-	if (ni_dbus_xml_method_num_args(method)) {
-		ni_dbus_variant_t *dict = &argv[argc++];
+	rv = ni_call_common_xml_args(service, method, config, argv, &argc);
+	if (rv == 0)
+		rv = ni_call_device_method_common(object, service, method, argc, argv, callback_list, &error_context);
 
-		ni_dbus_variant_init_dict(dict);
-		if (config && !ni_dbus_xml_serialize_arg(method, 0, dict, config)) {
-			ni_error("%s.%s: error serializing argument", service->name, method->name);
-			rv = -NI_ERROR_CANNOT_MARSHAL;
-			goto out;
-		}
-	}
-
-	rv = ni_call_device_method_common(object, service, method, argc, argv, callback_list, &error_context);
-
-out:
 	while (argc--)
 		ni_dbus_variant_destroy(&argv[argc]);
 
@@ -424,6 +446,136 @@ out:
 	return rv;
 }
 
+/*
+ * Asynchronous variant of ni_call_common_xml: the result is passed to
+ * the callback once the reply arrived. As in ni_call_common_xml, the
+ * error context handler modifies the config of the caller to retry the
+ * call; a reference to it is held until the reply arrived. The object
+ * may be deleted meanwhile, so a retry looks it up again by its path.
+ */
+typedef struct ni_call_async {
+	ni_dbus_object_t *		root;
+	char *				path;
+	const ni_dbus_service_t *	service;
+	const ni_dbus_method_t *	method;
+	xml_node_t *			config;
+	ni_call_error_context_t		error_context;
+
+	ni_call_async_callback_t *	callback;
+	void *				user_data;
+} ni_call_async_t;
+
+static void
+ni_call_async_free(ni_call_async_t *call)
+{
+	ni_call_error_context_destroy(&call->error_context);
+	xml_node_free(call->config);
+	ni_string_free(&call->path);
+	free(call);
+}
+
+static void	ni_call_common_xml_async_reply(ni_dbus_object_t *, ni_dbus_message_t *, void *);
+
+static int
+ni_call_common_xml_async_send(ni_call_async_t *call)
+{
+	ni_dbus_object_t *object;
+	ni_dbus_variant_t argv[1];
+	int rv, argc;
+
+	if (!(object = ni_dbus_object_lookup(call->root, call->path))) {
+		ni_error("%s.%s: object %s does not exist any more",
+				call->service->name, call->method->name, call->path);
+		return -NI_ERROR_DEVICE_NOT_KNOWN;
+	}
+
+	memset(argv, 0, sizeof(argv));
+
+	rv = ni_call_common_xml_args(call->service, call->method,
+			call->error_context.config, argv, &argc);
+	if (rv == 0) {
+		rv = ni_dbus_object_call_variant_async(object,
+				call->service->name, call->method->name,
+				argc, argv, ni_call_common_xml_async_reply, call);
+	}
+
+	while (argc--)
+		ni_dbus_variant_destroy(&argv[argc]);
+	return rv;
+}
+
+static void
+ni_call_common_xml_async_reply(ni_dbus_object_t *object, ni_dbus_message_t *reply, void *user_data)
+{
+	ni_objectmodel_callback_info_t *callback_list = NULL;
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_call_async_t *call = user_data;
+	int rv;
+
+	if (reply && dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_METHOD_RETURN) {
+		if (ni_dbus_message_get_args_variants(reply, &result, 1) < 0) {
+			ni_error("%s.%s: unable to parse reply",
+					call->service->name, call->method->name);
+			rv = -NI_ERROR_CANNOT_MARSHAL;
+		} else {
+			callback_list = ni_objectmodel_callback_info_from_dict(&result);
+			rv = 0;
+		}
+	} else {
+		if (reply && dbus_message_get_type(reply) == DBUS_MESSAGE_TYPE_ERROR)
+			dbus_set_error_from_message(&error, reply);
+		else
+			dbus_set_error(&error, DBUS_ERROR_FAILED, "dbus: no reply");
+
+		rv = ni_call_device_method_error(call->service, call->method,
+				&error, &call->error_context);
+
+		/* see ni_call_common_xml */
+		if (rv == -NI_ERROR_RETRY_OPERATION && call->error_context.config) {
+			if ((rv = ni_call_common_xml_async_send(call)) == 0) {
+				dbus_error_free(&error);
+				return;
+			}
+		}
+	}
+
+	call->callback(rv, callback_list, call->user_data);
+
+	ni_dbus_variant_destroy(&result);
+	dbus_error_free(&error);
+	ni_call_async_free(call);
+}
+
+int
+ni_call_common_xml_async(ni_dbus_object_t *object, const ni_dbus_service_t *service,
+			const ni_dbus_method_t *method, xml_node_t *config,
+			ni_call_error_handler_t *error_handler,
+			ni_call_async_callback_t *callback, void *user_data)
+{
+	ni_call_async_t *call;
+	int rv;
+
+	if (!object || !service || !method || !callback)
+		return -NI_ERROR_INVALID_ARGS;
+
+	call = xcalloc(1, sizeof(*call));
+	for (call->root = object; call->root->parent; )
+		call->root = call->root->parent;
+	ni_string_dup(&call->path, object->path);
+	call->service = service;
+	call->method = method;
+	call->config = xml_node_clone_ref(config);
+	call->error_context.handler = error_handler;
+	call->error_context.config = call->config;
+	call->callback = callback;
+	call->user_data = user_data;
+
+	if ((rv = ni_call_common_xml_async_send(call)) < 0)
+		ni_call_async_free(call);
+	return rv;
+}
+
 static int
 ni_get_device_method(ni_dbus_object_t *object, const char *method_name, const ni_dbus_service_t **service_ret, const ni_dbus_method_t **method_ret)
 {
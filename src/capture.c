@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -46,6 +47,7 @@
 #include "socket_priv.h"
 #include "modprobe.h"
 #include "buffer.h"
+#include "hashmap_priv.h"
 
 #define MTU_MAX			1500
 #define DHCP_CLIENT_PORT	68
@@ -110,6 +112,59 @@ typedef union ni_packetaddr {
 	struct sockaddr_ll	sll;
 } ni_packetaddr_t;
 
+/*
+ * The optional TPACKET_V3 receive ring maps blocks of frames the
+ * kernel fills and retires as a whole to the user, who walks the
+ * frames in place and hands the block back once it is consumed.
+ * A ring of a shared socket covers the frames of all interfaces.
+ */
+#if defined(TPACKET3_HDRLEN)
+#define NI_CAPTURE_RING
+#endif
+#define NI_CAPTURE_RING_BLOCK_MIN	(1U << 14)	/* or the page size */
+#define NI_CAPTURE_RING_BLOCK_NR	4
+#define NI_CAPTURE_RING_SHARED_NR	32
+#define NI_CAPTURE_RING_FRAME_SIZE	(1U << 11)
+#define NI_CAPTURE_RING_RETIRE_MSEC	10
+
+typedef struct ni_capture_ring {
+	unsigned char *		map;
+	size_t			size;
+	unsigned int		block_size;
+	unsigned int		block_nr;
+
+	unsigned int		block;		/* current block */
+	unsigned int		left;		/* frames left in block */
+	unsigned char *		next;		/* next frame in block */
+} ni_capture_ring_t;
+
+/*
+ * Captures opened in shared mode receive via one packet socket per
+ * protocol filter bound to all interfaces, instead of via a socket
+ * with its own filter per device. The socket dispatches the frames
+ * to the captures by the sll_ifindex of the receiving interface.
+ */
+typedef struct ni_capture_shared	ni_capture_shared_t;
+
+struct ni_capture_shared {
+	ni_capture_shared_t *	next;
+	unsigned int		refcount;
+
+	ni_socket_t *		sock;
+	uint16_t		eth_protocol;
+	uint8_t			ip_protocol;
+	uint16_t		ip_port;
+
+	ni_capture_t *		users;
+	ni_hashmap_t		ifindex;
+
+	ni_capture_ring_t *	ring;
+	void *			buffer;
+	size_t			mtu;
+};
+
+static ni_capture_shared_t *	ni_capture_shared_list;
+
 /*
  * Platform specific
  */
@@ -118,6 +173,21 @@ struct ni_capture {
 	ni_packetaddr_t		addr;
 	int			protocol;
 
+	/* in shared mode, sock is used for the callbacks only */
+	ni_capture_shared_t *	shared;
+	ni_capture_t *		shared_next;
+	ni_capture_t **		shared_pprev;
+
+	/* frame of a ring or shared socket passed to receive */
+	ni_capture_ring_t *	ring;
+	void			(*receive)(ni_socket_t *);
+	struct {
+		void *			data;
+		ssize_t			bytes;
+		ni_bool_t		partial_csum;
+		ni_sockaddr_t		from;
+	} frame;
+
 	char *			ifname;
 
 	void *			buffer;
@@ -133,9 +203,16 @@ struct ni_capture {
 	char *			desc;
 };
 
-static int		ni_capture_set_filter(ni_capture_t *, const ni_capture_protinfo_t *);
+static int		ni_capture_set_filter(int, const char *, const char *,
+					const ni_capture_protinfo_t *);
 static ssize_t		ni_capture_send_buf(const ni_capture_t *, const ni_buffer_t *);
 
+static inline int
+ni_capture_fd(const ni_capture_t *capture)
+{
+	return capture->shared ? capture->shared->sock->__fd : capture->sock->__fd;
+}
+
 static uint32_t
 checksum_partial(uint32_t sum, const void *data, uint16_t len)
 {
@@ -325,10 +402,19 @@ ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
 /*
  * Timeout handling
  */
+static inline void
+ni_capture_update_timeout(ni_capture_t *capture)
+{
+	/* rearm the timer of the socket handling our timeouts */
+	ni_socket_update_timeout(capture->shared ?
+			capture->shared->sock : capture->sock);
+}
+
 void
 ni_capture_arm_retransmit(ni_capture_t *capture)
 {
 	ni_timeout_arm_sec(&capture->retrans.deadline, &capture->retrans.timeout);
+	ni_capture_update_timeout(capture);
 }
 
 void
@@ -336,6 +422,7 @@ ni_capture_disarm_retransmit(ni_capture_t *capture)
 {
 	/* Clear retransmit timer, buffer, and everything else */
 	memset(&capture->retrans, 0, sizeof(capture->retrans));
+	ni_capture_update_timeout(capture);
 }
 
 void
@@ -346,6 +433,7 @@ ni_capture_force_retransmit(ni_capture_t *capture, unsigned int delay)
 
 		ni_timer_get_time(deadline);
 		deadline->tv_sec += delay;
+		ni_capture_update_timeout(capture);
 	}
 }
 
@@ -466,6 +554,144 @@ ni_capture_recv_raw(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_s
 #endif
 }
 
+/*
+ * Receive ring handling
+ */
+static void
+ni_capture_ring_free(ni_capture_ring_t *ring)
+{
+	if (!ring)
+		return;
+	if (ring->map)
+		munmap(ring->map, ring->size);
+	free(ring);
+}
+
+static ni_capture_ring_t *
+ni_capture_ring_open(int fd, unsigned int block_nr)
+{
+#if defined(NI_CAPTURE_RING)
+	struct tpacket_req3 req;
+	ni_capture_ring_t *ring;
+	int version = TPACKET_V3;
+	long page_size;
+	void *map;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		ni_debug_socket("cannot use TPACKET_V3, receiving without ring: %m");
+		return NULL;
+	}
+
+	/* the block size has to be a multiple of the page size */
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = NI_CAPTURE_RING_BLOCK_MIN;
+	if ((page_size = sysconf(_SC_PAGESIZE)) > (long)req.tp_block_size)
+		req.tp_block_size = page_size;
+	req.tp_block_nr = block_nr;
+	req.tp_frame_size = NI_CAPTURE_RING_FRAME_SIZE;
+	req.tp_frame_nr = req.tp_block_size / req.tp_frame_size * req.tp_block_nr;
+	req.tp_retire_blk_tov = NI_CAPTURE_RING_RETIRE_MSEC;
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+		ni_debug_socket("cannot setup receive ring, receiving without: %m");
+		return NULL;
+	}
+
+	map = mmap(NULL, (size_t)req.tp_block_size * req.tp_block_nr,
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		ni_debug_socket("cannot map receive ring, receiving without: %m");
+		/* the socket does not receive without a mapped ring */
+		memset(&req, 0, sizeof(req));
+		setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req));
+		return NULL;
+	}
+
+	ring = xcalloc(1, sizeof(*ring));
+	ring->map = map;
+	ring->size = (size_t)req.tp_block_size * req.tp_block_nr;
+	ring->block_size = req.tp_block_size;
+	ring->block_nr = req.tp_block_nr;
+	return ring;
+#else
+	return NULL;
+#endif
+}
+
+/*
+ * Return the next frame in the ring: its data is valid until the
+ * next call, which hands the consumed block back to the kernel.
+ */
+static ssize_t
+ni_capture_ring_next(ni_capture_ring_t *ring, void **data, ni_bool_t *partial_csum,
+			ni_sockaddr_t *from)
+{
+#if defined(NI_CAPTURE_RING)
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *hdr;
+
+	for (;;) {
+		bd = (struct tpacket_block_desc *)(ring->map + ring->block * ring->block_size);
+		if (!ring->next) {
+			if (!(*(volatile __u32 *)&bd->hdr.bh1.block_status & TP_STATUS_USER)) {
+				errno = EAGAIN;
+				return -1;
+			}
+			__sync_synchronize();
+			ring->left = bd->hdr.bh1.num_pkts;
+			ring->next = (unsigned char *)bd + bd->hdr.bh1.offset_to_first_pkt;
+		}
+		if (ring->left)
+			break;
+
+		__sync_synchronize();
+		bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+		ring->block = (ring->block + 1) % ring->block_nr;
+		ring->next = NULL;
+	}
+
+	hdr = (struct tpacket3_hdr *)ring->next;
+	if (--ring->left)
+		ring->next += hdr->tp_next_offset;
+
+	*data = (unsigned char *)hdr + hdr->tp_net;
+	*partial_csum = !!(hdr->tp_status & TP_STATUS_CSUMNOTREADY);
+	if (from) {
+		memset(from, 0, sizeof(*from));
+		memcpy(&from->ss, (unsigned char *)hdr + TPACKET_ALIGN(sizeof(*hdr)),
+				sizeof(struct sockaddr_ll));
+	}
+	return hdr->tp_snaplen;
+#else
+	errno = EAGAIN;
+	return -1;
+#endif
+}
+
+/*
+ * Receive the next frame from the ring or the socket into the buffer
+ */
+static ssize_t
+ni_capture_recv_frame(int fd, ni_capture_ring_t *ring, void *buf, size_t len,
+			void **data, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+{
+	if (ring)
+		return ni_capture_ring_next(ring, data, partial_csum, from);
+
+	*data = buf;
+	return ni_capture_recv_raw(fd, buf, len, partial_csum, from);
+}
+
+static inline void
+ni_capture_frame_set(ni_capture_t *capture, void *data, ssize_t bytes,
+			ni_bool_t partial_csum, const ni_sockaddr_t *from)
+{
+	capture->frame.data = data;
+	capture->frame.bytes = bytes;
+	capture->frame.partial_csum = partial_csum;
+	capture->frame.from = *from;
+}
+
 ni_bool_t
 ni_capture_from_hwaddr_set(ni_hwaddr_t *hwaddr, const ni_sockaddr_t *from)
 {
@@ -493,18 +719,47 @@ ni_capture_from_hwaddr_print(const ni_sockaddr_t *from)
 	return ni_link_address_print(&hwaddr);
 }
 
+/*
+ * Take the frame the ring or shared socket passes to the capture
+ */
+static ssize_t
+ni_capture_frame_take(ni_capture_t *capture, void **buffer, ni_bool_t *partial_csum,
+			ni_sockaddr_t *from)
+{
+	ssize_t bytes;
+
+	if (!(*buffer = capture->frame.data)) {
+		errno = EAGAIN;
+		return -1;
+	}
+	capture->frame.data = NULL;
+
+	bytes = capture->frame.bytes;
+	*partial_csum = capture->frame.partial_csum;
+	if (from)
+		*from = capture->frame.from;
+	return (size_t)bytes > capture->mtu ? (ssize_t)capture->mtu : bytes;
+}
+
 int
 ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from)
 {
 	void *payload;
+	void *buffer;
 	size_t payload_len;
 	ssize_t bytes;
 	ni_bool_t partial_checksum = FALSE;
 	const char *lladdr;
 	const char *hint = capture->desc;
 
-	bytes = ni_capture_recv_raw(capture->sock->__fd, capture->buffer,
-				  capture->mtu, &partial_checksum, from);
+	if (capture->shared || capture->ring) {
+		bytes = ni_capture_frame_take(capture, &buffer,
+					&partial_checksum, from);
+	} else {
+		buffer = capture->buffer;
+		bytes = ni_capture_recv_raw(capture->sock->__fd, buffer,
+					capture->mtu, &partial_checksum, from);
+	}
 
 	if (bytes < 0) {
 		ni_error("%s: %s cannot read %s%spacket from socket: %m",
@@ -522,7 +777,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from)
 	switch (capture->protocol) {
 	case ETHERTYPE_IP:
 		/* Make sure IP and UDP header are sane */
-		payload = ni_capture_inspect_udp_header(capture->buffer, bytes,
+		payload = ni_capture_inspect_udp_header(buffer, bytes,
 						&payload_len, partial_checksum);
 		if (payload == NULL) {
 			ni_debug_socket("%s: bad IP/UDP %s%spacket header",
@@ -534,7 +789,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from)
 
 	case ETHERTYPE_ARP:
 	case ETHERTYPE_LLDP:
-		payload = capture->buffer;
+		payload = buffer;
 		payload_len = bytes;
 		break;
 
@@ -569,7 +824,7 @@ ni_capture_get_user_data(const ni_capture_t *capture)
 int
 ni_capture_is_valid(const ni_capture_t *capture, int protocol)
 {
-	ni_socket_t *sock = capture->sock;
+	ni_socket_t *sock = capture->shared ? capture->shared->sock : capture->sock;
 
 	return (sock && !sock->error && capture->protocol == protocol);
 }
@@ -675,11 +930,306 @@ ni_capture_init_once(void)
 	ni_modprobe(AFPACKET_MODULE_NAME, AFPACKET_MODULE_OPTS);
 }
 
+/*
+ * Open a packet socket with the protocol filter, bound to the interface
+ * or with ifindex 0 to all interfaces
+ */
+static int
+ni_capture_open_socket(const ni_capture_protinfo_t *protinfo, int ifindex,
+			const char *ifname, const char *desc,
+			ni_capture_ring_t **ring, unsigned int block_nr)
+{
+	ni_packetaddr_t	addr;
+	int fd;
+
+	if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
+		ni_error("socket: %m");
+		return -1;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	if (ni_capture_set_filter(fd, ifname, desc, protinfo) < 0)
+		goto failed;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sll.sll_family = PF_PACKET;
+	addr.sll.sll_protocol = htons(protinfo->eth_protocol);
+	addr.sll.sll_ifindex = ifindex;
+
+	if (bind(fd, &addr.sa, sizeof(addr)) == -1) {
+		ni_error("bind: %m");
+		goto failed;
+	}
+
+	ni_capture_enable_packet_auxdata(fd);
+
+	/* the ring provides the auxdata in the frame headers */
+	*ring = protinfo->ring ? ni_capture_ring_open(fd, block_nr) : NULL;
+	return fd;
+
+failed:
+	close(fd);
+	return -1;
+}
+
+/*
+ * Shared capture socket handling
+ */
+static inline void
+ni_capture_shared_hold(ni_capture_shared_t *shared)
+{
+	shared->refcount++;
+}
+
+static void
+ni_capture_shared_release(ni_capture_shared_t *shared)
+{
+	ni_capture_shared_t **pos;
+
+	ni_assert(shared->refcount);
+	if (--shared->refcount)
+		return;
+
+	for (pos = &ni_capture_shared_list; *pos; pos = &(*pos)->next) {
+		if (*pos == shared) {
+			*pos = shared->next;
+			break;
+		}
+	}
+
+	shared->sock->user_data = NULL;
+	ni_capture_ring_free(shared->ring);
+	ni_socket_close(shared->sock);
+	ni_hashmap_destroy(&shared->ifindex);
+	free(shared->buffer);
+	free(shared);
+}
+
+/*
+ * The callbacks of a capture may free any capture, up to the shared
+ * socket: collect the callback sockets of the captures to call held
+ * and skip the ones freed meanwhile, with user_data reset to NULL.
+ */
+static void
+ni_capture_shared_collect(ni_socket_array_t *array, ni_capture_t *capture)
+{
+	if (ni_socket_array_append(array, capture->sock))
+		ni_socket_hold(capture->sock);
+}
+
+static void
+ni_capture_shared_dispatch(ni_capture_shared_t *shared, void *data, ssize_t bytes,
+			ni_bool_t partial_csum, const ni_sockaddr_t *from)
+{
+	ni_socket_array_t users = NI_SOCKET_ARRAY_INIT;
+	ni_hashmap_entry_t *he;
+	ni_capture_t *capture;
+	unsigned int i;
+	int ifindex;
+
+	ifindex = ((const struct sockaddr_ll *)&from->ss)->sll_ifindex;
+	ni_hashmap_foreach(&shared->ifindex, ni_hashmap_hash_uint(ifindex), he) {
+		capture = he->item;
+		if (capture->addr.sll.sll_ifindex == ifindex && capture->sock->receive)
+			ni_capture_shared_collect(&users, capture);
+	}
+
+	for (i = 0; i < users.count; ++i) {
+		if (!(capture = users.data[i]->user_data))
+			continue;
+
+		ni_capture_frame_set(capture, data, bytes, partial_csum, from);
+		capture->sock->receive(capture->sock);
+		capture = users.data[i]->user_data;
+		if (capture)
+			capture->frame.data = NULL;
+	}
+	ni_socket_array_destroy(&users);
+}
+
+static void
+ni_capture_shared_receive(ni_socket_t *sock)
+{
+	ni_capture_shared_t *shared = sock->user_data;
+	ni_bool_t partial_csum = FALSE;
+	ni_sockaddr_t from;
+	ssize_t bytes;
+	void *data;
+
+	if (!shared)
+		return;
+
+	bytes = ni_capture_recv_frame(sock->__fd, shared->ring, shared->buffer,
+				shared->mtu, &data, &partial_csum, &from);
+	if (bytes < 0) {
+		if (errno != EAGAIN)
+			ni_error("%s: cannot read packet from shared socket: %m", __func__);
+		return;
+	}
+
+	/* consume a ring in blocks, the socket a frame per wakeup */
+	ni_capture_shared_hold(shared);
+	do {
+		ni_capture_shared_dispatch(shared, data, bytes, partial_csum, &from);
+	} while (shared->ring && (bytes = ni_capture_ring_next(shared->ring,
+					&data, &partial_csum, &from)) >= 0);
+	ni_capture_shared_release(shared);
+}
+
+static int
+ni_capture_shared_get_timeout(const ni_socket_t *sock, struct timeval *tv)
+{
+	const ni_capture_shared_t *shared = sock->user_data;
+	const ni_capture_t *capture;
+
+	timerclear(tv);
+	if (!shared)
+		return -1;
+
+	for (capture = shared->users; capture; capture = capture->shared_next) {
+		if (!timerisset(&capture->retrans.deadline))
+			continue;
+		if (!timerisset(tv) || timercmp(&capture->retrans.deadline, tv, <))
+			*tv = capture->retrans.deadline;
+	}
+	return timerisset(tv)? 0 : -1;
+}
+
+static void
+ni_capture_shared_check_timeout(ni_socket_t *sock, const struct timeval *now)
+{
+	ni_socket_array_t expired = NI_SOCKET_ARRAY_INIT;
+	ni_capture_shared_t *shared = sock->user_data;
+	ni_capture_t *capture;
+	unsigned int i;
+
+	if (!shared)
+		return;
+
+	for (capture = shared->users; capture; capture = capture->shared_next) {
+		if (timerisset(&capture->retrans.deadline) &&
+		    timercmp(&capture->retrans.deadline, now, <))
+			ni_capture_shared_collect(&expired, capture);
+	}
+
+	for (i = 0; i < expired.count; ++i) {
+		if ((capture = expired.data[i]->user_data))
+			ni_capture_retransmit(capture);
+	}
+	ni_socket_array_destroy(&expired);
+}
+
+static ni_capture_shared_t *
+ni_capture_shared_get(const ni_capture_protinfo_t *protinfo, const char *ifname, const char *desc)
+{
+	ni_capture_shared_t *shared;
+	int fd;
+
+	for (shared = ni_capture_shared_list; shared; shared = shared->next) {
+		if (shared->eth_protocol == protinfo->eth_protocol &&
+		    shared->ip_protocol == protinfo->ip_protocol &&
+		    shared->ip_port == protinfo->ip_port &&
+		    !shared->sock->error)
+			return shared;
+	}
+
+	shared = xcalloc(1, sizeof(*shared));
+	if ((fd = ni_capture_open_socket(protinfo, 0, ifname, desc, &shared->ring,
+					NI_CAPTURE_RING_SHARED_NR)) < 0) {
+		free(shared);
+		return NULL;
+	}
+
+	shared->eth_protocol = protinfo->eth_protocol;
+	shared->ip_protocol = protinfo->ip_protocol;
+	shared->ip_port = protinfo->ip_port;
+	ni_hashmap_init(&shared->ifindex);
+
+	shared->sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	shared->sock->receive = ni_capture_shared_receive;
+	shared->sock->get_timeout = ni_capture_shared_get_timeout;
+	shared->sock->check_timeout = ni_capture_shared_check_timeout;
+	shared->sock->user_data = shared;
+	ni_socket_activate(shared->sock);
+
+	shared->next = ni_capture_shared_list;
+	ni_capture_shared_list = shared;
+
+	ni_debug_socket("opened shared %s%scapture socket %d%s",
+			desc ?: "", desc ? " " : "", fd,
+			shared->ring ? " with receive ring" : "");
+	return shared;
+}
+
+static void
+ni_capture_shared_join(ni_capture_shared_t *shared, ni_capture_t *capture)
+{
+	ni_capture_shared_hold(shared);
+	capture->shared = shared;
+
+	if ((capture->shared_next = shared->users))
+		shared->users->shared_pprev = &capture->shared_next;
+	capture->shared_pprev = &shared->users;
+	shared->users = capture;
+
+	ni_hashmap_insert(&shared->ifindex,
+			ni_hashmap_hash_uint(capture->addr.sll.sll_ifindex), capture);
+
+	/* the frames of all interfaces are received into one buffer */
+	if (capture->mtu > shared->mtu) {
+		shared->buffer = xrealloc(shared->buffer, capture->mtu);
+		shared->mtu = capture->mtu;
+	}
+}
+
+static void
+ni_capture_shared_leave(ni_capture_t *capture)
+{
+	ni_capture_shared_t *shared = capture->shared;
+
+	if ((*capture->shared_pprev = capture->shared_next))
+		capture->shared_next->shared_pprev = capture->shared_pprev;
+	capture->shared_next = NULL;
+	capture->shared_pprev = NULL;
+
+	ni_hashmap_remove(&shared->ifindex,
+			ni_hashmap_hash_uint(capture->addr.sll.sll_ifindex), capture);
+
+	capture->shared = NULL;
+	ni_capture_shared_release(shared);
+}
+
+/*
+ * Pass the frames of a ring to the receive callback, until the ring is
+ * consumed or the callback frees the capture and with it the ring.
+ */
+static void
+ni_capture_ring_receive(ni_socket_t *sock)
+{
+	ni_bool_t partial_csum = FALSE;
+	ni_capture_t *capture;
+	ni_sockaddr_t from;
+	ssize_t bytes;
+	void *data;
+
+	ni_socket_hold(sock);
+	while ((capture = sock->user_data) &&
+	       (bytes = ni_capture_ring_next(capture->ring, &data,
+					&partial_csum, &from)) >= 0) {
+		ni_capture_frame_set(capture, data, bytes, partial_csum, &from);
+		capture->receive(sock);
+		if ((capture = sock->user_data))
+			capture->frame.data = NULL;
+	}
+	ni_socket_release(sock);
+}
+
 ni_capture_t *
 ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo,
 		void (*receive)(ni_socket_t *), const char* desc)
 {
-	ni_packetaddr_t	addr;
+	ni_capture_shared_t *shared = NULL;
+	ni_capture_ring_t *ring = NULL;
 	ni_capture_t *capture = NULL;
 	ni_hwaddr_t destaddr;
 	int fd = -1;
@@ -704,15 +1254,17 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 
 	ni_capture_init_once();
 
-	if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
-		ni_error("socket: %m");
-		return NULL;
+	if (protinfo->shared) {
+		if (!(shared = ni_capture_shared_get(protinfo, devinfo->ifname, desc)))
+			return NULL;
+	} else {
+		fd = ni_capture_open_socket(protinfo, devinfo->ifindex, devinfo->ifname,
+					desc, &ring, NI_CAPTURE_RING_BLOCK_NR);
+		if (fd < 0)
+			return NULL;
 	}
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
 
-	capture = calloc(1, sizeof(*capture));
-	if (!capture)
-		goto failed;
+	capture = xcalloc(1, sizeof(*capture));
 	ni_string_dup(&capture->ifname, devinfo->ifname);
 	capture->sock = ni_socket_wrap(fd, SOCK_DGRAM);
 	capture->protocol = protinfo->eth_protocol;
@@ -724,43 +1276,34 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	capture->addr.sll.sll_halen = destaddr.len;
 	memcpy(&capture->addr.sll.sll_addr, destaddr.data, destaddr.len);
 
-	if (ni_capture_set_filter(capture, protinfo) < 0)
-		goto failed;
-
-	memset(&addr, 0, sizeof(addr));
-	addr.sll.sll_family = PF_PACKET;
-	addr.sll.sll_protocol = htons(protinfo->eth_protocol);
-	addr.sll.sll_ifindex = devinfo->ifindex;
-
-	if (bind(fd, &addr.sa, sizeof(addr)) == -1) {
-		ni_error("bind: %m");
-		goto failed;
-	}
-
-	ni_capture_enable_packet_auxdata(fd);
-
 	capture->mtu = devinfo->mtu;
 	if (capture->mtu == 0)
 		capture->mtu = MTU_MAX;
-	capture->buffer = xmalloc(capture->mtu);
 
 	capture->sock->receive = receive;
-	capture->sock->get_timeout = ni_capture_socket_get_timeout;
-	capture->sock->check_timeout = ni_capture_socket_check_timeout;
 	capture->sock->user_data = capture;
 	ni_string_dup(&capture->desc, desc);
-	ni_socket_activate(capture->sock);
-	return capture;
 
-failed:
-	ni_capture_free(capture);
-	if (fd >= 0)
-		close(fd);
-	return NULL;
+	if (shared) {
+		/* receives and timeouts are handled by the shared socket */
+		ni_capture_shared_join(shared, capture);
+	} else {
+		if ((capture->ring = ring)) {
+			capture->receive = receive;
+			capture->sock->receive = ni_capture_ring_receive;
+		} else {
+			capture->buffer = xmalloc(capture->mtu);
+		}
+		capture->sock->get_timeout = ni_capture_socket_get_timeout;
+		capture->sock->check_timeout = ni_capture_socket_check_timeout;
+		ni_socket_activate(capture->sock);
+	}
+	return capture;
 }
 
 static int
-ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
+ni_capture_set_filter(int fd, const char *ifname, const char *desc,
+			const ni_capture_protinfo_t *protinfo)
 {
 	struct sock_fprog pf;
 
@@ -778,7 +1321,7 @@ ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 	case ETHERTYPE_IP:
 		if (protinfo->ip_protocol != IPPROTO_UDP && protinfo->ip_protocol != IPPROTO_TCP) {
 			ni_error("%s: %s%scannot build capture filter for IP proto %d, port %d: not supported",
-					cap->ifname, cap->desc ?: "", cap->desc ? " " : "",
+					ifname, desc ?: "", desc ? " " : "",
 					protinfo->ip_protocol, protinfo->ip_port);
 			return -1;
 		}
@@ -792,13 +1335,13 @@ ni_capture_set_filter(ni_capture_t *cap, const ni_capture_protinfo_t *protinfo)
 
 	default:
 		ni_error("%s: %s%scannot build capture filter for ether type 0x%04x: not supported",
-				cap->ifname, cap->desc ?: "", cap->desc ? " " : "",
+				ifname, desc ?: "", desc ? " " : "",
 				protinfo->eth_protocol);
 		return -1;
 	}
 
-	if (setsockopt(cap->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
-		ni_error("%s: %s%sSO_ATTACH_FILTER: %m", cap->ifname, cap->desc ?: "", cap->desc ? " " : "");
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
+		ni_error("%s: %s%sSO_ATTACH_FILTER: %m", ifname, desc ?: "", desc ? " " : "");
 		return -1;
 	}
 
@@ -815,7 +1358,7 @@ ni_capture_send_buf(const ni_capture_t *capture, const ni_buffer_t *buf)
 		return -1;
 	}
 
-	rv = sendto(capture->sock->__fd, ni_buffer_head(buf), ni_buffer_count(buf), 0,
+	rv = sendto(ni_capture_fd(capture), ni_buffer_head(buf), ni_buffer_count(buf), 0,
 			&capture->addr.sa, sizeof(capture->addr));
 	if (rv < 0)
 		ni_error("%s: unable to send %s%spacket: %m", capture->ifname,
@@ -845,8 +1388,13 @@ ni_capture_free(ni_capture_t *capture)
 {
 	if (!capture)
 		return;
-	if (capture->sock)
+	if (capture->sock) {
+		capture->sock->user_data = NULL;
+		ni_capture_ring_free(capture->ring);
 		ni_socket_close(capture->sock);
+	}
+	if (capture->shared)
+		ni_capture_shared_leave(capture);
 	if (capture->buffer)
 		free(capture->buffer);
 	ni_string_free(&capture->ifname);
@@ -596,7 +596,7 @@ ni_client_state_set_persistent(xml_node_t *config)
 		return FALSE;
 
 	if (!persistent)
-		ni_string_dup(&pernode->cdata, ni_format_boolean(TRUE));
+		xml_node_set_cdata(pernode, ni_format_boolean(TRUE));
 
 	return TRUE;
 }
@@ -287,7 +287,7 @@ ni_convert_cfg_into_policy_node(const xml_node_t *ifcfg, xml_node_t *match, cons
 	 * TODO: ahm... add action parameter to this function.
 	 */
 	node = xml_node_clone(ifcfg, ifpolicy);
-	ni_string_dup(&node->name, NI_NANNY_IFPOLICY_MERGE);
+	xml_node_set_name(node, NI_NANNY_IFPOLICY_MERGE);
 
 	ni_var_array_destroy(&ifpolicy->attrs);
 	xml_node_add_attr(ifpolicy, NI_NANNY_IFPOLICY_NAME, name);
@@ -511,7 +511,7 @@ ni_ifconfig_migrate_wireless_node(xml_node_t *config, xml_node_t *wireless)
 		return modified;
 
 	while ((network = xml_node_get_child(wireless, "network"))) {
-		xml_node_reparent(networks, network);
+		network = xml_node_reparent(networks, network);
 		ni_ifconfig_migrate_wireless_network(network);
 		modified = TRUE;
 	}
@@ -463,13 +463,54 @@ ni_dbus_object_call_async(ni_dbus_object_t *proxy,
 	} else {
 		rv = ni_dbus_connection_call_async(client->connection,
 			call, client->call_timeout,
-			callback, proxy);
+			callback, proxy, NULL);
 		dbus_message_unref(call);
 	}
 
 	return rv;
 }
 
+/*
+ * Asynchronous call with variant arguments; the callback gets the
+ * reply message, which is either a method return or an error.
+ */
+int
+ni_dbus_object_call_variant_async(ni_dbus_object_t *proxy,
+			const char *interface_name, const char *method,
+			unsigned int nargs, const ni_dbus_variant_t *args,
+			ni_dbus_async_callback_t *callback, void *user_data)
+{
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_message_t *call = NULL;
+	ni_dbus_client_t *client;
+	int rv;
+
+	if (!proxy || !interface_name || !method || !callback ||
+	    !(client = ni_dbus_object_get_client(proxy)))
+		return -NI_ERROR_INVALID_ARGS;
+
+	ni_debug_dbus("%s(%s.%s, %s)", __func__, interface_name, method, proxy->path);
+	call = dbus_message_new_method_call(client->bus_name, proxy->path, interface_name, method);
+	if (call == NULL) {
+		ni_error("%s: unable to build %s() message", __func__, method);
+		return -NI_ERROR_DBUS_CALL_FAILED;
+	}
+
+	if (nargs && !ni_dbus_message_serialize_variants(call, nargs, args, &error)) {
+		ni_dbus_print_error(&error, "%s: unable to serialize %s() arguments",
+				__func__, method);
+		dbus_error_free(&error);
+		rv = -NI_ERROR_CANNOT_MARSHAL;
+	} else {
+		rv = ni_dbus_connection_call_async(client->connection,
+				call, client->call_timeout,
+				callback, proxy, user_data);
+	}
+
+	dbus_message_unref(call);
+	return rv;
+}
+
 /*
  * Use ObjectManager.GetManagedObjects to retrieve (part of)
  * the server's object hierarchy
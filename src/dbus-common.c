@@ -13,8 +13,22 @@
 #include "socket_priv.h"
 #include "dbus-common.h"
 #include "dbus-dict.h"
+#include "hashmap_priv.h"
 #include "debug.h"
 
+/*
+ * Dicts with at least this many entries get a key hash index
+ * on the first lookup; smaller ones are scanned.
+ */
+#define NI_DBUS_DICT_INDEX_MIN	16
+
+struct ni_dbus_dict_index {
+	unsigned int		len;	/* number of entries indexed */
+	ni_hashmap_t		map;	/* key hash -> entry position + 1 */
+};
+
+static void			ni_dbus_dict_index_free(ni_dbus_variant_t *);
+
 int
 ni_dbus_translate_error(const DBusError *err, const ni_intmap_t *error_map)
 {
@@ -825,6 +839,7 @@ ni_dbus_variant_destroy(ni_dbus_variant_t *var)
 
 	if (var->__message)
 		dbus_message_unref(var->__message);
+	ni_dbus_dict_index_free(var);
 
 	memset(var, 0, sizeof(*var));
 	var->type = DBUS_TYPE_INVALID;
@@ -1394,15 +1409,89 @@ ni_dbus_dict_add_byte_array(ni_dbus_variant_t *dict, const char *key,
 	return TRUE;
 }
 
+static void
+ni_dbus_dict_index_free(ni_dbus_variant_t *dict)
+{
+	struct ni_dbus_dict_index *index;
+
+	if ((index = dict->__index) != NULL) {
+		dict->__index = NULL;
+		ni_hashmap_destroy(&index->map);
+		free(index);
+	}
+}
+
+/*
+ * Return the key index of a large dict, indexing the entries added
+ * since the last lookup. Entries are only ever appended to the array,
+ * a delete drops the index.
+ */
+static struct ni_dbus_dict_index *
+ni_dbus_dict_index(ni_dbus_variant_t *dict)
+{
+	struct ni_dbus_dict_index *index = dict->__index;
+	ni_dbus_dict_entry_t *entry;
+
+	if (index && index->len > dict->array.len)
+		ni_dbus_dict_index_free(dict);
+
+	if (!(index = dict->__index)) {
+		if (dict->array.len < NI_DBUS_DICT_INDEX_MIN)
+			return NULL;
+
+		index = xcalloc(1, sizeof(*index));
+		ni_hashmap_init(&index->map);
+		dict->__index = index;
+	}
+
+	for ( ; index->len < dict->array.len; index->len++) {
+		entry = &dict->dict_array_value[index->len];
+		if (entry->key)
+			ni_hashmap_insert(&index->map, ni_hashmap_hash_string(entry->key),
+					(void *)(uintptr_t)(index->len + 1));
+	}
+	return index;
+}
+
+/*
+ * Find the first entry with the given key using the index
+ */
+static ni_dbus_dict_entry_t *
+ni_dbus_dict_index_find(const ni_dbus_variant_t *dict, const struct ni_dbus_dict_index *index,
+			const char *key)
+{
+	ni_dbus_dict_entry_t *entry;
+	ni_hashmap_entry_t *he;
+	uintptr_t pos, first = 0;
+
+	ni_hashmap_foreach(&index->map, ni_hashmap_hash_string(key), he) {
+		pos = (uintptr_t)he->item;
+		if (first && pos > first)
+			continue;
+
+		entry = &dict->dict_array_value[pos - 1];
+		if (entry->key && !strcmp(entry->key, key))
+			first = pos;
+	}
+	return first ? &dict->dict_array_value[first - 1] : NULL;
+}
+
 ni_dbus_variant_t *
 ni_dbus_dict_get(const ni_dbus_variant_t *dict, const char *key)
 {
+	const struct ni_dbus_dict_index *index;
 	ni_dbus_dict_entry_t *entry;
 	unsigned int i;
 
-	if (!ni_dbus_variant_is_dict(dict))
+	if (!ni_dbus_variant_is_dict(dict) || !key)
 		return NULL;
 
+	/* the index is a lookup cache and does not change the dict */
+	if ((index = ni_dbus_dict_index((ni_dbus_variant_t *)dict)) != NULL) {
+		entry = ni_dbus_dict_index_find(dict, index, key);
+		return entry ? &entry->datum : NULL;
+	}
+
 	for (i = 0; i < dict->array.len; ++i) {
 		entry = &dict->dict_array_value[i];
 		if (entry->key && !strcmp(entry->key, key))
@@ -1438,6 +1527,9 @@ ni_dbus_dict_get_next(const ni_dbus_variant_t *dict, const char *key, const ni_d
 	if (!ni_dbus_variant_is_dict(dict))
 		return FALSE;
 
+	if (previous == NULL && key != NULL)
+		return ni_dbus_dict_get(dict, key);
+
 	if (previous != NULL) {
 		dbus_bool_t found = FALSE;
 
@@ -1588,6 +1680,7 @@ ni_dbus_dict_delete_entry(ni_dbus_variant_t *dict, const char *key)
 	for (i = 0; i < dict->array.len; ++i, ++entry) {
 		if (entry->key && !strcmp(entry->key, key)) {
 			ni_dbus_variant_destroy(&entry->datum);
+			ni_dbus_dict_index_free(dict);
 			dict->array.len--;
 
 			/* Shift down all entries */
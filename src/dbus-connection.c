@@ -28,6 +28,7 @@ struct ni_dbus_async_client_call {
 	DBusPendingCall *	call;
 	ni_dbus_async_callback_t *callback;
 	ni_dbus_object_t *	proxy;
+	void *			user_data;
 };
 
 typedef struct ni_dbus_async_server_call ni_dbus_async_server_call_t;
@@ -260,7 +261,7 @@ static void
 ni_dbus_connection_add_pending(ni_dbus_connection_t *connection,
 			DBusPendingCall *call,
 			ni_dbus_async_callback_t *callback,
-			ni_dbus_object_t *proxy)
+			ni_dbus_object_t *proxy, void *user_data)
 {
 	ni_dbus_async_client_call_t *async;
 
@@ -268,6 +269,7 @@ ni_dbus_connection_add_pending(ni_dbus_connection_t *connection,
 	async->proxy = proxy;
 	async->call = call;
 	async->callback = callback;
+	async->user_data = user_data;
 
 	async->next = connection->async_client_calls;
 	connection->async_client_calls = async;
@@ -290,7 +292,7 @@ __ni_dbus_process_pending(ni_dbus_connection_t *dbc, DBusPendingCall *call)
 	for (pos = &dbc->async_client_calls; (async = *pos) != NULL; pos = &async->next) {
 		if (async->call == call) {
 			*pos = async->next;
-			async->callback(async->proxy, msg);
+			async->callback(async->proxy, msg, async->user_data);
 			__ni_dbus_async_client_call_free(async);
 			rv = 1;
 			break;
@@ -362,7 +364,8 @@ ni_dbus_connection_call(ni_dbus_connection_t *connection,
 int
 ni_dbus_connection_call_async(ni_dbus_connection_t *connection,
 			ni_dbus_message_t *call, unsigned int timeout,
-			ni_dbus_async_callback_t *callback, ni_dbus_object_t *proxy)
+			ni_dbus_async_callback_t *callback, ni_dbus_object_t *proxy,
+			void *user_data)
 {
 	DBusPendingCall *pending;
 
@@ -375,7 +378,7 @@ ni_dbus_connection_call_async(ni_dbus_connection_t *connection,
 		return -NI_ERROR_DBUS_CALL_FAILED;
 	}
 
-	ni_dbus_connection_add_pending(connection, pending, callback, proxy);
+	ni_dbus_connection_add_pending(connection, pending, callback, proxy, user_data);
 	dbus_pending_call_set_notify(pending, __ni_dbus_notify_async, connection, NULL);
 
 	return 0;
@@ -456,8 +459,9 @@ ni_dbus_add_signal_handler(ni_dbus_connection_t *connection,
 	ni_dbus_sigaction_t *sigact;
 	char specbuf[1024], *arg;
 
+	/* the object path matches the objects below it as well */
 	if (sender && object_path && object_interface) {
-		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',path='%s',interface='%s'",
+		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',path_namespace='%s',interface='%s'",
 			sender, object_path, object_interface);
 	} else if (sender && object_interface) {
 		snprintf(specbuf, sizeof(specbuf), "type='signal',sender='%s',interface='%s'",
@@ -771,7 +775,7 @@ restart:
 		__ni_put_dbus_watch_data(wd);
 	}
 
-	sock->poll_flags = poll_flags;
+	ni_socket_set_poll_flags(sock, poll_flags);
 	if (!found)
 		ni_warn("%s: dead socket", func);
 }
@@ -7,6 +7,8 @@
 #include "config.h"
 #endif
 
+#include <stddef.h>
+
 #include <wicked/util.h>
 #include <wicked/logging.h>
 #include <wicked/dbus-errors.h>
@@ -15,8 +17,18 @@
 #include "dbus-object.h"
 #include "dbus-dict.h"
 #include "util_priv.h"
+#include "hashmap_priv.h"
 #include "debug.h"
 
+/*
+ * The children of an object, hashed by their relative name,
+ * and the last child to append new ones in list order.
+ */
+struct ni_dbus_object_children {
+	ni_hashmap_t		names;
+	ni_dbus_object_t *	tail;
+};
+
 static ni_dbus_object_t *	__ni_dbus_objects_trashcan;
 
 static dbus_bool_t		__ni_dbus_object_get_one_property(const ni_dbus_object_t *object,
@@ -54,23 +66,66 @@ ni_dbus_object_new(const ni_dbus_class_t *class, const char *path, void *handle)
 	return object;
 }
 
+static void
+__ni_dbus_object_link_child(ni_dbus_object_t *parent, ni_dbus_object_t *child)
+{
+	struct ni_dbus_object_children *index;
+
+	if (!(index = parent->child_index)) {
+		index = xcalloc(1, sizeof(*index));
+		ni_hashmap_init(&index->names);
+		parent->child_index = index;
+	}
+
+	child->parent = parent;
+	__ni_dbus_object_insert(index->tail ? &index->tail->next : &parent->children, child);
+	ni_hashmap_insert(&index->names, ni_hashmap_hash_string(child->name), child);
+	index->tail = child;
+}
+
+static void
+__ni_dbus_object_unlink_child(ni_dbus_object_t *child)
+{
+	ni_dbus_object_t *parent = child->parent;
+	struct ni_dbus_object_children *index;
+
+	if (parent && child->pprev && (index = parent->child_index)) {
+		if (index->tail == child) {
+			if (child->pprev == &parent->children)
+				index->tail = NULL;
+			else
+				index->tail = (ni_dbus_object_t *)((char *)child->pprev -
+						offsetof(ni_dbus_object_t, next));
+		}
+		ni_hashmap_remove(&index->names, ni_hashmap_hash_string(child->name), child);
+	}
+	__ni_dbus_object_unlink(child);
+}
+
+static void
+__ni_dbus_object_free_children_index(ni_dbus_object_t *object)
+{
+	struct ni_dbus_object_children *index;
+
+	if ((index = object->child_index) != NULL) {
+		object->child_index = NULL;
+		ni_hashmap_destroy(&index->names);
+		free(index);
+	}
+}
+
 static ni_dbus_object_t *
 __ni_dbus_object_new_child(ni_dbus_object_t *parent, const ni_dbus_class_t *object_class, const char *name,
 				void *object_handle)
 {
-	ni_dbus_object_t **pos, *child;
-
-	/* Find the tail of the children list */
-	for (pos = &parent->children; (child = *pos) != NULL; pos = &child->next)
-		;
+	ni_dbus_object_t *child;
 
 	child = __ni_dbus_object_new(object_class, __ni_dbus_object_child_path(parent, name));
 	if (!child)
 		return NULL;
 
-	child->parent = parent;
-	__ni_dbus_object_insert(pos, child);
 	ni_string_dup(&child->name, name);
+	__ni_dbus_object_link_child(parent, child);
 	if (parent->server_object)
 		__ni_dbus_server_object_inherit(child, parent);
 	if (parent->client_object)
@@ -105,7 +160,7 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 {
 	ni_dbus_object_t *child;
 
-	__ni_dbus_object_unlink(object);
+	__ni_dbus_object_unlink_child(object);
 	object->parent = NULL;
 
 	if (object->server_object)
@@ -115,6 +170,7 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 
 	while ((child = object->children) != NULL)
 		__ni_dbus_object_free(child);
+	__ni_dbus_object_free_children_index(object);
 
 	if (object->handle && object->class && object->class->destroy)
 		object->class->destroy(object);
@@ -136,7 +192,7 @@ ni_dbus_object_free(ni_dbus_object_t *object)
 	if (object->pprev) {
 		ni_debug_dbus("%s: deferring deletion of active object %s",
 				__FUNCTION__, object->path);
-		__ni_dbus_object_unlink(object);
+		__ni_dbus_object_unlink_child(object);
 		object->parent = NULL;
 		__ni_dbus_object_insert(&__ni_dbus_objects_trashcan, object);
 	} else {
@@ -177,12 +233,17 @@ ni_dbus_object_translate_error(ni_dbus_object_t *obj, const DBusError *error)
 static ni_dbus_object_t *
 __ni_dbus_object_get_child(ni_dbus_object_t *parent, const char *name)
 {
+	ni_hashmap_entry_t *he;
 	ni_dbus_object_t *child;
 
 	if (*name == '\0')
 		return parent;
 
-	for (child = parent->children; child; child = child->next) {
+	if (!parent->child_index)
+		return NULL;
+
+	ni_hashmap_foreach(&parent->child_index->names, ni_hashmap_hash_string(name), he) {
+		child = he->item;
 		if (!strcmp(child->name, name))
 			return child;
 	}
@@ -502,6 +563,7 @@ ni_dbus_object_register_service(ni_dbus_object_t *object, const ni_dbus_service_
 	object->interfaces = realloc(object->interfaces, (count + 2) * sizeof(svc));
 	object->interfaces[count++] = svc;
 	object->interfaces[count] = NULL;
+	ni_dbus_object_invalidate_properties(object);
 
 	if (svc->properties)
 		ni_dbus_object_register_property_interface(object);
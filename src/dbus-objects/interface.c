@@ -1201,6 +1201,21 @@ ni_objectmodel_netif_set_client_state_scripts(ni_dbus_object_t *object, const ni
 	return TRUE;
 }
 
+/*
+ * Announce a netdev change that is not broadcast as an interface event,
+ * e.g. address, prefix and ndp user option updates, using a properties
+ * changed signal. It invalidates the cached object properties and lets
+ * the clients refresh the object.
+ */
+void
+ni_objectmodel_netif_properties_changed(ni_dbus_server_t *server, const ni_netdev_t *dev)
+{
+	ni_dbus_object_t *object;
+
+	if ((object = ni_objectmodel_get_netif_object(server, dev)))
+		ni_dbus_server_send_properties_changed(server, object);
+}
+
 /*
  * Broadcast an interface event
  * The optional uuid argument helps the client match e.g. notifications
@@ -1246,6 +1261,9 @@ __ni_objectmodel_device_event(ni_dbus_server_t *server, ni_dbus_object_t *object
 		argc++;
 	}
 
+	/* the event receivers refresh the object, e.g. the link state */
+	ni_dbus_object_invalidate_properties(object);
+
 	ni_debug_dbus("sending device event \"%s\" for %s; uuid=<%s>", signal_name,
 			ni_dbus_object_get_path(object), uuid ? ni_uuid_print(uuid) : "");
 	ni_dbus_server_send_signal(server, object, interface, signal_name, argc, &arg);
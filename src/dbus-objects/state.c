@@ -80,7 +80,7 @@ ni_objectmodel_save_state(const char *filename)
 
 	ni_debug_objectmodel("saving server state to %s", filename);
 
-	doc = xml_document_new();
+	doc = xml_document_new_arena();
 	if (!ni_objectmodel_save_state_xml(doc->root, __ni_objectmodel_server))
 		goto done;
 
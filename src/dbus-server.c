@@ -11,6 +11,7 @@
 #include <wicked/logging.h>
 #include <wicked/dbus-service.h>
 #include <wicked/dbus-errors.h>
+#include <wicked/time.h>
 #include "dbus-server.h"
 #include "dbus-object.h"
 #include "dbus-dict.h"
@@ -18,8 +19,34 @@
 #include "util_priv.h"
 
 
+/*
+ * Serialized interface/property dicts of an object are cached for
+ * GetManagedObjects. A cached dict is reused until the object is
+ * invalidated, the server epoch changes (any method call that may
+ * modify state) or it is older than the cache TTL.
+ *
+ * The netif objects are invalidated on every device event (link
+ * state and flags) and on address, prefix and nduseropt updates.
+ * Up to the TTL stale may be:
+ *   - time relative values such as address lifetimes,
+ *   - routes, wickedd does not listen to route events; they change
+ *     on a device refresh or an rtnetlink resync without an event.
+ * Routing rules are not part of any object, so the lack of rule
+ * events does not cause stale properties.
+ */
+#define NI_DBUS_SERVER_PROPERTY_CACHE_TTL	1000	/* msec */
+
+typedef struct ni_dbus_property_cache {
+	ni_bool_t		valid;
+	unsigned int		epoch;
+	struct timeval		stamp;
+	ni_dbus_variant_t	dict;
+} ni_dbus_property_cache_t;
+
 struct ni_dbus_server_object {
 	ni_dbus_server_t *	server;			/* back pointer at server */
+	ni_dbus_property_cache_t properties;		/* GetManagedObjects cache */
+	ni_bool_t		announced;		/* signaled since last read */
 };
 
 static const ni_dbus_class_t	dbus_root_object_class = {
@@ -29,12 +56,14 @@ static const ni_dbus_class_t	dbus_root_object_class = {
 struct ni_dbus_server {
 	ni_dbus_connection_t *	connection;
 	ni_dbus_object_t *	root_object;
+	unsigned int		properties_epoch;
 };
 
 static dbus_bool_t		ni_dbus_object_register_object_manager(ni_dbus_object_t *);
 static dbus_bool_t		ni_dbus_object_register_introspectable_interface(ni_dbus_object_t *);
 static const char *		__ni_dbus_server_root_path(const char *);
 static void			__ni_dbus_server_object_init(ni_dbus_object_t *object, ni_dbus_server_t *server);
+static void			__ni_dbus_property_cache_destroy(ni_dbus_property_cache_t *);
 
 /*
  * Constructor for DBus server handle
@@ -129,6 +158,11 @@ ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 	DBusMessage *msg = NULL;
 	dbus_bool_t rv = FALSE;
 
+	/* signals announce object changes */
+	ni_dbus_object_invalidate_properties(object);
+	if (object->server_object)
+		object->server_object->announced = TRUE;
+
 	if (interface) {
 		if (!(svc = ni_dbus_object_get_service(object, interface)))
 			ni_warn("%s: unknown interface %s", __func__, interface);
@@ -166,6 +200,61 @@ out:
 	return rv;
 }
 
+/*
+ * Send a PropertiesChanged signal invalidating all properties of
+ * the service, as we don't track which of them changed.
+ */
+static dbus_bool_t
+__ni_dbus_server_send_properties_invalidated(ni_dbus_server_t *server, ni_dbus_object_t *object,
+				const ni_dbus_service_t *service)
+{
+	const ni_dbus_property_t *property;
+	ni_dbus_variant_t args[3];
+	dbus_bool_t rv;
+
+	if (!service->properties || !service->properties->name)
+		return TRUE;
+
+	memset(args, 0, sizeof(args));
+	ni_dbus_variant_set_string(&args[0], service->name);
+	ni_dbus_variant_init_dict(&args[1]);
+	ni_dbus_variant_init_string_array(&args[2]);
+	for (property = service->properties; property->name; ++property)
+		ni_dbus_variant_append_string_array(&args[2], property->name);
+
+	rv = ni_dbus_server_send_signal(server, object, NI_DBUS_INTERFACE ".Properties",
+					"PropertiesChanged", 3, args);
+
+	ni_dbus_variant_destroy(&args[0]);
+	ni_dbus_variant_destroy(&args[1]);
+	ni_dbus_variant_destroy(&args[2]);
+	return rv;
+}
+
+/*
+ * Announce a change of the object properties using PropertiesChanged
+ * signals invalidating the properties of each of its interfaces, so
+ * clients re-read the object. Changes after the signals are coalesced
+ * until a client read the object properties.
+ */
+dbus_bool_t
+ni_dbus_server_send_properties_changed(ni_dbus_server_t *server, ni_dbus_object_t *object)
+{
+	const ni_dbus_service_t *service, **pos;
+	dbus_bool_t rv = TRUE;
+
+	if (!object || !object->server_object)
+		return FALSE;
+
+	ni_dbus_object_invalidate_properties(object);
+	if (object->server_object->announced)
+		return TRUE;
+
+	for (pos = object->interfaces; rv && pos && (service = *pos); ++pos)
+		rv = __ni_dbus_server_send_properties_invalidated(server, object, service);
+	return rv;
+}
+
 /*
  * When creating an object as a child of a server side object, inherit
  * its server handle.
@@ -189,6 +278,7 @@ __ni_dbus_server_object_destroy(ni_dbus_object_t *object)
 		ni_dbus_connection_unregister_object(server->connection, object);
 
 	if (object->server_object) {
+		__ni_dbus_property_cache_destroy(&object->server_object->properties);
 		free(object->server_object);
 		object->server_object = NULL;
 	}
@@ -217,7 +307,9 @@ static const ni_dbus_service_t __ni_dbus_object_manager_interface;
 static const ni_dbus_service_t __ni_dbus_object_properties_interface;
 static const ni_dbus_service_t __ni_dbus_object_introspectable_interface;
 static dbus_bool_t		__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *,
-					ni_dbus_variant_t *dict, DBusError *);
+					ni_dbus_variant_t *dict, const struct timeval *,
+					DBusError *);
+static void			__ni_dbus_object_manager_release_objects(ni_dbus_variant_t *);
 
 dbus_bool_t
 ni_dbus_object_register_object_manager(ni_dbus_object_t *object)
@@ -265,15 +357,17 @@ __ni_dbus_object_manager_get_managed_objects(ni_dbus_object_t *object,
 		DBusError *error)
 {
 	ni_dbus_variant_t obj_dict = NI_DBUS_VARIANT_INIT;
+	struct timeval now;
 	int rv = TRUE;
 
 	NI_TRACE_ENTER_ARGS("path=%s, method=%s", object->path, method->name);
 
+	ni_timer_get_time(&now);
 	ni_dbus_variant_init_dict(&obj_dict);
-	rv = __ni_dbus_object_manager_enumerate_object(object, &obj_dict, error);
+	rv = __ni_dbus_object_manager_enumerate_object(object, &obj_dict, &now, error);
 	if (rv)
 		rv = ni_dbus_message_serialize_variants(reply, 1, &obj_dict, error);
-	ni_dbus_variant_destroy(&obj_dict);
+	__ni_dbus_object_manager_release_objects(&obj_dict);
 
 	return rv;
 }
@@ -473,9 +567,15 @@ static ni_dbus_method_t	__ni_dbus_object_properties_methods[] = {
 	{ NULL }
 };
 
+static ni_dbus_method_t	__ni_dbus_object_properties_signals[] = {
+	{ "PropertiesChanged",	"sa{sv}as",	.handler = NULL },
+	{ NULL }
+};
+
 static const ni_dbus_service_t __ni_dbus_object_properties_interface = {
 	.name = NI_DBUS_INTERFACE ".Properties",
 	.methods = __ni_dbus_object_properties_methods,
+	.signals = __ni_dbus_object_properties_signals,
 };
 
 static dbus_bool_t
@@ -505,24 +605,102 @@ static const ni_dbus_service_t __ni_dbus_object_introspectable_interface = {
 	.methods = __ni_dbus_object_introspectable_methods,
 };
 
-dbus_bool_t
-__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_variant_t *obj_dict, DBusError *error)
+/*
+ * GetManagedObjects property cache
+ */
+static void
+__ni_dbus_property_cache_destroy(ni_dbus_property_cache_t *cache)
+{
+	ni_dbus_variant_destroy(&cache->dict);
+	cache->valid = FALSE;
+}
+
+static ni_bool_t
+__ni_dbus_property_cache_valid(const ni_dbus_property_cache_t *cache,
+		const ni_dbus_server_t *server, const struct timeval *now)
+{
+	if (!cache->valid || cache->epoch != server->properties_epoch)
+		return FALSE;
+
+	return ni_timeout_since(&cache->stamp, now, NULL) < NI_DBUS_SERVER_PROPERTY_CACHE_TTL;
+}
+
+static dbus_bool_t
+__ni_dbus_property_cache_update(ni_dbus_property_cache_t *cache, ni_dbus_object_t *object,
+		const ni_dbus_server_t *server, const struct timeval *now, DBusError *error)
 {
+	const ni_dbus_service_t *service;
+	unsigned int i;
+
+	ni_dbus_variant_init_dict(&cache->dict);
+	cache->valid = FALSE;
+
+	for (i = 0; (service = object->interfaces[i]) != NULL; ++i) {
+		ni_dbus_variant_t *propdict = ni_dbus_dict_add(&cache->dict, service->name);
+
+		ni_dbus_variant_init_dict(propdict);
+		if (!ni_dbus_object_get_properties_as_dict(object, service, propdict, error)) {
+			__ni_dbus_property_cache_destroy(cache);
+			return FALSE;
+		}
+	}
+
+	cache->epoch = server->properties_epoch;
+	cache->stamp = *now;
+	cache->valid = TRUE;
+	return TRUE;
+}
+
+/*
+ * Mark the cached properties of an object as stale, e.g. because the
+ * underlying C object changed without a method call on the object.
+ */
+void
+ni_dbus_object_invalidate_properties(ni_dbus_object_t *object)
+{
+	if (object && object->server_object)
+		object->server_object->properties.valid = FALSE;
+}
+
+/*
+ * Mark the cached properties of all objects as stale
+ */
+void
+ni_dbus_server_invalidate_properties(ni_dbus_server_t *server)
+{
+	if (server)
+		server->properties_epoch++;
+}
+
+/*
+ * Add the interface dicts of an object and its children to obj_dict.
+ * The dict entries borrow the cached dicts of the server objects and
+ * have to be released using __ni_dbus_object_manager_release_objects.
+ */
+static dbus_bool_t
+__ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_variant_t *obj_dict,
+		const struct timeval *now, DBusError *error)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
 	ni_dbus_object_t *child;
 	int rv = TRUE;
 
 	if (object->interfaces) {
-		ni_dbus_variant_t *ifdict = ni_dbus_dict_add(obj_dict, object->path);
-		const ni_dbus_service_t *service;
-		unsigned int i;
-
-		ni_dbus_variant_init_dict(ifdict);
-		for (i = 0; rv && (service = object->interfaces[i]) != NULL; ++i) {
-			ni_dbus_variant_t *propdict = ni_dbus_dict_add(ifdict, service->name);
+		ni_dbus_variant_t *ifdict;
 
-			ni_dbus_variant_init_dict(propdict);
-			rv = ni_dbus_object_get_properties_as_dict(object, service, propdict, error);
+		if (sob == NULL) {
+			dbus_set_error(error, DBUS_ERROR_FAILED,
+					"Object %s is not a server object", object->path);
+			return FALSE;
 		}
+
+		if (!__ni_dbus_property_cache_valid(&sob->properties, sob->server, now)
+		 && !__ni_dbus_property_cache_update(&sob->properties, object, sob->server, now, error))
+			return FALSE;
+
+		ifdict = ni_dbus_dict_add(obj_dict, object->path);
+		*ifdict = sob->properties.dict;
+		sob->announced = FALSE;
 	}
 
 	for (child = object->children; child && rv; child = child->next) {
@@ -537,12 +715,23 @@ __ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_vari
 			continue;
 		}
 
-		rv = __ni_dbus_object_manager_enumerate_object(child, obj_dict, error);
+		rv = __ni_dbus_object_manager_enumerate_object(child, obj_dict, now, error);
 	}
 
 	return rv;
 }
 
+static void
+__ni_dbus_object_manager_release_objects(ni_dbus_variant_t *obj_dict)
+{
+	unsigned int i;
+
+	/* the entries are owned by the object property caches */
+	for (i = 0; i < obj_dict->array.len; ++i)
+		memset(&obj_dict->dict_array_value[i].datum, 0, sizeof(ni_dbus_variant_t));
+	ni_dbus_variant_destroy(obj_dict);
+}
+
 /*
  * Object callbacks from dbus dispatcher
  */
@@ -565,6 +754,19 @@ __ni_dbus_object_unregister(DBusConnection *conn, void *user_data)
 	}
 }
 
+static ni_bool_t
+__ni_dbus_server_method_is_readonly(const ni_dbus_service_t *svc, const ni_dbus_method_t *method)
+{
+	if (svc == &__ni_dbus_object_manager_interface
+	 || svc == &__ni_dbus_object_introspectable_interface)
+		return TRUE;
+
+	if (svc == &__ni_dbus_object_properties_interface)
+		return method && method->handler != __ni_dbus_object_properties_set;
+
+	return FALSE;
+}
+
 static DBusHandlerResult
 __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_data)
 {
@@ -576,6 +778,7 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 	DBusMessage *reply = NULL;
 	const ni_dbus_service_t *svc;
 	ni_dbus_server_t *server;
+	char *object_path = NULL;
 	dbus_bool_t rv = FALSE;
 
 	/* Clean out deceased objects */
@@ -596,6 +799,9 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 	}
 
 	server = ni_dbus_object_get_server(object);
+	if (svc == &__ni_dbus_object_properties_interface && object->server_object)
+		object->server_object->announced = FALSE;
+	ni_string_dup(&object_path, object->path);
 
 	method = ni_dbus_service_get_method(svc, method_name);
 	if (method == NULL
@@ -686,6 +892,14 @@ __ni_dbus_object_message(DBusConnection *conn, DBusMessage *call, void *user_dat
 		}
 	}
 
+	/* Any but the read-only standard methods may change object state,
+	 * possibly of other objects as well (e.g. ports of a bridge). */
+	if (!__ni_dbus_server_method_is_readonly(svc, method)) {
+		ni_dbus_server_invalidate_properties(server);
+		if ((object = ni_dbus_object_lookup(server->root_object, object_path)))
+			ni_dbus_server_send_properties_changed(server, object);
+	}
+
 	if (!rv) {
 error_reply:
 		if (reply)
@@ -700,6 +914,7 @@ error_reply:
 		ni_error("unable to send reply (out of memory)");
 
 	dbus_error_free(&error);
+	ni_string_free(&object_path);
 	if (reply)
 		dbus_message_unref(reply);
 
@@ -786,6 +786,7 @@ ni_dbus_deserialize_xml_scalar(const ni_dbus_variant_t *var, const ni_xs_type_t
 		const ni_intmap_t *bits = scalar_info->constraint.bitmask->bits;
 		ni_string_array_t bit_name_arr = NI_STRING_ARRAY_INIT;
 		unsigned long value = 0;
+		char *names = NULL;
 
 		if (!ni_dbus_variant_get_ulong(var, &value))
 			return FALSE;
@@ -803,8 +804,10 @@ ni_dbus_deserialize_xml_scalar(const ni_dbus_variant_t *var, const ni_xs_type_t
 			ni_string_array_append(&bit_name_arr, num);
 		}
 
-		ni_string_join(&node->cdata, &bit_name_arr, " | ");
+		if (ni_string_join(&names, &bit_name_arr, " | "))
+			xml_node_set_cdata(node, names);
 		ni_string_array_destroy(&bit_name_arr);
+		ni_string_free(&names);
 		return TRUE;
 	}
 
@@ -813,6 +816,7 @@ ni_dbus_deserialize_xml_scalar(const ni_dbus_variant_t *var, const ni_xs_type_t
 		ni_string_array_t bit_name_arr = NI_STRING_ARRAY_INIT;
 		unsigned long value = 0;
 		unsigned int bb;
+		char *names = NULL;
 
 		if (!ni_dbus_variant_get_ulong(var, &value))
 			return FALSE;
@@ -829,10 +833,13 @@ ni_dbus_deserialize_xml_scalar(const ni_dbus_variant_t *var, const ni_xs_type_t
 				ni_warn("unable to represent bit%u in <%s>", bb, node->name);
 		}
 
-		if (!ni_string_join(&node->cdata, &bit_name_arr, ", "))
+		if (ni_string_join(&names, &bit_name_arr, ", "))
+			xml_node_set_cdata(node, names);
+		else
 			ni_debug_dbus("Empty bit names string obtained.");
 
 		ni_string_array_destroy(&bit_name_arr);
+		ni_string_free(&names);
 
 		return TRUE;
 	}
@@ -1815,19 +1822,13 @@ int
 ni_dbus_xml_expand_element_reference(xml_node_t *doc_node, const char *expr_string,
 			xml_node_t **ret_nodes, unsigned int max_nodes)
 {
-	xpath_enode_t *expression;
 	xpath_result_t *result;
 	unsigned int i, nret;
 
 	if (xml_node_is_empty(doc_node))
 		return 0;
 
-	expression = xpath_expression_parse(expr_string);
-	if (expression == NULL)
-		return -NI_ERROR_DOCUMENT_ERROR;
-
-	result = xpath_expression_eval(expression, doc_node);
-	xpath_expression_free(expression);
+	result = xpath_expression_eval_cached(expr_string, doc_node);
 
 	if (result == NULL)
 		return -NI_ERROR_DOCUMENT_ERROR;
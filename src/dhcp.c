@@ -1395,6 +1395,7 @@ ni_dhcp_option_scalar_to_xml(const ni_dhcp_option_t *opt, const ni_dhcp_option_d
 {
 	const ni_dhcp_option_type_t *type;
 	xml_node_t *node = NULL;
+	char *str = NULL;
 
 	if (!decl || !(type = decl->type))
 		goto failure;
@@ -1402,11 +1403,14 @@ ni_dhcp_option_scalar_to_xml(const ni_dhcp_option_t *opt, const ni_dhcp_option_d
 	if (!(node = xml_node_new(decl->name, parent)))
 		goto failure;
 
-	if (!type->opt_to_str(decl, buf, &node->cdata))
+	if (!type->opt_to_str(decl, buf, &str))
 		goto failure;
 
+	xml_node_set_cdata(node, str);
+	ni_string_free(&str);
 	return node;
 failure:
+	ni_string_free(&str);
 	xml_node_free(node);
 	return NULL;
 }
@@ -96,6 +96,8 @@ ni_dhcp4_socket_open(ni_dhcp4_device_t *dev)
 	prot_info.eth_protocol = ETHERTYPE_IP;
 	prot_info.ip_protocol = IPPROTO_UDP;
 	prot_info.ip_port = DHCP4_CLIENT_PORT;
+	prot_info.shared = TRUE;
+	prot_info.ring = TRUE;
 
 	if ((capture = dev->capture) != NULL) {
 		if (ni_capture_is_valid(capture, ETHERTYPE_IP))
@@ -34,6 +34,7 @@
 #include <wicked/util.h>
 #include <wicked/vlan.h>
 #include <wicked/ipv6.h>
+#include <wicked/socket.h>
 
 #include "dhcp6/dhcp6.h"
 #include "dhcp6/device.h"
@@ -799,6 +800,14 @@ ni_dhcp6_device_transmit_arm_delay(ni_dhcp6_device_t *dev)
 	return TRUE;
 }
 
+static inline void
+ni_dhcp6_device_retransmit_update(ni_dhcp6_device_t *dev)
+{
+	/* rearm the socket timer checking the retransmit deadline */
+	if (dev->mcast.sock)
+		ni_socket_update_timeout(dev->mcast.sock);
+}
+
 static void
 ni_dhcp6_device_retransmit_arm(ni_dhcp6_device_t *dev)
 {
@@ -849,6 +858,7 @@ ni_dhcp6_device_retransmit_arm(ni_dhcp6_device_t *dev)
 							&dev->retrans.params.jitter);
 	ni_timer_get_time(&dev->retrans.deadline);
 	ni_timeval_add_timeout(&dev->retrans.deadline, dev->retrans.params.timeout);
+	ni_dhcp6_device_retransmit_update(dev);
 	ni_debug_dhcp("%s: initialized xid 0x%06x retransmission timeout of %u.%03u [%.3f .. %.3f] sec",
 			dev->ifname, dev->dhcp6.xid,
 			NI_TIMEOUT_SEC(dev->retrans.params.timeout),
@@ -890,6 +900,7 @@ ni_dhcp6_device_retransmit_disarm(ni_dhcp6_device_t *dev)
 
 	dev->dhcp6.xid = 0;
 	memset(&dev->retrans, 0, sizeof(dev->retrans));
+	ni_dhcp6_device_retransmit_update(dev);
 }
 
 static ni_bool_t
@@ -919,6 +930,7 @@ ni_dhcp6_device_retransmit_advance(ni_dhcp6_device_t *dev)
 						&dev->retrans.params.jitter);
 		ni_timer_get_time(&dev->retrans.deadline);
 		ni_timeval_add_timeout(&dev->retrans.deadline, dev->retrans.params.timeout);
+		ni_dhcp6_device_retransmit_update(dev);
 
 		ni_debug_dhcp("%s: advanced xid 0x%06x retransmission timeout from %u.%03u to %u.%03u [%.3f .. %.3f] sec",
 				dev->ifname, dev->dhcp6.xid,
@@ -30,8 +30,10 @@
 
 #include "dbus-objects/model.h"
 #include "client/ifconfig.h"
+#include "dbus-common.h"
 #include "appconfig.h"
 #include "util_priv.h"
+#include "hashmap_priv.h"
 
 static ni_fsm_user_prompt_fn_t *ni_fsm_user_prompt_fn;
 static void *			ni_fsm_user_prompt_data;
@@ -69,6 +71,14 @@ static inline void		ni_ifworker_update_client_state_config(ni_ifworker_t *w);
 static void			ni_ifworker_update_client_state_scripts(ni_ifworker_t *w);
 static void			ni_fsm_events_destroy(ni_fsm_event_t **);
 static void			ni_fsm_process_event(ni_fsm_t *, ni_fsm_event_t *);
+static void			ni_ifworker_cancel_async_call(ni_ifworker_t *);
+static struct ni_fsm_worker_index *ni_fsm_worker_index_new(void);
+static void			ni_fsm_worker_index_free(struct ni_fsm_worker_index *);
+static struct ni_fsm_worker_index *ni_fsm_worker_index(const ni_fsm_t *);
+static void			ni_fsm_worker_index_insert(struct ni_fsm_worker_index *, ni_ifworker_t *);
+static void			ni_fsm_worker_index_update(ni_fsm_t *, ni_ifworker_t *);
+static void			ni_fsm_worker_index_remove(ni_fsm_t *, ni_ifworker_t *);
+static void			ni_fsm_refresh_clear_changed(ni_fsm_t *);
 
 
 ni_fsm_t *
@@ -78,6 +88,20 @@ ni_fsm_new(void)
 
 	fsm = calloc(1, sizeof(*fsm));
 	fsm->readonly = FALSE;
+	fsm->worker_index = ni_fsm_worker_index_new();
+	fsm->async.max = ni_global.config ? ni_global.config->fsm.max_async_calls :
+					NI_CONFIG_FSM_MAX_ASYNC_CALLS;
+	switch (ni_global.config ? ni_global.config->fsm.refresh :
+					NI_CONFIG_FSM_REFRESH_FULL) {
+	case NI_CONFIG_FSM_REFRESH_CHECK:
+		fsm->refresh.check = TRUE;
+		/* fall through */
+	case NI_CONFIG_FSM_REFRESH_INCREMENTAL:
+		fsm->refresh.incremental = TRUE;
+		break;
+	default:
+		break;
+	}
 
 	ni_fsm_user_prompt_fn = ni_fsm_user_prompt_default;
 	return fsm;
@@ -86,9 +110,16 @@ ni_fsm_new(void)
 void
 ni_fsm_free(ni_fsm_t *fsm)
 {
+	unsigned int i;
+
+	for (i = 0; i < fsm->workers.count; ++i)
+		ni_ifworker_cancel_async_call(fsm->workers.data[i]);
+
 	ni_fsm_events_destroy(&fsm->events);
 	ni_ifworker_array_destroy(&fsm->pending);
 	ni_ifworker_array_destroy(&fsm->workers);
+	ni_fsm_worker_index_free(fsm->worker_index);
+	ni_fsm_refresh_clear_changed(fsm);
 	free(fsm);
 }
 
@@ -178,10 +209,20 @@ ni_fsm_events_unblock(ni_fsm_t *fsm)
 void
 ni_fsm_process_events(ni_fsm_t *fsm)
 {
-	ni_fsm_event_t *ev;
+	ni_fsm_event_t *ev, *deferred = NULL;
+	ni_ifworker_t *w;
 
 	while ((ev = fsm->events)) {
 		fsm->events = ev->next;
+		ev->next = NULL;
+
+		/* a worker waiting for the reply to its async call did not
+		 * register the callbacks of the call yet; keep its events */
+		w = ni_fsm_ifworker_by_object_path(fsm, ev->object_path);
+		if (w && w->fsm.call) {
+			ni_fsm_events_append(&deferred, ev);
+			continue;
+		}
 
 		ni_fsm_events_block(fsm);
 		ni_fsm_process_event(fsm, ev);
@@ -189,6 +230,7 @@ ni_fsm_process_events(ni_fsm_t *fsm)
 
 		ni_fsm_event_free(ev);
 	}
+	ni_fsm_events_append(&fsm->events, deferred);
 }
 
 /*
@@ -243,13 +285,28 @@ ni_ifworker_new(ni_ifworker_array_t *array, ni_ifworker_type_t type, const char
 		return NULL;
 }
 
+/*
+ * Append a new worker to the fsm workers and index it
+ */
+static ni_ifworker_t *
+ni_fsm_worker_new(ni_fsm_t *fsm, ni_ifworker_type_t type, const char *name)
+{
+	struct ni_fsm_worker_index *index;
+	ni_ifworker_t *w;
+
+	if ((w = ni_ifworker_new(&fsm->workers, type, name)) &&
+	    (index = ni_fsm_worker_index(fsm)))
+		ni_fsm_worker_index_insert(index, w);
+	return w;
+}
+
 ni_ifworker_t *
 ni_fsm_ifworker_new(ni_fsm_t *fsm, ni_ifworker_type_t type, const char *name)
 {
 	if (!fsm || ni_string_empty(name) || ni_fsm_ifworker_by_name(fsm, type, name))
 		return NULL;
 
-	return ni_ifworker_new(&fsm->workers, type, name);
+	return ni_fsm_worker_new(fsm, type, name);
 }
 
 ni_ifworker_t *
@@ -322,6 +379,7 @@ __ni_ifworker_reset_action_table(ni_ifworker_t *w)
 {
 	ni_fsm_transition_t *action;
 
+	ni_ifworker_cancel_async_call(w);
 	for (action = w->fsm.action_table; action && action->next_state; action++) {
 		ni_fsm_transition_reset(action);
 		ni_fsm_require_list_destroy(&action->require.list);
@@ -565,6 +623,7 @@ __ni_ifworker_done(ni_ifworker_t *w)
 
 	ni_ifworker_cancel_secondary_timeout(w);
 	ni_ifworker_cancel_timeout(w);
+	ni_ifworker_cancel_async_call(w);
 	ni_ifworker_cancel_action_table_callbacks(w);
 
 	if (w->progress.callback)
@@ -885,6 +944,242 @@ ni_ifworker_array_find_by_name(const ni_ifworker_array_t *array, ni_ifworker_typ
 	return NULL;
 }
 
+/*
+ * Hash index of the fsm workers by name, ifindex and object path.
+ *
+ * Each worker in fsm->workers has an entry recording the keys it has
+ * been indexed with and its append order, so the lookups return the
+ * first matching worker of the array.  Workers have to be added via
+ * ni_fsm_worker_new and removed via ni_fsm_destroy_worker or
+ * ni_fsm_remove_worker_at, the functions which change the worker keys
+ * update the entry.  Lookups always compare the current worker keys.
+ */
+typedef struct ni_fsm_worker_index_entry {
+	ni_ifworker_t *		worker;
+	unsigned int		seq;
+	unsigned int		name_hash;
+	unsigned int		ifindex;
+	unsigned int		path_hash;
+} ni_fsm_worker_index_entry_t;
+
+struct ni_fsm_worker_index {
+	unsigned int		seq;
+	ni_hashmap_t		workers;
+	ni_hashmap_t		names;
+	ni_hashmap_t		ifindexes;
+	ni_hashmap_t		paths;
+};
+
+static struct ni_fsm_worker_index *
+ni_fsm_worker_index_new(void)
+{
+	struct ni_fsm_worker_index *index;
+
+	index = xcalloc(1, sizeof(*index));
+	ni_hashmap_init(&index->workers);
+	ni_hashmap_init(&index->names);
+	ni_hashmap_init(&index->ifindexes);
+	ni_hashmap_init(&index->paths);
+	return index;
+}
+
+static void
+ni_fsm_worker_index_clear(struct ni_fsm_worker_index *index)
+{
+	ni_hashmap_entry_t *he;
+	unsigned int i;
+
+	for (i = 0; i < index->workers.size; ++i) {
+		for (he = index->workers.buckets[i]; he; he = he->next)
+			free(he->item);
+	}
+	ni_hashmap_destroy(&index->workers);
+	ni_hashmap_destroy(&index->names);
+	ni_hashmap_destroy(&index->ifindexes);
+	ni_hashmap_destroy(&index->paths);
+	index->seq = 0;
+}
+
+static void
+ni_fsm_worker_index_free(struct ni_fsm_worker_index *index)
+{
+	if (index) {
+		ni_fsm_worker_index_clear(index);
+		free(index);
+	}
+}
+
+static void
+ni_fsm_worker_index_link(struct ni_fsm_worker_index *index, ni_fsm_worker_index_entry_t *ie)
+{
+	ni_ifworker_t *w = ie->worker;
+
+	ie->name_hash = ni_hashmap_hash_string(w->name);
+	ie->ifindex = w->ifindex;
+	ie->path_hash = ni_hashmap_hash_string(w->object_path);
+
+	if (!ni_string_empty(w->name))
+		ni_hashmap_insert(&index->names, ie->name_hash, ie);
+	if (ie->ifindex)
+		ni_hashmap_insert(&index->ifindexes, ni_hashmap_hash_uint(ie->ifindex), ie);
+	if (!ni_string_empty(w->object_path))
+		ni_hashmap_insert(&index->paths, ie->path_hash, ie);
+}
+
+static void
+ni_fsm_worker_index_unlink(struct ni_fsm_worker_index *index, ni_fsm_worker_index_entry_t *ie)
+{
+	ni_hashmap_remove(&index->names, ie->name_hash, ie);
+	if (ie->ifindex)
+		ni_hashmap_remove(&index->ifindexes, ni_hashmap_hash_uint(ie->ifindex), ie);
+	ni_hashmap_remove(&index->paths, ie->path_hash, ie);
+}
+
+static void
+ni_fsm_worker_index_insert(struct ni_fsm_worker_index *index, ni_ifworker_t *w)
+{
+	ni_fsm_worker_index_entry_t *ie;
+
+	ie = xcalloc(1, sizeof(*ie));
+	ie->worker = w;
+	ie->seq = index->seq++;
+	ni_hashmap_insert(&index->workers, ni_hashmap_hash_ptr(w), ie);
+	ni_fsm_worker_index_link(index, ie);
+}
+
+static ni_fsm_worker_index_entry_t *
+ni_fsm_worker_index_entry(const struct ni_fsm_worker_index *index, const ni_ifworker_t *w)
+{
+	ni_fsm_worker_index_entry_t *ie;
+	ni_hashmap_entry_t *he;
+
+	ni_hashmap_foreach(&index->workers, ni_hashmap_hash_ptr(w), he) {
+		ie = he->item;
+		if (ie->worker == w)
+			return ie;
+	}
+	return NULL;
+}
+
+static struct ni_fsm_worker_index *
+ni_fsm_worker_index(const ni_fsm_t *fsm)
+{
+	return fsm ? fsm->worker_index : NULL;
+}
+
+static void
+ni_fsm_worker_index_update(ni_fsm_t *fsm, ni_ifworker_t *w)
+{
+	struct ni_fsm_worker_index *index;
+	ni_fsm_worker_index_entry_t *ie;
+
+	if (!(index = ni_fsm_worker_index(fsm)))
+		return;
+
+	if ((ie = ni_fsm_worker_index_entry(index, w))) {
+		ni_fsm_worker_index_unlink(index, ie);
+		ni_fsm_worker_index_link(index, ie);
+	}
+}
+
+static void
+ni_fsm_worker_index_remove(ni_fsm_t *fsm, ni_ifworker_t *w)
+{
+	struct ni_fsm_worker_index *index;
+	ni_fsm_worker_index_entry_t *ie;
+
+	if (!(index = ni_fsm_worker_index(fsm)))
+		return;
+
+	while ((ie = ni_fsm_worker_index_entry(index, w))) {
+		ni_fsm_worker_index_unlink(index, ie);
+		ni_hashmap_remove(&index->workers, ni_hashmap_hash_ptr(w), ie);
+		free(ie);
+	}
+}
+
+static ni_ifworker_t *
+ni_fsm_worker_index_find_by_name(const struct ni_fsm_worker_index *index,
+		ni_ifworker_type_t type, const char *name)
+{
+	ni_fsm_worker_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
+
+	ni_hashmap_foreach(&index->names, ni_hashmap_hash_string(name), he) {
+		ie = he->item;
+		if (found && found->seq < ie->seq)
+			continue;
+		if (ie->worker->type == type && ni_string_eq(ie->worker->name, name))
+			found = ie;
+	}
+	return found ? found->worker : NULL;
+}
+
+static ni_ifworker_t *
+ni_fsm_worker_index_find_by_ifindex(const struct ni_fsm_worker_index *index,
+		unsigned int ifindex)
+{
+	ni_fsm_worker_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
+
+	ni_hashmap_foreach(&index->ifindexes, ni_hashmap_hash_uint(ifindex), he) {
+		ie = he->item;
+		if (found && found->seq < ie->seq)
+			continue;
+		if (ie->worker->ifindex == ifindex)
+			found = ie;
+	}
+	return found ? found->worker : NULL;
+}
+
+static ni_ifworker_t *
+ni_fsm_worker_index_find_by_path(const struct ni_fsm_worker_index *index,
+		const char *object_path)
+{
+	ni_fsm_worker_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
+
+	ni_hashmap_foreach(&index->paths, ni_hashmap_hash_string(object_path), he) {
+		ie = he->item;
+		if (found && found->seq < ie->seq)
+			continue;
+		if (ni_string_eq(ie->worker->object_path, object_path))
+			found = ie;
+	}
+	return found ? found->worker : NULL;
+}
+
+/*
+ * Append the workers with given name to the array, in fsm->workers order
+ */
+static ni_bool_t
+ni_fsm_worker_index_get_by_name(const ni_fsm_t *fsm, ni_ifworker_type_t type,
+		const char *name, ni_ifworker_array_t *result)
+{
+	struct ni_fsm_worker_index *index;
+	ni_fsm_worker_index_entry_t *ie, **found = NULL;
+	unsigned int i, j, count = 0;
+	ni_hashmap_entry_t *he;
+
+	if (ni_string_empty(name) || !(index = ni_fsm_worker_index(fsm)))
+		return FALSE;
+
+	ni_hashmap_foreach(&index->names, ni_hashmap_hash_string(name), he) {
+		ie = he->item;
+		if (ie->worker->type != type || !ni_string_eq(ie->worker->name, name))
+			continue;
+
+		found = xrealloc(found, (count + 1) * sizeof(*found));
+		for (j = count++; j > 0 && found[j - 1]->seq > ie->seq; --j)
+			found[j] = found[j - 1];
+		found[j] = ie;
+	}
+	for (i = 0; i < count; ++i)
+		ni_ifworker_array_append(result, found[i]->worker);
+	free(found);
+	return TRUE;
+}
+
 ni_ifworker_array_t *
 ni_ifworker_array_clone(ni_ifworker_array_t *array)
 {
@@ -953,6 +1248,14 @@ ni_ifworker_array_remove_with_children(ni_ifworker_array_t *array, ni_ifworker_t
 ni_ifworker_t *
 ni_fsm_ifworker_by_name(const ni_fsm_t *fsm, ni_ifworker_type_t type, const char *name)
 {
+	struct ni_fsm_worker_index *index;
+
+	if (ni_string_empty(name))
+		return NULL;
+
+	if ((index = ni_fsm_worker_index(fsm)))
+		return ni_fsm_worker_index_find_by_name(index, type, name);
+
 	return ni_ifworker_array_find_by_name(&fsm->workers, type, name);
 }
 
@@ -984,17 +1287,29 @@ ni_fsm_ifworker_by_policy_name(ni_fsm_t *fsm, ni_ifworker_type_t type, const cha
 ni_ifworker_t *
 ni_fsm_ifworker_by_object_path(ni_fsm_t *fsm, const char *object_path)
 {
+	struct ni_fsm_worker_index *index;
+
+	if (ni_string_empty(object_path))
+		return NULL;
+
+	if ((index = ni_fsm_worker_index(fsm)))
+		return ni_fsm_worker_index_find_by_path(index, object_path);
+
 	return ni_ifworker_array_find_by_objectpath(&fsm->workers, object_path);
 }
 
 ni_ifworker_t *
 ni_fsm_ifworker_by_ifindex(ni_fsm_t *fsm, unsigned int ifindex)
 {
+	struct ni_fsm_worker_index *index;
 	unsigned int i;
 
 	if (0 == ifindex)
 		return NULL;
 
+	if ((index = ni_fsm_worker_index(fsm)))
+		return ni_fsm_worker_index_find_by_ifindex(index, ifindex);
+
 	for (i = 0; i < fsm->workers.count; ++i) {
 		ni_ifworker_t *w = fsm->workers.data[i];
 
@@ -2176,7 +2491,7 @@ ni_fsm_workers_from_xml(ni_fsm_t *fsm, xml_node_t *node, const char *origin)
 				xml_node_location(node), node->name);
 			return NULL;
 		}
-		if (!(w = ni_ifworker_new(&fsm->workers, type, ifname))) {
+		if (!(w = ni_fsm_worker_new(fsm, type, ifname))) {
 			ni_error("%s: cannot allocate worker for '%s' configuration",
 				xml_node_location(node), node->name);
 			return NULL;
@@ -2899,12 +3214,47 @@ ni_ifworker_type_from_object_path(const char *path, const char **suffix)
 	return NI_IFWORKER_TYPE_NONE;
 }
 
+/*
+ * Result membership checks: a hash set of the result when matching all
+ * workers, the (short) result array otherwise.
+ */
+static ni_bool_t
+ni_fsm_matching_has(const ni_hashmap_t *set, const ni_ifworker_array_t *result,
+		const ni_ifworker_t *w)
+{
+	ni_hashmap_entry_t *he;
+
+	if (!set)
+		return ni_ifworker_array_index(result, w) >= 0;
+
+	ni_hashmap_foreach(set, ni_hashmap_hash_ptr(w), he) {
+		if (he->item == w)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+ni_fsm_matching_append(ni_hashmap_t *set, ni_ifworker_array_t *result, ni_ifworker_t *w)
+{
+	if (ni_fsm_matching_has(set, result, w))
+		return;
+
+	if (set)
+		ni_hashmap_insert(set, ni_hashmap_hash_ptr(w), w);
+	ni_ifworker_array_append(result, w);
+}
+
 /*
  * Get all interfaces matching some user-specified criteria
  */
 unsigned int
 ni_fsm_get_matching_workers(ni_fsm_t *fsm, ni_ifmatcher_t *match, ni_ifworker_array_t *result)
 {
+	ni_ifworker_array_t named = NI_IFWORKER_ARRAY_INIT;
+	const ni_ifworker_array_t *workers = &fsm->workers;
+	ni_hashmap_t matched = NI_HASHMAP_INIT;
+	ni_hashmap_t *set = NULL;
 	void (*logit)(const char *, ...) __fmtattr;
 	unsigned int i;
 
@@ -2915,8 +3265,21 @@ ni_fsm_get_matching_workers(ni_fsm_t *fsm, ni_ifmatcher_t *match, ni_ifworker_ar
 		logit = ni_note;
 	}
 
-	for (i = 0; i < fsm->workers.count; ++i) {
-		ni_ifworker_t *w = fsm->workers.data[i];
+	/* check the workers with the requested name only */
+	if (match->name && ni_fsm_worker_index_get_by_name(fsm,
+				NI_IFWORKER_TYPE_NETDEV, match->name, &named))
+		workers = &named;
+
+	/* hash the result when it grows by every worker */
+	if (workers == &fsm->workers) {
+		set = &matched;
+		for (i = 0; i < result->count; ++i)
+			ni_hashmap_insert(set, ni_hashmap_hash_ptr(result->data[i]),
+						result->data[i]);
+	}
+
+	for (i = 0; i < workers->count; ++i) {
+		ni_ifworker_t *w = workers->data[i];
 
 		if (w->type != NI_IFWORKER_TYPE_NETDEV)
 			continue;
@@ -2987,17 +3350,15 @@ ni_fsm_get_matching_workers(ni_fsm_t *fsm, ni_ifmatcher_t *match, ni_ifworker_ar
 		if (match->name) { /* Check only when particular interface specified */
 			if (!match->ifdown) {
 				if (w->masterdev) { /* Pull in also masterdev */
-					if (ni_ifworker_array_index(result, w->masterdev) < 0)
-						ni_ifworker_array_append(result, w->masterdev);
+					ni_fsm_matching_append(set, result, w->masterdev);
 				}
 				if (w->lowerdev) {
-					if (ni_ifworker_array_index(result, w->lowerdev) < 0)
-						ni_ifworker_array_append(result, w->lowerdev);
+					ni_fsm_matching_append(set, result, w->lowerdev);
 				}
 			}
 			else {
 				if (w->masterdev) {
-					if (ni_ifworker_array_index(result, w->masterdev) < 0) {
+					if (!ni_fsm_matching_has(set, result, w->masterdev)) {
 						logit("skipping %s interface: "
 							"unable to ifdown due to master device dependency to: %s",
 							w->name, w->masterdev->name);
@@ -3012,7 +3373,7 @@ ni_fsm_get_matching_workers(ni_fsm_t *fsm, ni_ifmatcher_t *match, ni_ifworker_ar
 					for (i = 0; i < w->lowerdev_for.count; i++) {
 						ni_ifworker_t *dep = w->lowerdev_for.data[i];
 
-						if (ni_ifworker_array_index(result, dep) < 0) {
+						if (!ni_fsm_matching_has(set, result, dep)) {
 							logit("skipping %s interface: "
 								"unable to ifdown due to lower device dependency to: %s",
 								w->name, dep->name);
@@ -3026,10 +3387,11 @@ ni_fsm_get_matching_workers(ni_fsm_t *fsm, ni_ifmatcher_t *match, ni_ifworker_ar
 			}
 		}
 
-		if (ni_ifworker_array_index(result,w) < 0)
-			ni_ifworker_array_append(result, w);
+		ni_fsm_matching_append(set, result, w);
 	}
 
+	ni_hashmap_destroy(&matched);
+	ni_ifworker_array_destroy(&named);
 	return result->count;
 }
 
@@ -3384,6 +3746,7 @@ ni_fsm_destroy_worker(ni_fsm_t *fsm, ni_ifworker_t *w)
 	ni_ifworker_get(w);
 
 	ni_debug_application("%s(%s)", __func__, w->name);
+	ni_fsm_worker_index_remove(fsm, w);
 	if (!ni_ifworker_array_remove(&fsm->workers, w)) {
 		ni_ifworker_release(w);
 		return;
@@ -3394,6 +3757,21 @@ ni_fsm_destroy_worker(ni_fsm_t *fsm, ni_ifworker_t *w)
 	ni_ifworker_release(w);
 }
 
+/*
+ * Remove the worker at index from the fsm workers without destroying
+ * its device, e.g. an obsolete config only worker
+ */
+ni_bool_t
+ni_fsm_remove_worker_at(ni_fsm_t *fsm, unsigned int index)
+{
+	if (!fsm || index >= fsm->workers.count)
+		return FALSE;
+
+	if (fsm->workers.data[index])
+		ni_fsm_worker_index_remove(fsm, fsm->workers.data[index]);
+	return ni_ifworker_array_remove_index(&fsm->workers, index);
+}
+
 static void
 ni_ifworker_get_check_state_req_for_methods(ni_ifworker_t *w)
 {
@@ -3984,6 +4362,271 @@ ni_fsm_refresh_state(ni_fsm_t *fsm)
 	return TRUE;
 }
 
+static ni_bool_t
+ni_fsm_refresh_is_changed(const ni_hashmap_t *dirty_index, const char *object_path)
+{
+	ni_hashmap_entry_t *he;
+
+	if (!dirty_index)
+		return FALSE;
+
+	ni_hashmap_foreach(dirty_index, ni_hashmap_hash_string(object_path), he) {
+		if (ni_string_eq(he->item, object_path))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Remember the netif object paths the server signaled as changed since
+ * the last refresh; the incremental refresh re-fetches only these.
+ */
+void
+ni_fsm_refresh_mark_changed(ni_fsm_t *fsm, const char *object_path)
+{
+	const char *suffix;
+
+	if (!fsm || ni_string_empty(object_path))
+		return;
+
+	if (ni_ifworker_type_from_object_path(object_path, &suffix) != NI_IFWORKER_TYPE_NETDEV)
+		return;
+
+	if (ni_fsm_refresh_is_changed(fsm->refresh.dirty_index, object_path))
+		return;
+
+	if (!fsm->refresh.dirty_index) {
+		fsm->refresh.dirty_index = xcalloc(1, sizeof(ni_hashmap_t));
+		ni_hashmap_init(fsm->refresh.dirty_index);
+	}
+	ni_string_array_append(&fsm->refresh.dirty, object_path);
+	ni_hashmap_insert(fsm->refresh.dirty_index, ni_hashmap_hash_string(object_path),
+			fsm->refresh.dirty.data[fsm->refresh.dirty.count - 1]);
+}
+
+static void
+ni_fsm_refresh_changed_destroy(ni_string_array_t *dirty, ni_hashmap_t **dirty_index)
+{
+	if (*dirty_index) {
+		ni_hashmap_destroy(*dirty_index);
+		free(*dirty_index);
+		*dirty_index = NULL;
+	}
+	ni_string_array_destroy(dirty);
+}
+
+static void
+ni_fsm_refresh_clear_changed(ni_fsm_t *fsm)
+{
+	ni_fsm_refresh_changed_destroy(&fsm->refresh.dirty, &fsm->refresh.dirty_index);
+}
+
+static ni_dbus_object_t *
+ni_fsm_refresh_find_child(ni_dbus_object_t *list_object, const char *object_path)
+{
+	ni_dbus_object_t *object;
+
+	for (object = list_object->children; object; object = object->next) {
+		if (ni_string_eq(object->path, object_path))
+			return object;
+	}
+	return NULL;
+}
+
+/*
+ * Re-fetch the properties of the netif objects signaled as changed
+ * and rebind the unchanged ones from their cached proxy objects.
+ * Returns FALSE when the cached list can't be trusted any more, e.g.
+ * a device has been created or deleted, so the caller does a full
+ * refresh instead.
+ */
+static ni_bool_t
+ni_fsm_refresh_netdevs_changed(ni_fsm_t *fsm, ni_dbus_object_t *list_object)
+{
+	ni_string_array_t dirty = NI_STRING_ARRAY_INIT;
+	ni_hashmap_t *dirty_index;
+	ni_dbus_object_t *object;
+	unsigned int i, found = 0;
+	ni_bool_t changed, rv = FALSE;
+
+	/* A roundtrip to the server dispatches the signals it sent until now */
+	if (ni_dbus_object_call_simple(list_object, NI_DBUS_INTERFACE ".Peer",
+					"Ping", 0, NULL, 0, NULL) < 0)
+		return FALSE;
+
+	/* Signals dispatched while re-fetching mark paths for the next refresh */
+	ni_string_array_move(&dirty, &fsm->refresh.dirty);
+	dirty_index = fsm->refresh.dirty_index;
+	fsm->refresh.dirty_index = NULL;
+
+	for (object = list_object->children; object; object = object->next) {
+		if (ni_fsm_refresh_is_changed(dirty_index, object->path))
+			found++;
+	}
+	if (found != dirty.count) {
+		for (i = 0; i < dirty.count; ++i) {
+			if (!ni_fsm_refresh_find_child(list_object, dirty.data[i])) {
+				ni_debug_application("%s: new object, refreshing all interfaces",
+						dirty.data[i]);
+				break;
+			}
+		}
+		goto out;
+	}
+
+	ni_debug_application("refreshing %u of the active network interfaces", found);
+	for (object = list_object->children; object; object = object->next) {
+		changed = ni_fsm_refresh_is_changed(dirty_index, object->path);
+		if (!ni_fsm_recv_new_netif(fsm, object, changed) && changed) {
+			ni_debug_application("%s: refresh failed, refreshing all interfaces",
+						object->path);
+			goto out;
+		}
+	}
+	rv = TRUE;
+
+out:
+	ni_fsm_refresh_changed_destroy(&dirty, &dirty_index);
+	return rv;
+}
+
+/*
+ * Drop the values relative to the time the properties were built,
+ * e.g. the remaining address lifetimes or the age of a wireless bss,
+ * which differ between two fetches of the same object state.
+ */
+static void
+ni_fsm_refresh_strip_volatile(ni_dbus_variant_t *var)
+{
+	static const char *	volatile_keys[] = {
+		"preferred-lifetime", "valid-lifetime", "age", NULL
+	};
+	const char **key;
+	unsigned int i;
+
+	switch (var->type) {
+	case DBUS_TYPE_VARIANT:
+		if (var->variant_value)
+			ni_fsm_refresh_strip_volatile(var->variant_value);
+		break;
+
+	case DBUS_TYPE_STRUCT:
+		for (i = 0; i < var->array.len; ++i)
+			ni_fsm_refresh_strip_volatile(&var->struct_value[i]);
+		break;
+
+	case DBUS_TYPE_ARRAY:
+		switch (var->array.element_type) {
+		case DBUS_TYPE_DICT_ENTRY:
+			for (key = volatile_keys; *key; ++key)
+				ni_dbus_dict_delete_entry(var, *key);
+			for (i = 0; i < var->array.len; ++i)
+				ni_fsm_refresh_strip_volatile(&var->dict_array_value[i].datum);
+			break;
+		case DBUS_TYPE_INVALID:
+			if (var->array.element_signature == NULL)
+				break;
+			/* fall through */
+		case DBUS_TYPE_VARIANT:
+			for (i = 0; i < var->array.len; ++i)
+				ni_fsm_refresh_strip_volatile(&var->variant_array_value[i]);
+			break;
+		case DBUS_TYPE_STRUCT:
+			for (i = 0; i < var->array.len; ++i)
+				ni_fsm_refresh_strip_volatile(&var->struct_value[i]);
+			break;
+		default:
+			break;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+static ni_bool_t
+ni_fsm_refresh_object_marshal(const ni_dbus_object_t *object, char **data, int *len)
+{
+	ni_dbus_variant_t dict = NI_DBUS_VARIANT_INIT;
+	const ni_dbus_service_t **pos, *service;
+	ni_dbus_message_t *msg;
+	dbus_bool_t rv = TRUE;
+
+	*data = NULL;
+	*len = 0;
+	if (!(msg = dbus_message_new_signal(object->path, NI_DBUS_INTERFACE ".Properties",
+					"PropertiesChanged")))
+		return FALSE;
+
+	pos = object->interfaces;
+	while (rv && pos && (service = *pos++) != NULL) {
+		ni_dbus_variant_init_dict(&dict);
+		rv = ni_dbus_object_get_properties_as_dict(object, service, &dict, NULL);
+		if (rv)
+			ni_fsm_refresh_strip_volatile(&dict);
+		rv = rv && ni_dbus_message_append_string(msg, service->name) &&
+		     ni_dbus_message_serialize_variants(msg, 1, &dict, NULL);
+		ni_dbus_variant_destroy(&dict);
+	}
+
+	if (rv)
+		rv = dbus_message_marshal(msg, data, len);
+	dbus_message_unref(msg);
+	return rv;
+}
+
+/*
+ * Check mode: compare the incrementally refreshed objects against
+ * the objects a full GetManagedObjects call returns right now,
+ * except for their time relative values.
+ */
+static ni_bool_t
+ni_fsm_refresh_netdevs_verify(ni_fsm_t *fsm, ni_dbus_object_t *list_object)
+{
+	ni_dbus_client_t *client = ni_dbus_object_get_client(list_object);
+	ni_dbus_object_t *check_object, *object, *cached;
+	unsigned int mismatches = 0;
+	char *data[2];
+	int len[2];
+
+	check_object = ni_dbus_client_object_new(client, list_object->class, list_object->path,
+					ni_dbus_object_get_default_interface(list_object), NULL);
+	if (!check_object || !ni_dbus_object_refresh_children(check_object)) {
+		if (check_object)
+			ni_dbus_object_free(check_object);
+		return FALSE;
+	}
+
+	for (object = check_object->children; object; object = object->next) {
+		if (!(cached = ni_fsm_refresh_find_child(list_object, object->path))) {
+			ni_warn("%s: incremental refresh missed a new object", object->path);
+			mismatches++;
+			continue;
+		}
+
+		if (!ni_fsm_refresh_object_marshal(object, &data[0], &len[0]) ||
+		    !ni_fsm_refresh_object_marshal(cached, &data[1], &len[1]) ||
+		    len[0] != len[1] || memcmp(data[0], data[1], len[0])) {
+			ni_warn("%s: incremental refresh returned stale properties",
+					object->path);
+			mismatches++;
+		}
+		dbus_free(data[0]);
+		dbus_free(data[1]);
+	}
+	for (object = list_object->children; object; object = object->next) {
+		if (!ni_fsm_refresh_find_child(check_object, object->path)) {
+			ni_warn("%s: incremental refresh missed a deleted object", object->path);
+			mismatches++;
+		}
+	}
+
+	ni_dbus_object_free(check_object);
+	fsm->refresh.mismatches += mismatches;
+	return mismatches == 0;
+}
+
 static ni_bool_t
 ni_fsm_refresh_netdevs_state(ni_fsm_t *fsm)
 {
@@ -3995,7 +4638,16 @@ ni_fsm_refresh_netdevs_state(ni_fsm_t *fsm)
 		return FALSE;
 	}
 
+	if (fsm->refresh.incremental && fsm->refresh.loaded &&
+	    ni_fsm_refresh_netdevs_changed(fsm, list_object)) {
+		if (!fsm->refresh.check || ni_fsm_refresh_netdevs_verify(fsm, list_object))
+			return TRUE;
+		ni_warn("incremental interface refresh mismatch, refreshing all interfaces");
+	}
+
 	/* Call ObjectManager.GetManagedObjects to get list of objects and their properties */
+	fsm->refresh.loaded = FALSE;
+	ni_fsm_refresh_clear_changed(fsm);
 	if (!ni_dbus_object_refresh_children(list_object)) {
 		ni_error("Couldn't refresh list of active network interfaces");
 		return FALSE;
@@ -4003,6 +4655,8 @@ ni_fsm_refresh_netdevs_state(ni_fsm_t *fsm)
 
 	for (object = list_object->children; object; object = object->next)
 		ni_fsm_recv_new_netif(fsm, object, TRUE);
+
+	fsm->refresh.loaded = TRUE;
 	return TRUE;
 }
 
@@ -4038,13 +4692,13 @@ ni_fsm_recv_new_netif(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh
 			ni_ifworker_array_remove(&fsm->pending, found);
 
 		/* lookup worker by object path (ifindex) first, then by name */
-		found = ni_ifworker_array_find_by_objectpath(&fsm->workers, object->path);
+		found = ni_fsm_ifworker_by_object_path(fsm, object->path);
 		if (!found)
 			found = ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, dev->name);
 		if (!found) {
 			ni_debug_application("received new ready device %s (%s)",
 						dev->name, object->path);
-			found = ni_ifworker_new(&fsm->workers, NI_IFWORKER_TYPE_NETDEV, dev->name);
+			found = ni_fsm_worker_new(fsm, NI_IFWORKER_TYPE_NETDEV, dev->name);
 			if (found)
 				found->readonly = fsm->readonly;
 		} else {
@@ -4101,6 +4755,7 @@ ni_fsm_recv_new_netif(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh
 
 	found->ifindex = dev->link.ifindex;
 	found->object = object;
+	ni_fsm_worker_index_update(fsm, found);
 
 	return found;
 }
@@ -4172,14 +4827,16 @@ ni_fsm_recv_new_modem(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh
 		found = ni_fsm_ifworker_by_object_path(fsm, object->path);
 	if (!found) {
 		ni_debug_application("received new modem %s (%s)", modem->device, object->path);
-		found = ni_ifworker_new(&fsm->workers, NI_IFWORKER_TYPE_MODEM, modem->device);
+		found = ni_fsm_worker_new(fsm, NI_IFWORKER_TYPE_MODEM, modem->device);
 	}
 
 	if (!found)
 		return NULL;
 
-	if (!found->object_path)
+	if (!found->object_path) {
 		ni_string_dup(&found->object_path, object->path);
+		ni_fsm_worker_index_update(fsm, found);
+	}
 	if (!found->modem)
 		found->modem = ni_modem_hold(modem);
 	found->object = object;
@@ -4885,20 +5542,226 @@ ni_ifworker_update_from_request(ni_ifworker_t *w, const char *service, const cha
 	}
 }
 
+/*
+ * Asynchronous calls of the common transitions.
+ *
+ * The call is attached to the worker while it is queued (all of the
+ * fsm->async.max slots in use) or in flight. ni_fsm_schedule sends the
+ * queued calls and resumes the transition once the reply arrived, so
+ * independent workers progress in parallel while the dependencies are
+ * checked as before. A call cancelled while in flight is detached from
+ * the worker and the fsm and freed when its reply arrives.
+ */
+typedef enum {
+	NI_FSM_ASYNC_CALL_QUEUED,
+	NI_FSM_ASYNC_CALL_SENT,
+	NI_FSM_ASYNC_CALL_DONE,
+} ni_fsm_async_call_state_t;
+
+struct ni_fsm_async_call {
+	ni_fsm_t *			fsm;
+	ni_ifworker_t *			worker;
+	ni_fsm_transition_t *		action;
+	unsigned int			binding;
+	unsigned int			count;
+
+	ni_fsm_async_call_state_t	state;
+	int				result;
+	ni_objectmodel_callback_info_t *callback_list;
+};
+
+void
+ni_fsm_set_max_async_calls(ni_fsm_t *fsm, unsigned int max)
+{
+	if (fsm)
+		fsm->async.max = max;
+}
+
+static void
+ni_fsm_async_call_free(ni_fsm_async_call_t *call)
+{
+	ni_objectmodel_callback_info_t *cb;
+
+	while ((cb = call->callback_list) != NULL) {
+		call->callback_list = cb->next;
+		ni_objectmodel_callback_info_free(cb);
+	}
+	free(call);
+}
+
+static void
+ni_fsm_async_call_reply(int result, ni_objectmodel_callback_info_t *callback_list, void *user_data)
+{
+	ni_fsm_async_call_t *call = user_data;
+
+	call->result = result;
+	call->callback_list = callback_list;
+
+	if (call->fsm == NULL) {
+		/* cancelled while in flight */
+		ni_fsm_async_call_free(call);
+		return;
+	}
+
+	call->state = NI_FSM_ASYNC_CALL_DONE;
+	call->fsm->async.calls--;
+	call->fsm->async.replies++;
+}
+
+static void
+ni_fsm_async_call_send(ni_fsm_async_call_t *call)
+{
+	ni_fsm_transition_bind_t *bind = &call->action->binding[call->binding];
+	ni_ifworker_t *w = call->worker;
+	int rv;
+
+	ni_debug_application("%s: calling %s.%s() asynchronously", w->name,
+			bind->service->name, bind->method->name);
+
+	call->state = NI_FSM_ASYNC_CALL_SENT;
+	call->fsm->async.calls++;
+
+	rv = ni_call_common_xml_async(w->object, bind->service, bind->method, bind->config,
+			ni_ifworker_error_handler, ni_fsm_async_call_reply, call);
+	if (rv < 0) {
+		call->fsm->async.calls--;
+		call->state = NI_FSM_ASYNC_CALL_DONE;
+		call->result = rv;
+	}
+}
+
+static void
+ni_ifworker_start_async_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action,
+				unsigned int binding, unsigned int count)
+{
+	ni_fsm_async_call_t *call;
+
+	call = xcalloc(1, sizeof(*call));
+	call->fsm = fsm;
+	call->worker = w;
+	call->action = action;
+	call->binding = binding;
+	call->count = count;
+	call->state = NI_FSM_ASYNC_CALL_QUEUED;
+	w->fsm.call = call;
+
+	if (fsm->async.calls < fsm->async.max)
+		ni_fsm_async_call_send(call);
+}
+
+/*
+ * Send a queued call when a slot is free and return whether the
+ * reply arrived, that is, the transition can be resumed.
+ */
+static ni_bool_t
+ni_ifworker_async_call_ready(ni_fsm_t *fsm, ni_ifworker_t *w)
+{
+	ni_fsm_async_call_t *call = w->fsm.call;
+
+	if (call->state == NI_FSM_ASYNC_CALL_QUEUED && fsm->async.calls < fsm->async.max)
+		ni_fsm_async_call_send(call);
+
+	return call->state == NI_FSM_ASYNC_CALL_DONE;
+}
+
+static ni_fsm_async_call_t *
+ni_ifworker_take_async_call(ni_ifworker_t *w, ni_fsm_transition_t *action)
+{
+	ni_fsm_async_call_t *call = w->fsm.call;
+
+	if (!call || call->action != action || call->state != NI_FSM_ASYNC_CALL_DONE)
+		return NULL;
+
+	w->fsm.call = NULL;
+	return call;
+}
+
+static void
+ni_ifworker_cancel_async_call(ni_ifworker_t *w)
+{
+	ni_fsm_async_call_t *call;
+
+	if (!w || !(call = w->fsm.call))
+		return;
+
+	ni_debug_application("%s: cancel %s async call", w->name,
+			call->action->common.method_name);
+	w->fsm.call = NULL;
+
+	if (call->state == NI_FSM_ASYNC_CALL_SENT) {
+		call->fsm->async.calls--;
+		call->fsm = NULL;
+		call->worker = NULL;
+		call->action = NULL;
+	} else {
+		ni_fsm_async_call_free(call);
+	}
+}
+
+/*
+ * Process the result of a common call binding; returns 0 to continue
+ * with the next binding, < 0 on failure and > 0 when the transition
+ * is complete because a failure of the call is ignored.
+ */
+static int
+ni_ifworker_common_call_result(ni_ifworker_t *w, ni_fsm_transition_t *action,
+				ni_fsm_transition_bind_t *bind, int rv,
+				ni_objectmodel_callback_info_t *callback_list,
+				unsigned int *count)
+{
+	char *service = NULL;
+	char *method = NULL;
+
+	ni_string_dup(&service, bind->service->name);
+	ni_string_dup(&method, bind->method->name);
+
+	ni_ifworker_update_from_request(w, service, method, rv, callback_list);
+	if (rv < 0) {
+		if (action->common.may_fail) {
+			ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
+					service, method, ni_strerror(rv));
+			ni_ifworker_set_state(w, action->next_state);
+			rv = 1;
+		} else {
+			ni_ifworker_fail(w, "call to %s.%s() failed: %s", service, method, ni_strerror(rv));
+		}
+	} else if (callback_list) {
+		ni_debug_application("%s: adding callback for %s.%s()", w->name, service, method);
+		ni_ifworker_add_callbacks(action, callback_list, w->name);
+		(*count)++;
+	}
+
+	ni_string_free(&service);
+	ni_string_free(&method);
+	return rv;
+}
+
 static int
 ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action)
 {
-	unsigned int i, count = 0;
+	ni_fsm_async_call_t *call;
+	unsigned int i = 0, count = 0;
 	int rv;
 
-	/* Initially, enable waiting for this action */
-	w->fsm.wait_for = action;
+	if ((call = ni_ifworker_take_async_call(w, action))) {
+		/* Resume after the reply to the call of the binding */
+		i = call->binding;
+		count = call->count;
+		rv = ni_ifworker_common_call_result(w, action, &action->binding[i],
+				call->result, call->callback_list, &count);
+		call->callback_list = NULL;
+		ni_fsm_async_call_free(call);
+		if (rv)
+			return rv < 0 ? rv : 0;
+		i++;
+	} else {
+		/* Initially, enable waiting for this action */
+		w->fsm.wait_for = action;
+	}
 
-	for (i = 0; i < action->num_bindings; ++i) {
+	for ( ; i < action->num_bindings; ++i) {
 		ni_fsm_transition_bind_t *bind = &action->binding[i];
 		ni_objectmodel_callback_info_t *callback_list = NULL;
-		char *service = NULL;
-		char *method = NULL;
 
 		if (!bind->method || !bind->service)
 			continue;
@@ -4906,37 +5769,19 @@ ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 		if (bind->skip_call)
 			continue;
 
-		ni_string_dup(&service, bind->service->name);
-		ni_string_dup(&method, bind->method->name);
+		if (fsm->async.max) {
+			ni_ifworker_start_async_call(fsm, w, action, i, count);
+			return 0;
+		}
 
-		ni_debug_application("%s: calling %s.%s()", w->name, service, method);
+		ni_debug_application("%s: calling %s.%s()", w->name,
+				bind->service->name, bind->method->name);
 
 		rv = ni_call_common_xml(w->object, bind->service, bind->method, bind->config,
 				&callback_list, ni_ifworker_error_handler);
-		ni_ifworker_update_from_request(w, service, method, rv, callback_list);
-		if (rv < 0) {
-			if (action->common.may_fail) {
-				ni_error("[ignored] %s: call to %s.%s() failed: %s", w->name,
-						service, method, ni_strerror(rv));
-				ni_ifworker_set_state(w, action->next_state);
-				ni_string_free(&service);
-				ni_string_free(&method);
-				return 0;
-			}
-			ni_ifworker_fail(w, "call to %s.%s() failed: %s", service, method, ni_strerror(rv));
-			ni_string_free(&service);
-			ni_string_free(&method);
-			return rv;
-		}
-
-		if (callback_list) {
-			ni_debug_application("%s: adding callback for %s.%s()", w->name, service, method);
-			ni_ifworker_add_callbacks(action, callback_list, w->name);
-			count++;
-		}
-
-		ni_string_free(&service);
-		ni_string_free(&method);
+		rv = ni_ifworker_common_call_result(w, action, bind, rv, callback_list, &count);
+		if (rv)
+			return rv < 0 ? rv : 0;
 	}
 
 	/* Reset wait_for if there are no callbacks ... */
@@ -4954,7 +5799,7 @@ ni_ifworker_do_common_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t
 static int
 ni_ifworker_do_wait_device_ready_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transition_t *action)
 {
-	if (ni_netdev_device_is_ready(w->device)) {
+	if (!w->fsm.call && ni_netdev_device_is_ready(w->device)) {
 		w->fsm.wait_for = action;
 		ni_ifworker_set_state(w, action->next_state);
 		w->fsm.wait_for = NULL;
@@ -4969,6 +5814,8 @@ ni_ifworker_link_detection_call(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transiti
 	int ret;
 
 	ret = ni_ifworker_do_common_call(fsm, w, action);
+	if (w->fsm.call)
+		return ret;
 
 	if (!ni_tristate_is_set(w->control.link_required) && w->device)
 		w->control.link_required = ni_netdev_guess_link_required(w->device);
@@ -5065,6 +5912,7 @@ ni_ifworker_call_device_factory(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_transiti
 		ni_debug_application("created device %s (path=%s)", w->name, object_path);
 		ni_string_free(&w->object_path);
 		w->object_path = object_path;
+		ni_fsm_worker_index_update(fsm, w);
 
 		/* Lookup the object corresponding to this path. If it doesn't
 		 * exist, create it on the fly (with a generic class of "netif" -
@@ -5323,11 +6171,12 @@ ni_fsm_schedule_bind_methods(ni_fsm_t *fsm, ni_ifworker_t *w)
 unsigned int
 ni_fsm_schedule(ni_fsm_t *fsm)
 {
-	unsigned int i, waiting, nrequested;
+	unsigned int i, waiting, nrequested, replies;
 
 	while (1) {
 		int made_progress = 0;
 
+		replies = fsm->async.replies;
 		for (i = 0; i < fsm->workers.count; ++i) {
 			ni_ifworker_t *w = fsm->workers.data[i];
 			ni_fsm_transition_t *action;
@@ -5339,6 +6188,15 @@ ni_fsm_schedule(ni_fsm_t *fsm)
 			if (w->pending)
 				goto release;
 
+			/* Resume the transition once its async call returned */
+			if (w->fsm.call) {
+				if (!ni_ifworker_async_call_ready(fsm, w))
+					goto release;
+
+				action = w->fsm.call->action;
+				goto call;
+			}
+
 			if (ni_ifworker_complete(w)) {
 				ni_ifworker_cancel_secondary_timeout(w);
 				ni_ifworker_cancel_timeout(w);
@@ -5387,10 +6245,17 @@ ni_fsm_schedule(ni_fsm_t *fsm)
 
 			ni_ifworker_cancel_secondary_timeout(w);
 
+call:
 			prev_state = w->fsm.state;
 			ni_fsm_events_block(fsm);
 
 			rv = action->call_func(fsm, w, action);
+			if (w->fsm.call) {
+				ni_debug_application("%s: waiting for %s() call reply",
+						w->name, action->common.method_name);
+				made_progress = 1;
+				goto unblock;
+			}
 			if (w->fsm.next_action)
 				w->fsm.next_action++;
 
@@ -5415,15 +6280,17 @@ ni_fsm_schedule(ni_fsm_t *fsm)
 						ni_ifworker_state_name(action->next_state));
 			}
 
+unblock:
 			ni_fsm_process_events(fsm);
 			ni_fsm_events_unblock(fsm);
 release:
 			ni_ifworker_release(w);
-
-			ni_dbus_objects_garbage_collect();
 		}
 
-		if (!made_progress)
+		ni_dbus_objects_garbage_collect();
+
+		/* replies received meanwhile permit to resume further workers */
+		if (!made_progress && replies == fsm->async.replies)
 			break;
 
 		/* If all the requested workers are done (eg because they failed)
@@ -5913,6 +6780,8 @@ interface_state_change_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg
 	ni_event_t  event_type;
 	ni_fsm_event_t *ev;
 
+	ni_fsm_refresh_mark_changed(fsm, object_path);
+
 	/* See if this event is a known one */
 	if (ni_objectmodel_signal_to_event(signal_name, &event_type) < 0) {
 		ni_warn("%s: unknown event signal %s from %s",
@@ -5973,6 +6842,18 @@ interface_state_change_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg
 	}
 }
 
+/*
+ * Properties of the netif objects below the wicked interface list
+ * changed; other objects and senders are not subscribed to.
+ */
+static void
+properties_changed_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void *user_data)
+{
+	ni_fsm_t *fsm = user_data;
+
+	ni_fsm_refresh_mark_changed(fsm, dbus_message_get_path(msg));
+}
+
 ni_dbus_client_t *
 ni_fsm_create_client(ni_fsm_t *fsm)
 {
@@ -5993,6 +6874,13 @@ ni_fsm_create_client(ni_fsm_t *fsm)
 					interface_state_change_signal,
 					fsm);
 
+	ni_dbus_client_add_signal_handler(client,
+					NI_OBJECTMODEL_DBUS_BUS_NAME,
+					NI_OBJECTMODEL_NETIF_LIST_PATH,
+					NI_DBUS_INTERFACE ".Properties",
+					properties_changed_signal,
+					fsm);
+
 	return client;
 }
 
@@ -0,0 +1,202 @@
+/*
+ *	Hash map of items indexed by caller computed hash values
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <wicked/util.h>
+#include "hashmap_priv.h"
+#include "util_priv.h"
+
+#define NI_HASHMAP_MIN_SIZE	16
+
+#define NI_HASHMAP_FNV_OFFSET	2166136261U
+#define NI_HASHMAP_FNV_PRIME	16777619U
+
+void
+ni_hashmap_init(ni_hashmap_t *map)
+{
+	if (map)
+		memset(map, 0, sizeof(*map));
+}
+
+void
+ni_hashmap_destroy(ni_hashmap_t *map)
+{
+	ni_hashmap_entry_t *entry;
+	unsigned int i;
+
+	if (!map)
+		return;
+
+	for (i = 0; i < map->size; ++i) {
+		while ((entry = map->buckets[i]) != NULL) {
+			map->buckets[i] = entry->next;
+			free(entry);
+		}
+	}
+	free(map->buckets);
+	memset(map, 0, sizeof(*map));
+}
+
+static void
+ni_hashmap_resize(ni_hashmap_t *map, unsigned int size)
+{
+	ni_hashmap_entry_t **buckets, *entry;
+	unsigned int i, n;
+
+	buckets = xcalloc(size, sizeof(*buckets));
+	for (i = 0; i < map->size; ++i) {
+		while ((entry = map->buckets[i]) != NULL) {
+			map->buckets[i] = entry->next;
+			n = entry->hash & (size - 1);
+			entry->next = buckets[n];
+			buckets[n] = entry;
+		}
+	}
+	free(map->buckets);
+	map->buckets = buckets;
+	map->size = size;
+}
+
+ni_bool_t
+ni_hashmap_insert(ni_hashmap_t *map, unsigned int hash, void *item)
+{
+	ni_hashmap_entry_t *entry;
+	unsigned int n;
+
+	if (!map)
+		return FALSE;
+
+	if (map->size == 0)
+		ni_hashmap_resize(map, NI_HASHMAP_MIN_SIZE);
+	else
+	if (map->count >= map->size)
+		ni_hashmap_resize(map, map->size * 2);
+
+	entry = xcalloc(1, sizeof(*entry));
+	entry->hash = hash;
+	entry->item = item;
+
+	n = hash & (map->size - 1);
+	entry->next = map->buckets[n];
+	map->buckets[n] = entry;
+	map->count++;
+	return TRUE;
+}
+
+void *
+ni_hashmap_remove(ni_hashmap_t *map, unsigned int hash, const void *item)
+{
+	ni_hashmap_entry_t **pos, *entry;
+	void *ret;
+
+	if (!map || !map->size)
+		return NULL;
+
+	for (pos = &map->buckets[hash & (map->size - 1)]; (entry = *pos); pos = &entry->next) {
+		if (entry->hash != hash || entry->item != item)
+			continue;
+
+		*pos = entry->next;
+		ret = entry->item;
+		free(entry);
+		map->count--;
+		return ret;
+	}
+	return NULL;
+}
+
+ni_hashmap_entry_t *
+ni_hashmap_first(const ni_hashmap_t *map, unsigned int hash)
+{
+	ni_hashmap_entry_t *entry;
+
+	if (!map || !map->size)
+		return NULL;
+
+	for (entry = map->buckets[hash & (map->size - 1)]; entry; entry = entry->next) {
+		if (entry->hash == hash)
+			return entry;
+	}
+	return NULL;
+}
+
+ni_hashmap_entry_t *
+ni_hashmap_next(const ni_hashmap_entry_t *prev)
+{
+	ni_hashmap_entry_t *entry;
+
+	if (!prev)
+		return NULL;
+
+	for (entry = prev->next; entry; entry = entry->next) {
+		if (entry->hash == prev->hash)
+			return entry;
+	}
+	return NULL;
+}
+
+/*
+ * Hash functions
+ */
+unsigned int
+ni_hashmap_hash_uint(unsigned int value)
+{
+	/* murmur3 finalizer */
+	value ^= value >> 16;
+	value *= 0x85ebca6bU;
+	value ^= value >> 13;
+	value *= 0xc2b2ae35U;
+	value ^= value >> 16;
+	return value;
+}
+
+unsigned int
+ni_hashmap_hash_ptr(const void *ptr)
+{
+	uint64_t value = (uintptr_t)ptr;
+
+	return ni_hashmap_hash_uint((unsigned int)(value ^ (value >> 32)));
+}
+
+unsigned int
+ni_hashmap_hash_data(unsigned int hash, const void *data, size_t len)
+{
+	const unsigned char *ptr = data;
+
+	/* FNV-1a, pass 0 to start a new hash or a hash to continue */
+	if (!hash)
+		hash = NI_HASHMAP_FNV_OFFSET;
+	while (ptr && len--) {
+		hash ^= *ptr++;
+		hash *= NI_HASHMAP_FNV_PRIME;
+	}
+	return hash;
+}
+
+unsigned int
+ni_hashmap_hash_string(const char *str)
+{
+	return ni_hashmap_hash_data(0, str, ni_string_len(str));
+}
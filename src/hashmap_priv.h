@@ -0,0 +1,65 @@
+/*
+ *	Hash map of items indexed by caller computed hash values
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NI_WICKED_HASHMAP_PRIV_H
+#define NI_WICKED_HASHMAP_PRIV_H
+
+#include <wicked/types.h>
+
+/*
+ * The map does not know anything about the item keys: the caller
+ * computes the hash of the key, inserts the item with it and walks
+ * the items with equal hash to compare the keys.  Multiple items may
+ * be inserted with the same hash, in no particular walk order.
+ * The map does not own the items.
+ */
+typedef struct ni_hashmap_entry	ni_hashmap_entry_t;
+typedef struct ni_hashmap	ni_hashmap_t;
+
+struct ni_hashmap_entry {
+	ni_hashmap_entry_t *	next;
+	unsigned int		hash;
+	void *			item;
+};
+
+struct ni_hashmap {
+	unsigned int		count;
+	unsigned int		size;
+	ni_hashmap_entry_t **	buckets;
+};
+
+#define NI_HASHMAP_INIT		{ .count = 0, .size = 0, .buckets = NULL }
+
+#define ni_hashmap_foreach(map, hash, entry)				\
+	for (entry = ni_hashmap_first(map, hash); entry;		\
+	     entry = ni_hashmap_next(entry))
+
+extern void			ni_hashmap_init(ni_hashmap_t *);
+extern void			ni_hashmap_destroy(ni_hashmap_t *);
+
+extern ni_bool_t		ni_hashmap_insert(ni_hashmap_t *, unsigned int, void *);
+extern void *			ni_hashmap_remove(ni_hashmap_t *, unsigned int, const void *);
+extern ni_hashmap_entry_t *	ni_hashmap_first(const ni_hashmap_t *, unsigned int);
+extern ni_hashmap_entry_t *	ni_hashmap_next(const ni_hashmap_entry_t *);
+
+extern unsigned int		ni_hashmap_hash_uint(unsigned int);
+extern unsigned int		ni_hashmap_hash_ptr(const void *);
+extern unsigned int		ni_hashmap_hash_string(const char *);
+extern unsigned int		ni_hashmap_hash_data(unsigned int, const void *, size_t);
+
+#endif /* NI_WICKED_HASHMAP_PRIV_H */
@@ -36,6 +36,7 @@
 
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "hashmap_priv.h"
 #include "sysfs.h"
 #include "kernel.h"
 #include "appconfig.h"
@@ -130,11 +131,7 @@ static int	__ni_rtnl_link_add_port_up(const ni_netdev_t *, const char *, unsigne
 static int	__ni_rtnl_link_bond_enslave(const ni_netdev_t *, const char *, unsigned int);
 
 static int	__ni_rtnl_send_deladdr(ni_netdev_t *, const ni_address_t *);
-static int	__ni_rtnl_send_newaddr(ni_netdev_t *, const ni_address_t *, int);
 static int	__ni_rtnl_send_delroute(ni_netdev_t *, ni_route_t *);
-static int	__ni_rtnl_send_newroute(ni_netdev_t *, ni_route_t *, int);
-static int	__ni_rtnl_send_newrule(const ni_rule_t *, int);
-static int	__ni_rtnl_send_delrule(const ni_rule_t *);
 
 static int	addattr_sockaddr(struct nl_msg *, int, const ni_sockaddr_t *);
 
@@ -4165,20 +4162,12 @@ __ni_netdev_address_in_list(ni_address_t *list, const ni_address_t *ap)
 	return NULL;
 }
 
-static int
-__ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
+static struct nl_msg *
+__ni_rtnl_newaddr_msg(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 {
-	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	unsigned int omit = IFA_F_TENTATIVE|IFA_F_DADFAILED;
 	struct ifaddrmsg ifa;
 	struct nl_msg *msg;
-	int err;
-
-	ni_debug_ifconfig("%s(%s, %s %s)", __FUNCTION__, dev->name,
-			flags & NLM_F_REPLACE ? "replace " :
-			flags & NLM_F_CREATE  ? "create " : "",
-			ni_address_print(&buf, ap));
-	ni_stringbuf_destroy(&buf);
 
 	memset(&ifa, 0, sizeof(ifa));
 	ifa.ifa_index = dev->link.ifindex;
@@ -4251,31 +4240,38 @@ __ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 			goto nla_put_failure;
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
-		ni_error("%s(%s/%u): ni_nl_talk failed [%s]", __func__,
-				ni_sockaddr_print(&ap->local_addr),
-				ap->prefixlen,  nl_geterror(err));
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink attr");
-failed:
 	nlmsg_free(msg);
-	return -1;
+	return NULL;
 }
 
 static int
-__ni_rtnl_send_deladdr(ni_netdev_t *dev, const ni_address_t *ap)
+__ni_rtnl_batch_newaddr(ni_nl_batch_t *batch, ni_netdev_t *dev, const ni_address_t *ap,
+			int flags, ni_nl_batch_done_fn_t *done, void *user_data)
 {
-	struct ifaddrmsg ifa;
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct nl_msg *msg;
-	int err;
 
-	ni_debug_ifconfig("%s(%s/%u)", __FUNCTION__, ni_sockaddr_print(&ap->local_addr), ap->prefixlen);
+	ni_debug_ifconfig("%s(%s, %s %s)", __FUNCTION__, dev->name,
+			flags & NLM_F_REPLACE ? "replace " :
+			flags & NLM_F_CREATE  ? "create " : "",
+			ni_address_print(&buf, ap));
+	ni_stringbuf_destroy(&buf);
+
+	if (!(msg = __ni_rtnl_newaddr_msg(dev, ap, flags)))
+		return -1;
+
+	return ni_nl_batch_add(batch, msg, done, user_data);
+}
+
+static struct nl_msg *
+__ni_rtnl_deladdr_msg(ni_netdev_t *dev, const ni_address_t *ap)
+{
+	struct ifaddrmsg ifa;
+	struct nl_msg *msg;
 
 	memset(&ifa, 0, sizeof(ifa));
 	ifa.ifa_index = dev->link.ifindex;
@@ -4297,39 +4293,59 @@ __ni_rtnl_send_deladdr(ni_netdev_t *dev, const ni_address_t *ap)
 			goto nla_put_failure;
 	}
 
+	return msg;
+
+nla_put_failure:
+	ni_error("failed to encode netlink attr");
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int
+__ni_rtnl_send_deladdr(ni_netdev_t *dev, const ni_address_t *ap)
+{
+	struct nl_msg *msg;
+	int err;
+
+	ni_debug_ifconfig("%s(%s/%u)", __FUNCTION__, ni_sockaddr_print(&ap->local_addr), ap->prefixlen);
+
+	if (!(msg = __ni_rtnl_deladdr_msg(dev, ap)))
+		return -1;
+
 	if ((err = ni_nl_talk(msg, NULL)) < 0) {
 		ni_error("%s(%s/%u): rtnl_talk failed: %s", __func__,
 				ni_sockaddr_print(&ap->local_addr),
 				ap->prefixlen,  nl_geterror(err));
-		goto failed;
+		nlmsg_free(msg);
+		return -1;
 	}
 
 	nlmsg_free(msg);
 	return 0;
+}
 
-nla_put_failure:
-	ni_error("failed to encode netlink attr");
-failed:
-	nlmsg_free(msg);
-	return -1;
+static int
+__ni_rtnl_batch_deladdr(ni_nl_batch_t *batch, ni_netdev_t *dev, const ni_address_t *ap,
+			ni_nl_batch_done_fn_t *done, void *user_data)
+{
+	struct nl_msg *msg;
+
+	ni_debug_ifconfig("%s(%s/%u)", __FUNCTION__, ni_sockaddr_print(&ap->local_addr), ap->prefixlen);
+
+	if (!(msg = __ni_rtnl_deladdr_msg(dev, ap)))
+		return -1;
+
+	return ni_nl_batch_add(batch, msg, done, user_data);
 }
 
 /*
  * Add a static route
  */
-static int
-__ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
+static struct nl_msg *
+__ni_rtnl_newroute_msg(ni_netdev_t *dev, ni_route_t *rp, int flags)
 {
-	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct rtmsg rt;
 	struct nl_msg *msg;
-	int err;
-
-	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
-			flags & NLM_F_REPLACE ? "replace " :
-			flags & NLM_F_CREATE  ? "create " : "",
-			ni_route_print(&buf, rp));
-	ni_stringbuf_destroy(&buf);
 
 	memset(&rt, 0, sizeof(rt));
 
@@ -4509,35 +4525,42 @@ __ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
 		nla_nest_end(msg, mxrta);
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
-		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
-		ni_error("%s(%s): ni_nl_talk failed [%s]", __FUNCTION__,
-				ni_route_print(&buf, rp),  nl_geterror(err));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink attr");
 failed:
 	nlmsg_free(msg);
-	return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+	return NULL;
 }
 
 static int
-__ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
+__ni_rtnl_batch_newroute(ni_nl_batch_t *batch, ni_netdev_t *dev, ni_route_t *rp,
+			int flags, ni_nl_batch_done_fn_t *done, void *user_data)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
-	struct rtmsg rt;
 	struct nl_msg *msg;
-	int err;
 
-	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_route_print(&buf, rp));
+	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
+			flags & NLM_F_REPLACE ? "replace " :
+			flags & NLM_F_CREATE  ? "create " : "",
+			ni_route_print(&buf, rp));
 	ni_stringbuf_destroy(&buf);
 
+	if (!(msg = __ni_rtnl_newroute_msg(dev, rp, flags)))
+		return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+
+	if (ni_nl_batch_add(batch, msg, done, user_data) < 0)
+		return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+	return 0;
+}
+
+static struct nl_msg *
+__ni_rtnl_delroute_msg(ni_netdev_t *dev, ni_route_t *rp)
+{
+	struct rtmsg rt;
+	struct nl_msg *msg;
+
 	memset(&rt, 0, sizeof(rt));
 	rt.rtm_family = rp->family;
 	rt.rtm_table = RT_TABLE_MAIN;
@@ -4563,22 +4586,54 @@ __ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
 
 	NLA_PUT_U32(msg, RTA_OIF, dev->link.ifindex);
 
+	return msg;
+
+nla_put_failure:
+	ni_error("failed to encode netlink attr");
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int
+__ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	struct nl_msg *msg;
+	int err;
+
+	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_route_print(&buf, rp));
+	ni_stringbuf_destroy(&buf);
+
+	if (!(msg = __ni_rtnl_delroute_msg(dev, rp)))
+		return -1;
+
 	if ((err = ni_nl_talk(msg, NULL)) < 0) {
 		ni_error("%s(%s): rtnl_talk failed[%d]: %s", __func__,
 				ni_route_print(&buf, rp),
 				err, nl_geterror(err));
 		ni_stringbuf_destroy(&buf);
-		goto failed;
+		nlmsg_free(msg);
+		return -1;
 	}
 
 	nlmsg_free(msg);
 	return 0;
+}
 
-nla_put_failure:
-	ni_error("failed to encode netlink attr");
-failed:
-	nlmsg_free(msg);
-	return -1;
+static int
+__ni_rtnl_batch_delroute(ni_nl_batch_t *batch, ni_netdev_t *dev, ni_route_t *rp,
+			ni_nl_batch_done_fn_t *done, void *user_data)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	struct nl_msg *msg;
+
+	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_route_print(&buf, rp));
+	ni_stringbuf_destroy(&buf);
+
+	if (!(msg = __ni_rtnl_delroute_msg(dev, rp)))
+		return -1;
+
+	return ni_nl_batch_add(batch, msg, done, user_data);
 }
 
 static int
@@ -4628,19 +4683,11 @@ nla_put_failure:
 	return -1;
 }
 
-static int
-__ni_rtnl_send_newrule(const ni_rule_t *rule, int flags)
+static struct nl_msg *
+__ni_rtnl_newrule_msg(const ni_rule_t *rule, int flags)
 {
-	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct nl_msg *msg;
 	struct fib_rule_hdr frh;
-	int err;
-
-	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
-			flags & NLM_F_REPLACE ? "replace " :
-			flags & NLM_F_CREATE  ? "create " : "",
-			ni_rule_print(&buf, rule));
-	ni_stringbuf_destroy(&buf);
 
 	memset(&frh, 0, sizeof(frh));
 	frh.family = rule->family;
@@ -4659,33 +4706,39 @@ __ni_rtnl_send_newrule(const ni_rule_t *rule, int flags)
 	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
 		goto nla_put_failure;
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
-		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink NEWRULE message attribute");
-failed:
 	nlmsg_free(msg);
-	return -1;
+	return NULL;
 }
 
 static int
-__ni_rtnl_send_delrule(const ni_rule_t *rule)
+__ni_rtnl_batch_newrule(ni_nl_batch_t *batch, const ni_rule_t *rule, int flags,
+			ni_nl_batch_done_fn_t *done, void *user_data)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
-	struct fib_rule_hdr frh;
 	struct nl_msg *msg;
-	int err;
 
-	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_rule_print(&buf, rule));
+	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
+			flags & NLM_F_REPLACE ? "replace " :
+			flags & NLM_F_CREATE  ? "create " : "",
+			ni_rule_print(&buf, rule));
 	ni_stringbuf_destroy(&buf);
 
+	if (!(msg = __ni_rtnl_newrule_msg(rule, flags)))
+		return -1;
+
+	return ni_nl_batch_add(batch, msg, done, user_data);
+}
+
+static struct nl_msg *
+__ni_rtnl_delrule_msg(const ni_rule_t *rule)
+{
+	struct fib_rule_hdr frh;
+	struct nl_msg *msg;
+
 	memset(&frh, 0, sizeof(frh));
 	frh.family = rule->family;
 	frh.action = rule->action;
@@ -4703,20 +4756,28 @@ __ni_rtnl_send_delrule(const ni_rule_t *rule)
 	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
 		goto nla_put_failure;
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_OBJ_NOTFOUND) {
-		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink DELRULE message attribute");
-failed:
 	nlmsg_free(msg);
-	return -1;
+	return NULL;
+}
+
+static int
+__ni_rtnl_batch_delrule(ni_nl_batch_t *batch, const ni_rule_t *rule,
+			ni_nl_batch_done_fn_t *done, void *user_data)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	struct nl_msg *msg;
+
+	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_rule_print(&buf, rule));
+	ni_stringbuf_destroy(&buf);
+
+	if (!(msg = __ni_rtnl_delrule_msg(rule)))
+		return -1;
+
+	return ni_nl_batch_add(batch, msg, done, user_data);
 }
 
 static void
@@ -5083,6 +5144,102 @@ ni_address_updater_arp_send(ni_addrconf_updater_t *updater, ni_netdev_t *dev, ni
 	return FALSE;
 }
 
+/*
+ * Batched address updates; the done callbacks apply the
+ * result of each request to the device and lease address.
+ */
+typedef struct ni_netdev_addr_update {
+	ni_netdev_t *			dev;
+	ni_addrconf_lease_t *		lease;
+	ni_address_updater_t *		au;
+	int				rv;
+} ni_netdev_addr_update_t;
+
+typedef struct ni_netdev_addr_op {
+	ni_netdev_addr_update_t *	update;
+	ni_address_t *			addr;	/* address in request	*/
+	ni_address_t *			cur;	/* address to replace	*/
+} ni_netdev_addr_op_t;
+
+static ni_netdev_addr_op_t *
+ni_netdev_addr_op_new(ni_netdev_addr_update_t *update, ni_address_t *addr, ni_address_t *cur)
+{
+	ni_netdev_addr_op_t *op;
+
+	op = xcalloc(1, sizeof(*op));
+	op->update = update;
+	op->addr = addr;
+	op->cur = cur;
+	return op;
+}
+
+static void
+ni_netdev_addr_del_done(ni_nl_batch_t *batch, int err, void *user_data)
+{
+	ni_netdev_addr_op_t *op = user_data;
+	ni_address_t *ap = op->addr;
+
+	if (err < 0) {
+		ni_error("%s: failed to delete address %s/%u: %s",
+				op->update->dev->name,
+				ni_sockaddr_print(&ap->local_addr),
+				ap->prefixlen, nl_geterror(err));
+	}
+	free(op);
+}
+
+static void
+ni_netdev_addr_new_done(ni_nl_batch_t *batch, int err, void *user_data)
+{
+	ni_netdev_addr_op_t *op = user_data;
+	ni_netdev_addr_update_t *update = op->update;
+	ni_address_t *ap = op->addr;
+
+	if (err < 0 && abs(err) != NLE_EXIST) {
+		ni_error("%s: failed to %s address %s/%u: %s", update->dev->name,
+				op->cur ? "replace" : "create",
+				ni_sockaddr_print(&ap->local_addr),
+				ap->prefixlen, nl_geterror(err));
+		if (!op->cur)
+			update->rv = -1;
+	} else {
+		ap->owner = update->lease->type;
+		if (op->cur)
+			ni_address_copy(op->cur, ap);
+		else
+			ni_arp_notify_add_address(&update->au->notify, ap);
+	}
+	free(op);
+}
+
+static int
+ni_netdev_addr_batch_del(ni_nl_batch_t *batch, ni_netdev_addr_update_t *update,
+			ni_address_t *ap)
+{
+	ni_netdev_addr_op_t *op = ni_netdev_addr_op_new(update, ap, NULL);
+
+	if (__ni_rtnl_batch_deladdr(batch, update->dev, ap,
+				ni_netdev_addr_del_done, op) < 0) {
+		free(op);
+		return -1;
+	}
+	return 0;
+}
+
+static int
+ni_netdev_addr_batch_new(ni_nl_batch_t *batch, ni_netdev_addr_update_t *update,
+			ni_address_t *ap, ni_address_t *cur, int flags)
+{
+	ni_netdev_addr_op_t *op = ni_netdev_addr_op_new(update, ap, cur);
+
+	if (__ni_rtnl_batch_newaddr(batch, update->dev, ap, flags,
+				ni_netdev_addr_new_done, op) < 0) {
+		free(op);
+		return -1;
+	}
+	return 0;
+}
+
 static int
 __ni_netdev_update_addrs(ni_netdev_t *dev,
 				const ni_addrconf_lease_t *old_lease,
@@ -5090,12 +5247,13 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 				ni_addrconf_updater_t     *updater)
 {
 	unsigned int max_changes = NI_ADDRCONF_UPDATER_MAX_ADDR_CHANGES;
+	ni_netdev_addr_update_t update = { .dev = dev, .lease = new_lease };
 	ni_addrconf_mode_t owner = NI_ADDRCONF_NONE;
 	ni_address_updater_t *au;
 	unsigned int family = AF_UNSPEC;
 	ni_address_t *ap, *next;
+	ni_nl_batch_t *batch;
 	unsigned int minprio;
-	int rv;
 
 	do {
 		__ni_global_seqno++;
@@ -5117,6 +5275,10 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 		ni_error("%s: unable to initialize address updater", dev->name);
 		return -1;
 	}
+	update.au = au;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
 
 	for (ap = dev->addrs; ap; ap = next) {
 		ni_address_t *new_addr;
@@ -5195,34 +5357,34 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 					ni_sockaddr_print(&ap->local_addr), ap->prefixlen);
 
 			if (replace < 0)
-				__ni_rtnl_send_deladdr(dev, ap);
+				ni_netdev_addr_batch_del(batch, &update, ap);
 
 			if (!ni_address_lft_is_valid(new_addr, NULL))
 				continue;
 
-			if ((rv = __ni_rtnl_send_newaddr(dev, new_addr, NLM_F_REPLACE)) < 0)
-				continue;
-
-			new_addr->owner = new_lease->type;
-			ni_address_copy(ap, new_addr);
+			ni_netdev_addr_batch_new(batch, &update, new_addr, ap, NLM_F_REPLACE);
 		} else {
 			if (max_changes == 0)
 				break;
 			else max_changes--;
 
-			if ((rv = __ni_rtnl_send_deladdr(dev, ap)) < 0)
-				continue;
+			ni_netdev_addr_batch_del(batch, &update, ap);
 		}
 	}
 
-	if (max_changes == 0)
+	ni_nl_batch_flush(batch);
+	if (max_changes == 0) {
+		ni_nl_batch_free(batch);
 		return 1;
+	}
 
 	/* Loop over all addresses in the configuration and create
 	 * those that don't exist yet.
 	 */
-	if (family == AF_INET && ni_address_updater_arp_send(updater, dev, owner))
+	if (family == AF_INET && ni_address_updater_arp_send(updater, dev, owner)) {
+		ni_nl_batch_free(batch);
 		return 1;
+	}
 
 	for (ap = new_lease ? new_lease->addrs : NULL ; ap; ap = ap->next) {
 		unsigned int count = 0;
@@ -5261,14 +5423,17 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 				ap->prefixlen);
 
 		__ni_netdev_addr_complete(dev, ap);
-		if ((rv = __ni_rtnl_send_newaddr(dev, ap, NLM_F_CREATE)) < 0)
-			return rv;
-
-		ap->owner = new_lease->type;
-
-		ni_arp_notify_add_address(&au->notify, ap);
+		if (ni_netdev_addr_batch_new(batch, &update, ap, NULL, NLM_F_CREATE) < 0) {
+			update.rv = -1;
+			break;
+		}
 	}
 
+	ni_nl_batch_flush(batch);
+	ni_nl_batch_free(batch);
+	if (update.rv < 0)
+		return update.rv;
+
 	if (family == AF_INET && ni_address_updater_arp_send(updater, dev, owner))
 		return 1;
 
@@ -5336,18 +5501,136 @@ __ni_skip_conflicting_route(ni_netconfig_t *nc, ni_netdev_t *our_dev,
 	return NULL;
 }
 
+/*
+ * Batched route updates; the done callbacks apply the
+ * result of each request to the netconfig route tables.
+ */
+typedef struct ni_netdev_route_update {
+	ni_netconfig_t *		nc;
+	ni_netdev_t *			dev;
+	ni_addrconf_lease_t *		lease;
+	int				rv;
+} ni_netdev_route_update_t;
+
+typedef struct ni_netdev_route_op {
+	ni_netdev_route_update_t *	update;
+	ni_route_t *			route;	/* route in request	*/
+	ni_route_t *			cur;	/* route to replace	*/
+} ni_netdev_route_op_t;
+
+static ni_netdev_route_op_t *
+ni_netdev_route_op_new(ni_netdev_route_update_t *update, ni_route_t *route, ni_route_t *cur)
+{
+	ni_netdev_route_op_t *op;
+
+	op = xcalloc(1, sizeof(*op));
+	op->update = update;
+	op->route = route;
+	op->cur = cur;
+	return op;
+}
+
+static void
+ni_netdev_route_del_done(ni_nl_batch_t *batch, int err, void *user_data)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_netdev_route_op_t *op = user_data;
+
+	if (err < 0) {
+		ni_error("%s: failed to delete route %s: %s",
+				op->update->dev->name,
+				ni_route_print(&buf, op->route),
+				nl_geterror(err));
+		ni_stringbuf_destroy(&buf);
+	}
+	free(op);
+}
+
+static int
+ni_netdev_route_batch_del(ni_nl_batch_t *batch, ni_netdev_route_update_t *update,
+			ni_route_t *rp)
+{
+	ni_netdev_route_op_t *op = ni_netdev_route_op_new(update, rp, NULL);
+
+	if (__ni_rtnl_batch_delroute(batch, update->dev, rp,
+				ni_netdev_route_del_done, op) < 0) {
+		free(op);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+ni_netdev_route_new_done(ni_nl_batch_t *batch, int err, void *user_data)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_netdev_route_op_t *op = user_data;
+	ni_netdev_route_update_t *update = op->update;
+	ni_netdev_t *dev = update->dev;
+	ni_route_t *rp = op->route;
+
+	if (err < 0 && abs(err) != NLE_EXIST) {
+		ni_error("%s: failed to %s route %s: %s", dev->name,
+				op->cur ? "update" : "create",
+				ni_route_print(&buf, rp), nl_geterror(err));
+		ni_stringbuf_destroy(&buf);
+
+		if (op->cur) {
+			ni_debug_ifconfig("%s: trying to delete existing route %s",
+					dev->name, ni_route_print(&buf, op->cur));
+			ni_stringbuf_destroy(&buf);
+			ni_netdev_route_batch_del(batch, update, op->cur);
+
+			/* unmark to create it in the add loop */
+			rp->seq = 0;
+		} else {
+			update->rv = -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+		}
+	} else {
+		if (op->cur) {
+			ni_debug_ifconfig("%s: successfully updated existing route %s",
+					dev->name, ni_route_print(&buf, op->cur));
+			ni_stringbuf_destroy(&buf);
+		} else {
+			update->rv = 0;
+		}
+		rp->owner = update->lease->type;
+		rp->seq = __ni_global_seqno;
+		ni_netconfig_route_add(update->nc, rp, dev);
+	}
+	free(op);
+}
+
+static int
+ni_netdev_route_batch_new(ni_nl_batch_t *batch, ni_netdev_route_update_t *update,
+			ni_route_t *rp, ni_route_t *cur, int flags)
+{
+	ni_netdev_route_op_t *op = ni_netdev_route_op_new(update, rp, cur);
+	int rv;
+
+	if ((rv = __ni_rtnl_batch_newroute(batch, update->dev, rp, flags,
+				ni_netdev_route_new_done, op)) < 0)
+		free(op);
+	return rv;
+}
+
 static int
 __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 				const ni_addrconf_lease_t *old_lease,
 				ni_addrconf_lease_t       *new_lease)
 {
+	ni_netdev_route_update_t update = { .nc = nc, .dev = dev, .lease = new_lease };
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_addrconf_mode_t old_type = NI_ADDRCONF_NONE;
 	unsigned int family = AF_UNSPEC;
 	ni_route_table_t *tab, *cfg_tab;
 	ni_route_t *rp, *new_route;
 	unsigned int minprio, i;
-	int rv = 0;
+	ni_nl_batch_t *batch;
+	int rv;
+
+	if (!(batch = ni_nl_batch_new()))
+		return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
 
 	do {
 		__ni_global_seqno++;
@@ -5420,14 +5703,11 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 			}
 
 			if (new_route != NULL) {
-				if (__ni_rtnl_send_newroute(dev, new_route, NLM_F_REPLACE) >= 0) {
-					ni_debug_ifconfig("%s: successfully updated existing route %s",
-							dev->name, ni_route_print(&buf, rp));
-					ni_stringbuf_destroy(&buf);
-					new_route->owner = new_lease->type;
+				/* deletes existing route when the update fails */
+				if (ni_netdev_route_batch_new(batch, &update, new_route,
+							rp, NLM_F_REPLACE) >= 0) {
+					/* mark it to skip in add loop */
 					new_route->seq = __ni_global_seqno;
-					ni_netconfig_route_add(nc, new_route, dev);
-
 					continue;
 				}
 
@@ -5440,11 +5720,10 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_route_print(&buf, rp));
 			ni_stringbuf_destroy(&buf);
 
-			if ((__ni_rtnl_send_delroute(dev, rp)) < 0) {
-				continue;
-			}
+			ni_netdev_route_batch_del(batch, &update, rp);
 		}
 	}
+	ni_nl_batch_flush(batch);
 
 	/* Loop over all tables and routes in the configuration
 	 * and create those that don't exist yet.
@@ -5466,16 +5745,15 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_route_print(&buf, rp));
 			ni_stringbuf_destroy(&buf);
 
-			if ((rv = __ni_rtnl_send_newroute(dev, rp, NLM_F_CREATE)) < 0)
-				continue;
-
-			rp->owner = new_lease->type;
-			rp->seq = __ni_global_seqno;
-			ni_netconfig_route_add(nc, rp, dev);
+			if ((rv = ni_netdev_route_batch_new(batch, &update, rp,
+							NULL, NLM_F_CREATE)) < 0)
+				update.rv = rv;
 		}
 	}
+	ni_nl_batch_flush(batch);
+	ni_nl_batch_free(batch);
 
-	return rv;
+	return update.rv;
 }
 
 const ni_addrconf_lease_t *
@@ -5597,6 +5875,88 @@ ni_netinfo_find_rule_owner(ni_netconfig_t *nc, ni_rule_t *rule, unsigned int min
 	return ni_netinfo_find_rule_lost_owner(nc, rule, minprio);
 }
 
+/*
+ * Batched rule updates; the done callbacks apply the
+ * result of each request to the netconfig rule array.
+ */
+typedef struct ni_netdev_rule_op {
+	ni_netconfig_t *		nc;
+	ni_netdev_t *			dev;
+	ni_rule_t *			rule;
+} ni_netdev_rule_op_t;
+
+static ni_netdev_rule_op_t *
+ni_netdev_rule_op_new(ni_netconfig_t *nc, ni_netdev_t *dev, ni_rule_t *rule)
+{
+	ni_netdev_rule_op_t *op;
+
+	op = xcalloc(1, sizeof(*op));
+	op->nc = nc;
+	op->dev = dev;
+	op->rule = rule;
+	return op;
+}
+
+static void
+ni_netdev_rule_del_done(ni_nl_batch_t *batch, int err, void *user_data)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_netdev_rule_op_t *op = user_data;
+
+	if (err < 0 && abs(err) != NLE_OBJ_NOTFOUND) {
+		ni_error("%s: failed to delete rule %s: %s", op->dev->name,
+				ni_rule_print(&buf, op->rule), nl_geterror(err));
+		ni_stringbuf_destroy(&buf);
+	} else {
+		ni_netconfig_rule_del(op->nc, op->rule, NULL);
+	}
+	free(op);
+}
+
+static void
+ni_netdev_rule_new_done(ni_nl_batch_t *batch, int err, void *user_data)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_netdev_rule_op_t *op = user_data;
+
+	if (err < 0 && abs(err) != NLE_EXIST) {
+		ni_error("%s: failed to apply rule %s: %s", op->dev->name,
+				ni_rule_print(&buf, op->rule), nl_geterror(err));
+		ni_stringbuf_destroy(&buf);
+		ni_rule_free(op->rule);
+	} else {
+		ni_netconfig_rule_add(op->nc, op->rule);
+	}
+	free(op);
+}
+
+/*
+ * Rule lookups in the lease rule arrays by ni_rule_hash
+ */
+static void
+ni_rule_index_build(ni_hashmap_t *index, const ni_rule_array_t *rules)
+{
+	unsigned int i;
+
+	for (i = 0; rules && i < rules->count; ++i) {
+		if (rules->data[i])
+			ni_hashmap_insert(index, ni_rule_hash(rules->data[i]), rules->data[i]);
+	}
+}
+
+static ni_rule_t *
+ni_rule_index_find(const ni_hashmap_t *index, const ni_rule_t *rule,
+		ni_bool_t (*match)(const ni_rule_t *, const ni_rule_t *))
+{
+	ni_hashmap_entry_t *he;
+
+	ni_hashmap_foreach(index, ni_rule_hash(rule), he) {
+		if (match(he->item, rule))
+			return he->item;
+	}
+	return NULL;
+}
+
 static int
 __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 			const ni_addrconf_lease_t *old_lease,
@@ -5605,9 +5965,14 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_rule_array_t del_rules = NI_RULE_ARRAY_INIT;
 	ni_rule_array_t mod_rules = NI_RULE_ARRAY_INIT;
+	ni_hashmap_t old_index = NI_HASHMAP_INIT;
+	ni_hashmap_t del_index = NI_HASHMAP_INIT;
+	ni_hashmap_t mod_index = NI_HASHMAP_INIT;
 	const ni_addrconf_lease_t *lease;
+	ni_netdev_rule_op_t *op;
 	ni_rule_array_t *old_rules;
 	ni_rule_array_t *new_rules;
+	ni_nl_batch_t *batch;
 	ni_rule_t *rule, *r;
 	unsigned int prio;
 	unsigned int i;
@@ -5618,6 +5983,7 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 
 	if (new_lease && (new_rules = new_lease->rules)) {
 		old_rules = old_lease ? old_lease->rules : NULL;
+		ni_rule_index_build(&old_index, old_rules);
 
 		for (i = 0; i < new_rules->count; ++i) {
 			rule = new_rules->data[i];
@@ -5627,10 +5993,10 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_rule_print(&out, rule));
 			ni_stringbuf_destroy(&out);
 
-			if (!rule || ni_rule_array_index(&mod_rules, rule) != -1U)
+			if (!rule || ni_rule_index_find(&mod_index, rule, ni_rule_equal_ref))
 				continue;
 
-			r = ni_rule_array_find_match(old_rules, rule, ni_rule_equal);
+			r = ni_rule_index_find(&old_index, rule, ni_rule_equal);
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_IFCONFIG|NI_TRACE_ROUTE,
 					"%s: rule to %s: %s", dev->name,
 					r ? "update" : "create",
@@ -5638,7 +6004,8 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 			ni_stringbuf_destroy(&out);
 
 			rule->seq = r ? __ni_global_seqno : 0;
-			ni_rule_array_append(&mod_rules, ni_rule_ref(rule));
+			if (ni_rule_array_append(&mod_rules, ni_rule_ref(rule)))
+				ni_hashmap_insert(&mod_index, ni_rule_hash(rule), rule);
 		}
 	} else {
 		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_IFCONFIG|NI_TRACE_ROUTE,
@@ -5656,10 +6023,10 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_rule_print(&out, rule));
 			ni_stringbuf_destroy(&out);
 
-			if (!rule || ni_rule_array_index(&del_rules, rule) != -1U)
+			if (!rule || ni_rule_index_find(&del_index, rule, ni_rule_equal_ref))
 				continue;
 
-			if (ni_rule_array_find_match(&mod_rules, rule, ni_rule_equal))
+			if (ni_rule_index_find(&mod_index, rule, ni_rule_equal))
 				continue;
 
 			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_IFCONFIG|NI_TRACE_ROUTE,
@@ -5667,12 +6034,16 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_rule_print(&out, rule));
 			ni_stringbuf_destroy(&out);
 
-			ni_rule_array_append(&del_rules, ni_rule_ref(rule));
+			if (ni_rule_array_append(&del_rules, ni_rule_ref(rule)))
+				ni_hashmap_insert(&del_index, ni_rule_hash(rule), rule);
 		}
 	} else {
 		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_IFCONFIG|NI_TRACE_ROUTE,
 				"%s: no old lease rules", dev->name);
 	}
+	ni_hashmap_destroy(&old_index);
+	ni_hashmap_destroy(&del_index);
+	ni_hashmap_destroy(&mod_index);
 
 	if (!del_rules.count && !mod_rules.count)
 		return 0;
@@ -5680,6 +6051,9 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 	if (__ni_system_refresh_rules(nc))
 		return -1;
 
+	if (!(batch = ni_nl_batch_new()))
+		return -1;
+
 	for (i = 0; i < del_rules.count; ++i) {
 		rule = del_rules.data[i];
 
@@ -5714,10 +6088,10 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 			}
 
 			/* OK to delete -- no other lease provides it */
-			if (__ni_rtnl_send_delrule(rule) < 0)
-				continue;
-
-			ni_netconfig_rule_del(nc, rule, NULL);
+			op = ni_netdev_rule_op_new(nc, dev, rule);
+			if (__ni_rtnl_batch_delrule(batch, rule,
+						ni_netdev_rule_del_done, op) < 0)
+				free(op);
 		}
 	}
 
@@ -5771,12 +6145,15 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 
 		r->seq = __ni_global_seqno;
 		r->owner = new_lease->uuid;
-		if (__ni_rtnl_send_newrule(r, NLM_F_REPLACE) < 0) {
+		op = ni_netdev_rule_op_new(nc, dev, r);
+		if (__ni_rtnl_batch_newrule(batch, r, NLM_F_REPLACE,
+					ni_netdev_rule_new_done, op) < 0) {
 			ni_rule_free(r);
-		} else {
-			ni_netconfig_rule_add(nc, r);
+			free(op);
 		}
 	}
+	ni_nl_batch_flush(batch);
+	ni_nl_batch_free(batch);
 
 	(void)__ni_system_refresh_rules(nc);
 
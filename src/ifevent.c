@@ -23,6 +23,7 @@
 
 #include "netinfo_priv.h"
 #include "socket_priv.h"
+#include "hashmap_priv.h"
 #include "ipv6_priv.h"
 #include "sysfs.h"
 #include "kernel.h"
@@ -66,6 +67,15 @@ typedef struct ni_rtevent_handle
  */
 static ni_socket_t *	__ni_rtevent_sock;
 
+/*
+ * Event statistics, e.g. the event socket receive buffer overruns
+ * (ENOBUFS), and the resync of the netconfig state to recover.
+ */
+static struct {
+	ni_rtevent_stats_t	stats;
+	const ni_timer_t *	timer;
+} __ni_rtevent_resync;
+
 static int	__ni_rtevent_process(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_newlink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
 static int	__ni_rtevent_dellink(ni_netconfig_t *, const struct sockaddr_nl *, struct nlmsghdr *);
@@ -278,8 +288,17 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	if (ifi->ifi_family == AF_BRIDGE)
 		return 0;
 
+	/*
+	 * The name in the event is current unless the device got renamed
+	 * again meanwhile: use it when it matches the device we know and
+	 * query the current name of new devices and on renames only.
+	 */
 	old = ni_netdev_by_index(nc, ifi->ifi_index);
-	ni_netdev_index_to_name(&ifname, ifi->ifi_index);
+	nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME);
+	if (old && nla && ni_string_eq(old->name, nla_get_string(nla)))
+		ni_string_dup(&ifname, old->name);
+	else
+		ni_netdev_index_to_name(&ifname, ifi->ifi_index);
 	if (!ifname) {
 		/*
 		 * device (index) does not exists any more;
@@ -301,7 +320,8 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 		if (!ni_string_eq(old->name, ifname)) {
 			ni_debug_events("%s[%u]: device renamed to %s",
 					old->name, old->link.ifindex, ifname);
-			ni_string_dup(&old->name, ifname);
+			__ni_rtevent_resync.stats.renames++;
+			ni_netdev_set_name(old, ifname);
 			__ni_netdev_event(nc, old, NI_EVENT_DEVICE_RENAME);
 		}
 		dev = old;
@@ -342,7 +362,7 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 			 * Just update the name of the conflicting device in advance too
 			 * and when the interface does not exist any more, emit events.
 			 */
-			if (ni_netdev_index_to_name(&conflict->name, conflict->link.ifindex)) {
+			if (ni_netdev_refresh_name(conflict)) {
 				__ni_netdev_event(nc, conflict, NI_EVENT_DEVICE_RENAME);
 			} else {
 				unsigned int ifflags = conflict->link.ifflags;
@@ -930,6 +950,494 @@ __ni_rtevent_process_cb(struct nl_msg *msg, void *ptr)
 static ni_bool_t	__ni_rtevent_restart(ni_socket_t *sock);
 
 
+/*
+ * Resynchronize the netconfig state after we've lost events.
+ *
+ * The state before the refresh is snapshotted (holding references,
+ * or copies of the addresses the refresh updates in place) and is
+ * compared to the state after the seq-based full refresh, to emit
+ * synthetic events for created, changed and deleted devices, and for
+ * added, changed and removed addresses, routes and rules.
+ */
+typedef struct ni_rtevent_resync_item	ni_rtevent_resync_item_t;
+
+struct ni_rtevent_resync_item {
+	ni_rtevent_resync_item_t *	next;
+	unsigned int			ifindex;
+	void *				obj;
+	ni_bool_t			seen;
+};
+
+typedef struct ni_rtevent_resync_list {
+	ni_rtevent_resync_item_t *	head;
+	ni_hashmap_t			map;
+} ni_rtevent_resync_list_t;
+
+typedef struct ni_rtevent_resync_dev {
+	ni_netdev_t *			dev;
+	char *				name;
+	unsigned int			ifflags;
+} ni_rtevent_resync_dev_t;
+
+typedef struct ni_rtevent_resync_state {
+	unsigned int			count;
+	ni_rtevent_resync_dev_t *	devs;
+	ni_hashmap_t			devmap;
+	ni_rtevent_resync_list_t	addrs;
+	ni_rtevent_resync_list_t	routes;
+	ni_rtevent_resync_list_t	rules;
+} ni_rtevent_resync_state_t;
+
+static unsigned int
+__ni_rtevent_resync_hash_sockaddr(unsigned int hash, const ni_sockaddr_t *sa)
+{
+	switch (sa->ss_family) {
+	case AF_INET:
+		return ni_hashmap_hash_data(hash, &sa->sin.sin_addr, sizeof(sa->sin.sin_addr));
+	case AF_INET6:
+		return ni_hashmap_hash_data(hash, &sa->six.sin6_addr, sizeof(sa->six.sin6_addr));
+	default:
+		return hash;
+	}
+}
+
+static unsigned int
+__ni_rtevent_resync_hash_addr(unsigned int ifindex, const ni_address_t *ap)
+{
+	unsigned int hash = ni_hashmap_hash_uint(ifindex);
+
+	hash = ni_hashmap_hash_data(hash, &ap->prefixlen, sizeof(ap->prefixlen));
+	return __ni_rtevent_resync_hash_sockaddr(hash, &ap->local_addr);
+}
+
+static unsigned int
+__ni_rtevent_resync_hash_route(const ni_route_t *rp)
+{
+	unsigned int hash = ni_hashmap_hash_uint(rp->table);
+
+	hash = ni_hashmap_hash_data(hash, &rp->prefixlen, sizeof(rp->prefixlen));
+	return __ni_rtevent_resync_hash_sockaddr(hash, &rp->destination);
+}
+
+static unsigned int
+__ni_rtevent_resync_hash_rule(const ni_rule_t *rule)
+{
+	unsigned int hash = ni_hashmap_hash_uint(rule->pref);
+
+	return ni_hashmap_hash_data(hash, &rule->table, sizeof(rule->table));
+}
+
+static void
+__ni_rtevent_resync_list_add(ni_rtevent_resync_list_t *list, unsigned int hash,
+				unsigned int ifindex, void *obj)
+{
+	ni_rtevent_resync_item_t *item;
+
+	item = xcalloc(1, sizeof(*item));
+	item->ifindex = ifindex;
+	item->obj = obj;
+	item->next = list->head;
+	list->head = item;
+	ni_hashmap_insert(&list->map, hash, item);
+}
+
+static ni_bool_t
+__ni_rtevent_resync_route_known(const ni_rtevent_resync_list_t *list, const ni_route_t *rp)
+{
+	ni_rtevent_resync_item_t *item;
+	ni_hashmap_entry_t *entry;
+
+	ni_hashmap_foreach(&list->map, __ni_rtevent_resync_hash_route(rp), entry) {
+		item = entry->item;
+		if (item->obj == rp)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+__ni_rtevent_resync_snapshot(ni_netconfig_t *nc, ni_rtevent_resync_state_t *state)
+{
+	ni_rtevent_resync_dev_t *rd;
+	ni_rule_array_t *rules;
+	ni_route_table_t *tab;
+	ni_netdev_t *dev;
+	ni_address_t *ap, *copy;
+	ni_route_t *rp;
+	unsigned int i;
+
+	for (i = 0, dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		i++;
+	state->devs = xcalloc(i ? i : 1, sizeof(*state->devs));
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		rd = &state->devs[state->count++];
+		rd->dev = ni_netdev_get(dev);
+		rd->ifflags = dev->link.ifflags;
+		ni_string_dup(&rd->name, dev->name);
+		ni_hashmap_insert(&state->devmap, ni_hashmap_hash_ptr(dev), rd);
+
+		/* the refresh updates the address flags and lifetimes in place */
+		for (ap = dev->addrs; ap && ni_global.interface_addr_event; ap = ap->next) {
+			if (!(copy = ni_address_clone(ap)))
+				continue;
+
+			__ni_rtevent_resync_list_add(&state->addrs,
+					__ni_rtevent_resync_hash_addr(dev->link.ifindex, ap),
+					dev->link.ifindex, copy);
+		}
+
+		for (tab = dev->routes; tab && ni_global.route_event; tab = tab->next) {
+			for (i = 0; i < tab->routes.count; ++i) {
+				/* multipath routes are in multiple devices */
+				rp = tab->routes.data[i];
+				if (!rp || __ni_rtevent_resync_route_known(&state->routes, rp))
+					continue;
+
+				__ni_rtevent_resync_list_add(&state->routes,
+						__ni_rtevent_resync_hash_route(rp),
+						0, ni_route_ref(rp));
+			}
+		}
+	}
+
+	if (ni_global.rule_event && (rules = ni_netconfig_rule_array(nc))) {
+		for (i = 0; i < rules->count; ++i) {
+			__ni_rtevent_resync_list_add(&state->rules,
+					__ni_rtevent_resync_hash_rule(rules->data[i]),
+					0, ni_rule_ref(rules->data[i]));
+		}
+	}
+}
+
+static ni_rtevent_resync_dev_t *
+__ni_rtevent_resync_find_dev(ni_rtevent_resync_state_t *state, const ni_netdev_t *dev)
+{
+	ni_rtevent_resync_dev_t *rd;
+	ni_hashmap_entry_t *entry;
+
+	ni_hashmap_foreach(&state->devmap, ni_hashmap_hash_ptr(dev), entry) {
+		rd = entry->item;
+		if (rd->dev == dev)
+			return rd;
+	}
+	return NULL;
+}
+
+static inline ni_bool_t
+__ni_rtevent_resync_dev_present(ni_netconfig_t *nc, const ni_netdev_t *dev)
+{
+	return ni_netdev_by_index(nc, dev->link.ifindex) == dev;
+}
+
+static void
+__ni_rtevent_resync_links(ni_netconfig_t *nc, ni_rtevent_resync_state_t *state)
+{
+	ni_rtevent_resync_dev_t *rd;
+	ni_netdev_t *dev;
+	unsigned int i;
+
+	for (i = 0; i < state->count; ++i) {
+		rd = &state->devs[i];
+		dev = rd->dev;
+
+		if (!__ni_rtevent_resync_dev_present(nc, dev)) {
+			ni_debug_events("%s[%u]: device deleted while events were lost",
+					rd->name, dev->link.ifindex);
+			dev->link.ifflags = 0;
+			dev->deleted = 1;
+			__ni_netdev_process_events(nc, dev, rd->ifflags);
+			continue;
+		}
+
+		if (!ni_string_eq(rd->name, dev->name)) {
+			ni_debug_events("%s[%u]: device renamed to %s while events were lost",
+					rd->name, dev->link.ifindex, dev->name);
+			__ni_netdev_event(nc, dev, NI_EVENT_DEVICE_RENAME);
+		}
+		if (rd->ifflags != dev->link.ifflags)
+			__ni_netdev_process_events(nc, dev, rd->ifflags);
+	}
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		if (__ni_rtevent_resync_find_dev(state, dev))
+			continue;
+
+		ni_debug_events("%s[%u]: device created while events were lost",
+				dev->name, dev->link.ifindex);
+		dev->created = 1;
+		__ni_netdev_process_events(nc, dev, 0);
+	}
+}
+
+static ni_bool_t
+__ni_rtevent_resync_lft_changed(unsigned int old, unsigned int lft)
+{
+	if (old == lft)
+		return FALSE;
+	if (old == NI_LIFETIME_INFINITE || lft == NI_LIFETIME_INFINITE)
+		return TRUE;
+
+	/* the lifetimes are in seconds, rebased at different times */
+	return (old > lft ? old - lft : lft - old) > 1;
+}
+
+static ni_bool_t
+__ni_rtevent_resync_addr_changed(const ni_address_t *old, const ni_address_t *ap,
+				const struct timeval *now)
+{
+	return old->flags != ap->flags ||
+		__ni_rtevent_resync_lft_changed(ni_address_valid_lft(old, now),
+						ni_address_valid_lft(ap, now)) ||
+		__ni_rtevent_resync_lft_changed(ni_address_preferred_lft(old, now),
+						ni_address_preferred_lft(ap, now));
+}
+
+static void
+__ni_rtevent_resync_addrs(ni_netconfig_t *nc, ni_rtevent_resync_state_t *state)
+{
+	ni_rtevent_resync_item_t *item;
+	ni_hashmap_entry_t *entry;
+	ni_address_t *ap, *old;
+	struct timeval now;
+	ni_netdev_t *dev;
+
+	if (!ni_global.interface_addr_event)
+		return;
+
+	ni_timer_get_time(&now);
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		for (ap = dev->addrs; ap; ap = ap->next) {
+			old = NULL;
+			ni_hashmap_foreach(&state->addrs.map,
+					__ni_rtevent_resync_hash_addr(dev->link.ifindex, ap),
+					entry) {
+				item = entry->item;
+				if (item->seen || item->ifindex != dev->link.ifindex)
+					continue;
+
+				old = item->obj;
+				if (old->prefixlen == ap->prefixlen &&
+				    ni_sockaddr_equal(&old->local_addr, &ap->local_addr)) {
+					item->seen = TRUE;
+					break;
+				}
+				old = NULL;
+			}
+
+			if (!old || __ni_rtevent_resync_addr_changed(old, ap, &now))
+				__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_UPDATE, ap);
+		}
+	}
+
+	/* addresses removed from devices which still exist */
+	for (item = state->addrs.head; item; item = item->next) {
+		if (item->seen || !(dev = ni_netdev_by_index(nc, item->ifindex)))
+			continue;
+		if (!__ni_rtevent_resync_find_dev(state, dev))
+			continue;
+
+		__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_DELETE, item->obj);
+	}
+}
+
+static void
+__ni_rtevent_resync_routes(ni_netconfig_t *nc, ni_rtevent_resync_state_t *state)
+{
+	ni_rtevent_resync_list_t added = { .head = NULL, .map = NI_HASHMAP_INIT };
+	ni_rtevent_resync_item_t *item;
+	ni_hashmap_entry_t *entry;
+	ni_route_table_t *tab;
+	ni_netdev_t *dev;
+	ni_route_t *rp;
+	ni_bool_t known;
+	unsigned int i;
+
+	if (!ni_global.route_event)
+		return;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		for (tab = dev->routes; tab; tab = tab->next) {
+			for (i = 0; i < tab->routes.count; ++i) {
+				if (!(rp = tab->routes.data[i]))
+					continue;
+
+				known = FALSE;
+				ni_hashmap_foreach(&state->routes.map,
+						__ni_rtevent_resync_hash_route(rp), entry) {
+					item = entry->item;
+					if (item->obj == rp || (rp->table == ((ni_route_t *)item->obj)->table
+					&&  ni_route_equal(rp, item->obj))) {
+						item->seen = TRUE;
+						known = TRUE;
+						break;
+					}
+				}
+				if (known || __ni_rtevent_resync_route_known(&added, rp))
+					continue;
+
+				__ni_rtevent_resync_list_add(&added,
+						__ni_rtevent_resync_hash_route(rp), 0, rp);
+				__ni_netinfo_route_event(nc, NI_EVENT_ROUTE_UPDATE, rp);
+			}
+		}
+	}
+
+	for (item = state->routes.head; item; item = item->next) {
+		if (!item->seen)
+			__ni_netinfo_route_event(nc, NI_EVENT_ROUTE_DELETE, item->obj);
+	}
+
+	while ((item = added.head)) {
+		added.head = item->next;
+		free(item);
+	}
+	ni_hashmap_destroy(&added.map);
+}
+
+static void
+__ni_rtevent_resync_rules(ni_netconfig_t *nc, ni_rtevent_resync_state_t *state)
+{
+	ni_rtevent_resync_item_t *item;
+	ni_hashmap_entry_t *entry;
+	ni_rule_array_t *rules;
+	ni_rule_t *rule;
+	ni_bool_t known;
+	unsigned int i;
+
+	if (!ni_global.rule_event || !(rules = ni_netconfig_rule_array(nc)))
+		return;
+
+	for (i = 0; i < rules->count; ++i) {
+		rule = rules->data[i];
+
+		known = FALSE;
+		ni_hashmap_foreach(&state->rules.map,
+				__ni_rtevent_resync_hash_rule(rule), entry) {
+			item = entry->item;
+			if (!item->seen && ni_rule_equal(rule, item->obj)) {
+				item->seen = TRUE;
+				known = TRUE;
+				break;
+			}
+		}
+		if (!known)
+			__ni_netinfo_rule_event(nc, NI_EVENT_RULE_UPDATE, rule);
+	}
+
+	for (item = state->rules.head; item; item = item->next) {
+		if (!item->seen)
+			__ni_netinfo_rule_event(nc, NI_EVENT_RULE_DELETE, item->obj);
+	}
+}
+
+static void
+__ni_rtevent_resync_list_destroy(ni_rtevent_resync_list_t *list, void (*release)(void *))
+{
+	ni_rtevent_resync_item_t *item;
+
+	while ((item = list->head)) {
+		list->head = item->next;
+		release(item->obj);
+		free(item);
+	}
+	ni_hashmap_destroy(&list->map);
+}
+
+static void
+__ni_rtevent_resync_release_addr(void *obj)
+{
+	ni_address_free(obj);
+}
+
+static void
+__ni_rtevent_resync_release_route(void *obj)
+{
+	ni_route_free(obj);
+}
+
+static void
+__ni_rtevent_resync_release_rule(void *obj)
+{
+	ni_rule_free(obj);
+}
+
+static void
+__ni_rtevent_resync_state_destroy(ni_rtevent_resync_state_t *state)
+{
+	unsigned int i;
+
+	__ni_rtevent_resync_list_destroy(&state->addrs, __ni_rtevent_resync_release_addr);
+	__ni_rtevent_resync_list_destroy(&state->routes, __ni_rtevent_resync_release_route);
+	__ni_rtevent_resync_list_destroy(&state->rules, __ni_rtevent_resync_release_rule);
+
+	for (i = 0; i < state->count; ++i) {
+		ni_string_free(&state->devs[i].name);
+		ni_netdev_put(state->devs[i].dev);
+	}
+	free(state->devs);
+	ni_hashmap_destroy(&state->devmap);
+}
+
+static int
+__ni_rtevent_resync_all(ni_netconfig_t *nc)
+{
+	ni_rtevent_resync_state_t state;
+	int ret;
+
+	memset(&state, 0, sizeof(state));
+	__ni_rtevent_resync_snapshot(nc, &state);
+
+	if ((ret = __ni_system_refresh_all(nc, NULL)) < 0) {
+		ni_error("rtnetlink event resync: unable to refresh interfaces");
+	} else {
+		__ni_rtevent_resync_links(nc, &state);
+		__ni_rtevent_resync_addrs(nc, &state);
+		__ni_rtevent_resync_routes(nc, &state);
+		__ni_rtevent_resync_rules(nc, &state);
+		__ni_rtevent_resync.stats.resyncs++;
+	}
+
+	__ni_rtevent_resync_state_destroy(&state);
+	return ret;
+}
+
+static void
+__ni_rtevent_resync_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_netconfig_t *nc;
+
+	if (__ni_rtevent_resync.timer != timer)
+		return;
+	__ni_rtevent_resync.timer = NULL;
+
+	if (!(nc = ni_global_state_handle(0)))
+		return;
+
+	ni_note("resynchronizing state after rtnetlink event loss");
+	__ni_rtevent_resync_all(nc);
+}
+
+static void
+__ni_rtevent_overrun(void)
+{
+	__ni_rtevent_resync.stats.overruns++;
+
+	/* coalesce overruns until the resync runs from the main loop */
+	if (__ni_rtevent_resync.timer)
+		return;
+
+	ni_warn("rtnetlink event receive buffer overrun, scheduling resync");
+	__ni_rtevent_resync.timer = ni_timer_register(0, __ni_rtevent_resync_timeout, NULL);
+}
+
+void
+ni_server_interface_event_stats(ni_rtevent_stats_t *stats)
+{
+	if (stats)
+		*stats = __ni_rtevent_resync.stats;
+}
+
 /*
  * Receive netlink message and trigger processing by callback
  */
@@ -942,6 +1450,11 @@ __ni_rtevent_receive(ni_socket_t *sock)
 	if (handle && handle->nlsock) {
 		do {
 			ret = nl_recvmsgs_default(handle->nlsock);
+			if (ret == -NLE_NOMEM && errno == ENOBUFS) {
+				/* events lost, but the socket is still usable */
+				__ni_rtevent_overrun();
+				ret = NLE_SUCCESS;
+			}
 		} while (ret == NLE_SUCCESS || ret == -NLE_INTR);
 
 		switch (ret) {
@@ -1444,6 +1957,10 @@ ni_server_deactivate_interface_events(void)
 		ni_socket_deactivate(sock);
 		ni_socket_release(sock);
 	}
+	if (__ni_rtevent_resync.timer) {
+		ni_timer_cancel(__ni_rtevent_resync.timer);
+		__ni_rtevent_resync.timer = NULL;
+	}
 	ni_global.rule_event = NULL;
 	ni_global.route_event = NULL;
 	ni_global.interface_event = NULL;
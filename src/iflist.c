@@ -76,241 +76,79 @@ static int		__ni_discover_ipip(ni_netdev_t *, struct nlattr **, struct nlattr**)
 static int		__ni_discover_gre(ni_netdev_t *, struct nlattr **, struct nlattr**);
 static int		ni_discover_vxlan(ni_netdev_t *, struct nlattr **, ni_netconfig_t *);
 
-struct ni_rtnl_info {
-	struct ni_nlmsg_list	nlmsg_list;
-	struct ni_nlmsg *	entry;
+/*
+ * Refresh state passed to the netlink dump callbacks, which parse
+ * each reply in place while it is in the netlink receive buffer.
+ */
+struct ni_rtnl_dump {
+	ni_netconfig_t *	nc;
+	ni_netdev_t *		dev;		/* single device refresh */
+	ni_netdev_t **		tail;		/* device list tail for new devices */
+	ni_linkinfo_t *		link;		/* link info refresh */
+	unsigned int		ifindex;	/* reply filter or 0 */
+	unsigned int		seqno;
+	int			rv;
 };
 
-struct ni_rtnl_query {
-	struct ni_rtnl_info	link_info;
-	struct ni_rtnl_info	addr_info;
-	struct ni_rtnl_info	ipv6_info;
-	struct ni_rtnl_info	route_info;
-	struct ni_rtnl_info	rule_info;
-	unsigned int		ifindex;
-};
+#define NI_RTNL_DUMP_INIT(_nc)	{ .nc = (_nc), .rv = 0 }
 
 /*
- * Query netlink for all relevant information
+ * Issue a dump request and pass each reply to func
  */
-static inline int
-__ni_rtnl_query(struct ni_rtnl_info *qr, int af, int type)
-{
-	int rv;
-
-	ni_nlmsg_list_init(&qr->nlmsg_list);
-retry:
-	rv = ni_nl_dump_store(af, type, &qr->nlmsg_list);
-	switch (rv) {
-	case NLE_SUCCESS:
-		qr->entry = qr->nlmsg_list.head;
-		break;
-	case -NLE_DUMP_INTR:
-		ni_nlmsg_list_destroy(&qr->nlmsg_list);
-		goto retry;
-	default:
-		qr->entry = NULL;
-		break;
-	}
-	return rv;
-}
-
-static inline struct nlmsghdr *
-__ni_rtnl_info_next(struct ni_rtnl_info *qr)
-{
-	struct ni_nlmsg *entry;
-
-	if ((entry = qr->entry) != NULL) {
-		qr->entry = entry->next;
-		return &entry->h;
-	}
-
-	return NULL;
-}
-
-static void
-ni_rtnl_query_destroy(struct ni_rtnl_query *q)
-{
-	ni_nlmsg_list_destroy(&q->link_info.nlmsg_list);
-	ni_nlmsg_list_destroy(&q->addr_info.nlmsg_list);
-	ni_nlmsg_list_destroy(&q->ipv6_info.nlmsg_list);
-	ni_nlmsg_list_destroy(&q->route_info.nlmsg_list);
-	ni_nlmsg_list_destroy(&q->rule_info.nlmsg_list);
-}
-
 static int
-ni_rtnl_query(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
-{
-	memset(q, 0, sizeof(*q));
-	q->ifindex = ifindex;
-
-	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0
-	 || (family != AF_INET && __ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK) < 0)
-	 || __ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0
-	 || __ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
-		ni_rtnl_query_destroy(q);
-		return -1;
-	}
-
-	return 0;
-}
-
-static int
-ni_rtnl_query_link(struct ni_rtnl_query *q, unsigned int ifindex)
-{
-	memset(q, 0, sizeof(*q));
-	q->ifindex = ifindex;
-
-	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0) {
-		ni_rtnl_query_destroy(q);
-		return -1;
-	}
-
-	return 0;
-}
-
-static int
-ni_rtnl_query_ipv6_link(struct ni_rtnl_query *q, unsigned int ifindex)
-{
-	memset(q, 0, sizeof(*q));
-	q->ifindex = ifindex;
-
-	if (__ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK) < 0) {
-		ni_rtnl_query_destroy(q);
-		return -1;
-	}
-
-	return 0;
-}
-
-static inline struct ifinfomsg *
-ni_rtnl_query_next_link_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
+ni_rtnl_dump(struct ni_rtnl_dump *dump, int af, int type, ni_nl_dump_func_t *func)
 {
-	struct nlmsghdr *h;
-
-	while ((h = __ni_rtnl_info_next(&q->link_info)) != NULL) {
-		struct ifinfomsg *ifi;
+	int rv;
 
-		if ((ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)) != NULL) {
-			if (!q->ifindex || q->ifindex == (unsigned int)ifi->ifi_index) {
-				*hp = h;
-				return ifi;
-			}
-		}
-	}
+	/* an interrupted dump is inconsistent, repeat it to process
+	 * a consistent one, the callbacks are updating the state. */
+	do {
+		rv = ni_nl_dump_foreach(af, type, func, dump);
+	} while (rv == -NLE_DUMP_INTR);
 
-	return NULL;
+	if (rv < 0)
+		return rv;
+	return dump->rv;
 }
 
 static inline struct ifinfomsg *
-ni_rtnl_query_next_ipv6_link_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
+ni_rtnl_dump_link_info(struct ni_rtnl_dump *dump, struct nlmsghdr *h)
 {
-	struct nlmsghdr *h;
+	struct ifinfomsg *ifi;
 
-	while ((h = __ni_rtnl_info_next(&q->ipv6_info)) != NULL) {
-		struct ifinfomsg *ifi;
+	if (!(ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)))
+		return NULL;
 
-		if ((ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)) != NULL) {
-			if (!q->ifindex || q->ifindex == (unsigned int)ifi->ifi_index) {
-				*hp = h;
-				return ifi;
-			}
-		}
-	}
+	if (dump->ifindex && dump->ifindex != (unsigned int)ifi->ifi_index)
+		return NULL;
 
-	return NULL;
-}
-
-static int
-ni_rtnl_query_addr_info(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
-{
-	memset(q, 0, sizeof(*q));
-	q->ifindex = ifindex;
-
-	if (__ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0) {
-		ni_rtnl_query_destroy(q);
-		return -1;
-	}
-
-	return 0;
+	return ifi;
 }
 
 static inline struct ifaddrmsg *
-ni_rtnl_query_next_addr_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
+ni_rtnl_dump_addr_info(struct ni_rtnl_dump *dump, struct nlmsghdr *h)
 {
-	struct nlmsghdr *h;
-
-	while ((h = __ni_rtnl_info_next(&q->addr_info)) != NULL) {
-		struct ifaddrmsg *ifa;
+	struct ifaddrmsg *ifa;
 
-		if ((ifa = ni_rtnl_ifaddrmsg(h, RTM_NEWADDR)) != NULL) {
-			if (!q->ifindex || q->ifindex == ifa->ifa_index) {
-				*hp = h;
-				return ifa;
-			}
-		}
-	}
-	return NULL;
-}
+	if (!(ifa = ni_rtnl_ifaddrmsg(h, RTM_NEWADDR)))
+		return NULL;
 
-static int
-ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int family)
-{
-	memset(q, 0, sizeof(*q));
+	if (dump->ifindex && dump->ifindex != ifa->ifa_index)
+		return NULL;
 
-	if (__ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
-		ni_rtnl_query_destroy(q);
-		return -1;
-	}
-
-	return 0;
+	return ifa;
 }
 
 static inline struct rtmsg *
-ni_rtnl_query_next_route_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
-{
-	struct nlmsghdr *h;
-
-	while ((h = __ni_rtnl_info_next(&q->route_info)) != NULL) {
-		struct rtmsg *rtm;
-
-		if (!(rtm = ni_rtnl_rtmsg(h, RTM_NEWROUTE)))
-			continue;
-
-		*hp = h;
-		return rtm;
-	}
-	return NULL;
-}
-
-static int
-ni_rtnl_query_rule_info(struct ni_rtnl_query *q, unsigned int family)
+ni_rtnl_dump_route_info(struct ni_rtnl_dump *dump, struct nlmsghdr *h)
 {
-	memset(q, 0, sizeof(*q));
-
-	if (__ni_rtnl_query(&q->rule_info, family, RTM_GETRULE) < 0) {
-		ni_rtnl_query_destroy(q);
-		return -1;
-	}
-
-	return 0;
+	return ni_rtnl_rtmsg(h, RTM_NEWROUTE);
 }
 
 static inline struct fib_rule_hdr *
-ni_rtnl_query_next_rule_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
+ni_rtnl_dump_rule_info(struct ni_rtnl_dump *dump, struct nlmsghdr *h)
 {
-	struct nlmsghdr *h;
-
-	while ((h = __ni_rtnl_info_next(&q->rule_info)) != NULL) {
-		struct fib_rule_hdr *frh;
-
-		if (!(frh = __ni_rtnl_msgdata(h, RTM_NEWRULE, sizeof(struct fib_rule_hdr))))
-			continue;
-
-		*hp = h;
-		return frh;
-	}
-	return NULL;
+	return __ni_rtnl_msgdata(h, RTM_NEWRULE, sizeof(struct fib_rule_hdr));
 }
 
 static void
@@ -357,29 +195,20 @@ ni_route_tables_reset_seq(ni_route_table_t *tab)
 }
 
 static void
-ni_route_array_drop_by_seq(ni_netconfig_t *nc, ni_route_array_t *routes, unsigned int seq)
+ni_route_tables_drop_by_seq(ni_netconfig_t *nc, ni_route_table_t *tab, unsigned int seq)
 {
+	ni_route_array_t stale = NI_ROUTE_ARRAY_INIT;
 	unsigned int i;
-	ni_route_t *rp;
 
-	for (i = 0; i < routes->count; ) {
-		rp = routes->data[i];
-		if (rp->seq != seq) {
-			if (ni_route_array_remove_at(routes, i) == rp) {
-				ni_netconfig_route_del(nc, rp, NULL);
-				ni_route_free(rp);
-				continue;
-			}
-		}
-		i++;
-	}
-}
+	for ( ; tab; tab = tab->next) {
+		if (!ni_route_table_remove_stale(tab, seq, &stale))
+			continue;
 
-static void
-ni_route_tables_drop_by_seq(ni_netconfig_t *nc, ni_route_table_t *tab, unsigned int seq)
-{
-	for ( ; tab; tab = tab->next)
-		ni_route_array_drop_by_seq(nc, &tab->routes, seq);
+		/* drop multipath route references of other devices */
+		for (i = 0; i < stale.count; ++i)
+			ni_netconfig_route_del(nc, stale.data[i], NULL);
+		ni_route_array_destroy(&stale);
+	}
 }
 
 static void
@@ -398,26 +227,6 @@ ni_netconfig_rules_reset_seq(ni_netconfig_t *nc)
 	}
 }
 
-static void
-ni_netconfig_rules_drop_by_seq(ni_netconfig_t *nc, unsigned int seq)
-{
-	ni_rule_array_t *rules;
-	unsigned int i;
-	ni_rule_t *ru;
-
-	if (!(rules = ni_netconfig_rule_array(nc)))
-		return;
-
-	for (i = 0; i < rules->count; ) {
-		ru = rules->data[i];
-		if (ru->seq != seq) {
-			ni_rule_array_delete_at(rules, i);
-		} else {
-			i++;
-		}
-	}
-}
-
 static inline void
 __ni_refresh_bonding_master_bind(ni_netdev_t *master, ni_linkinfo_t *link, const char *ifname)
 {
@@ -464,7 +273,8 @@ __ni_refresh_bind_lower(ni_netconfig_t *nc, ni_netdev_t *dev)
 	if (!ni_netdev_ref_bind_ifname(&dev->link.lowerdev, nc)) {
 		ni_info("Interface %s references unknown lower device (ifindex %u)",
 			dev->name, dev->link.lowerdev.index);
-	}
+	} else
+		ni_netdev_reindex(dev);
 }
 
 static inline void
@@ -510,15 +320,187 @@ __ni_system_refresh_interfaces(ni_netconfig_t *nc)
 	return __ni_system_refresh_all(nc, NULL);
 }
 
+/*
+ * Netlink dump callbacks of the refresh functions
+ */
+static void
+ni_rtnl_dump_newlink_all(struct nlmsghdr *h, void *user_data)
+{
+	struct ni_rtnl_dump *dump = user_data;
+	ni_netconfig_t *nc = dump->nc;
+	struct ifinfomsg *ifi;
+	struct nlattr *nla;
+	ni_netdev_t *dev;
+	char *ifname;
+
+	if (dump->rv < 0 || !(ifi = ni_rtnl_dump_link_info(dump, h)))
+		return;
+
+	if ((nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME)) == NULL) {
+		ni_warn("RTM_NEWLINK message without IFNAME");
+		return;
+	}
+	ifname = nla_get_string(nla);
+
+	/* Create interface if it doesn't exist. */
+	if ((dev = ni_netdev_by_index(nc, ifi->ifi_index)) == NULL) {
+		ni_pci_dev_t *pci_dev;
+
+		dev = ni_netdev_new(ifname, ifi->ifi_index);
+		if (!dev) {
+			dump->rv = -1;
+			return;
+		}
+
+		if ((pci_dev = ni_sysfs_netdev_get_pci(ifname)) != NULL)
+			ni_netdev_set_pci(dev, pci_dev);
+
+		/* FIXME: use ni_netconfig_device_append() */
+		*dump->tail = dev;
+		dump->tail = &dev->next;
+		ni_netconfig_device_index(nc, dev);
+	} else {
+		if (!ni_string_eq(dev->name, ifname))
+			ni_netdev_set_name(dev, ifname);
+
+		/* Clear out addresses and routes */
+		ni_address_list_reset_seq(dev->addrs);
+		ni_route_tables_reset_seq(dev->routes);
+	}
+
+	dev->seq = dump->seqno;
+
+	if (__ni_netdev_process_newlink(dev, h, ifi, nc) < 0)
+		ni_error("Problem parsing RTM_NEWLINK message for %s", ifname);
+}
+
+static void
+ni_rtnl_dump_newlink_dev(struct nlmsghdr *h, void *user_data)
+{
+	struct ni_rtnl_dump *dump = user_data;
+	ni_netdev_t *dev = dump->dev;
+	struct ifinfomsg *ifi;
+	struct nlattr *nla;
+	const char *ifname;
+
+	if (!(ifi = ni_rtnl_dump_link_info(dump, h)))
+		return;
+
+	if ((nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME)) == NULL) {
+		ni_warn("RTM_NEWLINK message without IFNAME");
+		return;
+	}
+
+	ifname = nla_get_string(nla);
+	if (!ni_string_eq(dev->name, ifname))
+		ni_netdev_set_name(dev, ifname);
+
+	/* Clear out addresses and routes */
+	dev->seq = dump->seqno;
+	ni_address_list_reset_seq(dev->addrs);
+	ni_route_tables_reset_seq(dev->routes);
+
+	if (__ni_netdev_process_newlink(dev, h, ifi, dump->nc) < 0)
+		ni_error("Problem parsing RTM_NEWLINK message for %s", dev->name);
+}
+
+static void
+ni_rtnl_dump_newlink_info(struct nlmsghdr *h, void *user_data)
+{
+	struct ni_rtnl_dump *dump = user_data;
+	struct ifinfomsg *ifi;
+
+	if (dump->rv < 0 || !(ifi = ni_rtnl_dump_link_info(dump, h)))
+		return;
+
+	if ((dump->rv = __ni_process_ifinfomsg(dump->link, h, ifi, dump->nc)) < 0)
+		ni_error("Problem parsing RTM_NEWLINK message");
+}
+
+static void
+ni_rtnl_dump_newlink_ipv6(struct nlmsghdr *h, void *user_data)
+{
+	struct ni_rtnl_dump *dump = user_data;
+	struct ifinfomsg *ifi;
+	ni_netdev_t *dev;
+
+	if (dump->rv < 0 || !(ifi = ni_rtnl_dump_link_info(dump, h)))
+		return;
+
+	if (dump->dev) {
+		dev = dump->dev;
+		if (ifi->ifi_family != AF_INET6)
+			return;
+		if (ifi->ifi_index <= 0)
+			return;
+		if ((unsigned int)ifi->ifi_index != dev->link.ifindex)
+			return;
+
+		if ((dump->rv = __ni_netdev_process_newlink_ipv6(dev, h, ifi)) < 0)
+			ni_error("Problem parsing IPv6 RTM_NEWLINK message for %s",
+				dev->name);
+		return;
+	}
+
+	if ((dev = ni_netdev_by_index(dump->nc, ifi->ifi_index)) == NULL)
+		return;
+
+	if (__ni_netdev_process_newlink_ipv6(dev, h, ifi) < 0)
+		ni_error("Problem parsing IPv6 RTM_NEWLINK message for %s", dev->name);
+}
+
+static void
+ni_rtnl_dump_newaddr(struct nlmsghdr *h, void *user_data)
+{
+	struct ni_rtnl_dump *dump = user_data;
+	struct ifaddrmsg *ifa;
+	ni_netdev_t *dev;
+
+	if (!(ifa = ni_rtnl_dump_addr_info(dump, h)))
+		return;
+
+	if (!(dev = dump->dev) && !(dev = ni_netdev_by_index(dump->nc, ifa->ifa_index)))
+		return;
+
+	if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
+		ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
+}
+
+static void
+ni_rtnl_dump_newroute(struct nlmsghdr *h, void *user_data)
+{
+	struct ni_rtnl_dump *dump = user_data;
+	struct rtmsg *rtm;
+
+	if (!(rtm = ni_rtnl_dump_route_info(dump, h)))
+		return;
+
+	if (__ni_netdev_process_newroute(dump->dev, h, rtm, dump->nc) < 0)
+		ni_error("Problem parsing RTM_NEWROUTE message");
+}
+
+static void
+ni_rtnl_dump_newrule(struct nlmsghdr *h, void *user_data)
+{
+	struct ni_rtnl_dump *dump = user_data;
+	struct fib_rule_hdr *frh;
+
+	if (!(frh = ni_rtnl_dump_rule_info(dump, h)))
+		return;
+
+	h->nlmsg_type = RTM_GETRULE; /* make refresh visible */
+	if (__ni_netdev_process_newrule(h, frh, dump->nc) < 0)
+		ni_error("Problem parsing RTM_NEWRULE message");
+}
+
 int
 __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 {
 	static int refresh = 0;
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
+	unsigned int family;
 	ni_netdev_t **tail, *dev;
 	unsigned int seqno;
-	int res = -1;
 
 	do {
 		seqno = ++__ni_global_seqno;
@@ -533,97 +515,31 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 				"Full refresh of all interfaces (enforced)");
 	}
 
-	if (ni_rtnl_query(&query, 0, ni_netconfig_get_family_filter(nc)) < 0)
-		goto failed;
-
 	/* Find tail of iflist */
 	tail = ni_netconfig_device_list_head(nc);
 	while ((dev = *tail) != NULL)
 		tail = &dev->next;
 
-	while (1) {
-		struct ifinfomsg *ifi;
-		struct nlattr *nla;
-		char *ifname = NULL;
-
-		if (!(ifi = ni_rtnl_query_next_link_info(&query, &h)))
-			break;
-
-		if ((nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME)) == NULL) {
-			ni_warn("RTM_NEWLINK message without IFNAME");
-			continue;
-		}
-		ifname = nla_get_string(nla);
-
-		/* Create interface if it doesn't exist. */
-		if ((dev = ni_netdev_by_index(nc, ifi->ifi_index)) == NULL) {
-			ni_pci_dev_t *pci_dev;
-
-			dev = ni_netdev_new(ifname, ifi->ifi_index);
-			if (!dev)
-				goto failed;
-
-			if ((pci_dev = ni_sysfs_netdev_get_pci(ifname)) != NULL)
-				ni_netdev_set_pci(dev, pci_dev);
-
-			/* FIXME: use ni_netconfig_device_append() */
-			*tail = dev;
-			tail = &dev->next;
-		} else {
-			if (!ni_string_eq(dev->name, ifname))
-				ni_string_dup(&dev->name, ifname);
-
-			/* Clear out addresses and routes */
-			ni_address_list_reset_seq(dev->addrs);
-			ni_route_tables_reset_seq(dev->routes);
-		}
-
-		dev->seq = seqno;
-
-		if (__ni_netdev_process_newlink(dev, h, ifi, nc) < 0)
-			ni_error("Problem parsing RTM_NEWLINK message for %s", ifname);
-	}
+	dump.tail = tail;
+	dump.seqno = seqno;
+	if (ni_rtnl_dump(&dump, AF_UNSPEC, RTM_GETLINK, ni_rtnl_dump_newlink_all) < 0)
+		return -1;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
 		__ni_refresh_bind_master(nc, dev);
 		__ni_refresh_bind_lower(nc, dev);
 	}
 
-	while (1) {
-		struct ifinfomsg *ifi;
-
-		if (!(ifi = ni_rtnl_query_next_ipv6_link_info(&query, &h)))
-			break;
-
-		if ((dev = ni_netdev_by_index(nc, ifi->ifi_index)) == NULL)
-			continue;
-
-		if (__ni_netdev_process_newlink_ipv6(dev, h, ifi) < 0)
-			ni_error("Problem parsing IPv6 RTM_NEWLINK message for %s", dev->name);
-	}
-
-	while (1) {
-		struct ifaddrmsg *ifa;
-
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
-
-		if ((dev = ni_netdev_by_index(nc, ifa->ifa_index)) == NULL)
-			continue;
-
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
-	}
-
-	while (1) {
-		struct rtmsg *rtm;
+	family = ni_netconfig_get_family_filter(nc);
+	if (family != AF_INET &&
+	    ni_rtnl_dump(&dump, AF_INET6, RTM_GETLINK, ni_rtnl_dump_newlink_ipv6) < 0)
+		return -1;
 
-		if (!(rtm = ni_rtnl_query_next_route_info(&query, &h)))
-			break;
+	if (ni_rtnl_dump(&dump, family, RTM_GETADDR, ni_rtnl_dump_newaddr) < 0)
+		return -1;
 
-		if (__ni_netdev_process_newroute(NULL, h, rtm, nc) < 0)
-			ni_error("Problem parsing RTM_NEWROUTE message");
-	}
+	if (ni_rtnl_dump(&dump, family, RTM_GETROUTE, ni_rtnl_dump_newroute) < 0)
+		return -1;
 
 	/* Cull any interfaces that went away */
 	tail = ni_netconfig_device_list_head(nc);
@@ -632,6 +548,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 		ni_route_tables_drop_by_seq(nc, dev->routes, seqno);
 		if (dev->seq != seqno) {
 			*tail = dev->next;
+			ni_netconfig_device_unindex(nc, dev);
 			if (del_list == NULL) {
 				__ni_refresh_unbind_master(nc, dev);
 				ni_client_state_drop(dev->link.ifindex);
@@ -652,11 +569,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 	if (!ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_ROUTE_RULES))
 		(void)__ni_system_refresh_rules(nc);
 
-	res = 0;
-
-failed:
-	ni_rtnl_query_destroy(&query);
-	return res;
+	return 0;
 }
 
 /*
@@ -665,9 +578,8 @@ failed:
 int
 __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
-	int res = -1;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
+	unsigned int family;
 
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 			"Full refresh of %s interface",
@@ -677,63 +589,24 @@ __ni_system_refresh_interface(ni_netconfig_t *nc, ni_netdev_t *dev)
 		__ni_global_seqno++;
 	} while (!__ni_global_seqno);
 
-	if (ni_rtnl_query(&query, dev->link.ifindex, ni_netconfig_get_family_filter(nc)) < 0)
-		goto failed;
+	dump.dev = dev;
+	dump.ifindex = dev->link.ifindex;
+	dump.seqno = __ni_global_seqno;
 
 	dev->seq = 0;
-	while (1) {
-		struct ifinfomsg *ifi;
-		struct nlattr *nla;
-		const char *ifname;
-
-		if (!(ifi = ni_rtnl_query_next_link_info(&query, &h)))
-			break;
-
-		if ((nla = nlmsg_find_attr(h, sizeof(*ifi), IFLA_IFNAME)) == NULL) {
-			ni_warn("RTM_NEWLINK message without IFNAME");
-			continue;
-		}
-
-		ifname = nla_get_string(nla);
-		if (!ni_string_eq(dev->name, ifname))
-			ni_string_dup(&dev->name, ifname);
-
-		/* Clear out addresses and routes */
-		dev->seq = __ni_global_seqno;
-		ni_address_list_reset_seq(dev->addrs);
-		ni_route_tables_reset_seq(dev->routes);
-
-		if (__ni_netdev_process_newlink(dev, h, ifi, nc) < 0)
-			ni_error("Problem parsing RTM_NEWLINK message for %s", dev->name);
-	}
-
-	while (1) {
-		struct ifaddrmsg *ifa;
-
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
+	if (ni_rtnl_dump(&dump, AF_UNSPEC, RTM_GETLINK, ni_rtnl_dump_newlink_dev) < 0)
+		return -1;
 
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
-	}
+	family = ni_netconfig_get_family_filter(nc);
+	if (ni_rtnl_dump(&dump, family, RTM_GETADDR, ni_rtnl_dump_newaddr) < 0)
+		return -1;
 	ni_address_list_drop_by_seq(&dev->addrs, dev->seq);
 
-	while (1) {
-		struct rtmsg *rtm;
-
-		if (!(rtm = ni_rtnl_query_next_route_info(&query, &h)))
-			break;
-
-		if (__ni_netdev_process_newroute(dev, h, rtm, nc) < 0)
-			ni_error("Problem parsing RTM_NEWROUTE message");
-	}
+	if (ni_rtnl_dump(&dump, family, RTM_GETROUTE, ni_rtnl_dump_newroute) < 0)
+		return -1;
 	ni_route_tables_drop_by_seq(nc, dev->routes, dev->seq);
 
-	res = 0;
-
-failed:
-	ni_rtnl_query_destroy(&query);
-	return res;
+	return 0;
 }
 
 /*
@@ -742,11 +615,9 @@ failed:
 int
 __ni_system_refresh_addrs(ni_netconfig_t *nc, unsigned int family)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
 	unsigned int seqno;
 	ni_netdev_t *dev;
-	int res = -1;
 
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 			"Refresh of all %s%saddresses",
@@ -757,43 +628,24 @@ __ni_system_refresh_addrs(ni_netconfig_t *nc, unsigned int family)
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
 
-	if (ni_rtnl_query_addr_info(&query, 0, family) < 0)
-		goto failed;
-
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
 		ni_address_list_reset_seq(dev->addrs);
 		dev->seq = seqno;
 	}
 
-	while (1) {
-		struct ifaddrmsg *ifa;
-
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
-
-		if ((dev = ni_netdev_by_index(nc, ifa->ifa_index)) == NULL)
-			continue;
-
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
-	}
+	if (ni_rtnl_dump(&dump, family, RTM_GETADDR, ni_rtnl_dump_newaddr) < 0)
+		return -1;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
 		ni_address_list_drop_by_seq(&dev->addrs, seqno);
 
-	res = 0;
-
-failed:
-	ni_rtnl_query_destroy(&query);
-	return res;
+	return 0;
 }
 
 int
 __ni_system_refresh_interface_addrs(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
-	int res = -1;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
 
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 			"Refresh of %s interface addresses",
@@ -803,26 +655,16 @@ __ni_system_refresh_interface_addrs(ni_netconfig_t *nc, ni_netdev_t *dev)
 		dev->seq = ++__ni_global_seqno;
 	} while (!dev->seq);
 
-	if (ni_rtnl_query_addr_info(&query, dev->link.ifindex, ni_netconfig_get_family_filter(nc)) < 0)
-		goto failed;
+	dump.dev = dev;
+	dump.ifindex = dev->link.ifindex;
 
 	ni_address_list_reset_seq(dev->addrs);
-	while (1) {
-		struct ifaddrmsg *ifa;
-
-		if (!(ifa = ni_rtnl_query_next_addr_info(&query, &h)))
-			break;
-
-		if (__ni_netdev_process_newaddr(dev, h, ifa) < 0)
-			ni_error("Problem parsing RTM_NEWADDR message for %s", dev->name);
-	}
+	if (ni_rtnl_dump(&dump, ni_netconfig_get_family_filter(nc),
+				RTM_GETADDR, ni_rtnl_dump_newaddr) < 0)
+		return -1;
 	ni_address_list_drop_by_seq(&dev->addrs, dev->seq);
 
-	res = 0;
-
-failed:
-	ni_rtnl_query_destroy(&query);
-	return res;
+	return 0;
 }
 
 /*
@@ -831,10 +673,8 @@ failed:
 int
 __ni_system_refresh_rules(ni_netconfig_t *nc)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
 	unsigned int seqno;
-	int res = -1;
 
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 			"Refresh route rules");
@@ -843,37 +683,21 @@ __ni_system_refresh_rules(ni_netconfig_t *nc)
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
 
-	if (ni_rtnl_query_rule_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
-		goto failed;
-
 	ni_netconfig_rules_reset_seq(nc);
-	while (1) {
-		struct fib_rule_hdr *frh;
-
-		if (!(frh = ni_rtnl_query_next_rule_info(&query, &h)))
-			break;
-
-		h->nlmsg_type = RTM_GETRULE; /* make refresh visible */
-		if (__ni_netdev_process_newrule(h, frh, nc) < 0)
-			ni_error("Problem parsing RTM_NEWRULE message");
-	}
+	if (ni_rtnl_dump(&dump, ni_netconfig_get_family_filter(nc),
+				RTM_GETRULE, ni_rtnl_dump_newrule) < 0)
+		return -1;
 	ni_netconfig_rules_drop_by_seq(nc, seqno);
 
-	res = 0;
-
-failed:
-	ni_rtnl_query_destroy(&query);
-	return res;
+	return 0;
 }
 
 int
 __ni_system_refresh_routes(ni_netconfig_t *nc)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
 	unsigned int seqno;
 	ni_netdev_t *dev;
-	int res = -1;
 
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 			"Refresh all routes");
@@ -882,38 +706,23 @@ __ni_system_refresh_routes(ni_netconfig_t *nc)
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
-		goto failed;
-
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
 		ni_route_tables_reset_seq(dev->routes);
 
-	while (1) {
-		struct rtmsg *rtm;
-
-		if (!(rtm = ni_rtnl_query_next_route_info(&query, &h)))
-			break;
-
-		if (__ni_netdev_process_newroute(NULL, h, rtm, nc) < 0)
-			ni_error("Problem parsing RTM_NEWROUTE message");
-	}
+	if (ni_rtnl_dump(&dump, ni_netconfig_get_family_filter(nc),
+				RTM_GETROUTE, ni_rtnl_dump_newroute) < 0)
+		return -1;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
 		ni_route_tables_drop_by_seq(nc, dev->routes, seqno);
 
-	res = 0;
-
-failed:
-	ni_rtnl_query_destroy(&query);
-	return res;
+	return 0;
 }
 
 int
 __ni_system_refresh_interface_routes(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
-	int res = -1;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
 
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 			"Refresh of %s interface routes",
@@ -923,26 +732,15 @@ __ni_system_refresh_interface_routes(ni_netconfig_t *nc, ni_netdev_t *dev)
 		dev->seq = ++__ni_global_seqno;
 	} while (!dev->seq);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
-		goto failed;
+	dump.dev = dev;
 
 	ni_route_tables_reset_seq(dev->routes);
-	while (1) {
-		struct rtmsg *rtm;
-
-		if (!(rtm = ni_rtnl_query_next_route_info(&query, &h)))
-			break;
-
-		if (__ni_netdev_process_newroute(dev, h, rtm, nc) < 0)
-			ni_error("Problem parsing RTM_NEWROUTE message");
-	}
+	if (ni_rtnl_dump(&dump, ni_netconfig_get_family_filter(nc),
+				RTM_GETROUTE, ni_rtnl_dump_newroute) < 0)
+		return -1;
 	ni_route_tables_drop_by_seq(nc, dev->routes, dev->seq);
 
-	res = 0;
-
-failed:
-	ni_rtnl_query_destroy(&query);
-	return res;
+	return 0;
 }
 
 
@@ -952,10 +750,8 @@ failed:
 int
 __ni_device_refresh_link_info(ni_netconfig_t *nc, ni_linkinfo_t *link)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
 	ni_netdev_t *dev;
-	int rv = 0;
 
 	dev = nc ? ni_netdev_by_index(nc, link->ifindex) : NULL;
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
@@ -964,24 +760,10 @@ __ni_device_refresh_link_info(ni_netconfig_t *nc, ni_linkinfo_t *link)
 			link->ifindex);
 
 	__ni_global_seqno++;
-	if ((rv = ni_rtnl_query_link(&query, link->ifindex)) < 0)
-		goto done;
-
-	while (1) {
-		struct ifinfomsg *ifi;
-
-		if (!(ifi = ni_rtnl_query_next_link_info(&query, &h)))
-			break;
+	dump.link = link;
+	dump.ifindex = link->ifindex;
 
-		if ((rv = __ni_process_ifinfomsg(link, h, ifi, nc)) < 0) {
-			ni_error("Problem parsing RTM_NEWLINK message");
-			goto done;
-		}
-	}
-
-done:
-	ni_rtnl_query_destroy(&query);
-	return rv;
+	return ni_rtnl_dump(&dump, AF_UNSPEC, RTM_GETLINK, ni_rtnl_dump_newlink_info);
 }
 
 /*
@@ -990,41 +772,17 @@ done:
 int
 __ni_device_refresh_ipv6_link_info(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
-	struct ni_rtnl_query query;
-	struct nlmsghdr *h;
-	int rv = 0;
+	struct ni_rtnl_dump dump = NI_RTNL_DUMP_INIT(nc);
 
 	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EVENTS,
 			"IPv6 link info refresh of %s interface",
 			dev->name);
 
 	__ni_global_seqno++;
-	if ((rv = ni_rtnl_query_ipv6_link(&query, dev->link.ifindex)) < 0)
-		goto done;
-
-	while (1) {
-		struct ifinfomsg *ifi;
-
-		if (!(ifi = ni_rtnl_query_next_ipv6_link_info(&query, &h)))
-			break;
+	dump.dev = dev;
+	dump.ifindex = dev->link.ifindex;
 
-		if (ifi->ifi_family != AF_INET6)
-			continue;
-		if (ifi->ifi_index <= 0)
-			continue;
-		if ((unsigned int)ifi->ifi_index != dev->link.ifindex)
-			continue;
-
-		if ((rv = __ni_netdev_process_newlink_ipv6(dev, h, ifi)) < 0) {
-			ni_error("Problem parsing IPv6 RTM_NEWLINK message for %s",
-				dev->name);
-			goto done;
-		}
-	}
-
-done:
-	ni_rtnl_query_destroy(&query);
-	return rv;
+	return ni_rtnl_dump(&dump, AF_INET6, RTM_GETLINK, ni_rtnl_dump_newlink_ipv6);
 }
 
 /*
@@ -1150,6 +908,12 @@ __ni_process_ifinfomsg_linktype(ni_linkinfo_t *link, const char *ifname, ni_netc
 			break;
 
 		case ARPHRD_ETHER:
+			/* Probing needs syscalls, don't repeat it on each event. */
+			if (link->type != NI_IFTYPE_UNKNOWN) {
+				tmp_link_type = link->type;
+				break;
+			}
+
 			/* We're at the very least an ethernet. */
 			tmp_link_type = NI_IFTYPE_ETHERNET;
 
@@ -1847,8 +1611,8 @@ __ni_process_ifinfomsg_af_spec(ni_netdev_t *dev, struct nlattr *ifla_af_spec, ni
 /*
  * Refresh complete interface link info given a RTM_NEWLINK message
  */
-int
-__ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
+static int
+__ni_netdev_process_newlink_info(ni_netdev_t *dev, struct nlmsghdr *h,
 				struct ifinfomsg *ifi, ni_netconfig_t *nc)
 {
 	struct nlattr *tb[IFLA_MAX+1];
@@ -1995,6 +1759,18 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 	return 0;
 }
 
+int
+__ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
+				struct ifinfomsg *ifi, ni_netconfig_t *nc)
+{
+	int rv;
+
+	/* the link info updates the name, hwaddr and vlan keys */
+	rv = __ni_netdev_process_newlink_info(dev, h, ifi, nc);
+	ni_netdev_reindex(dev);
+	return rv;
+}
+
 int
 __ni_discover_vlan(ni_netdev_t *dev, struct nlattr **tb, ni_netconfig_t *nc)
 {
@@ -29,9 +29,11 @@
 #include "json.h"
 #include "buffer.h"
 #include "util_priv.h"
+#include "hashmap_priv.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
 #include <ctype.h>
 #include <inttypes.h>
@@ -46,6 +48,11 @@
 #define	NI_JSON_OBJECT_CHUNK	4
 #define NI_JSON_ARRAY_CHUNK	4
 
+/*
+ * objects with at least this number of pairs get a key index
+ */
+#define NI_JSON_OBJECT_INDEX_MIN	8
+
 
 /*
  * structured types
@@ -74,6 +81,9 @@ struct ni_json_pair {
 struct ni_json_object {
 	unsigned int		count;
 	ni_json_pair_t **	data;
+
+	unsigned int		index_size;	/* power of 2, 0 if not indexed */
+	unsigned int *		index;		/* open addressing, pair pos + 1 */
 };
 
 struct ni_json_array {
@@ -276,6 +286,97 @@ ni_json_object_new(void)
 	return xcalloc(1, sizeof(ni_json_object_t));
 }
 
+static void
+ni_json_object_index_free(ni_json_object_t *njo)
+{
+	free(njo->index);
+	njo->index = NULL;
+	njo->index_size = 0;
+}
+
+static void
+ni_json_object_index_insert(ni_json_object_t *njo, unsigned int pos)
+{
+	unsigned int mask = njo->index_size - 1;
+	unsigned int slot;
+
+	slot = ni_hashmap_hash_string(njo->data[pos]->name) & mask;
+	while (njo->index[slot])
+		slot = (slot + 1) & mask;
+	njo->index[slot] = pos + 1;
+}
+
+/*
+ * (Re)build the key index with at most half of the slots used;
+ * the pairs are inserted in order, so probing finds the first
+ * of duplicate names first.
+ */
+static void
+ni_json_object_index_build(ni_json_object_t *njo)
+{
+	unsigned int i, size = NI_JSON_OBJECT_INDEX_MIN * 2;
+
+	while (size / 2 < njo->count + 1)
+		size *= 2;
+
+	free(njo->index);
+	njo->index = xcalloc(size, sizeof(*njo->index));
+	njo->index_size = size;
+
+	for (i = 0; i < njo->count; ++i)
+		ni_json_object_index_insert(njo, i);
+}
+
+/*
+ * Index the pair appended at the end of the pair array
+ */
+static void
+ni_json_object_index_append(ni_json_object_t *njo)
+{
+	if (!njo->index)
+		return;
+
+	if (njo->count > njo->index_size / 2)
+		ni_json_object_index_build(njo);
+	else
+		ni_json_object_index_insert(njo, njo->count - 1);
+}
+
+/*
+ * Find the position of the first pair named @name
+ */
+static ni_bool_t
+ni_json_object_find(ni_json_object_t *njo, const char *name, unsigned int *pos)
+{
+	unsigned int i, mask, slot;
+
+	if (!name)
+		return FALSE;
+
+	if (!njo->index && njo->count >= NI_JSON_OBJECT_INDEX_MIN)
+		ni_json_object_index_build(njo);
+
+	if (!njo->index) {
+		for (i = 0; i < njo->count; ++i) {
+			if (ni_string_eq(njo->data[i]->name, name)) {
+				*pos = i;
+				return TRUE;
+			}
+		}
+		return FALSE;
+	}
+
+	mask = njo->index_size - 1;
+	slot = ni_hashmap_hash_string(name) & mask;
+	for ( ; (i = njo->index[slot]) != 0; slot = (slot + 1) & mask) {
+		if (ni_string_eq(njo->data[i - 1]->name, name)) {
+			*pos = i - 1;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 static void
 ni_json_object_free(ni_json_object_t *njo)
 {
@@ -286,6 +387,7 @@ ni_json_object_free(ni_json_object_t *njo)
 	}
 	free(njo->data);
 	njo->data = NULL;
+	ni_json_object_index_free(njo);
 	free(njo);
 }
 
@@ -293,18 +395,14 @@ ni_json_pair_t *
 ni_json_object_get_pair(ni_json_t *json, const char *name)
 {
 	ni_json_object_t *njo;
-	unsigned int i;
+	unsigned int pos;
 
 	if (!(njo = ni_json_to_object(json)))
 		return NULL;
 
-	for (i = 0; i < njo->count; ++i) {
-		ni_json_pair_t *pair = njo->data[i];
-
-		if (ni_string_eq(pair->name, name))
-			return pair;
-	}
-	return NULL;
+	if (!ni_json_object_find(njo, name, &pos))
+		return NULL;
+	return njo->data[pos];
 }
 
 ni_json_pair_t *
@@ -373,6 +471,7 @@ ni_json_object_append(ni_json_t *json, const char *name, ni_json_t *value)
 		ni_json_object_realloc(njo, njo->count);
 
 	njo->data[njo->count++] = pair;
+	ni_json_object_index_append(njo);
 	return TRUE;
 }
 
@@ -424,6 +523,9 @@ ni_json_object_remove_at(ni_json_t *json, unsigned int pos)
 	ni_json_pair_free(njo->data[pos]);
 	njo->count--;
 
+	/* the positions of the following pairs change */
+	ni_json_object_index_free(njo);
+
 	if (pos < njo->count) {
 		memmove(&njo->data[pos], &njo->data[pos + 1],
 			(njo->count - pos) * sizeof(ni_json_pair_t *));
@@ -445,18 +547,14 @@ ni_json_t *
 ni_json_object_remove(ni_json_t *json, const char *name)
 {
 	ni_json_object_t *njo;
-	unsigned int i;
+	unsigned int pos;
 
 	if (!(njo = ni_json_to_object(json)))
 		return NULL;
 
-	for (i = 0; i < njo->count; ++i) {
-		ni_json_pair_t *pair = njo->data[i];
-
-		if (ni_string_eq(pair->name, name))
-			return ni_json_object_remove_at(json, i);
-	}
-	return NULL;
+	if (!ni_json_object_find(njo, name, &pos))
+		return NULL;
+	return ni_json_object_remove_at(json, pos);
 }
 
 ni_bool_t
@@ -1085,9 +1183,8 @@ typedef enum {
 
 typedef struct ni_json_reader_stack	ni_json_reader_stack_t;
 typedef struct ni_json_reader		ni_json_reader_t;
-typedef int    ni_json_reader_get_data_fn_t(ni_json_reader_t *, void *, size_t);
-typedef int    ni_json_reader_get_char_fn_t(ni_json_reader_t *);
-typedef int    ni_json_reader_unget_char_fn_t(ni_json_reader_t *, int);
+
+#define NI_JSON_READER_CHUNK_SIZE	65536
 
 struct ni_json_reader_stack {
 	ni_json_reader_stack_t *	parent;
@@ -1096,9 +1193,17 @@ struct ni_json_reader_stack {
 	ni_json_t *			value;
 };
 
+/*
+ * The reader scans a contiguous memory window [pos, end): the unread
+ * data of the input buffer or the last chunk read from the input file.
+ */
 struct ni_json_reader {
 	FILE *				file;
 	ni_buffer_t *			inbuf;
+	char *				chunk;
+	const char *			head;
+	const char *			pos;
+	const char *			end;
 #ifdef HAVE_ICONV_H
 	iconv_t				iconv;
 #endif
@@ -1106,9 +1211,6 @@ struct ni_json_reader {
 	ni_bool_t			quiet;
 	ni_string_array_t		error;
 	ni_json_reader_stack_t *	stack;
-	ni_json_reader_get_data_fn_t *	get_data;
-	ni_json_reader_get_char_fn_t *	get_char;
-	ni_json_reader_unget_char_fn_t *unget_char;
 };
 
 static ni_json_reader_stack_t *
@@ -1138,78 +1240,73 @@ ni_json_reader_stack_pop(ni_json_reader_t *jr)
 	return jr->stack;
 }
 
-static int
-ni_json_reader_buffer_get(ni_json_reader_t *jr, void *data, size_t len)
+static ni_bool_t
+ni_json_reader_init_buffer(ni_json_reader_t *jr, ni_buffer_t *buf)
 {
-	return ni_buffer_get(jr->inbuf, data, len);
-}
+	memset(jr, 0, sizeof(*jr));
+#ifdef HAVE_ICONV_H
+	jr->iconv = (iconv_t)-1;
+#endif
+	ni_string_array_init(&jr->error);
 
-static int
-ni_json_reader_buffer_getc(ni_json_reader_t *jr)
-{
-	return ni_buffer_getc(jr->inbuf);
-}
+	if (!(jr->inbuf = buf))
+		return FALSE;
 
-static int
-ni_json_reader_buffer_ungetc(ni_json_reader_t *jr, int cc)
-{
-	return ni_buffer_ungetc(jr->inbuf, cc);
+	jr->head = ni_buffer_head(buf);
+	jr->pos  = jr->head;
+	jr->end  = jr->head + ni_buffer_count(buf);
+	return TRUE;
 }
 
 static ni_bool_t
-ni_json_reader_init_buffer(ni_json_reader_t *jr, ni_buffer_t *buf)
+ni_json_reader_init_file(ni_json_reader_t *jr, FILE *file)
 {
-	jr->file  = NULL;
-	jr->inbuf = buf;
+	memset(jr, 0, sizeof(*jr));
 #ifdef HAVE_ICONV_H
 	jr->iconv = (iconv_t)-1;
 #endif
-	jr->stack = NULL;
-	jr->close = FALSE;
-	jr->quiet = FALSE;
 	ni_string_array_init(&jr->error);
 
-	jr->get_data   = ni_json_reader_buffer_get;
-	jr->get_char   = ni_json_reader_buffer_getc;
-	jr->unget_char = ni_json_reader_buffer_ungetc;
-	return buf != NULL;
+	jr->file = file;
+	return file != NULL;
 }
 
-static int
-ni_json_reader_file_get(ni_json_reader_t *jr, void *data, size_t len)
+/*
+ * Read the next chunk of the file into the window once it is consumed.
+ * Buffers are scanned in one window and have nothing left to read.
+ */
+static ni_bool_t
+ni_json_reader_fill(ni_json_reader_t *jr)
 {
-	return fread(data, 1, len, jr->file) == len ? 0 : EOF;
-}
+	size_t len;
 
-static int
-ni_json_reader_file_getc(ni_json_reader_t *jr)
-{
-	return getc(jr->file);
+	if (!jr->file)
+		return FALSE;
+
+	if (!jr->chunk)
+		jr->chunk = xmalloc(NI_JSON_READER_CHUNK_SIZE);
+
+	len = fread(jr->chunk, 1, NI_JSON_READER_CHUNK_SIZE, jr->file);
+	jr->head = jr->chunk;
+	jr->pos  = jr->chunk;
+	jr->end  = jr->chunk + len;
+	return len > 0;
 }
 
-static int
-ni_json_reader_file_ungetc(ni_json_reader_t *jr, int cc)
+static inline int
+ni_json_reader_peek(ni_json_reader_t *jr)
 {
-	return ungetc(cc, jr->file) == cc ? 0 : EOF;
+	if (jr->pos == jr->end && !ni_json_reader_fill(jr))
+		return EOF;
+	return (unsigned char)*jr->pos;
 }
 
-static ni_bool_t
-ni_json_reader_init_file(ni_json_reader_t *jr, FILE *file)
+static inline int
+ni_json_reader_getc(ni_json_reader_t *jr)
 {
-	jr->file  = file;
-	jr->inbuf = NULL;
-#ifdef HAVE_ICONV_H
-	jr->iconv = (iconv_t)-1;
-#endif
-	jr->stack = NULL;
-	jr->close = FALSE;
-	jr->quiet = FALSE;
-	ni_string_array_init(&jr->error);
-
-	jr->get_data   = ni_json_reader_file_get;
-	jr->get_char   = ni_json_reader_file_getc;
-	jr->unget_char = ni_json_reader_file_ungetc;
-	return file != NULL;
+	if (jr->pos == jr->end && !ni_json_reader_fill(jr))
+		return EOF;
+	return (unsigned char)*jr->pos++;
 }
 
 static ni_bool_t
@@ -1248,9 +1345,16 @@ ni_json_reader_destroy(ni_json_reader_t *jr)
 		jr->close = FALSE;
 		jr->file = NULL;
 	}
-	jr->inbuf = NULL;
+	if (jr->inbuf) {
+		/* consume the parsed data as the former getc reader did */
+		ni_buffer_pull_head(jr->inbuf, jr->pos - jr->head);
+		jr->inbuf = NULL;
+	}
+	free(jr->chunk);
+	jr->chunk = NULL;
+	jr->head = jr->pos = jr->end = NULL;
 #ifdef HAVE_ICONV_H
-	if (jr->iconv)
+	if (jr->iconv != (iconv_t)-1)
 		iconv_close(jr->iconv);
 	jr->iconv = (iconv_t)-1;
 #endif
@@ -1324,51 +1428,53 @@ ni_json_reader_get_parent(ni_json_reader_t *jr)
 static void
 ni_json_reader_skip_spaces(ni_json_reader_t *jr)
 {
-	int cc;
-
-	while ((cc = jr->get_char(jr)) != EOF) {
-		if (!isspace(cc)) {
-			jr->unget_char(jr, cc);
-			break;
-		}
-	}
+	do {
+		while (jr->pos < jr->end && isspace((unsigned char)*jr->pos))
+			jr->pos++;
+	} while (jr->pos == jr->end && ni_json_reader_fill(jr));
 }
 
 static void
 ni_json_reader_get_literal(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
-	int cc;
+	const char *run;
 
-	while ((cc = jr->get_char(jr)) != EOF) {
-		if (!isalpha(cc)) {
-			jr->unget_char(jr, cc);
-			break;
+	do {
+		for (run = jr->pos; jr->pos < jr->end; jr->pos++) {
+			if (!isalpha((unsigned char)*jr->pos))
+				break;
 		}
-		ni_stringbuf_putc(res, cc);
+		if (jr->pos > run)
+			ni_stringbuf_put(res, run, jr->pos - run);
+	} while (jr->pos == jr->end && ni_json_reader_fill(jr));
+}
+
+static inline ni_bool_t
+ni_json_number_char(char cc)
+{
+	switch (cc) {
+	case '+': case '-':
+	case 'e': case 'E':
+	case '.':
+		return TRUE;
+	default:
+		return isdigit((unsigned char)cc) != 0;
 	}
 }
 
 static void
 ni_json_reader_get_number(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
-	int cc;
+	const char *run;
 
-	while ((cc = jr->get_char(jr)) != EOF) {
-		switch (cc) {
-		case '+': case '-':
-		case 'e': case 'E':
-		case '.':
-			ni_stringbuf_putc(res, cc);
-			break;
-		default:
-			if (isdigit(cc)) {
-				ni_stringbuf_putc(res, cc);
+	do {
+		for (run = jr->pos; jr->pos < jr->end; jr->pos++) {
+			if (!ni_json_number_char(*jr->pos))
 				break;
-			}
-			jr->unget_char(jr, cc);
-			return;
 		}
-	}
+		if (jr->pos > run)
+			ni_stringbuf_put(res, run, jr->pos - run);
+	} while (jr->pos == jr->end && ni_json_reader_fill(jr));
 }
 
 static inline const char *
@@ -1399,9 +1505,15 @@ ni_json_reader_get_eunicode_hex(ni_json_reader_t *jr, uint8_t *hex)
 	char hbuf[3] = { 0x0, 0x0, 0x0 };
 	unsigned int octet;
 	char *end = NULL;
+	int cc;
 
-	if (jr->get_data(jr, &hbuf[0], 2))
+	if ((cc = ni_json_reader_getc(jr)) == EOF)
 		return FALSE;
+	hbuf[0] = cc;
+
+	if ((cc = ni_json_reader_getc(jr)) == EOF)
+		return FALSE;
+	hbuf[1] = cc;
 
 	octet = strtoul(&hbuf[0], &end, 16);
 	if (octet > 255 || *end != '\0')
@@ -1518,14 +1630,13 @@ ni_json_reader_get_eunicode(ni_json_reader_t *jr, ni_stringbuf_t *res)
 		if (!(ret = ni_json_reader_get_eunicode_raw(jr, &raw)))
 			break;
 
-		if ((cc = jr->get_char(jr)) != '\\') {
-			if (cc != EOF)
-				jr->unget_char(jr, cc);
+		if (ni_json_reader_peek(jr) != '\\') {
 			cc = EOF;
 			break;
 		}
+		jr->pos++;
 
-	} while ((cc = jr->get_char(jr)) == 'u');
+	} while ((cc = ni_json_reader_getc(jr)) == 'u');
 
 	ret = ni_json_reader_get_eunicode_str(jr, res,
 			ni_buffer_head(&raw),
@@ -1573,40 +1684,45 @@ ni_json_reader_get_eunicode(ni_json_reader_t *jr, ni_stringbuf_t *res)
 static ni_bool_t
 ni_json_reader_get_qstring(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
-	ni_bool_t escaped = FALSE;
-	const char *us;
+	const char *run, *us;
 	int cc;
 
-	while ((cc = jr->get_char(jr)) != EOF) {
-		if (escaped) {
-			if (cc == 'u') {
+	for (;;) {
+		/* copy the run up to the closing quote or an escape at once */
+		for (run = jr->pos; jr->pos < jr->end; jr->pos++) {
+			if (*jr->pos == '"' || *jr->pos == '\\')
+				break;
+		}
+		if (jr->pos > run)
+			ni_stringbuf_put(res, run, jr->pos - run);
+
+		if (jr->pos == jr->end) {
+			if (!ni_json_reader_fill(jr))
+				return FALSE; /* unterminated quoted string */
+			continue;
+		}
+
+		if (*jr->pos++ == '"')
+			return TRUE; /* OK, end of quoted string */
+
+		/* escape sequence */
+		if ((cc = ni_json_reader_getc(jr)) == EOF)
+			return FALSE; /* unterminated quoted string */
+
+		if (cc == 'u') {
 #ifdef HAVE_ICONV_H
-				if (!ni_json_reader_open_iconv(jr))
-					return FALSE;	/* decoder failed */
+			if (!ni_json_reader_open_iconv(jr))
+				return FALSE;	/* decoder failed */
 #endif
-				if (!ni_json_reader_get_eunicode(jr, res))
-					return FALSE;	/* decoding error */
-			} else {
-				if (!(us = ni_json_string_unescape_map(cc)))
-					return FALSE;	/* unknown escape */
-
-				ni_stringbuf_puts(res, us);
-			}
-			escaped = FALSE;
+			if (!ni_json_reader_get_eunicode(jr, res))
+				return FALSE;	/* decoding error */
 		} else {
-			switch (cc) {
-			case '"':
-				return TRUE; /* OK, end of quoted string */
-			case '\\':
-				escaped = TRUE;
-				break;
-			default:
-				ni_stringbuf_putc(res, cc);
-				break;
-			}
+			if (!(us = ni_json_string_unescape_map(cc)))
+				return FALSE;	/* unknown escape */
+
+			ni_stringbuf_puts(res, us);
 		}
 	}
-	return FALSE; /* unterminated quoted string */
 }
 
 static ni_json_token_type_t
@@ -1614,7 +1730,7 @@ ni_json_get_token(ni_json_reader_t *jr, ni_stringbuf_t *res)
 {
 	int cc;
 
-	if ((cc = jr->get_char(jr)) == EOF)
+	if ((cc = ni_json_reader_getc(jr)) == EOF)
 		return EndOfFile;
 
 	switch (cc) {
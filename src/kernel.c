@@ -398,6 +398,8 @@ struct __ni_nl_dump_state {
 	int			msg_type;
 	unsigned int		hdrlen;
 	struct ni_nlmsg_list *	list;
+	ni_nl_dump_func_t *	func;
+	void *			user_data;
 };
 
 void
@@ -449,7 +451,7 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 		return NL_SKIP;
 	}
 
-	if (data->list == NULL)
+	if (data->list == NULL && data->func == NULL)
 		return NL_OK;
 
 	nlh = nlmsg_hdr(msg);
@@ -464,6 +466,11 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 		return NL_SKIP;
 	}
 
+	if (data->func) {
+		/* parse in place from the receive buffer */
+		data->func(nlh, data->user_data);
+		return NL_OK;
+	}
 
 	if (!ni_nlmsg_list_append(data->list, nlh))
 		return NL_SKIP;
@@ -472,16 +479,12 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 }
 
 /*
- * Issue a DUMP request and store all replies in list
+ * Issue a DUMP request and pass the replies to the dump state
  */
-int
-ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+static int
+__ni_nl_dump(int af, int type, struct __ni_nl_dump_state *data)
 {
 	struct nl_sock *nl_sock;
-	struct __ni_nl_dump_state data = {
-		.msg_type = -1,
-		.list = list,
-	};
 	struct nl_cb *cb;
 	const char *name;
 	int rv;
@@ -500,7 +503,7 @@ ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
 	if (!(cb = __ni_nl_cb_clone(__ni_global_netlink)))
 		return -NLE_NOMEM;
 
-	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, __ni_nl_dump_valid, &data);
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, __ni_nl_dump_valid, data);
 
 retry:
 	rv = nl_recvmsgs(nl_sock, cb);
@@ -526,6 +529,42 @@ retry:
 	return rv;
 }
 
+/*
+ * Issue a DUMP request and store all replies in list
+ */
+int
+ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+{
+	struct __ni_nl_dump_state data = {
+		.msg_type = -1,
+		.list = list,
+	};
+
+	return __ni_nl_dump(af, type, &data);
+}
+
+/*
+ * Issue a DUMP request and call func for each reply while it is
+ * still in the receive buffer. The message must not be referenced
+ * after func returned.
+ * Note, that the replies are already processed when the dump got
+ * interrupted (-NLE_DUMP_INTR) and the caller repeats it.
+ */
+int
+ni_nl_dump_foreach(int af, int type, ni_nl_dump_func_t *func, void *user_data)
+{
+	struct __ni_nl_dump_state data = {
+		.msg_type = -1,
+		.func = func,
+		.user_data = user_data,
+	};
+
+	if (!func)
+		return -NLE_INVAL;
+
+	return __ni_nl_dump(af, type, &data);
+}
+
 /*
  * Send a message and capture the response message(s)
  */
@@ -550,6 +589,261 @@ ni_nl_talk(struct nl_msg *msg, struct ni_nlmsg_list *list)
 	}
 }
 
+/*
+ * Batched netlink requests.
+ *
+ * Queued requests are sent in chunks using a single sendmsg each.
+ * Further chunks are sent while the ACKs of the previous ones are
+ * outstanding, up to a window of requests in flight which keeps the
+ * ACKs within the default socket receive buffer. The ACKs are matched
+ * back to the requests by sequence number, reporting the per-request
+ * status to the done callback of the request.
+ */
+#define NI_NL_BATCH_CHUNK_MSGS		64
+#define NI_NL_BATCH_CHUNK_SIZE		(32 * 1024)
+#define NI_NL_BATCH_WINDOW_MSGS		(2 * NI_NL_BATCH_CHUNK_MSGS)
+
+typedef struct ni_nl_batch_req	ni_nl_batch_req_t;
+
+struct ni_nl_batch_req {
+	ni_nl_batch_req_t *		next;
+	struct nl_msg *			msg;
+	uint32_t			seq;
+	ni_nl_batch_done_fn_t *		done;
+	void *				user_data;
+};
+
+struct ni_nl_batch {
+	ni_netlink_t *			nl;
+	ni_nl_batch_req_t *		queue;
+	ni_nl_batch_req_t **		tail;
+	ni_nl_batch_req_t *		pending;
+	ni_nl_batch_req_t **		pending_tail;
+	unsigned int			inflight;
+	unsigned int			failed;
+};
+
+ni_nl_batch_t *
+ni_nl_batch_new(void)
+{
+	ni_nl_batch_t *batch;
+
+	if (!__ni_global_netlink) {
+		ni_error("%s: no netlink socket", __func__);
+		return NULL;
+	}
+
+	batch = xcalloc(1, sizeof(*batch));
+	batch->nl = __ni_global_netlink;
+	batch->tail = &batch->queue;
+	batch->pending_tail = &batch->pending;
+	return batch;
+}
+
+int
+ni_nl_batch_add(ni_nl_batch_t *batch, struct nl_msg *msg,
+		ni_nl_batch_done_fn_t *done, void *user_data)
+{
+	ni_nl_batch_req_t *req;
+
+	if (!batch || !msg) {
+		if (msg)
+			nlmsg_free(msg);
+		return -1;
+	}
+
+	req = xcalloc(1, sizeof(*req));
+	req->msg = msg;
+	req->done = done;
+	req->user_data = user_data;
+
+	*batch->tail = req;
+	batch->tail = &req->next;
+	return 0;
+}
+
+static void
+ni_nl_batch_req_done(ni_nl_batch_t *batch, ni_nl_batch_req_t *req, int err)
+{
+	if (err < 0)
+		batch->failed++;
+	if (req->done)
+		req->done(batch, err, req->user_data);
+	nlmsg_free(req->msg);
+	free(req);
+}
+
+static void
+ni_nl_batch_complete(ni_nl_batch_t *batch, uint32_t seq, int err)
+{
+	ni_nl_batch_req_t **pos, *req;
+
+	/* the kernel acks in request order, so it's usually the head */
+	for (pos = &batch->pending; (req = *pos); pos = &req->next) {
+		if (req->seq != seq)
+			continue;
+
+		if (!(*pos = req->next))
+			batch->pending_tail = pos;
+		batch->inflight--;
+		ni_nl_batch_req_done(batch, req, err);
+		return;
+	}
+	ni_debug_socket("netlink batch: ignoring ack for unknown seq %u", seq);
+}
+
+static int
+ni_nl_batch_seq_check(struct nl_msg *msg, void *arg)
+{
+	/* pipelined requests: matched by sequence in the ack handlers */
+	return NL_OK;
+}
+
+static int
+ni_nl_batch_ack_handler(struct nl_msg *msg, void *arg)
+{
+	ni_nl_batch_complete(arg, nlmsg_hdr(msg)->nlmsg_seq, 0);
+	return NL_OK;
+}
+
+static int
+ni_nl_batch_error_handler(struct sockaddr_nl *sender, struct nlmsgerr *err, void *arg)
+{
+	ni_debug_ifconfig("netlink reports error %d on seq %u",
+			err->error, err->msg.nlmsg_seq);
+	ni_nl_batch_complete(arg, err->msg.nlmsg_seq,
+			err->error ? -nl_syserr2nlerr(err->error) : 0);
+	return NL_OK;
+}
+
+static void
+ni_nl_batch_fail_pending(ni_nl_batch_t *batch, int err)
+{
+	ni_nl_batch_req_t *req;
+
+	while ((req = batch->pending)) {
+		batch->pending = req->next;
+		ni_nl_batch_req_done(batch, req, err);
+	}
+	batch->pending_tail = &batch->pending;
+	batch->inflight = 0;
+}
+
+static int
+ni_nl_batch_send_chunk(ni_nl_batch_t *batch, struct nl_sock *nl_sock)
+{
+	ni_nl_batch_req_t **tail = batch->pending_tail, *req;
+	unsigned char *buf = NULL;
+	struct nlmsghdr *nlh;
+	size_t len = 0, size;
+	unsigned int count;
+	int err;
+
+	for (count = 0; (req = batch->queue); ++count) {
+		nlh = nlmsg_hdr(req->msg);
+		size = NLMSG_ALIGN(nlh->nlmsg_len);
+		if (count && (count >= NI_NL_BATCH_CHUNK_MSGS ||
+				len + size > NI_NL_BATCH_CHUNK_SIZE))
+			break;
+		if (batch->inflight + count >= NI_NL_BATCH_WINDOW_MSGS)
+			break;
+
+		if (!(batch->queue = req->next))
+			batch->tail = &batch->queue;
+		req->next = NULL;
+		*tail = req;
+		tail = &req->next;
+
+		nl_complete_msg(nl_sock, req->msg);
+		nlh->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+		req->seq = nlh->nlmsg_seq;
+
+		buf = xrealloc(buf, len + size);
+		memset(buf + len, 0, size);
+		memcpy(buf + len, nlh, nlh->nlmsg_len);
+		len += size;
+	}
+
+	batch->pending_tail = tail;
+	batch->inflight += count;
+
+	err = nl_sendto(nl_sock, buf, len);
+	free(buf);
+	if (err < 0) {
+		ni_error("%s: unable to send %u requests: %s", __func__,
+				count, nl_geterror(err));
+		return err;
+	}
+	ni_debug_socket("%s: sent %u requests in %zu bytes", __func__, count, len);
+	return 0;
+}
+
+/*
+ * Send all queued requests and collect their acks.
+ * Returns the number of failed requests or a negative
+ * netlink error when the transfer itself failed.
+ */
+int
+ni_nl_batch_flush(ni_nl_batch_t *batch)
+{
+	struct nl_sock *nl_sock;
+	struct nl_cb *cb;
+	int err, ret = 0;
+
+	if (!batch)
+		return -NLE_INVAL;
+
+	if (!batch->nl || !(nl_sock = batch->nl->nl_sock)) {
+		ni_error("%s: no netlink socket", __func__);
+		return -NLE_BAD_SOCK;
+	}
+
+	if (!(cb = __ni_nl_cb_clone(batch->nl)))
+		return -NLE_NOMEM;
+
+	nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, ni_nl_batch_seq_check, NULL);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ni_nl_batch_ack_handler, batch);
+	nl_cb_err(cb, NL_CB_CUSTOM, ni_nl_batch_error_handler, batch);
+
+	batch->failed = 0;
+	while (batch->queue || batch->pending) {
+		/* fill the window, done callbacks may queue further requests */
+		while (batch->queue && batch->inflight < NI_NL_BATCH_WINDOW_MSGS) {
+			if ((err = ni_nl_batch_send_chunk(batch, nl_sock)) < 0) {
+				ni_nl_batch_fail_pending(batch, err);
+				ret = err;
+			}
+		}
+
+		if (batch->pending && (err = nl_recvmsgs(nl_sock, cb)) < 0) {
+			ni_debug_socket("%s: recv failed: %s", __func__,
+					nl_geterror(err));
+			ni_nl_batch_fail_pending(batch, err);
+			ret = err;
+		}
+	}
+	nl_cb_put(cb);
+
+	return ret < 0 ? ret : (int)batch->failed;
+}
+
+void
+ni_nl_batch_free(ni_nl_batch_t *batch)
+{
+	ni_nl_batch_req_t *req;
+
+	if (!batch)
+		return;
+
+	/* report requests never sent, e.g. on error paths */
+	ni_nl_batch_fail_pending(batch, -NLE_INTR);
+	while ((req = batch->queue)) {
+		batch->queue = req->next;
+		ni_nl_batch_req_done(batch, req, -NLE_INTR);
+	}
+	free(batch);
+}
+
 #define ni_t2n(x)	[x] = #x
 static const char *	ni_rtnl_msg_type_names[RTM_MAX] = {
 #ifdef	RTM_NEWLINK
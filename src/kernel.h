@@ -62,8 +62,20 @@ struct ni_nlmsg_list {
 	struct ni_nlmsg **	tail;
 };
 
+typedef void	ni_nl_dump_func_t(struct nlmsghdr *, void *);
+
 extern int	ni_nl_talk(struct nl_msg *, struct ni_nlmsg_list *);
 extern int	ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list);
+extern int	ni_nl_dump_foreach(int af, int type, ni_nl_dump_func_t *, void *);
+
+typedef struct ni_nl_batch	ni_nl_batch_t;
+typedef void			ni_nl_batch_done_fn_t(ni_nl_batch_t *, int, void *);
+
+extern ni_nl_batch_t *	ni_nl_batch_new(void);
+extern int		ni_nl_batch_add(ni_nl_batch_t *, struct nl_msg *,
+					ni_nl_batch_done_fn_t *, void *);
+extern int		ni_nl_batch_flush(ni_nl_batch_t *);
+extern void		ni_nl_batch_free(ni_nl_batch_t *);
 
 extern void	ni_nlmsg_list_init(struct ni_nlmsg_list *);
 extern void	ni_nlmsg_list_destroy(struct ni_nlmsg_list *);
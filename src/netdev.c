@@ -159,6 +159,34 @@ ni_netdev_reset(ni_netdev_t *dev)
 	ni_netdev_set_ethtool(dev, NULL);
 
 	ni_netdev_clear_event_filters(dev);
+	ni_netdev_reindex(dev);
+}
+
+/*
+ * Set the name of the device, updating the interfaces
+ * list lookup index when the device is in a list.
+ */
+ni_bool_t
+ni_netdev_set_name(ni_netdev_t *dev, const char *name)
+{
+	if (!dev || !ni_string_dup(&dev->name, name))
+		return FALSE;
+
+	ni_netdev_reindex(dev);
+	return TRUE;
+}
+
+/*
+ * Update the name of the device to its current kernel name.
+ */
+ni_bool_t
+ni_netdev_refresh_name(ni_netdev_t *dev)
+{
+	if (!dev || !ni_netdev_index_to_name(&dev->name, dev->link.ifindex))
+		return FALSE;
+
+	ni_netdev_reindex(dev);
+	return TRUE;
 }
 
 /*
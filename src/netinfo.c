@@ -19,6 +19,7 @@
 #include <wicked/socket.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
+#include "hashmap_priv.h"
 #include "dbus-server.h"
 #include "appconfig.h"
 #include "xml-schema.h"
@@ -40,14 +41,46 @@ typedef struct ni_netconfig_filter {
 	unsigned int		discover;
 } ni_netconfig_filter_t;
 
+/*
+ * Hash indexes of the interfaces list by the keys used by the
+ * ni_netdev_by_* lookup functions; each indexed device refers
+ * to its entry.
+ */
+enum {
+	NI_NETDEV_INDEX_IFINDEX,
+	NI_NETDEV_INDEX_NAME,
+	NI_NETDEV_INDEX_HWADDR,
+	NI_NETDEV_INDEX_VLAN,
+
+	NI_NETDEV_INDEX_MAX
+};
+
+typedef struct ni_netdev_index	ni_netdev_index_t;
+
+struct ni_netdev_index_entry {
+	ni_netdev_index_t *	index;
+	ni_netdev_t *		dev;
+	unsigned int		order;	/* position in interfaces list */
+	unsigned int		keys;	/* indexes containing the entry */
+	unsigned int		hash[NI_NETDEV_INDEX_MAX];
+};
+typedef struct ni_netdev_index_entry	ni_netdev_index_entry_t;
+
+struct ni_netdev_index {
+	unsigned int		order;
+	ni_hashmap_t		map[NI_NETDEV_INDEX_MAX];
+};
+
 struct ni_netconfig {
 	ni_netconfig_filter_t	filter;
 
 	ni_netdev_t *		interfaces;
+	ni_netdev_index_t	index;
 	ni_modem_t *		modems;
 
 	struct {
-		ni_rule_array_t	rules;
+		ni_rule_array_t	rules;		/* sorted by pref */
+		ni_hashmap_t	index;		/* rules by ni_rule_hash */
 	}			route;
 
 	unsigned char		initialized;
@@ -425,11 +458,21 @@ ni_create_dbus_client(const char *dbus_name)
 	return ni_dbus_client_open(ni_global.config->dbus_type, dbus_name);
 }
 
+/*
+ * The processed schema is cached in the state directory and used
+ * as long as the schema files do not change.
+ */
+#define NI_SERVER_DBUS_XML_SCHEMA_CACHE	"schema.cache"
+
 ni_xs_scope_t *
 ni_server_dbus_xml_schema(void)
 {
 	const char *filename = ni_global.config->dbus_xml_schema_file;
+	unsigned char key[NI_XS_CACHE_KEY_SIZE];
+	char cachefile[PATH_MAX] = { '\0' };
 	ni_xs_scope_t *scope;
+	unsigned int builtins;
+	int keylen;
 
 	if (filename == NULL) {
 		ni_error("Cannot create dbus xml schema: no schema path configured");
@@ -437,12 +480,27 @@ ni_server_dbus_xml_schema(void)
 	}
 
 	scope = ni_dbus_xml_init();
+	builtins = scope->types.count;
+
+	keylen = ni_xs_schema_cache_key(filename, key, sizeof(key));
+	if (keylen > 0 && ni_global.config->statedir.path) {
+		snprintf(cachefile, sizeof(cachefile), "%s/%s",
+				ni_global.config->statedir.path,
+				NI_SERVER_DBUS_XML_SCHEMA_CACHE);
+
+		if (ni_xs_scope_cache_load(scope, cachefile, key, keylen))
+			return scope;
+	}
+
 	if (ni_xs_process_schema_file(filename, scope) < 0) {
 		ni_error("Cannot create dbus xml schema: error in schema definition");
 		ni_xs_scope_free(scope);
 		return NULL;
 	}
 
+	if (*cachefile)
+		ni_xs_scope_cache_save(scope, builtins, cachefile, key, keylen);
+
 	return scope;
 }
 
@@ -517,7 +575,16 @@ ni_netconfig_init(ni_netconfig_t *nc)
 void
 ni_netconfig_destroy(ni_netconfig_t *nc)
 {
+	ni_netdev_t *dev;
+	unsigned int i;
+
+	for (dev = nc->interfaces; dev; dev = dev->next)
+		ni_netconfig_device_unindex(nc, dev);
+	for (i = 0; i < NI_NETDEV_INDEX_MAX; ++i)
+		ni_hashmap_destroy(&nc->index.map[i]);
+
 	__ni_netdev_list_destroy(&nc->interfaces);
+	ni_hashmap_destroy(&nc->route.index);
 	ni_rule_array_destroy(&nc->route.rules);
 	memset(nc, 0, sizeof(*nc));
 }
@@ -577,6 +644,7 @@ void
 ni_netconfig_device_append(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
 	__ni_netdev_list_append(&nc->interfaces, dev);
+	ni_netconfig_device_index(nc, dev);
 }
 
 static inline void
@@ -598,6 +666,7 @@ ni_netconfig_device_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
 	for (pos = &nc->interfaces; (cur = *pos) != NULL; pos = &cur->next) {
 		if (cur == dev) {
 			*pos = cur->next;
+			ni_netconfig_device_unindex(nc, cur);
 			ni_netconfig_device_unbind_slave_index(nc, cur->link.ifindex);
 			ni_netdev_put(cur);
 			return;
@@ -605,6 +674,120 @@ ni_netconfig_device_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
 	}
 }
 
+/*
+ * Maintain the interfaces list hash indexes.
+ *
+ * Devices are indexed by device_append and unindexed by device_remove;
+ * devices linked into or out of the interfaces list directly have to
+ * use ni_netconfig_device_index and ni_netconfig_device_unindex.
+ * The functions changing the device keys in place (name, ifindex,
+ * hwaddr, vlan) call ni_netdev_reindex to update the indexes.
+ */
+static inline unsigned int
+ni_netdev_index_hash_hwaddr(const ni_hwaddr_t *hwaddr)
+{
+	return ni_hashmap_hash_data(0, hwaddr->data, hwaddr->len);
+}
+
+static inline unsigned int
+ni_netdev_index_hash_vlan(const char *parent_name, uint16_t tag)
+{
+	return ni_hashmap_hash_data(ni_hashmap_hash_string(parent_name), &tag, sizeof(tag));
+}
+
+static void
+ni_netdev_index_add_key(ni_netdev_index_t *index, ni_netdev_index_entry_t *ie,
+			unsigned int key, unsigned int hash)
+{
+	if (ni_hashmap_insert(&index->map[key], hash, ie)) {
+		ie->hash[key] = hash;
+		ie->keys |= NI_BIT(key);
+	}
+}
+
+static void
+ni_netdev_index_add_keys(ni_netdev_index_t *index, ni_netdev_index_entry_t *ie)
+{
+	const ni_netdev_t *dev = ie->dev;
+
+	ni_netdev_index_add_key(index, ie, NI_NETDEV_INDEX_IFINDEX,
+			ni_hashmap_hash_uint(dev->link.ifindex));
+
+	if (dev->name)
+		ni_netdev_index_add_key(index, ie, NI_NETDEV_INDEX_NAME,
+				ni_hashmap_hash_string(dev->name));
+
+	if (dev->link.hwaddr.len)
+		ni_netdev_index_add_key(index, ie, NI_NETDEV_INDEX_HWADDR,
+				ni_netdev_index_hash_hwaddr(&dev->link.hwaddr));
+
+	if (dev->link.type == NI_IFTYPE_VLAN && dev->vlan && dev->vlan->tag &&
+	    dev->link.lowerdev.name)
+		ni_netdev_index_add_key(index, ie, NI_NETDEV_INDEX_VLAN,
+				ni_netdev_index_hash_vlan(dev->link.lowerdev.name,
+							dev->vlan->tag));
+}
+
+static void
+ni_netdev_index_del_keys(ni_netdev_index_t *index, ni_netdev_index_entry_t *ie)
+{
+	unsigned int key;
+
+	for (key = 0; key < NI_NETDEV_INDEX_MAX; ++key) {
+		if (ie->keys & NI_BIT(key))
+			ni_hashmap_remove(&index->map[key], ie->hash[key], ie);
+	}
+	ie->keys = 0;
+}
+
+void
+ni_netconfig_device_index(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netdev_index_entry_t *ie;
+
+	if (!nc || !dev)
+		return;
+
+	if ((ie = dev->index_entry)) {
+		if (ie->index != &nc->index)
+			return;
+		ni_netdev_index_del_keys(&nc->index, ie);
+	} else {
+		ie = xcalloc(1, sizeof(*ie));
+		ie->index = &nc->index;
+		ie->dev = dev;
+		ie->order = ++nc->index.order;
+		dev->index_entry = ie;
+	}
+	ni_netdev_index_add_keys(&nc->index, ie);
+}
+
+void
+ni_netconfig_device_unindex(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	ni_netdev_index_entry_t *ie;
+
+	if (!nc || !dev || !(ie = dev->index_entry) || ie->index != &nc->index)
+		return;
+
+	ni_netdev_index_del_keys(&nc->index, ie);
+	dev->index_entry = NULL;
+	free(ie);
+}
+
+void
+ni_netdev_reindex(ni_netdev_t *dev)
+{
+	ni_netdev_index_entry_t *ie;
+
+	/* update keys of devices in a list, ignore other devices */
+	if (!dev || !(ie = dev->index_entry))
+		return;
+
+	ni_netdev_index_del_keys(ie->index, ie);
+	ni_netdev_index_add_keys(ie->index, ie);
+}
+
 /*
  * Manage the list of modem devices
  */
@@ -729,27 +912,103 @@ ni_netconfig_rule_array(ni_netconfig_t *nc)
 	return nc ? &nc->route.rules : NULL;
 }
 
+/*
+ * The rules are kept sorted by pref and indexed by ni_rule_hash, which
+ * does not include the pref, to find the rules equal to a rule with or
+ * without a pref (auto assigned by the kernel) without a linear scan.
+ * The index is maintained by the rule add, del and drop_by_seq
+ * functions, the rule array must not be modified directly.
+ */
+static inline ni_hashmap_t *
+ni_netconfig_rule_index(ni_netconfig_t *nc)
+{
+	return &nc->route.index;
+}
+
+static unsigned int
+ni_netconfig_rule_lower_bound(const ni_rule_array_t *rules, unsigned int pref)
+{
+	unsigned int lo = 0, hi = rules->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (rules->data[mid]->pref < pref)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static unsigned int
+ni_netconfig_rule_upper_bound(const ni_rule_array_t *rules, unsigned int pref)
+{
+	unsigned int lo = 0, hi = rules->count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (rules->data[mid]->pref <= pref)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static unsigned int
+ni_netconfig_rule_position(ni_rule_array_t *rules, const ni_rule_t *rule)
+{
+	unsigned int i;
+
+	for (i = ni_netconfig_rule_lower_bound(rules, rule->pref); i < rules->count; ++i) {
+		if (rules->data[i] == rule)
+			return i;
+		if (rules->data[i]->pref != rule->pref)
+			break;
+	}
+	return ni_rule_array_index(rules, rule);
+}
+
+static ni_rule_t *
+ni_netconfig_rule_lookup(ni_netconfig_t *nc, const ni_rule_t *rule)
+{
+	ni_rule_array_t *rules = &nc->route.rules;
+	ni_rule_t *r, *found = NULL;
+	ni_hashmap_entry_t *he;
+
+	/* return the first equal rule in the array as a linear scan */
+	ni_hashmap_foreach(ni_netconfig_rule_index(nc), ni_rule_hash(rule), he) {
+		r = he->item;
+		if (found && (found->pref < r->pref || (found->pref == r->pref &&
+		    ni_netconfig_rule_position(rules, found) < ni_netconfig_rule_position(rules, r))))
+			continue;
+		if (ni_rule_equal(r, rule))
+			found = r;
+	}
+	return found;
+}
+
 int
 ni_netconfig_rule_add(ni_netconfig_t *nc, ni_rule_t *rule)
 {
-	unsigned int i, last = 0;
 	ni_rule_array_t *rules;
-	const ni_rule_t *r;
+	ni_hashmap_t *index;
+	unsigned int last;
 
 	if (!(rules = ni_netconfig_rule_array(nc)) || !rule)
 		return -1;
 
-	for (i = 0; i < rules->count; ++i) {
-		r = rules->data[i];
-		if (r->pref > rule->pref)
-			break;
-		last = i + 1;
-	}
-
+	index = ni_netconfig_rule_index(nc);
+	last = ni_netconfig_rule_upper_bound(rules, rule->pref);
 	if (!ni_rule_array_insert(rules, last, ni_rule_ref(rule))) {
 		ni_error("%s: unable to insert routing policy rule", __func__);
 		return -1;
 	}
+	if (!ni_hashmap_insert(index, ni_rule_hash(rule), rule)) {
+		ni_error("%s: unable to index routing policy rule", __func__);
+		ni_rule_array_delete_at(rules, last);
+		return -1;
+	}
 
 	return 0;
 }
@@ -764,45 +1023,59 @@ ni_netconfig_rule_del(ni_netconfig_t *nc, const ni_rule_t *rule, ni_rule_t **pde
 	if (!(rules = ni_netconfig_rule_array(nc)) || !rule)
 		return -1;
 
-	for (i = 0; i < rules->count; ++i) {
-		r = rules->data[i];
-		if (!ni_rule_equal(r, rule))
-			continue;
+	if (!(r = ni_netconfig_rule_lookup(nc, rule)))
+		return 1;
 
-		if (pdel) {
-			*pdel = ni_rule_array_remove_at(rules, i);
-			if (!*pdel) {
-				ni_error("%s: unable to remove policy rule", __func__);
-				return -1;
-			}
-		} else {
-			if (!ni_rule_array_delete_at(rules, i)) {
-				ni_error("%s: unable to remove policy rule", __func__);
-				return -1;
-			}
+	i = ni_netconfig_rule_position(rules, r);
+	ni_hashmap_remove(ni_netconfig_rule_index(nc), ni_rule_hash(r), r);
+	if (pdel) {
+		*pdel = ni_rule_array_remove_at(rules, i);
+		if (!*pdel) {
+			ni_error("%s: unable to remove policy rule", __func__);
+			return -1;
+		}
+	} else {
+		if (!ni_rule_array_delete_at(rules, i)) {
+			ni_error("%s: unable to remove policy rule", __func__);
+			return -1;
 		}
-
-		return 0;
 	}
-	return 1;
+	return 0;
 }
 
 ni_rule_t *
 ni_netconfig_rule_find(ni_netconfig_t *nc, const ni_rule_t *rule)
+{
+	if (!nc || !rule)
+		return NULL;
+
+	return ni_netconfig_rule_lookup(nc, rule);
+}
+
+unsigned int
+ni_netconfig_rules_drop_by_seq(ni_netconfig_t *nc, unsigned int seq)
 {
 	ni_rule_array_t *rules;
-	unsigned int i;
+	unsigned int i, j;
 	ni_rule_t *r;
 
-	if (!(rules = ni_netconfig_rule_array(nc)) || !rule)
-		return NULL;
+	if (!(rules = ni_netconfig_rule_array(nc)))
+		return 0;
 
-	for (i = 0; i < rules->count; ++i) {
+	for (i = j = 0; i < rules->count; ++i) {
 		r = rules->data[i];
-		if (ni_rule_equal(r, rule))
-			return r;
+		if (r && r->seq != seq) {
+			ni_hashmap_remove(ni_netconfig_rule_index(nc), ni_rule_hash(r), r);
+			ni_rule_free(r);
+			continue;
+		}
+		rules->data[j++] = r;
 	}
-	return NULL;
+	for (i = j; i < rules->count; ++i)
+		rules->data[i] = NULL;
+	i = rules->count - j;
+	rules->count = j;
+	return i;
 }
 
 
@@ -812,14 +1085,23 @@ ni_netconfig_rule_find(ni_netconfig_t *nc, const ni_rule_t *rule)
 ni_netdev_t *
 ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 {
-	ni_netdev_t *dev;
+	ni_netdev_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->name && ni_string_eq(dev->name, name))
-			return dev;
+	if (!name)
+		return NULL;
+
+	/* names may be transiently duplicate on renames, return first */
+	ni_hashmap_foreach(&nc->index.map[NI_NETDEV_INDEX_NAME],
+				ni_hashmap_hash_string(name), he) {
+		ie = he->item;
+		if (!ni_string_eq(ie->dev->name, name))
+			continue;
+		if (!found || ie->order < found->order)
+			found = ie;
 	}
 
-	return NULL;
+	return found ? found->dev : NULL;
 }
 
 /*
@@ -828,14 +1110,19 @@ ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 ni_netdev_t *
 ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 {
-	ni_netdev_t *dev;
+	ni_netdev_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->link.ifindex == ifindex)
-			return dev;
+	ni_hashmap_foreach(&nc->index.map[NI_NETDEV_INDEX_IFINDEX],
+				ni_hashmap_hash_uint(ifindex), he) {
+		ie = he->item;
+		if (ie->dev->link.ifindex != ifindex)
+			continue;
+		if (!found || ie->order < found->order)
+			found = ie;
 	}
 
-	return NULL;
+	return found ? found->dev : NULL;
 }
 
 /*
@@ -844,17 +1131,22 @@ ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 ni_netdev_t *
 ni_netdev_by_hwaddr(ni_netconfig_t *nc, const ni_hwaddr_t *lla)
 {
-	ni_netdev_t *dev;
+	ni_netdev_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
 
 	if (!lla || !lla->len)
 		return NULL;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (ni_link_address_equal(&dev->link.hwaddr, lla))
-			return dev;
+	ni_hashmap_foreach(&nc->index.map[NI_NETDEV_INDEX_HWADDR],
+				ni_netdev_index_hash_hwaddr(lla), he) {
+		ie = he->item;
+		if (!ni_link_address_equal(&ie->dev->link.hwaddr, lla))
+			continue;
+		if (!found || ie->order < found->order)
+			found = ie;
 	}
 
-	return NULL;
+	return found ? found->dev : NULL;
 }
 
 /*
@@ -863,20 +1155,28 @@ ni_netdev_by_hwaddr(ni_netconfig_t *nc, const ni_hwaddr_t *lla)
 ni_netdev_t *
 ni_netdev_by_vlan_name_and_tag(ni_netconfig_t *nc, const char *parent_name, uint16_t tag)
 {
+	ni_netdev_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
 	ni_netdev_t *dev;
 
 	if (!parent_name || !tag)
 		return NULL;
-	for (dev = nc->interfaces; dev; dev = dev->next) {
+
+	ni_hashmap_foreach(&nc->index.map[NI_NETDEV_INDEX_VLAN],
+				ni_netdev_index_hash_vlan(parent_name, tag), he) {
+		ie = he->item;
+		dev = ie->dev;
 		if (dev->link.type == NI_IFTYPE_VLAN
 		 && dev->vlan
 		 && dev->vlan->tag == tag
 		 && dev->link.lowerdev.name
-		 && !strcmp(dev->link.lowerdev.name, parent_name))
-			return dev;
+		 && !strcmp(dev->link.lowerdev.name, parent_name)) {
+			if (!found || ie->order < found->order)
+				found = ie;
+		}
 	}
 
-	return NULL;
+	return found ? found->dev : NULL;
 }
 
 unsigned int
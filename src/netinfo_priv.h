@@ -50,6 +50,9 @@ extern void		__ni_netlink_close(ni_netlink_t *);
 
 extern void		ni_netconfig_device_append(ni_netconfig_t *, ni_netdev_t *);
 extern void		ni_netconfig_device_remove(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_index(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_unindex(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netdev_reindex(ni_netdev_t *);
 extern ni_netdev_t **	ni_netconfig_device_list_head(ni_netconfig_t *);
 extern void		ni_netconfig_modem_append(ni_netconfig_t *, ni_modem_t *);
 extern int		ni_netconfig_route_add(ni_netconfig_t *, ni_route_t *, ni_netdev_t *);
@@ -57,6 +60,7 @@ extern int		ni_netconfig_route_del(ni_netconfig_t *, ni_route_t *, ni_netdev_t *
 extern int		ni_netconfig_rule_add(ni_netconfig_t *, ni_rule_t *);
 extern int		ni_netconfig_rule_del(ni_netconfig_t *, const ni_rule_t *, ni_rule_t **);
 extern ni_rule_t *	ni_netconfig_rule_find(ni_netconfig_t *, const ni_rule_t *);
+extern unsigned int	ni_netconfig_rules_drop_by_seq(ni_netconfig_t *, unsigned int);
 extern ni_rule_array_t *ni_netconfig_rule_array(ni_netconfig_t *);
 
 extern ni_bool_t	ni_netconfig_set_discover_filter(ni_netconfig_t *, unsigned int);
@@ -74,6 +78,14 @@ extern ni_addrconf_lease_t *__ni_netdev_route_to_lease(ni_netdev_t *, const ni_r
 extern void		__ni_netdev_track_ipv6_autoconf(ni_netdev_t *, int);
 extern unsigned int	__ni_netdev_translate_ifflags(const char *, unsigned int, unsigned int);
 extern void		__ni_netdev_process_events(ni_netconfig_t *, ni_netdev_t *, unsigned int);
+
+typedef struct ni_rtevent_stats {
+	unsigned int		overruns;	/* lost events (ENOBUFS)	*/
+	unsigned int		resyncs;	/* state resyncs to recover	*/
+	unsigned int		renames;	/* device renames detected	*/
+} ni_rtevent_stats_t;
+
+extern void		ni_server_interface_event_stats(ni_rtevent_stats_t *);
 extern void		__ni_netdev_event(ni_netconfig_t *, ni_netdev_t *, ni_event_t);
 
 extern int		__ni_ipv4_devconf_process_flags(ni_netdev_t *, int32_t *, unsigned int);
@@ -147,6 +159,12 @@ typedef struct ni_capture_protinfo {
 
 	/* If ip_protocol is IPPROT_UDP or TCP */
 	uint16_t		ip_port;
+
+	/* Receive via one socket shared by all devices */
+	ni_bool_t		shared;
+
+	/* Receive via a TPACKET_V3 ring if available */
+	ni_bool_t		ring;
 } ni_capture_protinfo_t;
 
 extern void		ni_capture_devinfo_destroy(ni_capture_devinfo_t *);
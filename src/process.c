@@ -28,10 +28,14 @@
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <sys/socket.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <signal.h>
+#include <spawn.h>
 
 #include <wicked/logging.h>
 #include <wicked/socket.h>
@@ -492,6 +496,93 @@ ni_process_sigchild(int sig)
 	/* nop for now */
 }
 
+static void
+ni_process_sigchild_install(void)
+{
+	static ni_bool_t installed = FALSE;
+
+	if (!installed) {
+		signal(SIGCHLD, ni_process_sigchild);
+		installed = TRUE;
+	}
+}
+
+/*
+ * Close all descriptors >= minfd in the child process.
+ * Use close_range when the kernel supports it, else the open
+ * descriptors listed in /proc/self/fd and the whole descriptor
+ * table as last resort.
+ */
+static void
+ni_process_close_fds(int minfd)
+{
+	struct dirent *d;
+	DIR *dir;
+	int fd, maxfd;
+
+#ifdef SYS_close_range
+	if (syscall(SYS_close_range, minfd, ~0U, 0) == 0)
+		return;
+#endif
+
+	if ((dir = opendir("/proc/self/fd")) != NULL) {
+		while ((d = readdir(dir)) != NULL) {
+			if (!ni_parse_int(d->d_name, &fd, 10) && fd >= minfd && fd != dirfd(dir))
+				close(fd);
+		}
+		closedir(dir);
+		return;
+	}
+
+	maxfd = getdtablesize();
+	for (fd = minfd; fd < maxfd; ++fd)
+		close(fd);
+}
+
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP)
+/*
+ * Execute the command using posix_spawn, which avoids to copy the
+ * address space of the (possibly large) parent process.
+ */
+static pid_t
+ni_process_spawn(ni_process_t *pi, int *pfd)
+{
+	static char *const empty_environ[] = { NULL };
+	posix_spawn_file_actions_t actions;
+	pid_t pid = -1;
+	int err;
+
+	if ((err = posix_spawn_file_actions_init(&actions))) {
+		errno = err;
+		return -1;
+	}
+
+	err = posix_spawn_file_actions_addchdir_np(&actions, "/");
+	if (!err)
+		err = posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+	if (!err && pfd) {
+		if (!(err = posix_spawn_file_actions_adddup2(&actions, pfd[1], 1)))
+			err = posix_spawn_file_actions_adddup2(&actions, pfd[1], 2);
+	}
+	if (!err)
+		err = posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+
+	/* argv and environ arrays are always NULL terminated */
+	if (!err)
+		err = posix_spawn(&pid, pi->argv.data[0], &actions, NULL, pi->argv.data,
+				pi->environ.data ? pi->environ.data : empty_environ);
+
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return pid;
+}
+#endif
+
 /*
  * Run a subprocess.
  */
@@ -655,7 +746,21 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 		return NI_PROCESS_COMMAND;
 	}
 
-	signal(SIGCHLD, ni_process_sigchild);
+	ni_process_sigchild_install();
+
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP) && \
+    defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP)
+	if (!pi->exec) {
+		if ((pid = ni_process_spawn(pi, pfd)) < 0) {
+			ni_error("%s: unable to execute %s: %m", __func__, arg0);
+			return NI_PROCESS_FAILURE;
+		}
+		pi->pid = pid;
+		pi->status = -1;
+		ni_timer_get_time(&pi->started);
+		return NI_PROCESS_SUCCESS;
+	}
+#endif
 
 	if ((pid = fork()) < 0) {
 		ni_error("%s: unable to fork child process: %m", __func__);
@@ -666,7 +771,6 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 	ni_timer_get_time(&pi->started);
 
 	if (pid == 0) {
-		int maxfd;
 		int fd;
 
 		if (chdir("/") < 0)
@@ -683,9 +787,7 @@ __ni_process_run(ni_process_t *pi, int *pfd)
 				ni_warn("%s: cannot dup pipe out descriptor: %m", __func__);
 		}
 
-		maxfd = getdtablesize();
-		for (fd = 3; fd < maxfd; ++fd)
-			close(fd);
+		ni_process_close_fds(3);
 
 		/* NULL terminate argv and env lists */
 		ni_string_array_append(&pi->argv, NULL);
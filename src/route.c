@@ -33,6 +33,7 @@
 #include "refcount_priv.h"
 #include "array_priv.h"
 #include "util_priv.h"
+#include "hashmap_priv.h"
 #include "debug.h"
 
 #include <stdlib.h>
@@ -520,6 +521,20 @@ ni_route_bind_ifindex(ni_route_t *rp, ni_netconfig_t *nc, ni_netdev_t *dev, unsi
 		ni_route_nexthop_bind_ifindex(nh, nc, dev, ifflags);
 }
 
+static unsigned int
+ni_route_ipv6_priority(const ni_route_t *rp)
+{
+	if (rp->priority)
+		return rp->priority;
+
+	/* the priority (metric) the kernel assigns when unset */
+	if (!ni_route_type_needs_nexthop(rp->type))
+		return IP6_RT_PRIO_USER;
+	if (ni_route_via_gateway(rp))
+		return IP6_RT_PRIO_USER;
+	return IP6_RT_PRIO_ADDRCONF;
+}
+
 ni_bool_t
 ni_route_equal_destination(const ni_route_t *r1, const ni_route_t *r2)
 {
@@ -550,27 +565,7 @@ ni_route_equal_destination(const ni_route_t *r1, const ni_route_t *r2)
 		 * we don't support source routes yet and filter them out, so
 		 * all routes have a "from all" source for now.
 		 */
-		unsigned int p1 = r1->priority;
-		unsigned int p2 = r2->priority;
-		if (!p1) {
-			if (!ni_route_type_needs_nexthop(r1->type))
-				p1 = IP6_RT_PRIO_USER;
-			else
-			if (ni_route_via_gateway(r1))
-				p1 = IP6_RT_PRIO_USER;
-			else
-				p1 = IP6_RT_PRIO_ADDRCONF;
-		}
-		if (!p2) {
-			if (!ni_route_type_needs_nexthop(r2->type))
-				p2 = IP6_RT_PRIO_USER;
-			else
-			if (ni_route_via_gateway(r2))
-				p2 = IP6_RT_PRIO_USER;
-			else
-				p2 = IP6_RT_PRIO_ADDRCONF;
-		}
-		if (p1 != p2)
+		if (ni_route_ipv6_priority(r1) != ni_route_ipv6_priority(r2))
 			return FALSE;
 	}
 	return TRUE;
@@ -1574,6 +1569,171 @@ ni_route_array_sort_rev(ni_route_array_t *nra)
 }
 
 
+/*
+ * ni_route_table index functions
+ *
+ * Large tables get a hash index of their routes by the destination
+ * key [family, prefixlen, destination, tos, priority] compared by
+ * ni_route_equal_destination.  The index is built on first lookup
+ * and maintained by the table functions, so the routes array of a
+ * table must not be modified directly; the key of a route must not
+ * change while it is in an indexed table.
+ * Each index entry records the insertion order of its route, which
+ * is the order in the array, to return the first match as the array
+ * lookup does.
+ */
+#define NI_ROUTE_INDEX_MIN_ROUTES	32
+
+typedef struct ni_route_index_entry {
+	ni_route_t *		route;
+	unsigned int		order;
+} ni_route_index_entry_t;
+
+struct ni_route_index {
+	ni_hashmap_t		map;
+	unsigned int		order;
+};
+
+static unsigned int
+ni_route_index_hash(const ni_route_t *rp)
+{
+	unsigned int hash, prio;
+
+	hash = ni_hashmap_hash_data(0, &rp->family, sizeof(rp->family));
+	hash = ni_hashmap_hash_data(hash, &rp->prefixlen, sizeof(rp->prefixlen));
+	if (rp->prefixlen) {
+		switch (rp->destination.ss_family) {
+		case AF_INET:
+			hash = ni_hashmap_hash_data(hash, &rp->destination.sin.sin_addr,
+						sizeof(rp->destination.sin.sin_addr));
+			break;
+		case AF_INET6:
+			hash = ni_hashmap_hash_data(hash, &rp->destination.six.sin6_addr,
+						sizeof(rp->destination.six.sin6_addr));
+			break;
+		default:
+			break;
+		}
+	}
+
+	switch (rp->family) {
+	case AF_INET:
+		hash = ni_hashmap_hash_data(hash, &rp->tos, sizeof(rp->tos));
+		hash = ni_hashmap_hash_data(hash, &rp->priority, sizeof(rp->priority));
+		break;
+	case AF_INET6:
+		prio = ni_route_ipv6_priority(rp);
+		hash = ni_hashmap_hash_data(hash, &prio, sizeof(prio));
+		break;
+	default:
+		break;
+	}
+	return hash;
+}
+
+static inline ni_bool_t
+ni_route_index_usable(ni_bool_t (*match)(const ni_route_t *, const ni_route_t *))
+{
+	/* match functions implying an equal destination key */
+	return match == ni_route_equal ||
+		match == ni_route_equal_destination ||
+		match == ni_route_equal_ref;
+}
+
+static ni_route_index_entry_t *
+ni_route_index_find_entry(struct ni_route_index *index, const ni_route_t *rp)
+{
+	ni_route_index_entry_t *ie;
+	ni_hashmap_entry_t *he;
+
+	ni_hashmap_foreach(&index->map, ni_route_index_hash(rp), he) {
+		ie = he->item;
+		if (ie->route == rp)
+			return ie;
+	}
+	return NULL;
+}
+
+static ni_bool_t
+ni_route_index_insert(struct ni_route_index *index, ni_route_t *rp)
+{
+	ni_route_index_entry_t *ie;
+
+	ie = xcalloc(1, sizeof(*ie));
+	ie->route = rp;
+	ie->order = index->order++;
+	if (ni_hashmap_insert(&index->map, ni_route_index_hash(rp), ie))
+		return TRUE;
+
+	free(ie);
+	return FALSE;
+}
+
+static void
+ni_route_index_remove(struct ni_route_index *index, ni_route_index_entry_t *ie)
+{
+	if (ni_hashmap_remove(&index->map, ni_route_index_hash(ie->route), ie))
+		free(ie);
+}
+
+static void
+ni_route_table_index_drop(ni_route_table_t *tab)
+{
+	struct ni_route_index *index;
+	ni_hashmap_entry_t *he;
+	unsigned int i;
+
+	if (!(index = tab->index))
+		return;
+
+	for (i = 0; i < index->map.size; ++i) {
+		for (he = index->map.buckets[i]; he; he = he->next)
+			free(he->item);
+	}
+	ni_hashmap_destroy(&index->map);
+	free(index);
+	tab->index = NULL;
+}
+
+static struct ni_route_index *
+ni_route_table_index(ni_route_table_t *tab)
+{
+	ni_route_t *rp;
+	unsigned int i;
+
+	if (tab->index || tab->routes.count < NI_ROUTE_INDEX_MIN_ROUTES)
+		return tab->index;
+
+	tab->index = xcalloc(1, sizeof(*tab->index));
+	ni_hashmap_init(&tab->index->map);
+	for (i = 0; i < tab->routes.count; ++i) {
+		rp = tab->routes.data[i];
+		if (!rp || !ni_route_index_insert(tab->index, rp)) {
+			ni_route_table_index_drop(tab);
+			break;
+		}
+	}
+	return tab->index;
+}
+
+static ni_route_t *
+ni_route_index_find_match(struct ni_route_index *index, const ni_route_t *rp,
+		ni_bool_t (*match)(const ni_route_t *, const ni_route_t *))
+{
+	ni_route_index_entry_t *ie, *found = NULL;
+	ni_hashmap_entry_t *he;
+
+	/* return the first match in the array as the linear lookup */
+	ni_hashmap_foreach(&index->map, ni_route_index_hash(rp), he) {
+		ie = he->item;
+		if (found && found->order < ie->order)
+			continue;
+		if (match(ie->route, rp))
+			found = ie;
+	}
+	return found ? found->route : NULL;
+}
+
 /*
  * ni_route_table functions
  */
@@ -1609,10 +1769,47 @@ void
 ni_route_table_clear(ni_route_table_t *tab)
 {
 	if (tab) {
+		ni_route_table_index_drop(tab);
 		ni_route_array_destroy(&tab->routes);
 	}
 }
 
+/*
+ * Move the routes not having the given seq into the stale array,
+ * preserving the order of the remaining routes.
+ */
+unsigned int
+ni_route_table_remove_stale(ni_route_table_t *tab, unsigned int seq,
+		ni_route_array_t *stale)
+{
+	ni_route_index_entry_t *ie;
+	ni_route_array_t *routes;
+	struct ni_route_index *index;
+	unsigned int i, j, count;
+	ni_route_t *rp;
+
+	if (!tab || !stale)
+		return 0;
+
+	index = tab->index;
+	routes = &tab->routes;
+	count = stale->count;
+	for (i = j = 0; i < routes->count; ++i) {
+		rp = routes->data[i];
+		if (rp && rp->seq != seq && ni_route_array_append(stale, rp)) {
+			if (index && (ie = ni_route_index_find_entry(index, rp)))
+				ni_route_index_remove(index, ie);
+			continue;
+		}
+		routes->data[j++] = rp;
+	}
+	for (i = j; i < routes->count; ++i)
+		routes->data[i] = NULL;
+	routes->count = j;
+
+	return stale->count - count;
+}
+
 /*
  * ni_route_tables list functions
  */
@@ -1644,9 +1841,15 @@ ni_route_tables_add_route(ni_route_table_t **list, ni_route_t *rp)
 {
 	ni_route_table_t *tab;
 
-	if (rp && (tab = ni_route_tables_get(list, rp->table)))
-		return ni_route_array_append(&tab->routes, rp);
-	return FALSE;
+	if (!rp || !(tab = ni_route_tables_get(list, rp->table)))
+		return FALSE;
+
+	if (!ni_route_array_append(&tab->routes, rp))
+		return FALSE;
+
+	if (tab->index && !ni_route_index_insert(tab->index, rp))
+		ni_route_table_index_drop(tab);
+	return TRUE;
 }
 
 ni_bool_t
@@ -1668,11 +1871,16 @@ ni_route_tables_add_routes(ni_route_table_t **list, ni_route_array_t *routes)
 ni_bool_t
 ni_route_tables_del_route(ni_route_table_t *list, ni_route_t *rp)
 {
+	struct ni_route_index *index;
+	ni_route_index_entry_t *ie;
 	ni_route_table_t *tab;
 
 	if (!rp || !(tab = ni_route_tables_find(list, rp->table)))
 		return FALSE;
 
+	if ((index = tab->index) && (ie = ni_route_index_find_entry(index, rp)))
+		ni_route_index_remove(index, ie);
+
 	return ni_route_array_delete_ref(&tab->routes, rp);
 }
 
@@ -1680,10 +1888,15 @@ ni_route_t *
 ni_route_tables_find_match(ni_route_table_t *list, const ni_route_t *rp,
 		ni_bool_t (*match)(const ni_route_t *, const ni_route_t *))
 {
+	struct ni_route_index *index;
 	ni_route_table_t *tab;
 
-	if (!rp || !(tab = ni_route_tables_find(list, rp->table)))
+	if (!rp || !match || !(tab = ni_route_tables_find(list, rp->table)))
 		return NULL;
+
+	if (ni_route_index_usable(match) && (index = ni_route_table_index(tab)))
+		return ni_route_index_find_match(index, rp, match);
+
 	return ni_route_array_find_match(&tab->routes, rp, match);
 }
 
@@ -2019,6 +2232,57 @@ ni_rule_equal_action(const ni_rule_t *r1, const ni_rule_t *r2)
 #undef do_cmp
 }
 
+static unsigned int
+ni_rule_hash_prefix(unsigned int hash, const ni_rule_prefix_t *prefix)
+{
+	hash = ni_hashmap_hash_data(hash, &prefix->len, sizeof(prefix->len));
+	if (!prefix->len)
+		return hash;
+
+	switch (prefix->addr.ss_family) {
+	case AF_INET:
+		return ni_hashmap_hash_data(hash, &prefix->addr.sin.sin_addr,
+					sizeof(prefix->addr.sin.sin_addr));
+	case AF_INET6:
+		return ni_hashmap_hash_data(hash, &prefix->addr.six.sin6_addr,
+					sizeof(prefix->addr.six.sin6_addr));
+	default:
+		return hash;
+	}
+}
+
+/*
+ * Hash of the fields compared by ni_rule_equal except the pref,
+ * which matches any pref when not set in one of the rules.
+ */
+unsigned int
+ni_rule_hash(const ni_rule_t *rule)
+{
+	unsigned int hash, invert;
+
+	if (!rule)
+		return 0;
+
+	invert = rule->flags & NI_BIT(NI_RULE_INVERT);
+	hash = ni_hashmap_hash_data(0, &rule->family, sizeof(rule->family));
+	hash = ni_hashmap_hash_data(hash, &invert, sizeof(invert));
+	hash = ni_rule_hash_prefix(hash, &rule->src);
+	hash = ni_rule_hash_prefix(hash, &rule->dst);
+	hash = ni_hashmap_hash_data(hash, &rule->tos, sizeof(rule->tos));
+	hash = ni_hashmap_hash_data(hash, &rule->fwmark, sizeof(rule->fwmark));
+	hash = ni_hashmap_hash_data(hash, &rule->fwmask, sizeof(rule->fwmask));
+	hash = ni_hashmap_hash_data(hash, rule->iif.name, ni_string_len(rule->iif.name));
+	hash = ni_hashmap_hash_data(hash, rule->oif.name, ni_string_len(rule->oif.name));
+	hash = ni_hashmap_hash_data(hash, &rule->action, sizeof(rule->action));
+	hash = ni_hashmap_hash_data(hash, &rule->table, sizeof(rule->table));
+	hash = ni_hashmap_hash_data(hash, &rule->target, sizeof(rule->target));
+	hash = ni_hashmap_hash_data(hash, &rule->suppress_prefixlen,
+					sizeof(rule->suppress_prefixlen));
+	hash = ni_hashmap_hash_data(hash, &rule->suppress_ifgroup,
+					sizeof(rule->suppress_ifgroup));
+	return hash;
+}
+
 static const ni_intmap_t	ni_rule_action_names[] = {
 	{ "lookup",		NI_RULE_ACTION_TO_TBL		},
 	{ "goto",		NI_RULE_ACTION_GOTO		},
@@ -12,6 +12,9 @@
 #include <sys/time.h>
 #include <sys/poll.h>
 #include <sys/un.h>
+#ifdef NI_SOCKET_EPOLL
+#include <sys/epoll.h>
+#endif
 #include <signal.h>
 #include <string.h>
 #include <stdlib.h>
@@ -30,10 +33,12 @@
 #include "appconfig.h"
 
 #define	NI_SOCKET_ARRAY_CHUNK	16
+#define	NI_SOCKET_EPOLL_EVENTS	64
 
 static void			__ni_socket_close(ni_socket_t *);
 static void			__ni_default_error_handler(ni_socket_t *);
 static void			__ni_default_hangup_handler(ni_socket_t *);
+static void			__ni_socket_timeout_arm(ni_socket_t *, const struct timeval *);
 
 static ni_socket_array_t	__ni_sockets = NI_SOCKET_ARRAY_INIT;
 
@@ -102,23 +107,151 @@ __ni_default_hangup_handler(ni_socket_t *sock)
 
 
 /*
- * Wait for incoming data on any of the sockets.
+ * Process the events poll or epoll reported for a socket.
+ * Note, that EPOLL* and POLL* event bits are identical.
  */
-int
-ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
+static void
+__ni_socket_handle_events(ni_socket_t *sock, int revents)
+{
+	if (revents & POLLERR) {
+		/* Deactivate socket */
+		ni_socket_deactivate(sock);
+		sock->handle_error(sock);
+		return;
+	}
+
+	if (revents & POLLIN) {
+		if (sock->receive == NULL) {
+			ni_error("socket %d has no receive callback", sock->__fd);
+			ni_socket_deactivate(sock);
+		} else {
+			sock->receive(sock);
+		}
+		if (sock->__fd < 0)
+			return;
+	}
+
+	if (revents & POLLHUP) {
+		if (sock->handle_hangup)
+			sock->handle_hangup(sock);
+	} else
+
+	if (revents & POLLOUT) {
+		if (sock->transmit == NULL) {
+			ni_error("socket %d has no transmit callback", sock->__fd);
+			ni_socket_deactivate(sock);
+		} else {
+			sock->transmit(sock);
+		}
+	}
+}
+
+/*
+ * A socket providing get_timeout has a timer armed at its deadline
+ * in the timer heap, which calls the check_timeout callback when it
+ * fires; the main loop runs the timers via ni_timer_next_timeout.
+ * The heap is not revalidated, so every get_timeout provider has to
+ * call ni_socket_update_timeout when it changes the deadline:
+ *
+ *  - capture.c (dedicated and shared capture sockets) updates in
+ *    ni_capture_arm_retransmit, ni_capture_disarm_retransmit and
+ *    ni_capture_force_retransmit,
+ *  - dhcp6/device.c (multicast socket) updates in the retransmit
+ *    arm, advance and disarm functions.
+ *
+ * A stale, earlier deadline only causes a check_timeout call that
+ * finds nothing to do. A deadline check_timeout did not advance is
+ * not retried until the owner updates it again.
+ */
+static void
+__ni_socket_timeout_expired(void *user_data, const ni_timer_t *timer)
+{
+	ni_socket_t *sock = user_data;
+	struct timeval now;
+
+	if (!sock || sock->timer != timer)
+		return;
+
+	sock->timer = NULL;
+	ni_socket_hold(sock);
+	ni_timer_get_time(&now);
+	if (sock->active && sock->check_timeout)
+		sock->check_timeout(sock, &now);
+	__ni_socket_timeout_arm(sock, &now);
+	ni_socket_release(sock);
+}
+
+static void
+__ni_socket_timeout_disarm(ni_socket_t *sock)
+{
+	if (sock->timer) {
+		ni_timer_cancel(sock->timer);
+		sock->timer = NULL;
+	}
+}
+
+static void
+__ni_socket_timeout_arm(ni_socket_t *sock, const struct timeval *checked)
+{
+	struct timeval expires, left;
+	ni_timeout_t timeout;
+
+	timerclear(&expires);
+	if (!sock->active || !sock->get_timeout ||
+	    sock->get_timeout(sock, &expires) != 0 || !timerisset(&expires)) {
+		__ni_socket_timeout_disarm(sock);
+		return;
+	}
+
+	/* check_timeout has seen it expired, but did not advance it */
+	if (checked && timercmp(&expires, checked, <)) {
+		__ni_socket_timeout_disarm(sock);
+		return;
+	}
+
+	/* round up, a timer firing before the deadline is a no-op */
+	timeout = ni_timeout_left(&expires, NULL, &left);
+	if (timeout != NI_TIMEOUT_INFINITE && left.tv_usec % 1000)
+		timeout++;
+
+	if (sock->timer)
+		sock->timer = ni_timer_rearm(sock->timer, timeout);
+	if (!sock->timer)
+		sock->timer = ni_timer_register(timeout,
+				__ni_socket_timeout_expired, sock);
+}
+
+void
+ni_socket_update_timeout(ni_socket_t *sock)
+{
+	if (sock)
+		__ni_socket_timeout_arm(sock, NULL);
+}
+
+/*
+ * The socket timeouts are in the timer heap, the main loop passes
+ * the ni_timer_next_timeout to wait for as usual.
+ */
+static int
+__ni_socket_poll_timeout(ni_timeout_t timeout)
+{
+	if (timeout >= NI_TIMEOUT_INFINITE)
+		return -1;
+	return timeout < INT_MAX ? (int)timeout : INT_MAX;
+}
+
+static int
+__ni_socket_array_poll_wait(ni_socket_array_t *array, ni_timeout_t timeout)
 {
 	struct pollfd pfd[array->count];
 	ni_socket_t *sock_array[array->count];
-	struct timeval now, expires;
 	unsigned int i, socket_count = 0;
-	int ptimeout = -1;
+	int ptimeout;
 	int retval = 0;
 
-	/* First step - build pollfd and working socket array and get timeouts */
-	timerclear(&expires);
+	/* First step - build pollfd and working socket array */
 	for (i = 0; i < array->count; ++i) {
 		ni_socket_t *sock = array->data[i];
-		struct timeval socket_expires;
 
 		if (sock->active != array)
 			continue;
@@ -127,29 +260,9 @@ ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
 		pfd[socket_count].events = sock->poll_flags;
 		sock_array[socket_count] = ni_socket_hold(sock);
 		socket_count++;
-
-		timerclear(&socket_expires);
-		if (sock->get_timeout && sock->get_timeout(sock, &socket_expires) == 0) {
-			if (!timerisset(&expires) || timercmp(&socket_expires, &expires, <))
-				expires = socket_expires;
-		}
-	}
-
-	ni_timer_get_time(&now);
-	if (timeout < NI_TIMEOUT_INFINITE)
-		ptimeout = timeout < INT_MAX ? (int)timeout : INT_MAX;
-	if (timerisset(&expires)) {
-		ni_timeout_t delta = ni_timeout_left(&expires, &now, NULL);
-
-		if (ptimeout < 0) {
-			if (delta < (ni_timeout_t)INT_MAX)
-				ptimeout = (int)delta;
-		} else {
-			if (delta < (ni_timeout_t)ptimeout)
-				ptimeout = (int)delta;
-		}
 	}
 
+	ptimeout = __ni_socket_poll_timeout(timeout);
 	if (socket_count == 0 && ptimeout < 0) {
 		ni_debug_socket("no sockets left to watch");
 		retval = 1;
@@ -173,57 +286,161 @@ ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
 		if (pfd[i].fd != sock->__fd)
 			continue;
 
-		if (pfd[i].revents & POLLERR) {
-			/* Deactivate socket */
-			ni_socket_deactivate(sock);
-			sock->handle_error(sock);
-			continue;
-		}
+		__ni_socket_handle_events(sock, pfd[i].revents);
+	}
 
-		if (pfd[i].revents & POLLIN) {
-			if (sock->receive == NULL) {
-				ni_error("socket %d has no receive callback", sock->__fd);
-				ni_socket_deactivate(sock);
-			} else {
-				sock->receive(sock);
-			}
-			if (sock->__fd < 0)
-				continue;
-		}
+out:
+	for (i = 0; i < socket_count; ++i)
+		ni_socket_release(sock_array[i]);
 
-		if (pfd[i].revents & POLLHUP) {
-			if (sock->handle_hangup)
-				sock->handle_hangup(sock);
-			if (sock->__fd < 0)
-				continue;
-		} else
-
-		if (pfd[i].revents & POLLOUT) {
-			if (sock->transmit == NULL) {
-				ni_error("socket %d has no transmit callback", sock->__fd);
-				ni_socket_deactivate(sock);
-			} else {
-				sock->transmit(sock);
-			}
-		}
+	return retval;
+}
+
+#ifdef NI_SOCKET_EPOLL
+/*
+ * The epoll backend registers each socket once on activation and
+ * modifies the registration when the poll_flags are changed via
+ * ni_socket_set_poll_flags. A wakeup then only costs the number
+ * of ready sockets.
+ */
+static void
+__ni_socket_array_epoll_open(ni_socket_array_t *array)
+{
+	if (array->epfd >= 0 || array->count)
+		return;
+
+	if ((array->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		ni_debug_socket("epoll_create1 failed, using poll instead: %m");
+}
+
+static void
+__ni_socket_array_epoll_close(ni_socket_array_t *array)
+{
+	if (array->epfd >= 0) {
+		close(array->epfd);
+		array->epfd = -1;
 	}
+}
 
-	ni_timer_get_time(&now);
-	for (i = 0; i < socket_count; ++i) {
-		ni_socket_t *sock = sock_array[i];
+static ni_bool_t
+__ni_socket_array_epoll_ctl(ni_socket_array_t *array, ni_socket_t *sock, int op)
+{
+	struct epoll_event ev;
 
-		if (sock->active != array)
+	memset(&ev, 0, sizeof(ev));
+	ev.events = sock->poll_flags;
+	ev.data.ptr = sock;
+	return epoll_ctl(array->epfd, op, sock->__fd, &ev) == 0;
+}
+
+static void
+__ni_socket_array_epoll_add(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	if (array->epfd < 0)
+		return;
+
+	if (!__ni_socket_array_epoll_ctl(array, sock, EPOLL_CTL_ADD)) {
+		ni_debug_socket("cannot add socket %d to epoll, using poll instead: %m",
+				sock->__fd);
+		__ni_socket_array_epoll_close(array);
+	}
+}
+
+static void
+__ni_socket_array_epoll_mod(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	if (array->epfd < 0 || sock->__fd < 0)
+		return;
+
+	if (!__ni_socket_array_epoll_ctl(array, sock, EPOLL_CTL_MOD)) {
+		ni_debug_socket("cannot modify socket %d in epoll, using poll instead: %m",
+				sock->__fd);
+		__ni_socket_array_epoll_close(array);
+	}
+}
+
+static void
+__ni_socket_array_epoll_del(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	struct epoll_event ev;
+
+	if (array->epfd < 0 || sock->__fd < 0)
+		return;
+
+	/* the socket may be already gone from the epoll set, fine */
+	memset(&ev, 0, sizeof(ev));
+	epoll_ctl(array->epfd, EPOLL_CTL_DEL, sock->__fd, &ev);
+}
+
+static int
+__ni_socket_array_epoll_wait(ni_socket_array_t *array, ni_timeout_t timeout)
+{
+	struct epoll_event events[NI_SOCKET_EPOLL_EVENTS];
+	ni_socket_t *ready[NI_SOCKET_EPOLL_EVENTS];
+	int ptimeout, ready_count;
+	unsigned int i;
+
+	ptimeout = __ni_socket_poll_timeout(timeout);
+	if (array->count == 0 && ptimeout < 0) {
+		ni_debug_socket("no sockets left to watch");
+		return 1;
+	}
+
+	ready_count = epoll_wait(array->epfd, events, NI_SOCKET_EPOLL_EVENTS, ptimeout);
+	if (ready_count < 0) {
+		if (errno == EINTR)
+			return 0;
+		ni_error("epoll_wait returns error: %m");
+		return -1;
+	}
+
+	/* Hold all ready sockets, callbacks may close any of them */
+	for (i = 0; i < (unsigned int)ready_count; ++i)
+		ready[i] = ni_socket_hold(events[i].data.ptr);
+
+	for (i = 0; i < (unsigned int)ready_count; ++i) {
+		ni_socket_t *sock = ready[i];
+
+		if (sock->active != array || sock->__fd < 0)
 			continue;
 
-		if (sock->check_timeout)
-			sock->check_timeout(sock, &now);
+		__ni_socket_handle_events(sock, events[i].events);
 	}
 
-out:
-	for (i = 0; i < socket_count; ++i)
-		ni_socket_release(sock_array[i]);
+	for (i = 0; i < (unsigned int)ready_count; ++i)
+		ni_socket_release(ready[i]);
 
-	return retval;
+	return 0;
+}
+#endif
+
+/*
+ * Apply changed poll flags of a socket at once
+ */
+void
+ni_socket_set_poll_flags(ni_socket_t *sock, int poll_flags)
+{
+	if (!sock || sock->poll_flags == poll_flags)
+		return;
+
+	sock->poll_flags = poll_flags;
+#ifdef NI_SOCKET_EPOLL
+	if (sock->active)
+		__ni_socket_array_epoll_mod(sock->active, sock);
+#endif
+}
+
+/*
+ * Wait for incoming data on any of the sockets.
+ */
+int
+ni_socket_array_wait(ni_socket_array_t *array, ni_timeout_t timeout)
+{
+#ifdef NI_SOCKET_EPOLL
+	if (array->epfd >= 0)
+		return __ni_socket_array_epoll_wait(array, timeout);
+#endif
+	return __ni_socket_array_poll_wait(array, timeout);
 }
 
 int
@@ -271,6 +488,10 @@ ni_socket_wrap(int fd, int sotype)
 static void
 __ni_socket_close(ni_socket_t *sock)
 {
+	/* deactivate first to unregister the fd from epoll */
+	if (sock->active)
+		ni_socket_deactivate(sock);
+
 	if (sock->__fd >= 0) {
 		if (sock->close)
 			sock->close(sock);
@@ -281,9 +502,6 @@ __ni_socket_close(ni_socket_t *sock)
 
 	ni_buffer_destroy(&sock->wbuf);
 	ni_buffer_destroy(&sock->rbuf);
-
-	if (sock->active)
-		ni_socket_deactivate(sock);
 }
 
 void
@@ -300,6 +518,7 @@ void
 ni_socket_array_init(ni_socket_array_t *array)
 {
 	memset(array, 0, sizeof(*array));
+	array->epfd = -1;
 }
 
 void
@@ -312,13 +531,18 @@ ni_socket_array_destroy(ni_socket_array_t *array)
 			sock = array->data[array->count];
 			array->data[array->count] = NULL;
 			if (sock) {
-				if (sock->active == array)
+				if (sock->active == array) {
+					__ni_socket_timeout_disarm(sock);
 					sock->active = NULL;
+				}
 				ni_socket_release(sock);
 			}
 		}
 		free(array->data);
-		memset(array, 0, sizeof(*array));
+#ifdef NI_SOCKET_EPOLL
+		__ni_socket_array_epoll_close(array);
+#endif
+		ni_socket_array_init(array);
 	}
 }
 
@@ -361,6 +585,10 @@ ni_socket_array_remove_at(ni_socket_array_t *array, unsigned int index)
 		return NULL;
 
 	sock = array->data[index];
+#ifdef NI_SOCKET_EPOLL
+	if (sock && sock->active == array)
+		__ni_socket_array_epoll_del(array, sock);
+#endif
 	array->count--;
 	if (index < array->count) {
 		memmove(&array->data[index], &array->data[index + 1],
@@ -368,8 +596,10 @@ ni_socket_array_remove_at(ni_socket_array_t *array, unsigned int index)
 	}
 	array->data[array->count] = NULL;
 
-	if (sock && sock->active == array)
+	if (sock && sock->active == array) {
+		__ni_socket_timeout_disarm(sock);
 		sock->active = NULL;
+	}
 	return sock;
 }
 
@@ -411,12 +641,19 @@ ni_socket_array_activate(ni_socket_array_t *array, ni_socket_t *sock)
 	if (sock->active)
 		return sock->active == array;
 
+#ifdef NI_SOCKET_EPOLL
+	__ni_socket_array_epoll_open(array);
+#endif
 	if (!ni_socket_array_append(array, sock))
 		return FALSE;
 
 	ni_socket_hold(sock);
 	sock->active = array;
 	sock->poll_flags = POLLIN;
+#ifdef NI_SOCKET_EPOLL
+	__ni_socket_array_epoll_add(array, sock);
+#endif
+	__ni_socket_timeout_arm(sock, NULL);
 	return TRUE;
 }
 
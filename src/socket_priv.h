@@ -10,6 +10,7 @@
 #include <stdio.h>
 
 #include <wicked/types.h>
+#include <wicked/time.h>
 #include <wicked/socket.h>
 #include "buffer.h"
 
@@ -21,6 +22,8 @@ struct ni_socket {
 	unsigned int	error  : 1;
 	int		poll_flags;
 
+	const ni_timer_t *timer;	/* get_timeout deadline in the timer heap */
+
 	ni_buffer_t	rbuf;
 	ni_buffer_t	wbuf;
 
@@ -43,9 +46,10 @@ struct ni_socket {
 struct ni_socket_array {
 	unsigned int	count;
 	ni_socket_t **	data;
+	int		epfd;		/* epoll instance or -1 to use poll */
 };
 
-#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL }
+#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL, .epfd = -1 }
 
 extern void		ni_socket_array_init(ni_socket_array_t *);
 extern void		ni_socket_array_destroy(ni_socket_array_t *);
@@ -59,5 +63,7 @@ extern unsigned int	ni_socket_array_find(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_activate(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_deactivate(ni_socket_array_t *, ni_socket_t *);
 
+extern void		ni_socket_set_poll_flags(ni_socket_t *, int);
+
 #endif /* __WICKED_SOCKET_PRIV_H__ */
 
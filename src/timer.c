@@ -10,51 +10,182 @@
 #include <time.h>
 #include <sys/time.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <wicked/time.h>
 
 #include "netinfo_priv.h"
 #include "util_priv.h"
 
+#define NI_TIMER_SLAB_CHUNK	64
+#define NI_TIMER_HEAP_CHUNK	64
+#define NI_TIMER_DISARMED	-1U
+
 struct ni_timer {
-	ni_timer_t *		next;
+	ni_timer_t *		next;		/* slab free list */
+	unsigned int		index;		/* position in the heap */
 	unsigned int		ident;
+	unsigned long long	seq;		/* arm order on equal expires */
 	struct timeval		expires;
 	ni_timeout_callback_t	*callback;
 	void *			user_data;
 };
 
-static ni_timer_t *		ni_timer_list;
+/*
+ * Armed timers are kept in a binary min-heap ordered by expiry time,
+ * timers with equal expiry time fire in the order they were armed.
+ * Each timer knows its heap position, so the (possibly stale) handle
+ * passed to cancel/rearm is verified and removed in O(log n).
+ *
+ * Timers are carved from slab chunks, which are never released to
+ * keep handles of freed timers safe to inspect.
+ */
+typedef struct ni_timer_heap {
+	unsigned int		count;
+	unsigned int		size;
+	ni_timer_t **		data;
+	unsigned long long	seq;
+} ni_timer_heap_t;
+
+static ni_timer_heap_t		ni_timer_heap;
+static ni_timer_t *		ni_timer_slab;
 
 static ni_bool_t		ni_timer_arm(ni_timer_t *, ni_timeout_t);
 static ni_timer_t *		ni_timer_disarm(const ni_timer_t *);
 
+static ni_timer_t *
+ni_timer_slab_alloc(void)
+{
+	ni_timer_t *timer, *chunk;
+	unsigned int i;
+
+	if (!ni_timer_slab) {
+		if (!(chunk = calloc(NI_TIMER_SLAB_CHUNK, sizeof(*chunk))))
+			return NULL;
+
+		for (i = NI_TIMER_SLAB_CHUNK; i-- > 0; ) {
+			chunk[i].next = ni_timer_slab;
+			ni_timer_slab = &chunk[i];
+		}
+	}
+
+	timer = ni_timer_slab;
+	ni_timer_slab = timer->next;
+
+	memset(timer, 0, sizeof(*timer));
+	timer->index = NI_TIMER_DISARMED;
+	return timer;
+}
+
+static void
+ni_timer_slab_free(ni_timer_t *timer)
+{
+	memset(timer, 0, sizeof(*timer));
+	timer->index = NI_TIMER_DISARMED;
+	timer->next = ni_timer_slab;
+	ni_timer_slab = timer;
+}
+
+static inline ni_bool_t
+ni_timer_heap_less(const ni_timer_t *a, const ni_timer_t *b)
+{
+	if (timercmp(&a->expires, &b->expires, !=))
+		return timercmp(&a->expires, &b->expires, <);
+	return a->seq < b->seq;
+}
+
 static inline void
-ni_timer_list_insert(ni_timer_t **list, ni_timer_t *timer)
+ni_timer_heap_set(ni_timer_heap_t *heap, unsigned int index, ni_timer_t *timer)
 {
-	ni_timer_t *tail, **pos;
+	heap->data[index] = timer;
+	timer->index = index;
+}
+
+static void
+ni_timer_heap_sift_up(ni_timer_heap_t *heap, unsigned int index)
+{
+	ni_timer_t *timer = heap->data[index];
+	unsigned int parent;
 
-	for (pos = list; (tail = *pos) != NULL; pos = &tail->next) {
-		if (timercmp(&timer->expires, &tail->expires, <))
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (!ni_timer_heap_less(timer, heap->data[parent]))
 			break;
+		ni_timer_heap_set(heap, index, heap->data[parent]);
+		index = parent;
 	}
-	timer->next = tail;
-	*pos = timer;
+	ni_timer_heap_set(heap, index, timer);
 }
 
-static inline ni_timer_t *
-ni_timer_list_remove(ni_timer_t **list, const ni_timer_t *timer)
+static void
+ni_timer_heap_sift_down(ni_timer_heap_t *heap, unsigned int index)
 {
-	ni_timer_t **pos, *cur;
+	ni_timer_t *timer = heap->data[index];
+	unsigned int child;
+
+	while ((child = 2 * index + 1) < heap->count) {
+		if (child + 1 < heap->count &&
+		    ni_timer_heap_less(heap->data[child + 1], heap->data[child]))
+			child++;
+		if (!ni_timer_heap_less(heap->data[child], timer))
+			break;
+		ni_timer_heap_set(heap, index, heap->data[child]);
+		index = child;
+	}
+	ni_timer_heap_set(heap, index, timer);
+}
 
-	for (pos = list; (cur = *pos) != NULL; pos = &cur->next) {
-		if (cur == timer) {
-			*pos = cur->next;
-			cur->next = NULL;
-			return cur;
-		}
+static ni_bool_t
+ni_timer_heap_insert(ni_timer_heap_t *heap, ni_timer_t *timer)
+{
+	ni_timer_t **data;
+	unsigned int size;
+
+	if (heap->count == heap->size) {
+		size = heap->size + NI_TIMER_HEAP_CHUNK;
+		if (!(data = realloc(heap->data, size * sizeof(*data))))
+			return FALSE;
+		heap->data = data;
+		heap->size = size;
 	}
-	return NULL;
+
+	timer->seq = ++heap->seq;
+	heap->data[heap->count] = timer;
+	ni_timer_heap_sift_up(heap, heap->count++);
+	return TRUE;
+}
+
+static ni_timer_t *
+ni_timer_heap_remove(ni_timer_heap_t *heap, const ni_timer_t *handle)
+{
+	ni_timer_t *timer, *last;
+	unsigned int index;
+
+	if (!handle || (index = handle->index) >= heap->count)
+		return NULL;
+
+	if ((timer = heap->data[index]) != handle)
+		return NULL;
+
+	last = heap->data[--heap->count];
+	heap->data[heap->count] = NULL;
+	if (last != timer) {
+		ni_timer_heap_set(heap, index, last);
+		if (index > 0 && ni_timer_heap_less(last, heap->data[(index - 1) / 2]))
+			ni_timer_heap_sift_up(heap, index);
+		else
+			ni_timer_heap_sift_down(heap, index);
+	}
+
+	timer->index = NI_TIMER_DISARMED;
+	return timer;
+}
+
+static inline ni_timer_t *
+ni_timer_heap_top(const ni_timer_heap_t *heap)
+{
+	return heap->count ? heap->data[0] : NULL;
 }
 
 const ni_timer_t *
@@ -63,7 +194,7 @@ ni_timer_register(ni_timeout_t timeout, ni_timeout_callback_t *callback, void *d
 	static unsigned int id_counter;
 	ni_timer_t *timer;
 
-	if (!(timer = calloc(1, sizeof(*timer))))
+	if (!(timer = ni_timer_slab_alloc()))
 		return NULL;
 
 	timer->callback = callback;
@@ -78,7 +209,7 @@ ni_timer_register(ni_timeout_t timeout, ni_timeout_callback_t *callback, void *d
 		return timer;
 	}
 
-	free(timer);
+	ni_timer_slab_free(timer);
 	return NULL;
 }
 
@@ -93,7 +224,7 @@ ni_timer_cancel(const ni_timer_t *handle)
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p id %x canceled",
 				__func__, timer, timer->ident);
-		free(timer);
+		ni_timer_slab_free(timer);
 	} else {
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p NOT found",
@@ -107,9 +238,12 @@ ni_timer_rearm(const ni_timer_t *handle, ni_timeout_t timeout)
 {
 	ni_timer_t *timer;
 
-	if ((timer = ni_timer_disarm(handle)) != NULL)
-		ni_timer_arm(timer, timeout);
-	else
+	if ((timer = ni_timer_disarm(handle)) != NULL) {
+		if (!ni_timer_arm(timer, timeout)) {
+			ni_timer_slab_free(timer);
+			timer = NULL;
+		}
+	} else
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p NOT found",
 				__func__, handle);
@@ -129,7 +263,7 @@ ni_timer_next_timeout(void)
 	if (ni_timer_get_time(&now))
 		return NI_TIMEOUT_INFINITE;
 
-	while ((timer = ni_timer_list) != NULL) {
+	while ((timer = ni_timer_heap_top(&ni_timer_heap)) != NULL) {
 		if (timer->expires.tv_sec == LONG_MAX) {
 			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 					"%s: timer %p id %x next timeout is infinite",
@@ -152,9 +286,9 @@ ni_timer_next_timeout(void)
 				now.tv_sec, now.tv_usec,
 				timer->expires.tv_sec, timer->expires.tv_usec);
 
-		ni_timer_list = timer->next;
+		ni_timer_heap_remove(&ni_timer_heap, timer);
 		timer->callback(timer->user_data, timer);
-		free(timer);
+		ni_timer_slab_free(timer);
 	}
 
 	return NI_TIMEOUT_INFINITE;
@@ -167,7 +301,8 @@ ni_timer_arm(ni_timer_t *timer, ni_timeout_t timeout)
 		return FALSE;
 
 	ni_timeval_add_timeout(&timer->expires, timeout);
-	ni_timer_list_insert(&ni_timer_list, timer);
+	if (!ni_timer_heap_insert(&ni_timer_heap, timer))
+		return FALSE;
 
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 			"%s: timer %p id %x armed with timeout %u.%03u (expires=%ld.%06ld)",
@@ -182,7 +317,7 @@ ni_timer_disarm(const ni_timer_t *handle)
 {
 	ni_timer_t *timer;
 
-	if (handle && (timer = ni_timer_list_remove(&ni_timer_list, handle))) {
+	if ((timer = ni_timer_heap_remove(&ni_timer_heap, handle))) {
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p id %x disarmed",
 				__func__, timer, timer->ident);
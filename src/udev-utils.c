@@ -315,7 +315,7 @@ ni_udev_netdev_is_ready(ni_netdev_t *dev)
 		 * start to receive, that is the device ifname may
 		 * be obsolete in the meantime due to udev renames.
 		 */
-		if (!ni_netdev_index_to_name(&dev->name, dev->link.ifindex))
+		if (!ni_netdev_refresh_name(dev))
 			return FALSE;
 
 		snprintf(pathbuf, sizeof(pathbuf), "%s/%s",
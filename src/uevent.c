@@ -666,7 +666,7 @@ __ni_uevent_ifevent_forwarder(const ni_var_array_t *vars, void *user_data)
 		if (!uinfo.tags || !strstr(uinfo.tags, ":systemd:"))
 			return;
 
-		if (!ni_netdev_index_to_name(&dev->name, dev->link.ifindex))
+		if (!ni_netdev_refresh_name(dev))
 			return; /* device gone in the meantime */
 
 		dev->link.ifflags |= NI_IFF_DEVICE_READY;
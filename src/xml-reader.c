@@ -27,10 +27,12 @@
 
 #include <ctype.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 
 #include <wicked/xml.h>
 #include <wicked/logging.h>
 #include "buffer.h"
+#include "xml_priv.h"
 
 #undef XMLDEBUG_PARSER
 
@@ -52,22 +54,25 @@ typedef enum {
 	Comment,
 } xml_token_type_t;
 
-#define XML_READER_BUFSZ	512
+#define XML_READER_BUFSZ	65536
 typedef struct xml_reader {
 	const char *		filename;
 
 	ni_buffer_t *		in_buffer;
 
 	FILE *			file;
-	unsigned char *		buffer;		/* FIXME: use in_buffer for this as well */
+	unsigned char *		buffer;		/* the whole file content */
 
 	unsigned int		no_close : 1;
 
 	char *			doctype;
 
-	/* This pointer must be unsigned char, else 0xFF would
-	 * be expanded to EOF */
-	unsigned char *		pos;
+	/* The input is tokenized from memory: the file buffer or the
+	 * in_buffer data. These pointers must be unsigned char, else
+	 * 0xFF would be expanded to EOF */
+	const unsigned char *	data;
+	const unsigned char *	pos;
+	const unsigned char *	end;
 
 	xml_parser_state_t	state;
 	unsigned int		lineCount;
@@ -101,8 +106,9 @@ static int		xml_reader_init_file(xml_reader_t *xr, FILE *fp, const char *locatio
 static int		xml_reader_init_buffer(xml_reader_t *xr, ni_buffer_t *buf, const char *location);
 static int		xml_reader_open(xml_reader_t *xr, const char *filename);
 static int		xml_reader_destroy(xml_reader_t *xr);
-static int		xml_getc(xml_reader_t *xr);
+static inline int	xml_getc(xml_reader_t *xr);
 static void		xml_ungetc(xml_reader_t *xr, int cc);
+static void		xml_get_run(xml_reader_t *, ni_stringbuf_t *, const char *);
 
 /*
  * Document reader implementation
@@ -181,7 +187,7 @@ xml_process_document(xml_reader_t *xr)
 	xml_document_t *doc;
 	xml_node_t *root;
 
-	doc = xml_document_new();
+	doc = xml_document_new_arena();
 
 	root = xml_document_root(doc);
 	if (xr->shared_location)
@@ -199,26 +205,14 @@ xml_process_document(xml_reader_t *xr)
 xml_node_t *
 xml_node_scan(FILE *fp, const char *location)
 {
-	xml_reader_t reader;
-	xml_node_t *root = xml_node_new(NULL, NULL);
+	xml_document_t *doc;
+	xml_node_t *root;
 
-	if (xml_reader_init_file(&reader, fp, location) < 0)
+	if (!(doc = xml_document_scan(fp, location)))
 		return NULL;
 
-	if (reader.shared_location)
-		root->location = xml_location_new(reader.shared_location, reader.lineCount);
-
-	/* Note! We do not deal with properly formatted XML documents here.
-	 * Specifically, we do not expect them to have a document header. */
-	if (!xml_process_element_nested(&reader, root, 0)) {
-		xml_node_free(root);
-		return NULL;
-	}
-
-	if (xml_reader_destroy(&reader) < 0) {
-		xml_node_free(root);
-		return NULL;
-	}
+	root = xml_document_take_root(doc);
+	xml_document_free(doc);
 	return root;
 }
 
@@ -246,11 +240,15 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 {
 	ni_stringbuf_t tokenValue, identifier;
 	xml_token_type_t token;
-	xml_node_t *child;
+	xml_node_t *child, **tail;
 
 	ni_stringbuf_init(&tokenValue);
 	ni_stringbuf_init(&identifier);
 
+	/* append the children at the tail instead of searching it each time */
+	for (tail = &cur->children; *tail; tail = &(*tail)->next)
+		;
+
 	while (1) {
 		token = xml_get_token(xr, &tokenValue);
 
@@ -292,7 +290,10 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 				goto error;
 			}
 
-			child = xml_node_new(identifier.string, cur);
+			child = __xml_node_new(identifier.string, cur->arena);
+			child->parent = cur;
+			*tail = child;
+			tail = &child->next;
 			if (xr->shared_location)
 				child->location = xml_location_new(xr->shared_location, xr->lineCount);
 
@@ -573,6 +574,7 @@ restart:
 				return None;
 		} else {
 			ni_stringbuf_putc(res, cc);
+			xml_get_run(xr, res, "<&");
 		}
 
 		cc = xml_getc(xr);
@@ -642,6 +644,7 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 		ni_stringbuf_clear(res);
 		oc = cc;
 		while (1) {
+			xml_get_run(xr, res, oc == '"' ? "\"" : "'");
 			cc = xml_getc(xr);
 			if (cc == EOF) {
 				xml_parse_error(xr, "Unexpected EOF while parsing quoted string");
@@ -686,6 +689,9 @@ xml_skip_comment(xml_reader_t *xr)
 				return Comment;
 			}
 			match = 0;
+
+			/* only a "-->" ends it, skip ahead to the next dash */
+			xml_get_run(xr, NULL, "-");
 		}
 	}
 
@@ -768,6 +774,23 @@ xml_skip_space(xml_reader_t *xr, ni_stringbuf_t *result)
 	}
 }
 
+/*
+ * Copy the input up to the next character in @stop, a newline
+ * or a NUL byte into @result at once.
+ */
+void
+xml_get_run(xml_reader_t *xr, ni_stringbuf_t *result, const char *stop)
+{
+	const unsigned char *beg = xr->pos;
+
+	while (xr->pos < xr->end && *xr->pos != '\n' && *xr->pos != '\0'
+	    && !strchr(stop, *xr->pos))
+		xr->pos++;
+
+	if (result && xr->pos > beg)
+		ni_stringbuf_put(result, (const char *)beg, xr->pos - beg);
+}
+
 void
 xml_parse_error(struct xml_reader *reader, const char *fmt, ...)
 {
@@ -1009,6 +1032,30 @@ xml_location_free(xml_location_t *loc)
 /*
  * XML Reader object
  */
+static int
+xml_reader_load_file(xml_reader_t *xr)
+{
+	size_t size = XML_READER_BUFSZ, len = 0, n;
+	struct stat stb;
+
+	/* read the whole file at once, a stream in chunks */
+	if (fstat(fileno(xr->file), &stb) == 0 && S_ISREG(stb.st_mode) && stb.st_size > 0)
+		size = stb.st_size + 1;
+
+	xr->buffer = xmalloc(size);
+	while ((n = fread(xr->buffer + len, 1, size - len, xr->file)) > 0) {
+		len += n;
+		if (len == size) {
+			size += XML_READER_BUFSZ;
+			xr->buffer = xrealloc(xr->buffer, size);
+		}
+	}
+
+	xr->data = xr->pos = xr->buffer;
+	xr->end = xr->buffer + len;
+	return 0;
+}
+
 static int
 xml_reader_open(xml_reader_t *xr, const char *filename)
 {
@@ -1021,11 +1068,10 @@ xml_reader_open(xml_reader_t *xr, const char *filename)
 		return -1;
 	}
 
-	xr->buffer = xmalloc(XML_READER_BUFSZ);
 	xr->state = Initial;
 	xr->lineCount = 1;
 	xr->shared_location = xml_location_shared_new(filename);
-	return 0;
+	return xml_reader_load_file(xr);
 }
 
 static int
@@ -1039,12 +1085,11 @@ xml_reader_init_file(xml_reader_t *xr, FILE *fp, const char *location)
 	xr->file = fp;
 	xr->no_close = 1;
 
-	xr->buffer = xmalloc(XML_READER_BUFSZ);
 	xr->state = Initial;
 	xr->lineCount = 1;
 	xr->shared_location = xml_location_shared_new(location);
 
-	return 0;
+	return xml_reader_load_file(xr);
 }
 
 static int
@@ -1058,6 +1103,9 @@ xml_reader_init_buffer(xml_reader_t *xr, ni_buffer_t *buf, const char *location)
 	xr->in_buffer = buf;
 	xr->no_close = 1;
 
+	xr->data = xr->pos = ni_buffer_head(buf);
+	xr->end = xr->data + ni_buffer_count(buf);
+
 	xr->state = Initial;
 	xr->lineCount = 1;
 	xr->shared_location = xml_location_shared_new(location);
@@ -1070,6 +1118,10 @@ xml_reader_destroy(xml_reader_t *xr)
 {
 	int rv = 0;
 
+	/* consume the parsed data of the caller's buffer */
+	if (xr->in_buffer)
+		ni_buffer_pull_head(xr->in_buffer, xr->pos - xr->data);
+
 	if (xr->file && ferror(xr->file))
 		rv = -1;
 	if (xr->file && !xr->no_close) {
@@ -1088,37 +1140,21 @@ xml_reader_destroy(xml_reader_t *xr)
 	return rv;
 }
 
-int
+static inline int
 xml_getc(xml_reader_t *xr)
 {
 	int cc;
 
-	if (xr->in_buffer) {
-		cc = ni_buffer_getc(xr->in_buffer);
+	while (xr->pos < xr->end) {
+		cc = *xr->pos++;
 		if (cc == '\n')
 			xr->lineCount++;
-		return cc;
-	}
+		if (cc != '\0' || xr->in_buffer)
+			return cc;
 
-	while (1) {
-		if (xr->pos) {
-			cc = *xr->pos++;
-			if (cc == '\n')
-				xr->lineCount++;
-			if (cc != '\0')
-				return cc;
-			xr->pos = NULL;
-		}
-
-		if (xr->file == NULL) {
-			/* Parsing just a string, no file backing */
-			break;
-		}
-
-		if (fgets((char *)xr->buffer, XML_READER_BUFSZ, xr->file) == NULL)
-			break;
-
-		xr->pos = xr->buffer;
+		/* a NUL byte ends the line of a file as it did with fgets */
+		while (xr->pos < xr->end && *xr->pos != '\n')
+			xr->pos++;
 	}
 
 	return EOF;
@@ -1127,21 +1163,11 @@ xml_getc(xml_reader_t *xr)
 void
 xml_ungetc(xml_reader_t *xr, int cc)
 {
-	if (xr->in_buffer) {
-		if (ni_buffer_ungetc(xr->in_buffer, cc) < 0)
-			ni_error("xml_ungetc: cannot put back");
-		if (cc == '\n')
-			xr->lineCount--;
-		return;
-	}
-
-	if (xr->pos == NULL
-	 || xr->pos == xr->buffer
-	 || xr->pos[-1] != cc) {
+	if (xr->pos == xr->data || xr->pos[-1] != cc) {
 		ni_error("xml_ungetc: cannot put back");
-		ni_error("  buffer=%p pos=%p *pos=0x%x cc=0x%x",
-				xr->buffer, xr->pos,
-				xr->pos? xr->pos[-1] : 0,
+		ni_error("  data=%p pos=%p *pos=0x%x cc=0x%x",
+				xr->data, xr->pos,
+				xr->pos != xr->data ? xr->pos[-1] : 0,
 				cc);
 		return;
 	}
@@ -1150,4 +1176,3 @@ xml_ungetc(xml_reader_t *xr, int cc)
 		xr->lineCount--;
 	xr->pos--;
 }
-
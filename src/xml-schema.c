@@ -8,12 +8,19 @@
 #endif
 
 #include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <wicked/logging.h>
 #include <wicked/xml.h>
 #include <wicked/logging.h>
+#include <wicked/util.h>
 #include "xml-schema.h"
 #include "util_priv.h"
+#include "hashmap_priv.h"
+#include "buffer.h"
 
 static int		ni_xs_process_include(xml_node_t *, ni_xs_scope_t *);
 static int		ni_xs_process_class(xml_node_t *, ni_xs_scope_t *);
@@ -801,8 +808,8 @@ ni_xs_process_method(xml_node_t *node, ni_xs_service_t *service, ni_xs_scope_t *
 		if (!strncmp(child->name, "meta:", 5)) {
 			if (method->meta == NULL)
 				method->meta = xml_node_new("meta", NULL);
-			xml_node_reparent(method->meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			child = xml_node_reparent(method->meta, child);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 
@@ -1300,8 +1307,8 @@ ni_xs_build_simple_type(xml_node_t *node, const char *typeName, ni_xs_scope_t *s
 		if (!strncasecmp(child->name, "meta:", 5)) {
 			if (meta == NULL)
 				meta = xml_node_new("meta", NULL);
-			xml_node_reparent(meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			child = xml_node_reparent(meta, child);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 	if (meta) {
@@ -1859,3 +1866,1256 @@ ni_xs_get_array_notation(const char *name)
 	}
 	return NULL;
 }
+
+/*
+ * Binary cache of a processed schema.
+ *
+ * The resolved scope tree is serialized into a versioned file
+ * with a key (digest of the schema files) and loaded directly,
+ * without to parse the xml files and to resolve the types again.
+ *
+ * All numbers are stored as 32bit values in network byte order.
+ * Types, groups and constraints are shared by reference, so each
+ * object is written once on first use and referenced by its index
+ * afterwards. The builtin (scalar) types of the root scope are not
+ * stored, but referenced by their index in the root scope.
+ */
+#define NI_XS_CACHE_MAGIC		0x57584353	/* "WXSC" */
+#define NI_XS_CACHE_VERSION		1
+#define NI_XS_CACHE_NONE		0xffffffffU
+
+enum {
+	NI_XS_CACHE_TAG_NULL,
+	NI_XS_CACHE_TAG_DEF,
+	NI_XS_CACHE_TAG_REF,
+	NI_XS_CACHE_TAG_BUILTIN,
+};
+
+enum {
+	NI_XS_CACHE_OBJ_TYPE,
+	NI_XS_CACHE_OBJ_GROUP,
+	NI_XS_CACHE_OBJ_INTMAP,
+	NI_XS_CACHE_OBJ_RANGE,
+	NI_XS_CACHE_OBJ_SCOPE,
+};
+
+typedef struct ni_xs_cache_obj	ni_xs_cache_obj_t;
+struct ni_xs_cache_obj {
+	ni_xs_cache_obj_t *	next;
+	const void *		ptr;
+	unsigned int		kind;
+	unsigned int		id;
+};
+
+typedef struct ni_xs_cache_writer {
+	ni_buffer_t		buf;
+	const ni_xs_scope_t *	root;
+	unsigned int		builtins;
+
+	ni_hashmap_t		map;
+	ni_xs_cache_obj_t *	objs;
+	unsigned int		nobjs;
+	unsigned int		nscopes;
+} ni_xs_cache_writer_t;
+
+typedef struct ni_xs_cache_origdef	ni_xs_cache_origdef_t;
+struct ni_xs_cache_origdef {
+	ni_xs_cache_origdef_t *	next;
+	ni_xs_type_t *		type;
+	unsigned int		scope;
+	unsigned int		index;
+};
+
+typedef struct ni_xs_cache_reader {
+	ni_buffer_t		buf;
+	ni_bool_t		error;
+	const ni_xs_scope_t *	root;
+
+	unsigned int		nobjs;
+	ni_xs_cache_obj_t *	objs;
+	unsigned int		nscopes;
+	ni_xs_scope_t **	scopes;
+	ni_xs_cache_origdef_t *	origdefs;
+} ni_xs_cache_reader_t;
+
+/*
+ * Writer helpers
+ */
+static void
+ni_xs_cache_put_uint(ni_xs_cache_writer_t *w, unsigned int value)
+{
+	if (ni_buffer_ensure_tailroom(&w->buf, sizeof(uint32_t)))
+		ni_buffer_put_uint32(&w->buf, value);
+	else
+		w->buf.overflow = 1;
+}
+
+static void
+ni_xs_cache_put_ulong(ni_xs_cache_writer_t *w, unsigned long value)
+{
+	ni_xs_cache_put_uint(w, (uint64_t)value >> 32);
+	ni_xs_cache_put_uint(w, (uint64_t)value & 0xffffffffU);
+}
+
+static void
+ni_xs_cache_put_string(ni_xs_cache_writer_t *w, const char *string)
+{
+	size_t len;
+
+	if (string == NULL) {
+		ni_xs_cache_put_uint(w, NI_XS_CACHE_NONE);
+		return;
+	}
+
+	len = strlen(string);
+	ni_xs_cache_put_uint(w, len);
+	if (ni_buffer_ensure_tailroom(&w->buf, len))
+		ni_buffer_put(&w->buf, string, len);
+	else
+		w->buf.overflow = 1;
+}
+
+static void
+ni_xs_cache_put_vars(ni_xs_cache_writer_t *w, const ni_var_array_t *vars)
+{
+	unsigned int i;
+
+	ni_xs_cache_put_uint(w, vars->count);
+	for (i = 0; i < vars->count; ++i) {
+		ni_xs_cache_put_string(w, vars->data[i].name);
+		ni_xs_cache_put_string(w, vars->data[i].value);
+	}
+}
+
+static void
+ni_xs_cache_put_xml(ni_xs_cache_writer_t *w, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int count;
+
+	if (node == NULL) {
+		ni_xs_cache_put_uint(w, NI_XS_CACHE_TAG_NULL);
+		return;
+	}
+
+	ni_xs_cache_put_uint(w, NI_XS_CACHE_TAG_DEF);
+	ni_xs_cache_put_string(w, node->name);
+	ni_xs_cache_put_string(w, node->cdata);
+	ni_xs_cache_put_vars(w, &node->attrs);
+
+	for (count = 0, child = node->children; child; child = child->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (child = node->children; child; child = child->next)
+		ni_xs_cache_put_xml(w, child);
+}
+
+/*
+ * Write a tag referencing an object written before, or a tag
+ * defining it and return TRUE to write the object data.
+ */
+static ni_bool_t
+ni_xs_cache_put_object(ni_xs_cache_writer_t *w, unsigned int kind, const void *ptr)
+{
+	unsigned int hash = ni_hashmap_hash_ptr(ptr);
+	ni_hashmap_entry_t *entry;
+	ni_xs_cache_obj_t *obj;
+
+	if (ptr == NULL) {
+		ni_xs_cache_put_uint(w, NI_XS_CACHE_TAG_NULL);
+		return FALSE;
+	}
+
+	ni_hashmap_foreach(&w->map, hash, entry) {
+		obj = entry->item;
+		if (obj->ptr == ptr && obj->kind == kind) {
+			ni_xs_cache_put_uint(w, NI_XS_CACHE_TAG_REF);
+			ni_xs_cache_put_uint(w, obj->id);
+			return FALSE;
+		}
+	}
+
+	obj = xcalloc(1, sizeof(*obj));
+	obj->ptr = ptr;
+	obj->kind = kind;
+	obj->id = w->nobjs++;
+	obj->next = w->objs;
+	w->objs = obj;
+	ni_hashmap_insert(&w->map, hash, obj);
+
+	ni_xs_cache_put_uint(w, NI_XS_CACHE_TAG_DEF);
+	return TRUE;
+}
+
+static void
+ni_xs_cache_put_intmap(ni_xs_cache_writer_t *w, const ni_xs_intmap_t *map)
+{
+	const ni_intmap_t *bits;
+	unsigned int count;
+
+	if (!ni_xs_cache_put_object(w, NI_XS_CACHE_OBJ_INTMAP, map))
+		return;
+
+	for (count = 0, bits = map->bits; bits && bits->name; ++bits)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (bits = map->bits; bits && bits->name; ++bits) {
+		ni_xs_cache_put_string(w, bits->name);
+		ni_xs_cache_put_uint(w, bits->value);
+	}
+}
+
+static void
+ni_xs_cache_put_range(ni_xs_cache_writer_t *w, const ni_xs_range_t *range)
+{
+	if (!ni_xs_cache_put_object(w, NI_XS_CACHE_OBJ_RANGE, range))
+		return;
+
+	ni_xs_cache_put_ulong(w, range->min);
+	ni_xs_cache_put_ulong(w, range->max);
+}
+
+static void
+ni_xs_cache_put_group(ni_xs_cache_writer_t *w, const ni_xs_group_t *group)
+{
+	if (!ni_xs_cache_put_object(w, NI_XS_CACHE_OBJ_GROUP, group))
+		return;
+
+	ni_xs_cache_put_uint(w, group->relation);
+	ni_xs_cache_put_string(w, group->name);
+}
+
+static void	ni_xs_cache_put_name_types(ni_xs_cache_writer_t *, const ni_xs_name_type_array_t *);
+
+/*
+ * The scope ids are assigned in the (depth-first) order the scopes
+ * are written, the type definition scope reference is resolved by
+ * the reader after all scopes were read.
+ */
+static void
+ni_xs_cache_number_scopes(ni_xs_cache_writer_t *w, const ni_xs_scope_t *scope)
+{
+	const ni_xs_scope_t *child;
+	ni_xs_cache_obj_t *obj;
+
+	obj = xcalloc(1, sizeof(*obj));
+	obj->ptr = scope;
+	obj->kind = NI_XS_CACHE_OBJ_SCOPE;
+	obj->id = w->nscopes++;
+	obj->next = w->objs;
+	w->objs = obj;
+	ni_hashmap_insert(&w->map, ni_hashmap_hash_ptr(scope), obj);
+
+	for (child = scope->children; child; child = child->next)
+		ni_xs_cache_number_scopes(w, child);
+}
+
+static void
+ni_xs_cache_put_origdef(ni_xs_cache_writer_t *w, const ni_xs_type_t *type)
+{
+	const ni_xs_scope_t *scope = type->origdef.scope;
+	ni_hashmap_entry_t *entry;
+	ni_xs_cache_obj_t *obj;
+	unsigned int i;
+
+	ni_hashmap_foreach(&w->map, ni_hashmap_hash_ptr(scope), entry) {
+		obj = entry->item;
+		if (obj->ptr != scope || obj->kind != NI_XS_CACHE_OBJ_SCOPE)
+			continue;
+
+		for (i = 0; i < scope->types.count; ++i) {
+			if (scope->types.data[i].type == type &&
+			    scope->types.data[i].name == type->origdef.name) {
+				ni_xs_cache_put_uint(w, obj->id);
+				ni_xs_cache_put_uint(w, i);
+				return;
+			}
+		}
+	}
+	/* builtin or defined in a temporary scope */
+	ni_xs_cache_put_uint(w, NI_XS_CACHE_NONE);
+}
+
+static void
+ni_xs_cache_put_type(ni_xs_cache_writer_t *w, const ni_xs_type_t *type)
+{
+	unsigned int i;
+
+	for (i = 0; type && i < w->builtins; ++i) {
+		if (w->root->types.data[i].type == type) {
+			ni_xs_cache_put_uint(w, NI_XS_CACHE_TAG_BUILTIN);
+			ni_xs_cache_put_uint(w, i);
+			return;
+		}
+	}
+
+	if (!ni_xs_cache_put_object(w, NI_XS_CACHE_OBJ_TYPE, type))
+		return;
+
+	ni_xs_cache_put_uint(w, type->class);
+	ni_xs_cache_put_string(w, type->name);
+	ni_xs_cache_put_string(w, type->description);
+	ni_xs_cache_put_uint(w, type->constraint.mandatory);
+	ni_xs_cache_put_group(w, type->constraint.group);
+	ni_xs_cache_put_origdef(w, type);
+	ni_xs_cache_put_xml(w, type->meta);
+
+	switch (type->class) {
+	case NI_XS_TYPE_SCALAR:
+		ni_xs_cache_put_string(w, type->u.scalar_info->basic_name);
+		ni_xs_cache_put_uint(w, type->u.scalar_info->type);
+		ni_xs_cache_put_intmap(w, type->u.scalar_info->constraint.enums);
+		ni_xs_cache_put_range(w, type->u.scalar_info->constraint.range);
+		ni_xs_cache_put_intmap(w, type->u.scalar_info->constraint.bitmap);
+		ni_xs_cache_put_intmap(w, type->u.scalar_info->constraint.bitmask);
+		break;
+
+	case NI_XS_TYPE_STRUCT:
+		ni_xs_cache_put_name_types(w, &type->u.struct_info->children);
+		break;
+
+	case NI_XS_TYPE_UNION:
+		ni_xs_cache_put_string(w, type->u.union_info->discriminant);
+		ni_xs_cache_put_name_types(w, &type->u.union_info->children);
+		break;
+
+	case NI_XS_TYPE_DICT:
+		ni_xs_cache_put_name_types(w, &type->u.dict_info->children);
+		ni_xs_cache_put_uint(w, type->u.dict_info->groups.count);
+		for (i = 0; i < type->u.dict_info->groups.count; ++i)
+			ni_xs_cache_put_group(w, type->u.dict_info->groups.data[i]);
+		break;
+
+	case NI_XS_TYPE_ARRAY:
+		ni_xs_cache_put_type(w, type->u.array_info->element_type);
+		ni_xs_cache_put_string(w, type->u.array_info->element_name);
+		ni_xs_cache_put_ulong(w, type->u.array_info->minlen);
+		ni_xs_cache_put_ulong(w, type->u.array_info->maxlen);
+		ni_xs_cache_put_string(w, type->u.array_info->notation ?
+				type->u.array_info->notation->name : NULL);
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void
+ni_xs_cache_put_name_types(ni_xs_cache_writer_t *w, const ni_xs_name_type_array_t *array)
+{
+	unsigned int i;
+
+	ni_xs_cache_put_uint(w, array->count);
+	for (i = 0; i < array->count; ++i) {
+		ni_xs_cache_put_string(w, array->data[i].name);
+		ni_xs_cache_put_type(w, array->data[i].type);
+		ni_xs_cache_put_string(w, array->data[i].description);
+	}
+}
+
+static void
+ni_xs_cache_put_methods(ni_xs_cache_writer_t *w, const ni_xs_method_t *list)
+{
+	const ni_xs_method_t *method;
+	unsigned int count;
+
+	for (count = 0, method = list; method; method = method->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+
+	for (method = list; method; method = method->next) {
+		ni_xs_cache_put_string(w, method->name);
+		ni_xs_cache_put_string(w, method->description);
+		ni_xs_cache_put_name_types(w, &method->arguments);
+		ni_xs_cache_put_type(w, method->retval);
+		ni_xs_cache_put_xml(w, method->meta);
+	}
+}
+
+static void
+ni_xs_cache_put_scope(ni_xs_cache_writer_t *w, const ni_xs_scope_t *scope)
+{
+	const ni_xs_service_t *service;
+	const ni_xs_scope_t *child;
+	const ni_xs_class_t *class;
+	unsigned int count, i;
+
+	ni_xs_cache_put_string(w, scope->name);
+
+	/* root scope builtins are defined by the reader */
+	i = scope == w->root ? w->builtins : 0;
+	ni_xs_cache_put_uint(w, scope->types.count - i);
+	for ( ; i < scope->types.count; ++i) {
+		ni_xs_cache_put_string(w, scope->types.data[i].name);
+		ni_xs_cache_put_type(w, scope->types.data[i].type);
+		ni_xs_cache_put_string(w, scope->types.data[i].description);
+	}
+
+	ni_xs_cache_put_vars(w, &scope->constants);
+
+	for (count = 0, class = scope->classes; class; class = class->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (class = scope->classes; class; class = class->next) {
+		ni_xs_cache_put_string(w, class->name);
+		ni_xs_cache_put_string(w, class->base_name);
+	}
+
+	for (count = 0, service = scope->services; service; service = service->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (service = scope->services; service; service = service->next) {
+		ni_xs_cache_put_string(w, service->name);
+		ni_xs_cache_put_string(w, service->interface);
+		ni_xs_cache_put_string(w, service->description);
+		ni_xs_cache_put_vars(w, &service->attributes);
+		ni_xs_cache_put_methods(w, service->methods);
+		ni_xs_cache_put_methods(w, service->signals);
+	}
+
+	/* the service in the parent scope defining this scope */
+	count = NI_XS_CACHE_NONE;
+	if (scope->defined_by.service && scope->parent) {
+		for (i = 0, service = scope->parent->services; service; service = service->next, ++i) {
+			if (service == scope->defined_by.service) {
+				count = i;
+				break;
+			}
+		}
+	}
+	ni_xs_cache_put_uint(w, count);
+
+	for (count = 0, child = scope->children; child; child = child->next)
+		count++;
+	ni_xs_cache_put_uint(w, count);
+	for (child = scope->children; child; child = child->next)
+		ni_xs_cache_put_scope(w, child);
+}
+
+/*
+ * Reader helpers
+ */
+static unsigned int
+ni_xs_cache_get_uint(ni_xs_cache_reader_t *r)
+{
+	uint32_t value = 0;
+
+	if (r->error || ni_buffer_get_uint32(&r->buf, &value) < 0) {
+		r->error = TRUE;
+		return NI_XS_CACHE_NONE;
+	}
+	return value;
+}
+
+static unsigned long
+ni_xs_cache_get_ulong(ni_xs_cache_reader_t *r)
+{
+	uint64_t value;
+
+	value  = (uint64_t)ni_xs_cache_get_uint(r) << 32;
+	value |= ni_xs_cache_get_uint(r);
+	return value;
+}
+
+static char *
+ni_xs_cache_get_string(ni_xs_cache_reader_t *r)
+{
+	unsigned int len;
+	char *string;
+
+	len = ni_xs_cache_get_uint(r);
+	if (r->error || len == NI_XS_CACHE_NONE)
+		return NULL;
+
+	if (len > ni_buffer_count(&r->buf)) {
+		r->error = TRUE;
+		return NULL;
+	}
+
+	string = xmalloc(len + 1);
+	ni_buffer_get(&r->buf, string, len);
+	string[len] = '\0';
+	return string;
+}
+
+static void
+ni_xs_cache_get_vars(ni_xs_cache_reader_t *r, ni_var_array_t *vars)
+{
+	unsigned int count, i;
+	char *name, *value;
+
+	count = ni_xs_cache_get_uint(r);
+	for (i = 0; i < count && !r->error; ++i) {
+		name = ni_xs_cache_get_string(r);
+		value = ni_xs_cache_get_string(r);
+		if (name)
+			ni_var_array_set(vars, name, value);
+		else
+			r->error = TRUE;
+		free(name);
+		free(value);
+	}
+}
+
+static xml_node_t *
+ni_xs_cache_get_xml(ni_xs_cache_reader_t *r, xml_node_t *parent)
+{
+	unsigned int count, i;
+	xml_node_t *node;
+	char *string;
+
+	switch (ni_xs_cache_get_uint(r)) {
+	case NI_XS_CACHE_TAG_DEF:
+		break;
+	case NI_XS_CACHE_TAG_NULL:
+		return NULL;
+	default:
+		r->error = TRUE;
+		return NULL;
+	}
+
+	string = ni_xs_cache_get_string(r);
+	node = xml_node_new(string, parent);
+	free(string);
+
+	string = ni_xs_cache_get_string(r);
+	xml_node_set_cdata(node, string);
+	free(string);
+
+	ni_xs_cache_get_vars(r, &node->attrs);
+
+	count = ni_xs_cache_get_uint(r);
+	for (i = 0; i < count && !r->error; ++i)
+		ni_xs_cache_get_xml(r, node);
+
+	return node;
+}
+
+/*
+ * Process an object tag and return the referenced object (with
+ * an additional reference) or NULL when the object is defined.
+ */
+static void *
+ni_xs_cache_get_object(ni_xs_cache_reader_t *r, unsigned int kind, unsigned int tag, ni_bool_t *define)
+{
+	ni_xs_cache_obj_t *obj;
+	unsigned int id;
+
+	*define = FALSE;
+	switch (tag) {
+	case NI_XS_CACHE_TAG_DEF:
+		*define = !r->error;
+		return NULL;
+
+	case NI_XS_CACHE_TAG_REF:
+		id = ni_xs_cache_get_uint(r);
+		if (id >= r->nobjs || r->objs[id].kind != kind)
+			break;
+
+		obj = &r->objs[id];
+		switch (kind) {
+		case NI_XS_CACHE_OBJ_TYPE:
+			return ni_xs_type_hold((ni_xs_type_t *) obj->ptr);
+		case NI_XS_CACHE_OBJ_GROUP:
+			return ni_xs_group_clone((ni_xs_group_t *) obj->ptr);
+		case NI_XS_CACHE_OBJ_INTMAP:
+			((ni_xs_intmap_t *) obj->ptr)->refcount++;
+			return (void *) obj->ptr;
+		case NI_XS_CACHE_OBJ_RANGE:
+			((ni_xs_range_t *) obj->ptr)->refcount++;
+			return (void *) obj->ptr;
+		}
+		break;
+
+	case NI_XS_CACHE_TAG_NULL:
+		return NULL;
+
+	default:
+		break;
+	}
+
+	r->error = TRUE;
+	return NULL;
+}
+
+/*
+ * Register a defined object; the table holds its initial reference
+ * and the caller gets an additional one.
+ */
+static void
+ni_xs_cache_add_object(ni_xs_cache_reader_t *r, unsigned int kind, void *ptr)
+{
+	ni_xs_cache_obj_t *obj;
+
+	if ((r->nobjs % 64) == 0)
+		r->objs = xrealloc(r->objs, (r->nobjs + 64) * sizeof(r->objs[0]));
+
+	obj = &r->objs[r->nobjs];
+	memset(obj, 0, sizeof(*obj));
+	obj->ptr = ptr;
+	obj->kind = kind;
+	obj->id = r->nobjs++;
+}
+
+static ni_xs_intmap_t *
+ni_xs_cache_get_intmap(ni_xs_cache_reader_t *r)
+{
+	ni_xs_intmap_t *map;
+	unsigned int count, i;
+	ni_bool_t define;
+
+	map = ni_xs_cache_get_object(r, NI_XS_CACHE_OBJ_INTMAP, ni_xs_cache_get_uint(r), &define);
+	if (!map && !define)
+		return NULL;
+	if (map)
+		return map;
+
+	count = ni_xs_cache_get_uint(r);
+	if (r->error || count > ni_buffer_count(&r->buf)) {
+		r->error = TRUE;
+		return NULL;
+	}
+
+	map = xcalloc(1, sizeof(*map));
+	map->refcount = 2;
+	map->bits = xcalloc(count + 1, sizeof(ni_intmap_t));
+	ni_xs_cache_add_object(r, NI_XS_CACHE_OBJ_INTMAP, map);
+
+	for (i = 0; i < count && !r->error; ++i) {
+		map->bits[i].name = ni_xs_cache_get_string(r);
+		map->bits[i].value = ni_xs_cache_get_uint(r);
+		if (!map->bits[i].name)
+			r->error = TRUE;
+	}
+	return map;
+}
+
+static ni_xs_range_t *
+ni_xs_cache_get_range(ni_xs_cache_reader_t *r)
+{
+	ni_xs_range_t *range;
+	ni_bool_t define;
+
+	range = ni_xs_cache_get_object(r, NI_XS_CACHE_OBJ_RANGE, ni_xs_cache_get_uint(r), &define);
+	if (!range && !define)
+		return NULL;
+	if (range)
+		return range;
+
+	range = xcalloc(1, sizeof(*range));
+	range->refcount = 2;
+	ni_xs_cache_add_object(r, NI_XS_CACHE_OBJ_RANGE, range);
+
+	range->min = ni_xs_cache_get_ulong(r);
+	range->max = ni_xs_cache_get_ulong(r);
+	return range;
+}
+
+static ni_xs_group_t *
+ni_xs_cache_get_group(ni_xs_cache_reader_t *r)
+{
+	ni_xs_group_t *group;
+	unsigned int relation;
+	ni_bool_t define;
+	char *name;
+
+	group = ni_xs_cache_get_object(r, NI_XS_CACHE_OBJ_GROUP, ni_xs_cache_get_uint(r), &define);
+	if (!group && !define)
+		return NULL;
+	if (group)
+		return group;
+
+	relation = ni_xs_cache_get_uint(r);
+	name = ni_xs_cache_get_string(r);
+	group = ni_xs_group_new(relation, name);
+	free(name);
+
+	ni_xs_cache_add_object(r, NI_XS_CACHE_OBJ_GROUP, group);
+	return ni_xs_group_clone(group);
+}
+
+static void	ni_xs_cache_get_name_types(ni_xs_cache_reader_t *, ni_xs_name_type_array_t *);
+
+static const char *
+ni_xs_cache_basic_name(const ni_xs_cache_reader_t *r, const char *name)
+{
+	const ni_xs_type_t *type;
+	unsigned int i;
+
+	/* refer to the static basic name of the builtin scalars */
+	for (i = 0; name && i < r->root->types.count; ++i) {
+		type = r->root->types.data[i].type;
+		if (type->class == NI_XS_TYPE_SCALAR &&
+		    ni_string_eq(type->u.scalar_info->basic_name, name))
+			return type->u.scalar_info->basic_name;
+	}
+	return NULL;
+}
+
+static ni_xs_type_t *
+ni_xs_cache_get_type(ni_xs_cache_reader_t *r)
+{
+	ni_xs_cache_origdef_t *origdef;
+	ni_xs_type_t *type;
+	unsigned int tag, i, count;
+	ni_bool_t define;
+	char *string;
+
+	tag = ni_xs_cache_get_uint(r);
+	if (tag == NI_XS_CACHE_TAG_BUILTIN) {
+		i = ni_xs_cache_get_uint(r);
+		if (i < r->root->types.count)
+			return ni_xs_type_hold(r->root->types.data[i].type);
+		r->error = TRUE;
+		return NULL;
+	}
+
+	type = ni_xs_cache_get_object(r, NI_XS_CACHE_OBJ_TYPE, tag, &define);
+	if (!type && !define)
+		return NULL;
+	if (type)
+		return type;
+
+	type = ni_xs_type_new(ni_xs_cache_get_uint(r));
+	ni_xs_cache_add_object(r, NI_XS_CACHE_OBJ_TYPE, type);
+	ni_xs_type_hold(type);
+
+	type->name = ni_xs_cache_get_string(r);
+	type->description = ni_xs_cache_get_string(r);
+	type->constraint.mandatory = !!ni_xs_cache_get_uint(r);
+	type->constraint.group = ni_xs_cache_get_group(r);
+
+	if ((i = ni_xs_cache_get_uint(r)) != NI_XS_CACHE_NONE) {
+		origdef = xcalloc(1, sizeof(*origdef));
+		origdef->type = type;
+		origdef->scope = i;
+		origdef->index = ni_xs_cache_get_uint(r);
+		origdef->next = r->origdefs;
+		r->origdefs = origdef;
+	}
+
+	type->meta = ni_xs_cache_get_xml(r, NULL);
+
+	switch (type->class) {
+	case NI_XS_TYPE_VOID:
+		break;
+
+	case NI_XS_TYPE_SCALAR:
+		type->u.scalar_info = xcalloc(1, sizeof(ni_xs_scalar_info_t));
+
+		string = ni_xs_cache_get_string(r);
+		type->u.scalar_info->basic_name = ni_xs_cache_basic_name(r, string);
+		free(string);
+		type->u.scalar_info->type = ni_xs_cache_get_uint(r);
+		if (!type->u.scalar_info->basic_name)
+			r->error = TRUE;
+
+		type->u.scalar_info->constraint.enums = ni_xs_cache_get_intmap(r);
+		type->u.scalar_info->constraint.range = ni_xs_cache_get_range(r);
+		type->u.scalar_info->constraint.bitmap = ni_xs_cache_get_intmap(r);
+		type->u.scalar_info->constraint.bitmask = ni_xs_cache_get_intmap(r);
+		break;
+
+	case NI_XS_TYPE_STRUCT:
+		type->u.struct_info = xcalloc(1, sizeof(ni_xs_struct_info_t));
+		ni_xs_cache_get_name_types(r, &type->u.struct_info->children);
+		break;
+
+	case NI_XS_TYPE_UNION:
+		type->u.union_info = xcalloc(1, sizeof(ni_xs_union_info_t));
+		type->u.union_info->discriminant = ni_xs_cache_get_string(r);
+		ni_xs_cache_get_name_types(r, &type->u.union_info->children);
+		break;
+
+	case NI_XS_TYPE_DICT:
+		type->u.dict_info = xcalloc(1, sizeof(ni_xs_dict_info_t));
+		ni_xs_cache_get_name_types(r, &type->u.dict_info->children);
+
+		count = ni_xs_cache_get_uint(r);
+		for (i = 0; i < count && !r->error; ++i) {
+			ni_xs_group_t *group;
+
+			if ((group = ni_xs_cache_get_group(r))) {
+				ni_xs_group_array_append(&type->u.dict_info->groups, group);
+				ni_xs_group_free(group);
+			}
+		}
+		break;
+
+	case NI_XS_TYPE_ARRAY:
+		type->u.array_info = xcalloc(1, sizeof(ni_xs_array_info_t));
+		type->u.array_info->element_type = ni_xs_cache_get_type(r);
+		type->u.array_info->element_name = ni_xs_cache_get_string(r);
+		type->u.array_info->minlen = ni_xs_cache_get_ulong(r);
+		type->u.array_info->maxlen = ni_xs_cache_get_ulong(r);
+		if ((string = ni_xs_cache_get_string(r))) {
+			if (!(type->u.array_info->notation = ni_xs_get_array_notation(string)))
+				r->error = TRUE;
+			free(string);
+		}
+		if (!type->u.array_info->element_type)
+			r->error = TRUE;
+		break;
+
+	default:
+		/* unknown class; ni_xs_type_free would not know it either */
+		type->class = NI_XS_TYPE_VOID;
+		r->error = TRUE;
+		break;
+	}
+
+	return type;
+}
+
+static void
+ni_xs_cache_get_name_types(ni_xs_cache_reader_t *r, ni_xs_name_type_array_t *array)
+{
+	unsigned int count, i;
+	char *name, *description;
+	ni_xs_type_t *type;
+
+	count = ni_xs_cache_get_uint(r);
+	for (i = 0; i < count && !r->error; ++i) {
+		name = ni_xs_cache_get_string(r);
+		type = ni_xs_cache_get_type(r);
+		description = ni_xs_cache_get_string(r);
+
+		if (type)
+			ni_xs_name_type_array_append(array, name, type, description);
+		else
+			r->error = TRUE;
+
+		ni_xs_type_release(type);
+		free(description);
+		free(name);
+	}
+}
+
+static void
+ni_xs_cache_get_methods(ni_xs_cache_reader_t *r, ni_xs_method_t **list)
+{
+	ni_xs_method_t *method;
+	unsigned int count, i;
+	char *name;
+
+	count = ni_xs_cache_get_uint(r);
+	for (i = 0; i < count && !r->error; ++i) {
+		name = ni_xs_cache_get_string(r);
+		method = ni_xs_method_new(list, name);
+		free(name);
+
+		method->description = ni_xs_cache_get_string(r);
+		ni_xs_cache_get_name_types(r, &method->arguments);
+		method->retval = ni_xs_cache_get_type(r);
+		method->meta = ni_xs_cache_get_xml(r, NULL);
+	}
+}
+
+static void
+ni_xs_cache_get_scope(ni_xs_cache_reader_t *r, ni_xs_scope_t *scope)
+{
+	ni_xs_service_t *service;
+	ni_xs_class_t *class, **tail;
+	unsigned int count, i;
+	ni_xs_scope_t *child;
+	char *name;
+
+	if ((r->nscopes % 64) == 0)
+		r->scopes = xrealloc(r->scopes, (r->nscopes + 64) * sizeof(r->scopes[0]));
+	r->scopes[r->nscopes++] = scope;
+
+	ni_xs_cache_get_name_types(r, &scope->types);
+	ni_xs_cache_get_vars(r, &scope->constants);
+
+	count = ni_xs_cache_get_uint(r);
+	for (tail = &scope->classes; *tail; tail = &(*tail)->next)
+		;
+	for (i = 0; i < count && !r->error; ++i) {
+		class = xcalloc(1, sizeof(*class));
+		class->name = ni_xs_cache_get_string(r);
+		class->base_name = ni_xs_cache_get_string(r);
+		*tail = class;
+		tail = &class->next;
+	}
+
+	count = ni_xs_cache_get_uint(r);
+	for (i = 0; i < count && !r->error; ++i) {
+		service = ni_xs_service_new(NULL, NULL, scope);
+		service->name = ni_xs_cache_get_string(r);
+		service->interface = ni_xs_cache_get_string(r);
+		service->description = ni_xs_cache_get_string(r);
+		ni_xs_cache_get_vars(r, &service->attributes);
+		ni_xs_cache_get_methods(r, &service->methods);
+		ni_xs_cache_get_methods(r, &service->signals);
+	}
+
+	if ((count = ni_xs_cache_get_uint(r)) != NI_XS_CACHE_NONE) {
+		for (i = 0, service = scope->parent ? scope->parent->services : NULL;
+				service && i < count; service = service->next)
+			++i;
+		if (service)
+			scope->defined_by.service = service;
+		else
+			r->error = TRUE;
+	}
+
+	count = ni_xs_cache_get_uint(r);
+	for (i = 0; i < count && !r->error; ++i) {
+		name = ni_xs_cache_get_string(r);
+		if (name == NULL) {
+			r->error = TRUE;
+			break;
+		}
+		child = ni_xs_scope_new(scope, name);
+		ni_xs_cache_get_scope(r, child);
+		free(name);
+	}
+}
+
+static void
+ni_xs_cache_reader_destroy(ni_xs_cache_reader_t *r)
+{
+	ni_xs_cache_origdef_t *origdef;
+	ni_xs_cache_obj_t *obj;
+	unsigned int i;
+
+	for (i = 0; i < r->nobjs; ++i) {
+		obj = &r->objs[i];
+		switch (obj->kind) {
+		case NI_XS_CACHE_OBJ_TYPE:
+			ni_xs_type_release((ni_xs_type_t *) obj->ptr);
+			break;
+		case NI_XS_CACHE_OBJ_GROUP:
+			ni_xs_group_free((ni_xs_group_t *) obj->ptr);
+			break;
+		case NI_XS_CACHE_OBJ_INTMAP:
+			ni_xs_intmap_free((ni_xs_intmap_t *) obj->ptr);
+			break;
+		case NI_XS_CACHE_OBJ_RANGE:
+			ni_xs_range_free((ni_xs_range_t *) obj->ptr);
+			break;
+		}
+	}
+	free(r->objs);
+	free(r->scopes);
+
+	while ((origdef = r->origdefs)) {
+		r->origdefs = origdef->next;
+		free(origdef);
+	}
+}
+
+static void
+ni_xs_scope_free_classes(ni_xs_scope_t *scope)
+{
+	ni_xs_class_t *class;
+	ni_xs_scope_t *child;
+
+	while ((class = scope->classes)) {
+		scope->classes = class->next;
+		ni_string_free(&class->name);
+		ni_string_free(&class->base_name);
+		free(class);
+	}
+	for (child = scope->children; child; child = child->next)
+		ni_xs_scope_free_classes(child);
+}
+
+/*
+ * Move the loaded definitions into the root scope, which contains
+ * the builtin types only; the type array entries (and their names
+ * referenced by origdef) are moved as they are.
+ */
+static void
+ni_xs_cache_merge_root(ni_xs_scope_t *root, ni_xs_scope_t *temp)
+{
+	ni_xs_scope_t *child, **tail;
+	ni_xs_class_t **ctail;
+	ni_xs_service_t **stail;
+	unsigned int count, i;
+
+	count = root->types.count + temp->types.count;
+	if (temp->types.count) {
+		root->types.data = xrealloc(root->types.data,
+				((count + 31) / 32) * 32 * sizeof(root->types.data[0]));
+		memcpy(root->types.data + root->types.count, temp->types.data,
+				temp->types.count * sizeof(temp->types.data[0]));
+		root->types.count = count;
+	}
+	free(temp->types.data);
+	memset(&temp->types, 0, sizeof(temp->types));
+
+	for (i = 0; i < temp->constants.count; ++i)
+		ni_var_array_set(&root->constants, temp->constants.data[i].name,
+				temp->constants.data[i].value);
+
+	for (ctail = &root->classes; *ctail; ctail = &(*ctail)->next)
+		;
+	*ctail = temp->classes;
+	temp->classes = NULL;
+
+	for (stail = &root->services; *stail; stail = &(*stail)->next)
+		;
+	*stail = temp->services;
+	temp->services = NULL;
+
+	for (tail = &root->children; *tail; tail = &(*tail)->next)
+		;
+	*tail = temp->children;
+	for (child = temp->children; child; child = child->next)
+		child->parent = root;
+	temp->children = NULL;
+}
+
+/*
+ * Compute the cache key of the schema: a digest over the names and
+ * content of all xml files in the directory of the schema file.
+ */
+static int
+ni_xs_cache_key_cmp(const void *a, const void *b)
+{
+	return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+int
+ni_xs_schema_cache_key(const char *filename, unsigned char *key, size_t size)
+{
+	ni_string_array_t files = NI_STRING_ARRAY_INIT;
+	char pathbuf[PATH_MAX];
+	ni_hashctx_t *ctx;
+	const char *dir;
+	unsigned int i;
+	size_t len;
+	void *data;
+	FILE *fp;
+	int rv = -1;
+
+	if (!filename || !key || size < NI_XS_CACHE_KEY_SIZE)
+		return -1;
+
+	if (!(ctx = ni_hashctx_new(NI_HASHCTX_SHA1)))
+		return -1;
+
+	dir = ni_dirname(filename);
+	if (!dir || ni_scandir(dir, "*.xml", &files) <= 0)
+		goto out;
+	qsort(files.data, files.count, sizeof(files.data[0]), ni_xs_cache_key_cmp);
+
+	ni_hashctx_begin(ctx);
+	ni_hashctx_puts(ctx, filename);
+	for (i = 0; i < files.count; ++i) {
+		snprintf(pathbuf, sizeof(pathbuf), "%s/%s", dir, files.data[i]);
+		if (!(fp = fopen(pathbuf, "re")))
+			goto out;
+
+		data = ni_file_read(fp, &len, 0);
+		fclose(fp);
+		if (!data)
+			goto out;
+
+		ni_hashctx_put(ctx, files.data[i], strlen(files.data[i]) + 1);
+		ni_hashctx_put(ctx, data, len);
+		free(data);
+	}
+	ni_hashctx_finish(ctx);
+
+	if (ni_hashctx_get_digest(ctx, key, size) == NI_XS_CACHE_KEY_SIZE)
+		rv = NI_XS_CACHE_KEY_SIZE;
+
+out:
+	ni_string_array_destroy(&files);
+	ni_hashctx_free(ctx);
+	return rv;
+}
+
+/*
+ * Load the cached schema into the scope with the builtin types
+ * as returned by ni_dbus_xml_init. The scope is not modified when
+ * the cache does not exist, has been created for another key or
+ * builtins, or is corrupt.
+ */
+ni_bool_t
+ni_xs_scope_cache_load(ni_xs_scope_t *root, const char *filename, const unsigned char *key, size_t keylen)
+{
+	ni_xs_cache_reader_t r;
+	ni_xs_cache_origdef_t *origdef;
+	ni_xs_scope_t *temp, *scope;
+	struct stat stb;
+	void *addr;
+	char *name;
+	unsigned int i;
+	int fd;
+
+	if (!root || root->parent || !filename || !key || !keylen)
+		return FALSE;
+
+	if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) < 0) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_XML,
+				"unable to open schema cache %s: %m", filename);
+		return FALSE;
+	}
+	if (fstat(fd, &stb) < 0 || stb.st_size <= 0) {
+		close(fd);
+		return FALSE;
+	}
+	addr = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return FALSE;
+
+	memset(&r, 0, sizeof(r));
+	ni_buffer_init_reader(&r.buf, addr, stb.st_size);
+	r.root = root;
+
+	if (ni_xs_cache_get_uint(&r) != NI_XS_CACHE_MAGIC ||
+	    ni_xs_cache_get_uint(&r) != NI_XS_CACHE_VERSION ||
+	    ni_xs_cache_get_uint(&r) != keylen ||
+	    keylen > ni_buffer_count(&r.buf) ||
+	    memcmp(ni_buffer_head(&r.buf), key, keylen)) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_XML,
+				"schema cache %s is outdated", filename);
+		munmap(addr, stb.st_size);
+		return FALSE;
+	}
+	ni_buffer_pull_head(&r.buf, keylen);
+
+	/* the builtin types have to match */
+	if (ni_xs_cache_get_uint(&r) != root->types.count)
+		r.error = TRUE;
+	for (i = 0; i < root->types.count && !r.error; ++i) {
+		name = ni_xs_cache_get_string(&r);
+		if (!ni_string_eq(name, root->types.data[i].name))
+			r.error = TRUE;
+		free(name);
+	}
+
+	name = ni_xs_cache_get_string(&r);
+	if (!ni_string_eq(name, root->name))
+		r.error = TRUE;
+	free(name);
+
+	temp = ni_xs_scope_new(NULL, root->name);
+	if (!r.error)
+		ni_xs_cache_get_scope(&r, temp);
+	if (ni_xs_cache_get_uint(&r) != NI_XS_CACHE_MAGIC || ni_buffer_count(&r.buf))
+		r.error = TRUE;
+
+	if (r.error) {
+		ni_error("unable to load corrupt schema cache %s", filename);
+		ni_xs_scope_free_classes(temp);
+		ni_xs_cache_reader_destroy(&r);
+		ni_xs_scope_free(temp);
+		munmap(addr, stb.st_size);
+		return FALSE;
+	}
+
+	/* root scope type indexes include the builtins */
+	r.scopes[0] = root;
+	for (origdef = r.origdefs; origdef; origdef = origdef->next) {
+		if (origdef->scope >= r.nscopes)
+			continue;
+
+		scope = r.scopes[origdef->scope];
+		i = origdef->index;
+		if (scope == root) {
+			if (i < root->types.count)
+				continue;
+			scope = temp;
+			i -= root->types.count;
+		}
+		if (i < scope->types.count && scope->types.data[i].type == origdef->type) {
+			origdef->type->origdef.scope = r.scopes[origdef->scope];
+			origdef->type->origdef.name = scope->types.data[i].name;
+		}
+	}
+
+	ni_xs_cache_merge_root(root, temp);
+	ni_xs_cache_reader_destroy(&r);
+	ni_xs_scope_free(temp);
+	munmap(addr, stb.st_size);
+
+	ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_XML,
+			"loaded schema from cache %s", filename);
+	return TRUE;
+}
+
+/*
+ * Write the schema to the cache file. The first builtins types of
+ * the root scope are the ones defined by ni_dbus_xml_init.
+ */
+int
+ni_xs_scope_cache_save(const ni_xs_scope_t *root, unsigned int builtins, const char *filename,
+			const unsigned char *key, size_t keylen)
+{
+	ni_xs_cache_writer_t w;
+	ni_xs_cache_obj_t *obj;
+	char *tempname = NULL;
+	unsigned int i;
+	int fd, rv = -1;
+
+	if (!root || root->parent || builtins > root->types.count || !filename || !key || !keylen)
+		return -1;
+
+	memset(&w, 0, sizeof(w));
+	ni_buffer_init_dynamic(&w.buf, 64 * 1024);
+	ni_hashmap_init(&w.map);
+	w.root = root;
+	w.builtins = builtins;
+	ni_xs_cache_number_scopes(&w, root);
+
+	ni_xs_cache_put_uint(&w, NI_XS_CACHE_MAGIC);
+	ni_xs_cache_put_uint(&w, NI_XS_CACHE_VERSION);
+	ni_xs_cache_put_uint(&w, keylen);
+	if (ni_buffer_ensure_tailroom(&w.buf, keylen))
+		ni_buffer_put(&w.buf, key, keylen);
+	ni_xs_cache_put_uint(&w, builtins);
+	for (i = 0; i < builtins; ++i)
+		ni_xs_cache_put_string(&w, root->types.data[i].name);
+	ni_xs_cache_put_scope(&w, root);
+	ni_xs_cache_put_uint(&w, NI_XS_CACHE_MAGIC);
+
+	if (w.buf.overflow) {
+		ni_error("unable to serialize schema cache");
+		goto out;
+	}
+
+	ni_string_printf(&tempname, "%s.XXXXXX", filename);
+	if ((fd = mkstemp(tempname)) < 0) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_XML,
+				"unable to create schema cache %s: %m", filename);
+		goto out;
+	}
+	if (fchmod(fd, 0644) < 0 ||
+	    write(fd, ni_buffer_head(&w.buf), ni_buffer_count(&w.buf)) != (ssize_t)ni_buffer_count(&w.buf) ||
+	    fsync(fd) < 0) {
+		ni_error("unable to write schema cache %s: %m", tempname);
+		close(fd);
+		unlink(tempname);
+		goto out;
+	}
+	if (close(fd) < 0) {
+		ni_error("unable to write schema cache %s: %m", tempname);
+		unlink(tempname);
+		goto out;
+	}
+	if (rename(tempname, filename) < 0) {
+		ni_error("unable to rename schema cache %s: %m", tempname);
+		unlink(tempname);
+		goto out;
+	}
+
+	ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_XML,
+			"saved schema cache %s with %u objects in %u scopes",
+			filename, w.nobjs, w.nscopes);
+	rv = 0;
+
+out:
+	while ((obj = w.objs)) {
+		w.objs = obj->next;
+		free(obj);
+	}
+	ni_hashmap_destroy(&w.map);
+	ni_buffer_destroy(&w.buf);
+	ni_string_free(&tempname);
+	return rv;
+}
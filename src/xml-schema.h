@@ -353,6 +353,14 @@ extern ni_xs_type_t *	ni_xs_scope_lookup_local(const ni_xs_scope_t *, const char
 extern int		ni_xs_process_schema_file(const char *, ni_xs_scope_t *);
 extern int		ni_xs_process_schema(xml_node_t *, ni_xs_scope_t *);
 
+#define NI_XS_CACHE_KEY_SIZE	20	/* SHA1 digest */
+
+extern int		ni_xs_schema_cache_key(const char *, unsigned char *, size_t);
+extern ni_bool_t	ni_xs_scope_cache_load(ni_xs_scope_t *, const char *,
+					const unsigned char *, size_t);
+extern int		ni_xs_scope_cache_save(const ni_xs_scope_t *, unsigned int, const char *,
+					const unsigned char *, size_t);
+
 extern ni_xs_type_t *	ni_xs_scalar_new(const char *, unsigned int);
 extern int		ni_xs_scope_typedef(ni_xs_scope_t *, const char *, ni_xs_type_t *, const char *);
 extern void		ni_xs_type_free(ni_xs_type_t *type);
@@ -233,7 +233,7 @@ xml_node_content_uuid(const xml_node_t *node, unsigned int version,
 	 * children/cdata, but without node name or attrs. */
 	temp = xml_node_clone(node, NULL);
 	ni_var_array_destroy(&temp->attrs);
-	ni_string_free(&temp->name);
+	xml_node_set_name(temp, NULL);
 
 	ret = xml_node_uuid(temp, version, namespace, uuid);
 	xml_node_free(temp);
@@ -23,14 +23,132 @@
 #include "config.h"
 #endif
 
+#include <stddef.h>
+#include <string.h>
 #include <wicked/xml.h>
 #include <wicked/logging.h>
 #include "util_priv.h"
+#include "hashmap_priv.h"
+#include "xml_priv.h"
 #include <inttypes.h>
 
 #define XML_DOCUMENTARRAY_CHUNK		1
 #define XML_NODEARRAY_CHUNK		8
 
+#define XML_ARENA_CHUNK_MIN		4096
+#define XML_ARENA_CHUNK_MAX		(256 * 1024)
+
+#define XML_NODE_INDEX_MIN		16
+
+/*
+ * Document arena: a bump allocator for nodes, their names and cdata.
+ * Every node allocated in it holds a reference, so nodes detached from
+ * the document or referenced beyond it stay valid; the chunks are freed
+ * at once when the document and the last of its nodes are gone.
+ * Attributes and locations are not in the arena, as the var array and
+ * location code modifies them in place.
+ */
+struct xml_arena_chunk {
+	struct xml_arena_chunk *next;
+	size_t			size;
+	size_t			used;
+};
+
+struct xml_arena {
+	unsigned int		refcount;
+	size_t			chunk_size;
+	struct xml_arena_chunk *chunks;
+};
+
+static struct xml_arena *
+xml_arena_new(void)
+{
+	struct xml_arena *arena;
+
+	arena = xcalloc(1, sizeof(*arena));
+	arena->refcount = 1;
+	arena->chunk_size = XML_ARENA_CHUNK_MIN;
+	return arena;
+}
+
+static inline struct xml_arena *
+xml_arena_hold(struct xml_arena *arena)
+{
+	arena->refcount++;
+	return arena;
+}
+
+static void
+xml_arena_release(struct xml_arena *arena)
+{
+	struct xml_arena_chunk *chunk;
+
+	ni_assert(arena->refcount);
+	if (--(arena->refcount) != 0)
+		return;
+
+	while ((chunk = arena->chunks) != NULL) {
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	free(arena);
+}
+
+static void *
+xml_arena_alloc(struct xml_arena *arena, size_t size)
+{
+	struct xml_arena_chunk *chunk;
+	unsigned char *ptr;
+
+	size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+	chunk = arena->chunks;
+	if (chunk && chunk->size - chunk->used >= size) {
+		ptr = (unsigned char *)(chunk + 1) + chunk->used;
+		chunk->used += size;
+		return ptr;
+	}
+
+	if (size > arena->chunk_size / 4) {
+		/* large blocks get a chunk of their own, queued behind
+		 * the current one to keep allocating from its rest */
+		chunk = xmalloc(sizeof(*chunk) + size);
+		chunk->size = chunk->used = size;
+		if (arena->chunks) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else {
+			chunk->next = NULL;
+			arena->chunks = chunk;
+		}
+		return chunk + 1;
+	}
+
+	chunk = xmalloc(sizeof(*chunk) + arena->chunk_size);
+	chunk->size = arena->chunk_size;
+	chunk->used = size;
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	if (arena->chunk_size < XML_ARENA_CHUNK_MAX)
+		arena->chunk_size *= 2;
+	return chunk + 1;
+}
+
+static char *
+xml_arena_strdup(struct xml_arena *arena, const char *str)
+{
+	size_t len;
+	char *ptr;
+
+	if (!str)
+		return NULL;
+
+	len = strlen(str) + 1;
+	ptr = xml_arena_alloc(arena, len);
+	memcpy(ptr, str, len);
+	return ptr;
+}
+
 xml_document_t *
 xml_document_new()
 {
@@ -41,6 +159,20 @@ xml_document_new()
 	return doc;
 }
 
+/*
+ * Create a document allocating its nodes in an arena
+ */
+xml_document_t *
+xml_document_new_arena(void)
+{
+	xml_document_t *doc;
+
+	doc = xcalloc(1, sizeof(*doc));
+	doc->arena = xml_arena_new();
+	doc->root = __xml_node_new(NULL, doc->arena);
+	return doc;
+}
+
 xml_node_t *
 xml_document_root(xml_document_t *doc)
 {
@@ -80,10 +212,187 @@ xml_document_free(xml_document_t *doc)
 	if (doc) {
 		xml_node_free(doc->root);
 		ni_string_free(&doc->dtd);
+		if (doc->arena)
+			xml_arena_release(doc->arena);
 		free(doc);
 	}
 }
 
+/*
+ * Lookup index of a node, built once a child or attribute lookup
+ * has to scan XML_NODE_INDEX_MIN entries. The children index maps
+ * each name to its first child; children are only ever appended at
+ * the tail, other changes of the list update or drop the index.
+ * Attributes are indexed up to the count seen at the last lookup,
+ * a deleted attribute drops their index.
+ */
+struct xml_node_index {
+	ni_bool_t		has_children;
+	ni_hashmap_t		children;	/* name hash -> first child */
+	xml_node_t *		last;		/* last child */
+
+	unsigned int		nattrs;		/* number of attrs indexed */
+	ni_hashmap_t		attrs;		/* name hash -> attr position + 1 */
+};
+
+static struct xml_node_index *
+__xml_node_index(xml_node_t *node)
+{
+	if (!node->index)
+		node->index = xcalloc(1, sizeof(*node->index));
+	return node->index;
+}
+
+static void
+__xml_node_index_free(xml_node_t *node)
+{
+	struct xml_node_index *index;
+
+	if ((index = node->index) != NULL) {
+		node->index = NULL;
+		ni_hashmap_destroy(&index->children);
+		ni_hashmap_destroy(&index->attrs);
+		free(index);
+	}
+}
+
+static xml_node_t *
+__xml_node_index_first(const struct xml_node_index *index, const char *name)
+{
+	ni_hashmap_entry_t *he;
+	xml_node_t *child;
+
+	ni_hashmap_foreach(&index->children, ni_hashmap_hash_string(name), he) {
+		child = he->item;
+		if (ni_string_eq(child->name, name))
+			return child;
+	}
+	return NULL;
+}
+
+static void
+__xml_node_index_add_child(struct xml_node_index *index, xml_node_t *child)
+{
+	if (child->name && !__xml_node_index_first(index, child->name))
+		ni_hashmap_insert(&index->children, ni_hashmap_hash_string(child->name), child);
+	index->last = child;
+}
+
+static void
+__xml_node_index_children(xml_node_t *node)
+{
+	struct xml_node_index *index = __xml_node_index(node);
+	xml_node_t *child;
+
+	if (index->has_children)
+		return;
+
+	for (child = node->children; child; child = child->next)
+		__xml_node_index_add_child(index, child);
+	index->has_children = TRUE;
+}
+
+static void
+__xml_node_index_drop_children(xml_node_t *node)
+{
+	struct xml_node_index *index;
+
+	if ((index = node->index) && index->has_children) {
+		ni_hashmap_destroy(&index->children);
+		index->has_children = FALSE;
+		index->last = NULL;
+	}
+}
+
+/*
+ * Update the index of @parent for the @child linked into its list
+ */
+static void
+__xml_node_index_link(xml_node_t *parent, xml_node_t *child)
+{
+	struct xml_node_index *index = parent->index;
+
+	if (!index || !index->has_children)
+		return;
+
+	if (child->next)
+		__xml_node_index_drop_children(parent);
+	else
+		__xml_node_index_add_child(index, child);
+}
+
+/*
+ * Update the index of @parent for the @child about to be removed
+ * from the list @pos of @parent points to
+ */
+static void
+__xml_node_index_unlink(xml_node_t *parent, xml_node_t **pos, xml_node_t *child)
+{
+	struct xml_node_index *index = parent->index;
+	unsigned int hash;
+	xml_node_t *np;
+
+	if (!index || !index->has_children)
+		return;
+
+	if (index->last == child) {
+		if (pos == &parent->children)
+			index->last = NULL;
+		else
+			index->last = (xml_node_t *)((char *)pos - offsetof(xml_node_t, next));
+	}
+
+	if (!child->name || __xml_node_index_first(index, child->name) != child)
+		return;
+
+	hash = ni_hashmap_hash_string(child->name);
+	ni_hashmap_remove(&index->children, hash, child);
+	for (np = child->next; np; np = np->next) {
+		if (ni_string_eq(np->name, child->name)) {
+			ni_hashmap_insert(&index->children, hash, np);
+			break;
+		}
+	}
+}
+
+static const ni_var_t *
+__xml_node_index_get_attr(xml_node_t *node, const char *name)
+{
+	struct xml_node_index *index = __xml_node_index(node);
+	const ni_var_array_t *attrs = &node->attrs;
+	unsigned int pos, found = 0;
+	ni_hashmap_entry_t *he;
+
+	if (index->nattrs > attrs->count) {
+		ni_hashmap_destroy(&index->attrs);
+		index->nattrs = 0;
+	}
+	for ( ; index->nattrs < attrs->count; index->nattrs++) {
+		if (attrs->data[index->nattrs].name)
+			ni_hashmap_insert(&index->attrs,
+					ni_hashmap_hash_string(attrs->data[index->nattrs].name),
+					(void *)(uintptr_t)(index->nattrs + 1));
+	}
+
+	ni_hashmap_foreach(&index->attrs, ni_hashmap_hash_string(name), he) {
+		pos = (uintptr_t)he->item;
+		if ((!found || pos < found) && ni_string_eq(attrs->data[pos - 1].name, name))
+			found = pos;
+	}
+	return found ? &attrs->data[found - 1] : NULL;
+}
+
+static void
+__xml_node_index_drop_attrs(xml_node_t *node)
+{
+	struct xml_node_index *index;
+
+	if ((index = node->index) && index->nattrs) {
+		ni_hashmap_destroy(&index->attrs);
+		index->nattrs = 0;
+	}
+}
+
 /*
  * Helper functions for xml node list management
  */
@@ -93,6 +402,7 @@ __xml_node_list_insert(xml_node_t **pos, xml_node_t *node, xml_node_t *parent)
 	node->parent = parent;
 	node->next = *pos;
 	*pos = node;
+	__xml_node_index_link(parent, node);
 }
 
 static inline xml_node_t *
@@ -101,6 +411,8 @@ __xml_node_list_remove(xml_node_t **pos)
 	xml_node_t *np = *pos;
 
 	if (np) {
+		if (np->parent)
+			__xml_node_index_unlink(np->parent, pos, np);
 		np->parent = NULL;
 		*pos = np->next;
 		np->next = NULL;
@@ -135,22 +447,41 @@ xml_node_add_child(xml_node_t *parent, xml_node_t *child)
 
 	ni_assert(child->parent == NULL);
 
-	tail = __xml_node_list_tail(&parent->children);
+	if (parent->index && parent->index->has_children)
+		tail = parent->index->last ? &parent->index->last->next : &parent->children;
+	else
+		tail = __xml_node_list_tail(&parent->children);
 	__xml_node_list_insert(tail, child, parent);
 }
 
 xml_node_t *
-xml_node_new(const char *ident, xml_node_t *parent)
+__xml_node_new(const char *ident, struct xml_arena *arena)
 {
 	xml_node_t *node;
 
-	node = xcalloc(1, sizeof(xml_node_t));
-	if (ident)
-		node->name = xstrdup(ident);
+	if (arena) {
+		node = xml_arena_alloc(arena, sizeof(xml_node_t));
+		memset(node, 0, sizeof(xml_node_t));
+		node->arena = xml_arena_hold(arena);
+		node->name = xml_arena_strdup(arena, ident);
+	} else {
+		node = xcalloc(1, sizeof(xml_node_t));
+		if (ident)
+			node->name = xstrdup(ident);
+	}
+	node->refcount = 1;
 
+	return node;
+}
+
+xml_node_t *
+xml_node_new(const char *ident, xml_node_t *parent)
+{
+	xml_node_t *node;
+
+	node = __xml_node_new(ident, parent ? parent->arena : NULL);
 	if (parent)
 		xml_node_add_child(parent, node);
-	node->refcount = 1;
 
 	return node;
 }
@@ -227,7 +558,7 @@ xml_node_clone(const xml_node_t *src, xml_node_t *parent)
 		return NULL;
 
 	dst = xml_node_new(src->name, parent);
-	ni_string_dup(&dst->cdata, src->cdata);
+	xml_node_set_cdata(dst, src->cdata);
 
 	for (i = 0, attr = src->attrs.data; i < src->attrs.count; ++i, ++attr)
 		xml_node_add_attr(dst, attr->name, attr->value);
@@ -262,17 +593,8 @@ xml_node_merge(xml_node_t *base, const xml_node_t *merge)
 	const xml_node_t *mchild;
 
 	for (mchild = merge->children; mchild; mchild = mchild->next) {
-		xml_node_t **pos, *np, *clone;
-
-		for (pos = &base->children; (np = *pos) != NULL; pos = &np->next) {
-			if (ni_string_eq(mchild->name, np->name))
-				goto dont_merge;
-		}
-
-		clone = xml_node_clone(mchild, NULL);
-		__xml_node_list_insert(pos, clone, base);
-
-dont_merge: ;
+		if (!xml_node_get_child(base, mchild->name))
+			xml_node_clone(mchild, base);
 	}
 }
 
@@ -302,16 +624,36 @@ xml_node_free(xml_node_t *node)
 	if (node->location)
 		xml_location_free(node->location);
 
+	__xml_node_index_free(node);
 	ni_var_array_destroy(&node->attrs);
+	if (node->arena) {
+		xml_arena_release(node->arena);
+		return;
+	}
 	free(node->cdata);
 	free(node->name);
 	free(node);
 }
 
+void
+xml_node_set_name(xml_node_t *node, const char *name)
+{
+	if (node->parent)
+		__xml_node_index_drop_children(node->parent);
+
+	if (node->arena)
+		node->name = xml_arena_strdup(node->arena, name);
+	else
+		ni_string_dup(&node->name, name);
+}
+
 void
 xml_node_set_cdata(xml_node_t *node, const char *cdata)
 {
-	ni_string_dup(&node->cdata, cdata);
+	if (node->arena)
+		node->cdata = xml_arena_strdup(node->arena, cdata);
+	else
+		ni_string_dup(&node->cdata, cdata);
 }
 
 void
@@ -320,7 +662,7 @@ xml_node_set_int(xml_node_t *node, int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%d", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -329,7 +671,7 @@ xml_node_set_int64(xml_node_t *node, int64_t value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%"PRId64, value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -338,7 +680,7 @@ xml_node_set_uint(xml_node_t *node, unsigned int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%u", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -347,7 +689,7 @@ xml_node_set_uint64(xml_node_t *node, uint64_t value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%"PRIu64, value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -356,7 +698,7 @@ xml_node_set_uint_hex(xml_node_t *node, unsigned int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "0x%x", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -386,7 +728,12 @@ xml_node_add_attr_double(xml_node_t *node, const char *name, double value)
 const ni_var_t *
 xml_node_get_attr_var(const xml_node_t *node, const char *name)
 {
-	return node ? ni_var_array_get(&node->attrs, name) : NULL;
+	if (!node)
+		return NULL;
+
+	if (name && node->attrs.count >= XML_NODE_INDEX_MIN)
+		return __xml_node_index_get_attr((xml_node_t *)node, name);
+	return ni_var_array_get(&node->attrs, name);
 }
 
 ni_bool_t
@@ -408,7 +755,11 @@ xml_node_get_attr(const xml_node_t *node, const char *name)
 ni_bool_t
 xml_node_del_attr(xml_node_t *node, const char *name)
 {
-	return node ? ni_var_array_remove(&node->attrs, name) : FALSE;
+	if (!node)
+		return FALSE;
+
+	__xml_node_index_drop_attrs(node);
+	return ni_var_array_remove(&node->attrs, name);
 }
 
 ni_bool_t
@@ -460,15 +811,23 @@ xml_node_t *
 xml_node_get_next_child(const xml_node_t *top, const char *name, const xml_node_t *cur)
 {
 	xml_node_t *child;
+	unsigned int n = 0;
 
 	if (top == NULL)
 		return NULL;
-	for (child = cur ? cur->next : top->children; child; child = child->next) {
-		if (!strcmp(child->name, name))
-			return child;
+
+	if (!cur && name && top->index && top->index->has_children)
+		return __xml_node_index_first(top->index, name);
+
+	for (child = cur ? cur->next : top->children; child; child = child->next, ++n) {
+		if (ni_string_eq(child->name, name))
+			break;
 	}
 
-	return NULL;
+	/* index the children of nodes we have to scan a lot */
+	if (!cur && name && n >= XML_NODE_INDEX_MIN)
+		__xml_node_index_children((xml_node_t *)top);
+	return child;
 }
 
 inline xml_node_t *
@@ -486,9 +845,9 @@ xml_node_get_child_with_attrs(const xml_node_t *node, const char *name,
 {
 	xml_node_t *child;
 
-	for (child = node->children; child; child = child->next) {
-		if (!strcmp(child->name, name)
-		 && xml_node_match_attrs(child, attrs))
+	for (child = xml_node_get_child(node, name); child;
+	     child = xml_node_get_next_child(node, name, child)) {
+		if (xml_node_match_attrs(child, attrs))
 			return child;
 	}
 	return NULL;
@@ -570,12 +929,19 @@ xml_node_detach(xml_node_t *node)
 	}
 }
 
-void
+/*
+ * Move @child to the end of the children of @parent and return it.
+ * A node from the arena of another document is linked in place, its
+ * arena reference keeps it valid after that document is freed.
+ */
+xml_node_t *
 xml_node_reparent(xml_node_t *parent, xml_node_t *child)
 {
 	if (child->parent)
 		xml_node_detach(child);
+
 	xml_node_add_child(parent, child);
+	return child;
 }
 
 xml_node_t *
@@ -0,0 +1,30 @@
+/*
+ *	XML objects - private declarations
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef NI_WICKED_XML_PRIV_H
+#define NI_WICKED_XML_PRIV_H
+
+#include <wicked/xml.h>
+
+/*
+ * Create an unlinked node in the @arena, or on the heap when NULL;
+ * the caller links it into the children of a node of the arena.
+ */
+extern xml_node_t *	__xml_node_new(const char *ident, struct xml_arena *arena);
+
+#endif /* NI_WICKED_XML_PRIV_H */
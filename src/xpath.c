@@ -30,6 +30,7 @@
 #include <wicked/xml.h>
 #include <wicked/xpath.h>
 #include "util_priv.h"
+#include "hashmap_priv.h"
 
 #include "debug.h"	/* NI_XPATH_DEBUG_LEVEL */
 
@@ -168,23 +169,230 @@ xpath_expression_free(xpath_enode_t *enode)
 }
 
 /*
- * Convenience function: parse XPATH expression, evaluate it once,
+ * Cache of compiled XPATH expressions, keyed by the expression string.
+ *
+ * Policy and schema metadata evaluate the same few expressions over
+ * and over, so parsed expressions are kept in a hash map with a LRU
+ * list to evict the least recently used ones beyond the limit.
+ * The handles are refcounted and remain valid after eviction until
+ * the last user puts them.
+ */
+#define XPATH_CACHE_LIMIT	256
+
+struct xpath_compiled {
+	unsigned int		refcount;
+	unsigned int		hash;
+	xpath_compiled_t *	prev;
+	xpath_compiled_t *	next;
+	ni_bool_t		cached;
+
+	char *			expression;
+	xpath_enode_t *		enode;
+};
+
+static struct xpath_cache {
+	ni_hashmap_t		map;
+	xpath_compiled_t *	head;		/* most recently used	*/
+	xpath_compiled_t *	tail;		/* least recently used	*/
+	xpath_cache_stats_t	stats;
+} xpath_cache = {
+	.map	= NI_HASHMAP_INIT,
+	.stats	= { .limit = XPATH_CACHE_LIMIT },
+};
+
+static void
+xpath_cache_unlink(xpath_compiled_t *xc)
+{
+	if (xc->prev)
+		xc->prev->next = xc->next;
+	else
+		xpath_cache.head = xc->next;
+	if (xc->next)
+		xc->next->prev = xc->prev;
+	else
+		xpath_cache.tail = xc->prev;
+	xc->prev = xc->next = NULL;
+}
+
+static void
+xpath_cache_link_head(xpath_compiled_t *xc)
+{
+	xc->prev = NULL;
+	xc->next = xpath_cache.head;
+	if (xpath_cache.head)
+		xpath_cache.head->prev = xc;
+	else
+		xpath_cache.tail = xc;
+	xpath_cache.head = xc;
+}
+
+static void
+xpath_cache_remove(xpath_compiled_t *xc)
+{
+	xpath_cache_unlink(xc);
+	ni_hashmap_remove(&xpath_cache.map, xc->hash, xc);
+	xpath_cache.stats.count--;
+	xc->cached = FALSE;
+	xpath_compiled_put(xc);
+}
+
+static void
+xpath_cache_shrink(unsigned int limit)
+{
+	while (xpath_cache.tail && xpath_cache.stats.count > limit) {
+		xpath_cache_remove(xpath_cache.tail);
+		xpath_cache.stats.evictions++;
+	}
+}
+
+static xpath_compiled_t *
+xpath_cache_lookup(const char *expr, unsigned int hash)
+{
+	ni_hashmap_entry_t *entry;
+	xpath_compiled_t *xc;
+
+	ni_hashmap_foreach(&xpath_cache.map, hash, entry) {
+		xc = entry->item;
+		if (ni_string_eq(xc->expression, expr))
+			return xc;
+	}
+	return NULL;
+}
+
+/*
+ * Get a reference to the compiled expression, parsing it on cache miss
+ */
+xpath_compiled_t *
+xpath_compiled_get(const char *expr)
+{
+	xpath_enode_t *enode;
+	xpath_compiled_t *xc;
+	unsigned int hash;
+
+	if (!expr)
+		return NULL;
+
+	hash = ni_hashmap_hash_string(expr);
+	if ((xc = xpath_cache_lookup(expr, hash))) {
+		xpath_cache.stats.hits++;
+		if (xpath_cache.head != xc) {
+			xpath_cache_unlink(xc);
+			xpath_cache_link_head(xc);
+		}
+		return xpath_compiled_ref(xc);
+	}
+
+	xpath_cache.stats.misses++;
+	if (!(enode = xpath_expression_parse(expr)))
+		return NULL;
+
+	xc = xcalloc(1, sizeof(*xc));
+	xc->refcount = 1;
+	xc->hash = hash;
+	xc->enode = enode;
+	xc->expression = xstrdup(expr);
+
+	if (xpath_cache.stats.limit) {
+		xpath_cache_shrink(xpath_cache.stats.limit - 1);
+		if (ni_hashmap_insert(&xpath_cache.map, hash, xc)) {
+			xpath_cache_link_head(xc);
+			xpath_cache.stats.count++;
+			xc->cached = TRUE;
+			xpath_compiled_ref(xc);
+		}
+	}
+	return xc;
+}
+
+xpath_compiled_t *
+xpath_compiled_ref(xpath_compiled_t *xc)
+{
+	if (xc) {
+		ni_assert(xc->refcount);
+		xc->refcount++;
+	}
+	return xc;
+}
+
+void
+xpath_compiled_put(xpath_compiled_t *xc)
+{
+	if (!xc)
+		return;
+
+	ni_assert(xc->refcount);
+	if (--xc->refcount)
+		return;
+
+	xpath_expression_free(xc->enode);
+	free(xc->expression);
+	free(xc);
+}
+
+const char *
+xpath_compiled_expression(const xpath_compiled_t *xc)
+{
+	return xc ? xc->expression : NULL;
+}
+
+xpath_result_t *
+xpath_compiled_eval(const xpath_compiled_t *xc, xml_node_t *xn)
+{
+	if (!xc)
+		return NULL;
+	return xpath_expression_eval(xc->enode, xn);
+}
+
+/*
+ * Evaluate an expression string using the cache
+ */
+xpath_result_t *
+xpath_expression_eval_cached(const char *expr, xml_node_t *xn)
+{
+	xpath_compiled_t *xc;
+	xpath_result_t *result;
+
+	if (!(xc = xpath_compiled_get(expr)))
+		return NULL;
+
+	result = xpath_compiled_eval(xc, xn);
+	xpath_compiled_put(xc);
+	return result;
+}
+
+void
+xpath_cache_get_stats(xpath_cache_stats_t *stats)
+{
+	if (stats)
+		*stats = xpath_cache.stats;
+}
+
+void
+xpath_cache_set_limit(unsigned int limit)
+{
+	xpath_cache.stats.limit = limit;
+	xpath_cache_shrink(limit);
+}
+
+void
+xpath_cache_flush(void)
+{
+	while (xpath_cache.head)
+		xpath_cache_remove(xpath_cache.head);
+	ni_hashmap_destroy(&xpath_cache.map);
+}
+
+/*
+ * Convenience function: evaluate (cached) XPATH expression once,
  * and return the resulting string.
  */
 char *
 xml_xpath_eval_string(xml_document_t *doc, xml_node_t *xn, const char *expr)
 {
 	xpath_result_t *xresult;
-	xpath_enode_t *expr_tree;
 	char *result = NULL;
 
-	expr_tree = xpath_expression_parse(expr);
-	if (!expr_tree)
-		return NULL;
-
-	xresult = xpath_expression_eval(expr_tree, xn);
-	xpath_expression_free(expr_tree);
-
+	xresult = xpath_expression_eval_cached(expr, xn);
 	if (!xresult)
 		return NULL;
 	if (xresult->type == XPATH_STRING && xresult->count)
@@ -0,0 +1,720 @@
+/*
+ *	packet capture socket unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Opens DHCP captures on many virtual interfaces using mocked
+ *		packet socket calls and verifies that the captures of src/capture.c
+ *		in shared mode use one socket and get the frames of their ifindex,
+ *		received via recvmsg or an in-memory TPACKET_V3 ring.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <net/if.h>
+#include <net/ethernet.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#ifdef NI_SOCKET_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include <wicked/netinfo.h>
+#include <wicked/socket.h>
+#include "netinfo_priv.h"
+#include "socket_priv.h"
+#include "buffer.h"
+#include "wunit.h"
+
+#define TEST_DEVICES		64
+#define TEST_FIRST_IFINDEX	100
+#define TEST_DHCP_PORT		68
+#define TEST_MAX_FDS		1024
+#define TEST_MAX_FRAMES		(TEST_DEVICES * 4)
+#define TEST_RING_FRAMES	4
+
+/*
+ * Mocked packet socket calls: packet sockets are unix sockets with the
+ * calls on them recorded, recvmsg returns the queued frames of the bound
+ * ifindex (or of any for unbound sockets) and poll reports them readable.
+ * A receive ring is anonymous memory the test fills as the kernel does.
+ */
+typedef struct mock_frame {
+	int		ifindex;
+	size_t		len;
+	unsigned char	data[128];
+} mock_frame_t;
+
+typedef struct mock_ring {
+	unsigned char *	map;
+	unsigned int	block_size;
+	unsigned int	block_nr;
+	unsigned int	block;
+} mock_ring_t;
+
+static struct {
+	ni_bool_t	packet[TEST_MAX_FDS];
+	int		bound[TEST_MAX_FDS];
+	unsigned int	sockets;
+	unsigned int	open;
+	unsigned int	filters;
+	unsigned int	binds;
+	unsigned int	max_poll_fds;
+	unsigned int	polls;
+	unsigned int	recvmsgs;
+	ni_bool_t	mock_poll;
+
+	mock_ring_t	ring[TEST_MAX_FDS];
+	unsigned int	rings;
+	ni_bool_t	ring_fail;
+
+	mock_frame_t	frames[TEST_MAX_FRAMES];
+	unsigned int	queued;
+
+	unsigned int	sent[TEST_DEVICES];
+	unsigned int	sent_fd_mismatch;
+	int		sent_fd;
+} mock;
+
+static struct {
+	ni_capture_t *	capture;
+	unsigned int	received;
+	unsigned int	bad;
+	ni_bool_t	free_on_receive;
+} devices[TEST_DEVICES];
+
+static inline ni_bool_t
+mock_is_packet(int fd)
+{
+	return fd >= 0 && fd < TEST_MAX_FDS && mock.packet[fd];
+}
+
+int
+socket(int domain, int type, int protocol)
+{
+	int fd;
+
+	if (domain != PF_PACKET)
+		return syscall(SYS_socket, domain, type, protocol);
+
+	fd = syscall(SYS_socket, AF_UNIX, SOCK_DGRAM, 0);
+	if (fd >= 0 && fd < TEST_MAX_FDS) {
+		mock.packet[fd] = TRUE;
+		mock.bound[fd] = -1;
+		mock.sockets++;
+		mock.open++;
+	}
+	return fd;
+}
+
+int
+close(int fd)
+{
+	if (mock_is_packet(fd)) {
+		memset(&mock.ring[fd], 0, sizeof(mock.ring[fd]));
+		mock.packet[fd] = FALSE;
+		mock.open--;
+	}
+	return syscall(SYS_close, fd);
+}
+
+int
+bind(int fd, const struct sockaddr *sa, socklen_t len)
+{
+	if (!mock_is_packet(fd))
+		return syscall(SYS_bind, fd, sa, len);
+
+	mock.bound[fd] = ((const struct sockaddr_ll *)sa)->sll_ifindex;
+	mock.binds++;
+	return 0;
+}
+
+int
+setsockopt(int fd, int level, int name, const void *val, socklen_t len)
+{
+	if (!mock_is_packet(fd))
+		return syscall(SYS_setsockopt, fd, level, name, val, len);
+
+	if (level == SOL_SOCKET && name == SO_ATTACH_FILTER)
+		mock.filters++;
+
+	if (level == SOL_PACKET && name == PACKET_RX_RING) {
+		const struct tpacket_req3 *req = val;
+
+		if (mock.ring_fail) {
+			errno = EINVAL;
+			return -1;
+		}
+		mock.ring[fd].block_size = req->tp_block_size;
+		mock.ring[fd].block_nr = req->tp_block_nr;
+	}
+	return 0;
+}
+
+void *
+mmap(void *addr, size_t len, int prot, int flags, int fd, off_t off)
+{
+	mock_ring_t *ring;
+
+	if (!mock_is_packet(fd))
+		return (void *)syscall(SYS_mmap, addr, len, prot, flags, fd, off);
+
+	ring = &mock.ring[fd];
+	if (!ring->block_nr || len != (size_t)ring->block_size * ring->block_nr) {
+		errno = EINVAL;
+		return MAP_FAILED;
+	}
+	ring->map = (void *)syscall(SYS_mmap, NULL, len, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	mock.rings++;
+	return ring->map;
+}
+
+static inline struct tpacket_block_desc *
+mock_ring_block(const mock_ring_t *ring, unsigned int block)
+{
+	return (struct tpacket_block_desc *)(ring->map + block * ring->block_size);
+}
+
+/* the number of blocks handed to the user and not released */
+static unsigned int
+mock_ring_user_blocks(int fd)
+{
+	const mock_ring_t *ring = &mock.ring[fd];
+	unsigned int i, blocks = 0;
+
+	for (i = 0; ring->map && i < ring->block_nr; ++i) {
+		if (mock_ring_block(ring, i)->hdr.bh1.block_status & TP_STATUS_USER)
+			blocks++;
+	}
+	return blocks;
+}
+
+/* the first queued frame for a socket bound to ifindex or to all */
+static mock_frame_t *
+mock_next_frame(int fd)
+{
+	unsigned int i;
+
+	for (i = 0; i < mock.queued; ++i) {
+		if (mock.bound[fd] == 0 || mock.bound[fd] == mock.frames[i].ifindex)
+			return &mock.frames[i];
+	}
+	return NULL;
+}
+
+ssize_t
+recvmsg(int fd, struct msghdr *msg, int flags)
+{
+	struct sockaddr_ll *sll = msg->msg_name;
+	mock_frame_t *frame;
+	size_t len;
+
+	if (!mock_is_packet(fd))
+		return syscall(SYS_recvmsg, fd, msg, flags);
+
+	mock.recvmsgs++;
+	if (!(frame = mock_next_frame(fd))) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (sll && msg->msg_namelen >= sizeof(*sll)) {
+		memset(sll, 0, sizeof(*sll));
+		sll->sll_family = AF_PACKET;
+		sll->sll_protocol = htons(ETHERTYPE_IP);
+		sll->sll_ifindex = frame->ifindex;
+		msg->msg_namelen = sizeof(*sll);
+	}
+	msg->msg_controllen = 0;
+	msg->msg_flags = 0;
+
+	len = frame->len;
+	if (len > msg->msg_iov[0].iov_len)
+		len = msg->msg_iov[0].iov_len;
+	memcpy(msg->msg_iov[0].iov_base, frame->data, len);
+
+	mock.queued--;
+	memmove(frame, frame + 1, (&mock.frames[mock.queued] - frame) * sizeof(*frame));
+	return len;
+}
+
+ssize_t
+sendto(int fd, const void *buf, size_t len, int flags,
+		const struct sockaddr *sa, socklen_t salen)
+{
+	int n;
+
+	if (!mock_is_packet(fd))
+		return syscall(SYS_sendto, fd, buf, len, flags, sa, salen);
+
+	n = ((const struct sockaddr_ll *)sa)->sll_ifindex - TEST_FIRST_IFINDEX;
+	if (n >= 0 && n < TEST_DEVICES)
+		mock.sent[n]++;
+	if (mock.sent_fd >= 0 && fd != mock.sent_fd)
+		mock.sent_fd_mismatch++;
+	return len;
+}
+
+int
+poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	int ready = 0;
+	nfds_t i;
+
+	if (!mock.mock_poll)
+		return syscall(SYS_poll, fds, nfds, timeout);
+
+	if (nfds > mock.max_poll_fds)
+		mock.max_poll_fds = nfds;
+	mock.polls++;
+
+	for (i = 0; i < nfds; ++i) {
+		fds[i].revents = 0;
+		if (mock_is_packet(fds[i].fd) && (mock_next_frame(fds[i].fd) ||
+					mock_ring_user_blocks(fds[i].fd))) {
+			fds[i].revents = fds[i].events & POLLIN;
+			ready++;
+		}
+	}
+	return ready;
+}
+
+#ifdef NI_SOCKET_EPOLL
+int
+epoll_create1(int flags)
+{
+	/* use the poll backend to count the watched sockets */
+	errno = ENOSYS;
+	return -1;
+}
+#endif
+
+static size_t
+build_frame(int ifindex, unsigned char *data, size_t size)
+{
+	struct in_addr any = { .s_addr = INADDR_ANY };
+	ni_buffer_t buf;
+	size_t len;
+
+	/* the frame payload is the ifindex it is sent to */
+	ni_buffer_init(&buf, data, size);
+	ni_buffer_reserve_head(&buf, 28);
+	ni_buffer_put(&buf, &ifindex, sizeof(ifindex));
+	ni_capture_build_udp_header(&buf, any, 67, any, TEST_DHCP_PORT);
+	len = ni_buffer_count(&buf);
+	memmove(data, ni_buffer_head(&buf), len);
+	return len;
+}
+
+static void
+queue_frame(int ifindex)
+{
+	mock_frame_t *frame;
+
+	ni_assert(mock.queued < TEST_MAX_FRAMES);
+	frame = &mock.frames[mock.queued++];
+	frame->ifindex = ifindex;
+	frame->len = build_frame(ifindex, frame->data, sizeof(frame->data));
+}
+
+/*
+ * Fill the next block of the ring with frames and retire it to the
+ * user as the kernel does, unless the user did not release it yet.
+ */
+static ni_bool_t
+ring_fill_block(int fd, const int *ifindex, unsigned int count)
+{
+	mock_ring_t *ring = &mock.ring[fd];
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *hdr = NULL;
+	struct sockaddr_ll *sll;
+	unsigned int i, offset;
+
+	bd = mock_ring_block(ring, ring->block);
+	if (bd->hdr.bh1.block_status != TP_STATUS_KERNEL)
+		return FALSE;
+
+	memset(bd, 0, ring->block_size);
+	bd->version = TPACKET_V3;
+	offset = TPACKET_ALIGN(sizeof(*bd));
+	bd->hdr.bh1.offset_to_first_pkt = offset;
+
+	for (i = 0; i < count; ++i) {
+		if (hdr)
+			hdr->tp_next_offset = offset - ((unsigned char *)hdr - (unsigned char *)bd);
+		hdr = (struct tpacket3_hdr *)((unsigned char *)bd + offset);
+
+		sll = (struct sockaddr_ll *)((unsigned char *)hdr + TPACKET_ALIGN(sizeof(*hdr)));
+		sll->sll_family = AF_PACKET;
+		sll->sll_protocol = htons(ETHERTYPE_IP);
+		sll->sll_ifindex = ifindex[i];
+
+		hdr->tp_mac = hdr->tp_net = TPACKET_ALIGN(TPACKET3_HDRLEN);
+		hdr->tp_snaplen = hdr->tp_len = build_frame(ifindex[i],
+				(unsigned char *)hdr + hdr->tp_net, 128);
+		hdr->tp_status = TP_STATUS_USER;
+		offset += TPACKET_ALIGN(hdr->tp_net + hdr->tp_snaplen);
+		bd->hdr.bh1.num_pkts++;
+	}
+	bd->hdr.bh1.blk_len = offset;
+	bd->hdr.bh1.block_status = TP_STATUS_USER;
+
+	ring->block = (ring->block + 1) % ring->block_nr;
+	return TRUE;
+}
+
+/* the fd of the first packet socket with a ring */
+static int
+ring_fd(void)
+{
+	int fd;
+
+	for (fd = 0; fd < TEST_MAX_FDS; ++fd) {
+		if (mock.packet[fd] && mock.ring[fd].map)
+			return fd;
+	}
+	return -1;
+}
+
+static unsigned int
+ring_user_blocks(void)
+{
+	unsigned int fd, blocks = 0;
+
+	for (fd = 0; fd < TEST_MAX_FDS; ++fd) {
+		if (mock.packet[fd])
+			blocks += mock_ring_user_blocks(fd);
+	}
+	return blocks;
+}
+
+static void
+process_frames(void)
+{
+	unsigned int loops = 0;
+
+	mock.mock_poll = TRUE;
+	while ((mock.queued || ring_user_blocks()) && ni_socket_wait(0) == 0 &&
+			++loops < TEST_MAX_FRAMES * 2)
+		;
+	mock.mock_poll = FALSE;
+}
+
+static void
+capture_receive(ni_socket_t *sock)
+{
+	ni_capture_t *capture = sock->user_data;
+	ni_sockaddr_t from;
+	ni_buffer_t buf;
+	unsigned int n;
+	int ifindex;
+
+	n = (unsigned long)ni_capture_get_user_data(capture);
+	if (ni_capture_recv(capture, &buf, &from) < 0 ||
+	    ni_buffer_get(&buf, &ifindex, sizeof(ifindex)) < 0 ||
+	    ifindex != TEST_FIRST_IFINDEX + (int)n ||
+	    ((struct sockaddr_ll *)&from.ss)->sll_ifindex != ifindex)
+		devices[n].bad++;
+	devices[n].received++;
+
+	if (devices[n].free_on_receive) {
+		/* the next device is freed before its frame is dispatched */
+		if (n + 1 < TEST_DEVICES && devices[n + 1].capture) {
+			ni_capture_free(devices[n + 1].capture);
+			devices[n + 1].capture = NULL;
+		}
+		ni_capture_free(capture);
+		devices[n].capture = NULL;
+	}
+}
+
+static unsigned int
+open_captures(unsigned int count, ni_bool_t shared, ni_bool_t ring)
+{
+	ni_capture_devinfo_t devinfo;
+	ni_capture_protinfo_t protinfo;
+	char ifname[IFNAMSIZ];
+	unsigned int n, opened = 0;
+
+	memset(&protinfo, 0, sizeof(protinfo));
+	protinfo.eth_protocol = ETHERTYPE_IP;
+	protinfo.ip_protocol = IPPROTO_UDP;
+	protinfo.ip_port = TEST_DHCP_PORT;
+	protinfo.shared = shared;
+	protinfo.ring = ring;
+
+	for (n = 0; n < count; ++n) {
+		memset(&devinfo, 0, sizeof(devinfo));
+		snprintf(ifname, sizeof(ifname), "vlan%u", n);
+		devinfo.ifname = ifname;
+		devinfo.ifindex = TEST_FIRST_IFINDEX + n;
+		devinfo.hwaddr.type = ARPHRD_ETHER;
+		devinfo.mtu = 1500 + n;
+
+		memset(&devices[n], 0, sizeof(devices[n]));
+		devices[n].capture = ni_capture_open(&devinfo, &protinfo, capture_receive, "dhcp4");
+		if (devices[n].capture) {
+			ni_capture_set_user_data(devices[n].capture, (void *)(unsigned long)n);
+			opened++;
+		}
+	}
+	return opened;
+}
+
+static void
+free_captures(void)
+{
+	unsigned int n;
+
+	for (n = 0; n < TEST_DEVICES; ++n) {
+		ni_capture_free(devices[n].capture);
+		devices[n].capture = NULL;
+	}
+}
+
+/* returns the number of devices not receiving exactly @expected frames */
+static unsigned int
+check_received(unsigned int count, unsigned int expected)
+{
+	unsigned int n, failed = 0;
+
+	for (n = 0; n < count; ++n) {
+		if (devices[n].received != expected || devices[n].bad)
+			failed++;
+	}
+	return failed;
+}
+
+TESTCASE(capture_shared_open)
+{
+	memset(&mock, 0, sizeof(mock));
+
+	CHECK2(open_captures(TEST_DEVICES, TRUE, FALSE) == TEST_DEVICES,
+			"opened %u shared captures", TEST_DEVICES);
+	CHECK2(mock.sockets == 1 && mock.filters == 1 && mock.binds == 1,
+			"%u sockets, %u filters, %u binds",
+			mock.sockets, mock.filters, mock.binds);
+	CHECK(ni_capture_is_valid(devices[0].capture, ETHERTYPE_IP));
+}
+
+TESTCASE(capture_shared_dispatch)
+{
+	unsigned int n;
+
+	/* interleaved with frames of interfaces without a capture */
+	for (n = 0; n < TEST_DEVICES; ++n) {
+		queue_frame(TEST_FIRST_IFINDEX + TEST_DEVICES - 1 - n);
+		if (n % 8 == 0)
+			queue_frame(TEST_FIRST_IFINDEX + TEST_DEVICES + n);
+	}
+	process_frames();
+
+	CHECK2(mock.queued == 0, "%u frames left", mock.queued);
+	CHECK2(check_received(TEST_DEVICES, 1) == 0, "%u devices received their frame", TEST_DEVICES);
+	CHECK2(mock.max_poll_fds == 1, "%u polled sockets", mock.max_poll_fds);
+}
+
+TESTCASE(capture_shared_send)
+{
+	ni_timeout_param_t tmo;
+	static unsigned char data[64];
+	static ni_buffer_t buf;
+	unsigned int n, failed = 0;
+
+	memset(&tmo, 0, sizeof(tmo));
+	tmo.nretries = 1;
+	tmo.timeout = 60000;
+	ni_buffer_init_reader(&buf, data, sizeof(data));
+
+	mock.sent_fd = -1;
+	for (n = 0; n < TEST_MAX_FDS && mock.sent_fd < 0; ++n) {
+		if (mock.packet[n])
+			mock.sent_fd = n;
+	}
+
+	for (n = 0; n < TEST_DEVICES; ++n)
+		ni_capture_send(devices[n].capture, &buf, n % 2 ? &tmo : NULL);
+	for (n = 0; n < TEST_DEVICES; ++n)
+		failed += mock.sent[n] != 1;
+	CHECK2(failed == 0 && !mock.sent_fd_mismatch, "sent via the shared socket");
+
+	/* the odd devices retransmit once via the shared socket timer */
+	for (n = 1; n < TEST_DEVICES; n += 2)
+		ni_capture_force_retransmit(devices[n].capture, 0);
+	usleep(1000);
+	ni_timer_next_timeout();
+
+	for (n = failed = 0; n < TEST_DEVICES; ++n)
+		failed += mock.sent[n] != (n % 2 ? 2U : 1U);
+	CHECK2(failed == 0, "%u retransmits", TEST_DEVICES / 2);
+
+	for (n = 0; n < TEST_DEVICES; ++n)
+		ni_capture_disarm_retransmit(devices[n].capture);
+}
+
+TESTCASE(capture_shared_free)
+{
+	unsigned int n, freed = 0;
+
+	/* freed in a receive callback: the own and the next capture */
+	for (n = 0; n < TEST_DEVICES; ++n)
+		devices[n].received = 0;
+	devices[10].free_on_receive = TRUE;
+	queue_frame(TEST_FIRST_IFINDEX + 10);
+	queue_frame(TEST_FIRST_IFINDEX + 11);
+	queue_frame(TEST_FIRST_IFINDEX + 12);
+	process_frames();
+
+	CHECK(devices[10].received == 1 && devices[11].received == 0);
+	CHECK(devices[12].received == 1 && !devices[12].bad);
+	CHECK(!devices[10].capture && !devices[11].capture);
+
+	/* the socket is closed with the last capture */
+	for (n = 0; n < TEST_DEVICES; ++n) {
+		if (devices[n].capture && n != 12) {
+			ni_capture_free(devices[n].capture);
+			devices[n].capture = NULL;
+			freed++;
+		}
+	}
+	CHECK2(mock.open == 1, "%u captures freed", freed);
+	free_captures();
+	CHECK2(mock.open == 0, "%u sockets open", mock.open);
+}
+
+TESTCASE(capture_dedicated)
+{
+	unsigned int n;
+
+	memset(&mock, 0, sizeof(mock));
+	CHECK(open_captures(TEST_DEVICES / 8, FALSE, FALSE) == TEST_DEVICES / 8);
+	CHECK2(mock.sockets == TEST_DEVICES / 8 && mock.filters == TEST_DEVICES / 8,
+			"%u sockets, %u filters", mock.sockets, mock.filters);
+
+	for (n = 0; n < TEST_DEVICES / 8; ++n)
+		queue_frame(TEST_FIRST_IFINDEX + n);
+	process_frames();
+
+	CHECK(check_received(TEST_DEVICES / 8, 1) == 0);
+	CHECK2(mock.max_poll_fds == TEST_DEVICES / 8, "%u polled sockets", mock.max_poll_fds);
+
+	free_captures();
+	CHECK2(mock.open == 0, "%u sockets open", mock.open);
+}
+
+TESTCASE(capture_ring_shared)
+{
+	int ifindex[TEST_RING_FRAMES + 1];
+	unsigned int b, i, n = 0, filled = 0;
+	int fd;
+
+	memset(&mock, 0, sizeof(mock));
+	CHECK(open_captures(TEST_DEVICES, TRUE, TRUE) == TEST_DEVICES);
+	CHECK2(mock.sockets == 1 && mock.rings == 1, "%u sockets, %u rings",
+			mock.sockets, mock.rings);
+	CHECK((fd = ring_fd()) >= 0);
+
+	/* more blocks than the ring has, wrapping around after release */
+	for (b = 0; b < mock.ring[fd].block_nr * 3 / 2; ++b) {
+		if (b == mock.ring[fd].block_nr)
+			process_frames();
+		for (i = 0; i < TEST_RING_FRAMES; ++i, ++n)
+			ifindex[i] = TEST_FIRST_IFINDEX + n % TEST_DEVICES;
+		/* plus a frame for a device without capture */
+		ifindex[i] = TEST_FIRST_IFINDEX + TEST_DEVICES + b;
+		filled += ring_fill_block(fd, ifindex, TEST_RING_FRAMES + 1);
+	}
+	process_frames();
+
+	CHECK2(filled == b && ring_user_blocks() == 0, "%u blocks released", filled);
+	CHECK2(check_received(TEST_DEVICES, n / TEST_DEVICES) == 0,
+			"%u frames received in place", n);
+	CHECK2(mock.recvmsgs == 0 && mock.polls == 2, "%u recvmsg, %u polls",
+			mock.recvmsgs, mock.polls);
+
+	free_captures();
+	CHECK2(mock.open == 0, "%u sockets open", mock.open);
+}
+
+TESTCASE(capture_ring_dedicated)
+{
+	int ifindex[2];
+	unsigned int n, count = TEST_DEVICES / 8, failed = 0;
+	int fd;
+
+	memset(&mock, 0, sizeof(mock));
+	CHECK(open_captures(count, FALSE, TRUE) == count);
+	CHECK2(mock.sockets == count && mock.rings == count, "%u sockets, %u rings",
+			mock.sockets, mock.rings);
+
+	/* two frames per device, the third frees itself and the fourth */
+	for (fd = 0; fd < TEST_MAX_FDS; ++fd) {
+		if (!mock.packet[fd] || !mock.ring[fd].map)
+			continue;
+		ifindex[0] = ifindex[1] = mock.bound[fd];
+		ring_fill_block(fd, ifindex, 2);
+	}
+	devices[3].free_on_receive = TRUE;
+	process_frames();
+
+	for (n = 0; n < count; ++n) {
+		if (devices[n].received != (n == 3 ? 1 : n == 4 ? 0 : 2) || devices[n].bad)
+			failed++;
+	}
+	CHECK2(failed == 0, "freed in the callback");
+	CHECK2(mock.recvmsgs == 0 && mock.polls == 1, "%u recvmsg, %u polls",
+			mock.recvmsgs, mock.polls);
+	CHECK(ring_user_blocks() == 0);
+
+	free_captures();
+	CHECK2(mock.open == 0, "%u sockets open", mock.open);
+}
+
+TESTCASE(capture_ring_fallback)
+{
+	unsigned int n;
+
+	memset(&mock, 0, sizeof(mock));
+	mock.ring_fail = TRUE;
+	CHECK(open_captures(TEST_DEVICES, TRUE, TRUE) == TEST_DEVICES);
+	CHECK2(mock.sockets == 1 && mock.rings == 0, "%u sockets, %u rings",
+			mock.sockets, mock.rings);
+
+	for (n = 0; n < TEST_DEVICES; ++n)
+		queue_frame(TEST_FIRST_IFINDEX + n);
+	process_frames();
+
+	CHECK(check_received(TEST_DEVICES, 1) == 0);
+	CHECK2(mock.recvmsgs == TEST_DEVICES, "%u recvmsg", mock.recvmsgs);
+
+	free_captures();
+	CHECK2(mock.open == 0, "%u sockets open", mock.open);
+}
+
+TESTMAIN();
@@ -0,0 +1,172 @@
+/*
+ *	dbus dict key lookup unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Compares the indexed dict lookups in src/dbus-common.c
+ *		against a linear scan, using dicts shaped like the
+ *		ethtool features dicts of network devices.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/util.h>
+#include <wicked/dbus.h>
+#include <wicked/time.h>
+#include "dbus-common.h"
+#include "wunit.h"
+
+#define TEST_DEVICES		2000
+
+static const char *		feature_names[] = {
+	"rx-checksum", "tx-checksum-ipv4", "tx-checksum-ip-generic",
+	"tx-checksum-ipv6", "tx-checksum-fcoe-crc", "tx-checksum-sctp",
+	"tx-scatter-gather", "tx-scatter-gather-fraglist",
+	"tx-tcp-segmentation", "tx-tcp-ecn-segmentation",
+	"tx-tcp-mangleid-segmentation", "tx-tcp6-segmentation",
+	"generic-segmentation-offload", "generic-receive-offload",
+	"large-receive-offload", "rx-vlan-offload", "tx-vlan-offload",
+	"ntuple-filters", "receive-hashing", "highdma",
+	"rx-vlan-filter", "vlan-challenged", "tx-lockless",
+	"netns-local", "tx-gso-robust", "tx-fcoe-segmentation",
+	"tx-gre-segmentation", "tx-gre-csum-segmentation",
+	"tx-ipxip4-segmentation", "tx-ipxip6-segmentation",
+	"tx-udp_tnl-segmentation", "tx-udp_tnl-csum-segmentation",
+	"tx-gso-partial", "tx-tunnel-remcsum-segmentation",
+	"tx-sctp-segmentation", "tx-esp-segmentation",
+	"tx-udp-segmentation", "tx-gso-list", "fcoe-mtu",
+	"tx-nocache-copy", "loopback", "rx-fcs", "rx-all",
+	"tx-vlan-stag-hw-insert", "rx-vlan-stag-hw-parse",
+	"rx-vlan-stag-filter", "l2-fwd-offload", "hw-tc-offload",
+	"esp-hw-offload", "esp-tx-csum-hw-offload",
+	"rx-udp_tunnel-port-offload", "tls-hw-tx-offload",
+	"tls-hw-rx-offload", "rx-gro-hw", "tls-hw-record",
+	"rx-gro-list", "macsec-hw-offload", "rx-udp-gro-forwarding",
+	"hsr-tag-ins-offload", "hsr-tag-rm-offload",
+	"hsr-fwd-offload", "hsr-dup-offload",
+};
+
+#define TEST_FEATURES	(sizeof(feature_names) / sizeof(feature_names[0]))
+
+static ni_dbus_variant_t	devices[TEST_DEVICES];
+
+static ni_dbus_variant_t *
+linear_get(const ni_dbus_variant_t *dict, const char *key)
+{
+	unsigned int i;
+
+	for (i = 0; i < dict->array.len; ++i) {
+		if (ni_string_eq(dict->dict_array_value[i].key, key))
+			return &dict->dict_array_value[i].datum;
+	}
+	return NULL;
+}
+
+/*
+ * Look up every feature of every device as the ethtool
+ * property setters do; returns the number of enabled ones.
+ */
+static unsigned int
+lookup_all(ni_dbus_variant_t *(*get)(const ni_dbus_variant_t *, const char *),
+		unsigned long long *msec)
+{
+	struct timeval beg, end;
+	ni_dbus_variant_t *var;
+	unsigned int d, f, enabled = 0;
+
+	ni_timer_get_time(&beg);
+	for (d = 0; d < TEST_DEVICES; ++d) {
+		for (f = 0; f < TEST_FEATURES; ++f) {
+			if ((var = get(&devices[d], feature_names[f])) && var->bool_value)
+				enabled++;
+		}
+		if (get(&devices[d], "unknown-feature"))
+			enabled++;
+	}
+	ni_timer_get_time(&end);
+	*msec = ni_timeout_since(&beg, &end, NULL);
+	return enabled;
+}
+
+TESTCASE(dbus_dict_setup)
+{
+	unsigned int d, f;
+
+	for (d = 0; d < TEST_DEVICES; ++d) {
+		ni_dbus_variant_init_dict(&devices[d]);
+		for (f = 0; f < TEST_FEATURES; ++f)
+			ni_dbus_dict_add_bool(&devices[d], feature_names[f], (d + f) % 3 == 0);
+	}
+	CHECK2(devices[0].array.len == TEST_FEATURES, "%u dicts with %u features",
+			TEST_DEVICES, (unsigned int)TEST_FEATURES);
+}
+
+TESTCASE(dbus_dict_lookup)
+{
+	unsigned long long cold, indexed, linear;
+	unsigned int a, b, c;
+
+	/* the first lookups build the indexes */
+	a = lookup_all(ni_dbus_dict_get, &cold);
+	b = lookup_all(ni_dbus_dict_get, &indexed);
+	c = lookup_all(linear_get, &linear);
+	CHECK2(a == c && b == c, "indexed %llu msec, cold %llu msec, linear %llu msec",
+			indexed, cold, linear);
+}
+
+TESTCASE(dbus_dict_update)
+{
+	ni_dbus_variant_t *dict = &devices[0];
+	ni_dbus_variant_t *var;
+	dbus_bool_t value;
+
+	/* entries added after the first lookup are found */
+	CHECK(ni_dbus_dict_get(dict, "rx-checksum") != NULL);
+	CHECK(ni_dbus_dict_add_uint32(dict, "mtu", 9000));
+	CHECK((var = ni_dbus_dict_get(dict, "mtu")) && var->uint32_value == 9000);
+
+	/* the first of duplicate keys is returned */
+	CHECK(ni_dbus_dict_add_bool(dict, "rx-checksum", FALSE));
+	var = ni_dbus_dict_get(dict, "rx-checksum");
+	CHECK(var != NULL && var == linear_get(dict, "rx-checksum"));
+	CHECK(ni_dbus_dict_get_next(dict, "rx-checksum", NULL) == var);
+	CHECK((var = ni_dbus_dict_get_next(dict, "rx-checksum", var)) != NULL &&
+		var == &dict->dict_array_value[dict->array.len - 1].datum);
+
+	/* deleted entries are not found, the following ones are */
+	CHECK(ni_dbus_dict_delete_entry(dict, "rx-checksum"));
+	CHECK(ni_dbus_dict_get_bool(dict, "rx-checksum", &value) && value == FALSE);
+	CHECK(ni_dbus_dict_delete_entry(dict, "rx-checksum"));
+	CHECK(ni_dbus_dict_get(dict, "rx-checksum") == NULL);
+	CHECK((var = ni_dbus_dict_get(dict, "hsr-dup-offload")) &&
+		var == linear_get(dict, "hsr-dup-offload"));
+	CHECK((var = ni_dbus_dict_get(dict, "mtu")) && var->uint32_value == 9000);
+}
+
+TESTCASE(dbus_dict_cleanup)
+{
+	unsigned int d;
+
+	for (d = 0; d < TEST_DEVICES; ++d)
+		ni_dbus_variant_destroy(&devices[d]);
+}
+
+TESTMAIN();
@@ -0,0 +1,157 @@
+/*
+ *	dbus object tree unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Creates, looks up and deletes thousands of interface objects
+ *		in the object tree of src/dbus-object.c and verifies that the
+ *		children keep their creation order.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/util.h>
+#include <wicked/dbus.h>
+#include <wicked/time.h>
+#include "wunit.h"
+
+#define TEST_OBJECTS		5000
+#define TEST_ROOT_PATH		"/org/opensuse/Network"
+#define TEST_LIST_PATH		TEST_ROOT_PATH "/Interface"
+
+static ni_dbus_object_t *	root;
+
+static const char *
+object_path(unsigned int n)
+{
+	static char path[128];
+
+	snprintf(path, sizeof(path), TEST_LIST_PATH "/%u", n);
+	return path;
+}
+
+/* returns the number of children not in ascending order */
+static unsigned int
+unordered_children(const ni_dbus_object_t *list, unsigned int *count)
+{
+	const ni_dbus_object_t *child, *prev = NULL;
+	unsigned int unordered = 0;
+
+	*count = 0;
+	for (child = list->children; child; prev = child, child = child->next) {
+		if (prev && strtoul(prev->name, NULL, 10) >= strtoul(child->name, NULL, 10))
+			unordered++;
+		(*count)++;
+	}
+	return unordered;
+}
+
+TESTCASE(dbus_object_create)
+{
+	struct timeval beg, end;
+	unsigned int n, count, unordered, failed = 0;
+	ni_dbus_object_t *list;
+
+	root = ni_dbus_object_new(&ni_dbus_anonymous_class, TEST_ROOT_PATH, NULL);
+	CHECK(root != NULL);
+
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_OBJECTS; ++n) {
+		if (!ni_dbus_object_create(root, object_path(n), NULL, NULL))
+			failed++;
+	}
+	ni_timer_get_time(&end);
+
+	CHECK((list = ni_dbus_object_lookup(root, TEST_LIST_PATH)) != NULL);
+	unordered = unordered_children(list, &count);
+	CHECK2(failed == 0 && !unordered && count == TEST_OBJECTS,
+			"created %u objects in %llu msec", count,
+			ni_timeout_since(&beg, &end, NULL));
+
+	/* creating an existing path returns the object */
+	CHECK(ni_dbus_object_create(root, object_path(7), NULL, NULL) ==
+		ni_dbus_object_lookup(root, object_path(7)));
+}
+
+TESTCASE(dbus_object_lookup)
+{
+	struct timeval beg, end;
+	ni_dbus_object_t *object;
+	unsigned int n, failed = 0;
+
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_OBJECTS * 2; ++n) {
+		object = ni_dbus_object_lookup(root, object_path(n));
+		if (n < TEST_OBJECTS ? !object || !ni_string_eq(object->path, object_path(n)) : !!object)
+			failed++;
+	}
+	ni_timer_get_time(&end);
+
+	CHECK2(failed == 0, "%u lookups in %llu msec", TEST_OBJECTS * 2,
+			ni_timeout_since(&beg, &end, NULL));
+	CHECK(ni_dbus_object_lookup(root, TEST_ROOT_PATH) == root);
+	CHECK(ni_dbus_object_lookup(root, "/org/opensuse/Other") == NULL);
+}
+
+TESTCASE(dbus_object_delete)
+{
+	ni_dbus_object_t *list, *object;
+	unsigned int n, count, failed = 0;
+
+	list = ni_dbus_object_lookup(root, TEST_LIST_PATH);
+
+	/* delete the first, every third and the last object */
+	for (n = 0; n < TEST_OBJECTS; n += 3) {
+		if ((object = ni_dbus_object_lookup(root, object_path(n))))
+			ni_dbus_object_free(object);
+	}
+	ni_dbus_object_free(ni_dbus_object_lookup(root, object_path(TEST_OBJECTS - 1)));
+	ni_dbus_objects_garbage_collect();
+
+	for (n = 0; n < TEST_OBJECTS; ++n) {
+		object = ni_dbus_object_lookup(root, object_path(n));
+		if ((n % 3 == 0 || n == TEST_OBJECTS - 1) ? !!object : !object)
+			failed++;
+	}
+	CHECK2(failed == 0, "deleted objects not found");
+	CHECK(!unordered_children(list, &count));
+	CHECK2(count == TEST_OBJECTS - (TEST_OBJECTS + 2) / 3 - 1, "%u objects left", count);
+
+	/* new objects are appended after the remaining tail */
+	CHECK((object = ni_dbus_object_create(root, object_path(TEST_OBJECTS), NULL, NULL)));
+	CHECK(object->next == NULL && !unordered_children(list, &count));
+	CHECK(ni_dbus_object_lookup(root, object_path(TEST_OBJECTS)) == object);
+
+	/* all children deleted, appending starts at the head */
+	while ((object = list->children) != NULL)
+		ni_dbus_object_free(object);
+	ni_dbus_objects_garbage_collect();
+	CHECK((object = ni_dbus_object_create(root, object_path(1), NULL, NULL)));
+	CHECK(list->children == object && object->next == NULL);
+}
+
+TESTCASE(dbus_object_cleanup)
+{
+	ni_dbus_object_free(root);
+	root = NULL;
+}
+
+TESTMAIN();
@@ -0,0 +1,250 @@
+/*
+ *	dbus server GetManagedObjects property cache tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Enumerates synthetic netif objects of a dbus server using
+ *		mocked bus connection calls and checks the property cache
+ *		in src/dbus-server.c
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <net/if.h>
+#include <dbus/dbus.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/objectmodel.h>
+#include <wicked/dbus.h>
+#include <wicked/dbus-service.h>
+#include <wicked/time.h>
+#include "dbus-server.h"
+#include "appconfig.h"
+#include "wunit.h"
+
+#ifndef TEST_SCHEMA_FILE
+#define TEST_SCHEMA_FILE	"../schema/wicked.xml"
+#endif
+
+#define TEST_NETIF_COUNT	2000
+
+static struct {
+	unsigned int		registered;
+	unsigned int		signals;
+	unsigned int		invalidated;
+	ni_bool_t		addresses;
+} mock;
+
+/*
+ * Mocked bus connection: objects are enumerated by calling the
+ * GetManagedObjects handler directly.
+ */
+ni_dbus_connection_t *
+ni_dbus_connection_open(const char *bus_type, const char *bus_name)
+{
+	static char connection;
+
+	return (ni_dbus_connection_t *)&connection;
+}
+
+void
+ni_dbus_connection_free(ni_dbus_connection_t *connection)
+{
+}
+
+void
+ni_dbus_connection_register_object(ni_dbus_connection_t *connection, ni_dbus_object_t *object)
+{
+	mock.registered++;
+}
+
+void
+ni_dbus_connection_unregister_object(ni_dbus_connection_t *connection, ni_dbus_object_t *object)
+{
+	mock.registered--;
+}
+
+/* records the property names a PropertiesChanged signal invalidates */
+int
+ni_dbus_connection_send_message(ni_dbus_connection_t *connection, ni_dbus_message_t *msg)
+{
+	DBusMessageIter iter, names;
+	const char *name;
+
+	mock.signals++;
+	if (!dbus_message_is_signal(msg, NI_DBUS_INTERFACE ".Properties", "PropertiesChanged"))
+		return 0;
+
+	dbus_message_iter_init(msg, &iter);
+	if (!dbus_message_iter_next(&iter) || !dbus_message_iter_next(&iter) ||
+	    dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY)
+		return 0;
+
+	dbus_message_iter_recurse(&iter, &names);
+	while (dbus_message_iter_get_arg_type(&names) == DBUS_TYPE_STRING) {
+		dbus_message_iter_get_basic(&names, &name);
+		if (ni_string_eq(name, "addresses"))
+			mock.addresses = TRUE;
+		mock.invalidated++;
+		dbus_message_iter_next(&names);
+	}
+	return 0;
+}
+
+static ni_dbus_server_t *	server;
+static ni_netdev_t *		devs[TEST_NETIF_COUNT];
+
+/*
+ * Call GetManagedObjects and return the marshalled reply
+ */
+static ni_bool_t
+get_managed_objects(char **data, int *len, ni_timeout_t *msec)
+{
+	const ni_dbus_service_t *service;
+	const ni_dbus_method_t *method;
+	DBusError error = DBUS_ERROR_INIT;
+	DBusMessage *call, *reply;
+	struct timeval beg, end;
+	ni_bool_t rv;
+
+	service = ni_dbus_get_standard_service(NI_DBUS_INTERFACE ".ObjectManager");
+	method = ni_dbus_service_get_method(service, "GetManagedObjects");
+
+	call = dbus_message_new_method_call(NI_OBJECTMODEL_DBUS_BUS_NAME,
+			NI_OBJECTMODEL_OBJECT_PATH, service->name, method->name);
+	dbus_message_set_serial(call, 1);
+	reply = dbus_message_new_method_return(call);
+
+	ni_timer_get_time(&beg);
+	rv = method->handler(ni_dbus_server_get_root_object(server), method,
+			0, NULL, reply, &error);
+	ni_timer_get_time(&end);
+	*msec = ni_timeout_since(&beg, &end, NULL);
+
+	if (rv)
+		rv = dbus_message_marshal(reply, data, len);
+
+	dbus_error_free(&error);
+	dbus_message_unref(reply);
+	dbus_message_unref(call);
+	return rv;
+}
+
+static ni_bool_t
+same_reply(const char *a, int alen, const char *b, int blen)
+{
+	return alen == blen && memcmp(a, b, alen) == 0;
+}
+
+TESTCASE(enumerate_setup)
+{
+	char name[IFNAMSIZ];
+	unsigned int i;
+
+	ni_global.initialized = 1;
+	ni_global.config = ni_config_new();
+	ni_string_dup(&ni_global.config->dbus_xml_schema_file, TEST_SCHEMA_FILE);
+	CHECK(ni_global_state_handle(0) != NULL);
+
+	CHECK((server = ni_dbus_server_open("system", NI_OBJECTMODEL_DBUS_BUS_NAME, NULL)) != NULL);
+	CHECK2(ni_objectmodel_init(server) != NULL, "object model initialized");
+
+	for (i = 0; i < TEST_NETIF_COUNT; ++i) {
+		snprintf(name, sizeof(name), "eth%u", i);
+		devs[i] = ni_netdev_new(name, i + 1);
+		devs[i]->link.type = NI_IFTYPE_ETHERNET;
+		devs[i]->link.mtu = 1500;
+		if (!ni_objectmodel_register_netif(server, devs[i], NULL))
+			break;
+	}
+	CHECK2(i == TEST_NETIF_COUNT, "registered %u netif objects", i);
+}
+
+TESTCASE(enumerate_cached)
+{
+	char *cold = NULL, *warm = NULL;
+	int cold_len = 0, warm_len = 0;
+	ni_timeout_t cold_msec, warm_msec;
+
+	ni_dbus_server_invalidate_properties(server);
+	CHECK(get_managed_objects(&cold, &cold_len, &cold_msec));
+	CHECK(get_managed_objects(&warm, &warm_len, &warm_msec));
+
+	CHECK2(same_reply(cold, cold_len, warm, warm_len),
+			"%u objects: %llu msec, cached %llu msec",
+			TEST_NETIF_COUNT, cold_msec, warm_msec);
+
+	dbus_free(cold);
+	dbus_free(warm);
+}
+
+TESTCASE(enumerate_invalidate)
+{
+	char *orig = NULL, *stale = NULL, *changed = NULL, *fresh = NULL, *event = NULL;
+	int orig_len = 0, stale_len = 0, changed_len = 0, fresh_len = 0, event_len = 0;
+	ni_timeout_t msec;
+
+	ni_dbus_server_invalidate_properties(server);
+	CHECK(get_managed_objects(&orig, &orig_len, &msec));
+
+	/* a change nobody told the cache about is not visible */
+	devs[TEST_NETIF_COUNT / 2]->link.mtu = 9000;
+	CHECK(get_managed_objects(&stale, &stale_len, &msec));
+	CHECK2(same_reply(orig, orig_len, stale, stale_len), "unannounced change is cached");
+
+	/* the netdev change path invalidates the object */
+	ni_objectmodel_netif_properties_changed(server, devs[TEST_NETIF_COUNT / 2]);
+	CHECK2(mock.addresses, "%u properties invalidated", mock.invalidated);
+	CHECK(get_managed_objects(&changed, &changed_len, &msec));
+	CHECK2(!same_reply(orig, orig_len, changed, changed_len), "changed object re-enumerated");
+
+	/* and matches a complete re-enumeration */
+	ni_dbus_server_invalidate_properties(server);
+	CHECK(get_managed_objects(&fresh, &fresh_len, &msec));
+	CHECK2(same_reply(changed, changed_len, fresh, fresh_len), "partial matches full enumeration");
+
+	/* sending an event invalidates the object as well */
+	devs[0]->link.mtu = 9000;
+	ni_objectmodel_send_netif_event(server,
+			ni_objectmodel_get_netif_object(server, devs[0]),
+			NI_EVENT_DEVICE_CHANGE, NULL);
+	CHECK(get_managed_objects(&event, &event_len, &msec));
+	CHECK2(!same_reply(fresh, fresh_len, event, event_len) && mock.signals > 0,
+			"object re-enumerated after device event");
+
+	dbus_free(orig);
+	dbus_free(stale);
+	dbus_free(changed);
+	dbus_free(fresh);
+	dbus_free(event);
+}
+
+TESTCASE(enumerate_cleanup)
+{
+	unsigned int i;
+
+	ni_dbus_server_free(server);
+	CHECK2(mock.registered == 0, "all objects unregistered");
+
+	for (i = 0; i < TEST_NETIF_COUNT; ++i)
+		ni_netdev_put(devs[i]);
+}
+
+TESTMAIN();
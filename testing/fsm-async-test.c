@@ -0,0 +1,434 @@
+/*
+ *	fsm asynchronous call unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Sends the ni_call_common_xml_async calls of src/calls.c and
+ *		of the src/fsm.c transitions to a mocked dbus client, checks
+ *		the retry of a call, the max-async-calls limit and the cancel
+ *		of calls in flight.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/objectmodel.h>
+#include <wicked/client.h>
+#include <wicked/fsm.h>
+#include "dbus-objects/model.h"
+#include "appconfig.h"
+#include "wunit.h"
+
+#ifndef TEST_SCHEMA_FILE
+#define TEST_SCHEMA_FILE	"../schema/wicked.xml"
+#endif
+
+#define TEST_DEVICES		4
+#define TEST_MAX_CALLS		2
+#define TEST_FIRST_IFINDEX	100
+#define TEST_MAX_PENDING	64
+
+/*
+ * Mocked client calls: the async calls are queued until the test
+ * replies to them, the interface list is a fixed set of devices.
+ */
+typedef struct mock_call {
+	ni_dbus_object_t *		proxy;
+	char *				method;
+	ni_dbus_async_callback_t *	callback;
+	void *				user_data;
+} mock_call_t;
+
+static struct {
+	ni_dbus_object_t *list;
+	mock_call_t	pending[TEST_MAX_PENDING];
+	unsigned int	count;
+	unsigned int	sent;
+} mock;
+
+static struct {
+	unsigned int	count;
+	int		result;
+} reply;
+
+static ni_fsm_t *		fsm;
+
+static const char *
+netif_path(unsigned int n)
+{
+	static char path[128];
+
+	snprintf(path, sizeof(path), NI_OBJECTMODEL_NETIF_LIST_PATH "/%u",
+			TEST_FIRST_IFINDEX + n);
+	return path;
+}
+
+static void
+mock_update_netdev(ni_netdev_t *dev, unsigned int n)
+{
+	char name[16];
+
+	snprintf(name, sizeof(name), "eth%u", n);
+	ni_string_dup(&dev->name, name);
+	dev->link.ifindex = TEST_FIRST_IFINDEX + n;
+	dev->link.type = NI_IFTYPE_ETHERNET;
+	dev->link.ifflags = NI_IFF_DEVICE_READY | NI_IFF_DEVICE_UP | NI_IFF_LINK_UP;
+}
+
+static ni_dbus_object_t *
+mock_netif_new(unsigned int n)
+{
+	ni_dbus_object_t *object;
+	ni_netdev_t *dev;
+
+	dev = ni_netdev_new(NULL, TEST_FIRST_IFINDEX + n);
+	mock_update_netdev(dev, n);
+
+	object = ni_dbus_object_create(mock.list, netif_path(n),
+			&ni_objectmodel_netif_class, dev);
+	if (object)
+		ni_objectmodel_bind_compatible_interfaces(object);
+	return object;
+}
+
+ni_dbus_object_t *
+ni_call_get_netif_list_object(void)
+{
+	return mock.list;
+}
+
+int
+ni_dbus_object_call_simple(const ni_dbus_object_t *proxy,
+			const char *interface_name, const char *method,
+			int arg_type, void *arg_ptr,
+			int res_type, void *res_ptr)
+{
+	return 0;
+}
+
+dbus_bool_t
+ni_dbus_object_refresh_children(ni_dbus_object_t *proxy)
+{
+	unsigned int ifindex, n;
+	const char *suffix;
+
+	if (!ni_string_eq(proxy->path, NI_OBJECTMODEL_NETIF_LIST_PATH)) {
+		suffix = strrchr(proxy->path, '/');
+		if (!suffix || ni_parse_uint(suffix + 1, &ifindex, 10) < 0)
+			return FALSE;
+
+		mock_update_netdev(proxy->handle, ifindex - TEST_FIRST_IFINDEX);
+		return TRUE;
+	}
+
+	for (n = 0; n < TEST_DEVICES; ++n) {
+		if (!ni_dbus_object_lookup(proxy, netif_path(n)) && !mock_netif_new(n))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+int
+ni_dbus_object_call_variant_async(ni_dbus_object_t *proxy,
+			const char *interface_name, const char *method,
+			unsigned int nargs, const ni_dbus_variant_t *args,
+			ni_dbus_async_callback_t *callback, void *user_data)
+{
+	mock_call_t *call;
+
+	if (mock.count >= TEST_MAX_PENDING)
+		return -NI_ERROR_DBUS_CALL_FAILED;
+
+	call = &mock.pending[mock.count++];
+	call->proxy = proxy;
+	call->method = strdup(method);
+	call->callback = callback;
+	call->user_data = user_data;
+	mock.sent++;
+	return 0;
+}
+
+/*
+ * Deliver the reply to the first pending call, either an empty
+ * result dict or the given error.
+ */
+static void
+mock_reply(const char *error_name)
+{
+	ni_dbus_variant_t result = NI_DBUS_VARIANT_INIT;
+	DBusError error = DBUS_ERROR_INIT;
+	ni_dbus_message_t *msg;
+	mock_call_t call;
+
+	if (!mock.count)
+		return;
+
+	call = mock.pending[0];
+	memmove(&mock.pending[0], &mock.pending[1], --mock.count * sizeof(call));
+
+	if (error_name) {
+		msg = dbus_message_new(DBUS_MESSAGE_TYPE_ERROR);
+		dbus_message_set_error_name(msg, error_name);
+	} else {
+		msg = dbus_message_new(DBUS_MESSAGE_TYPE_METHOD_RETURN);
+		ni_dbus_variant_init_dict(&result);
+		ni_dbus_message_serialize_variants(msg, 1, &result, &error);
+		ni_dbus_variant_destroy(&result);
+	}
+
+	call.callback(call.proxy, msg, call.user_data);
+	dbus_message_unref(msg);
+	dbus_error_free(&error);
+	free(call.method);
+}
+
+static void
+test_reply(int result, ni_objectmodel_callback_info_t *callback_list, void *user_data)
+{
+	reply.count++;
+	reply.result = result;
+	while (callback_list) {
+		ni_objectmodel_callback_info_t *cb = callback_list;
+
+		callback_list = cb->next;
+		ni_objectmodel_callback_info_free(cb);
+	}
+}
+
+/*
+ * Fills in a password and retries twice, as ni_ifworker_error_handler does.
+ */
+static int
+test_error_handler(ni_call_error_context_t *ctx, const DBusError *error)
+{
+	xml_node_t *node;
+
+	if (ni_call_error_context_get_retries(ctx, error) > 2)
+		return -NI_ERROR_AUTH_INFO_MISSING;
+
+	node = ni_call_error_context_get_node(ctx, "auth.password");
+	xml_node_set_cdata(node, "secret");
+	return -NI_ERROR_RETRY_OPERATION;
+}
+
+static int
+test_call(ni_dbus_object_t *object, xml_node_t *config)
+{
+	const ni_dbus_service_t *service;
+	const ni_dbus_method_t *method;
+
+	if (!(service = ni_dbus_object_get_service_for_method(object, "linkUp")))
+		return -NI_ERROR_METHOD_NOT_SUPPORTED;
+	if (!(method = ni_dbus_service_get_method(service, "linkUp")))
+		return -NI_ERROR_METHOD_NOT_SUPPORTED;
+
+	memset(&reply, 0, sizeof(reply));
+	return ni_call_common_xml_async(object, service, method, config,
+			test_error_handler, test_reply, NULL);
+}
+
+static unsigned int
+workers_in_state(unsigned int state)
+{
+	unsigned int i, count = 0;
+
+	for (i = 0; i < fsm->workers.count; ++i) {
+		if (fsm->workers.data[i]->fsm.state == state)
+			count++;
+	}
+	return count;
+}
+
+static int
+start_workers(unsigned int max_state)
+{
+	ni_ifworker_t *w;
+	unsigned int i;
+	int rv;
+
+	for (i = 0; i < fsm->workers.count; ++i) {
+		w = fsm->workers.data[i];
+		w->done = FALSE;
+		w->failed = FALSE;
+		w->target_range.min = NI_FSM_STATE_NONE;
+		w->target_range.max = max_state;
+		if ((rv = ni_ifworker_start(fsm, w, 0)) < 0)
+			return rv;
+	}
+	return 0;
+}
+
+TESTCASE(fsm_async_setup)
+{
+	unsigned int n;
+
+	ni_global.initialized = 1;
+	ni_global.config = ni_config_new();
+	ni_string_dup(&ni_global.config->dbus_xml_schema_file, TEST_SCHEMA_FILE);
+	CHECK2(ni_objectmodel_init(NULL) != NULL, "object model initialized");
+
+	mock.list = ni_dbus_client_object_new(NULL,
+			ni_objectmodel_get_class(NI_OBJECTMODEL_NETIF_LIST_CLASS),
+			NI_OBJECTMODEL_NETIF_LIST_PATH, NULL, NULL);
+	CHECK(mock.list != NULL);
+	for (n = 0; n < TEST_DEVICES; ++n)
+		CHECK(mock_netif_new(n) != NULL);
+}
+
+TESTCASE(call_async_reply)
+{
+	ni_dbus_object_t *object = ni_dbus_object_lookup(mock.list, netif_path(0));
+
+	CHECK(test_call(object, NULL) == 0);
+	CHECK(mock.count == 1 && mock.pending[0].proxy == object);
+	CHECK(ni_string_eq(mock.pending[0].method, "linkUp"));
+	CHECK(reply.count == 0);
+
+	mock_reply(NULL);
+	CHECK2(reply.count == 1 && reply.result == 0, "%u replies, result %d",
+			reply.count, reply.result);
+}
+
+TESTCASE(call_async_retry)
+{
+	ni_dbus_object_t *object = ni_dbus_object_lookup(mock.list, netif_path(1));
+	xml_node_t *config = xml_node_new("link", NULL);
+	xml_node_t *auth, *password;
+
+	/* the error handler fills in the config of the caller */
+	CHECK(test_call(object, config) == 0);
+	mock_reply(DBUS_ERROR_FAILED);
+	CHECK2(mock.count == 1 && reply.count == 0, "retried after error");
+	CHECK((auth = xml_node_get_child(config, "auth")) != NULL);
+	CHECK((password = xml_node_get_child(auth, "password")) != NULL);
+	CHECK(ni_string_eq(password->cdata, "secret"));
+
+	/* the retry is sent to the object recreated meanwhile */
+	ni_dbus_object_free(object);
+	CHECK((object = mock_netif_new(1)) != NULL);
+	mock.pending[0].proxy = NULL;
+	mock_reply(DBUS_ERROR_FAILED);
+	CHECK(mock.count == 1 && mock.pending[0].proxy == object);
+
+	mock_reply(NULL);
+	CHECK(reply.count == 1 && reply.result == 0);
+
+	/* the reply holds a reference to the config */
+	CHECK(test_call(object, config) == 0);
+	xml_node_free(config);
+	mock_reply(NULL);
+	CHECK(reply.count == 1 && reply.result == 0);
+}
+
+TESTCASE(call_async_object_gone)
+{
+	ni_dbus_object_t *object = ni_dbus_object_lookup(mock.list, netif_path(2));
+
+	CHECK(test_call(object, NULL) == 0);
+	ni_dbus_object_free(object);
+	mock.pending[0].proxy = NULL;
+
+	/* the retry fails instead of using the deleted object */
+	mock_reply(DBUS_ERROR_FAILED);
+	CHECK2(mock.count == 0 && reply.count == 1 &&
+			reply.result == -NI_ERROR_DEVICE_NOT_KNOWN,
+			"%u pending, %u replies, result %d",
+			mock.count, reply.count, reply.result);
+
+	CHECK(mock_netif_new(2) != NULL);
+}
+
+TESTCASE(fsm_async_setup_workers)
+{
+	CHECK((fsm = ni_fsm_new()) != NULL);
+	ni_fsm_set_max_async_calls(fsm, TEST_MAX_CALLS);
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK2(fsm->workers.count == TEST_DEVICES, "%u workers", fsm->workers.count);
+}
+
+TESTCASE(fsm_async_max_calls)
+{
+	unsigned int max = 0, rounds = 0;
+
+	CHECK(start_workers(NI_FSM_STATE_FIREWALL_UP) == 0);
+
+	mock.sent = 0;
+	ni_fsm_schedule(fsm);
+	while (mock.count && rounds++ < 1000) {
+		if (mock.count > max)
+			max = mock.count;
+		CHECK2(fsm->async.calls == mock.count, "%u calls in flight, %u pending",
+				fsm->async.calls, mock.count);
+		mock_reply(NULL);
+		ni_fsm_schedule(fsm);
+	}
+	CHECK2(max == TEST_MAX_CALLS, "%u calls sent, at most %u in flight", mock.sent, max);
+	CHECK(mock.sent >= TEST_DEVICES);
+	CHECK2(workers_in_state(NI_FSM_STATE_FIREWALL_UP) == TEST_DEVICES,
+			"%u workers down", workers_in_state(NI_FSM_STATE_FIREWALL_UP));
+}
+
+TESTCASE(fsm_async_cancel)
+{
+	ni_ifworker_t *w;
+	unsigned int n, replies;
+
+	CHECK(start_workers(NI_FSM_STATE_DEVICE_READY) == 0);
+
+	mock.sent = 0;
+	ni_fsm_schedule(fsm);
+	CHECK(mock.count == TEST_MAX_CALLS && fsm->async.calls == TEST_MAX_CALLS);
+
+	/* failing the workers cancels the calls in flight ... */
+	for (n = 0; n < TEST_MAX_CALLS; ++n) {
+		w = ni_fsm_ifworker_by_object_path(fsm, mock.pending[n].proxy->path);
+		CHECK(w != NULL && w->fsm.call != NULL);
+		ni_ifworker_fail(w, "cancelled by test");
+		CHECK(w->fsm.call == NULL);
+	}
+	CHECK(fsm->async.calls == 0);
+
+	/* ... and frees them once their reply arrives */
+	replies = fsm->async.replies;
+	for (n = 0; n < TEST_MAX_CALLS; ++n)
+		mock_reply(NULL);
+	CHECK2(fsm->async.calls == 0 && fsm->async.replies == replies,
+			"%u calls, %u replies", fsm->async.calls, fsm->async.replies - replies);
+
+	/* the queued calls of the other workers use the free slots */
+	ni_fsm_schedule(fsm);
+	CHECK(mock.count == TEST_MAX_CALLS && fsm->async.calls == TEST_MAX_CALLS);
+
+	/* freeing the fsm cancels the remaining calls */
+	ni_fsm_free(fsm);
+	fsm = NULL;
+	while (mock.count)
+		mock_reply(NULL);
+}
+
+TESTCASE(fsm_async_cleanup)
+{
+	ni_dbus_object_free(mock.list);
+	ni_config_free(ni_global.config);
+	ni_global.config = NULL;
+}
+
+TESTMAIN();
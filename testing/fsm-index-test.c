@@ -0,0 +1,338 @@
+/*
+ *	client fsm worker index unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Builds a synthetic hierarchy of ethernet devices with a
+ *		vlan on top of each in src/fsm.c and compares the indexed
+ *		worker lookups against the linear scans of the workers.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <net/if.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/objectmodel.h>
+#include <wicked/fsm.h>
+#include <wicked/xml.h>
+#include <wicked/time.h>
+#include "appconfig.h"
+#include "wunit.h"
+
+#ifndef TEST_SCHEMA_FILE
+#define TEST_SCHEMA_FILE	"../schema/wicked.xml"
+#endif
+
+#define TEST_ETHERNETS		2500
+#define TEST_WORKERS		(TEST_ETHERNETS * 2)
+#define TEST_FIRST_IFINDEX	100
+#define TEST_NETIF_PATH		"/org/opensuse/Network/Interface"
+
+static ni_fsm_t *		fsm;
+static ni_netdev_t *		devs[TEST_ETHERNETS];
+
+static xml_node_t *
+ethernet_config(unsigned int n)
+{
+	char name[IFNAMSIZ];
+	xml_node_t *ifnode;
+
+	snprintf(name, sizeof(name), "eth%u", n);
+	ifnode = xml_node_new("interface", NULL);
+	xml_node_new_element("name", ifnode, name);
+	return ifnode;
+}
+
+static xml_node_t *
+vlan_config(unsigned int n)
+{
+	char name[IFNAMSIZ], tag[16];
+	xml_node_t *ifnode, *vlan;
+
+	snprintf(name, sizeof(name), "vlan%u", n);
+	ifnode = xml_node_new("interface", NULL);
+	xml_node_new_element("name", ifnode, name);
+
+	vlan = xml_node_new("vlan", ifnode);
+	snprintf(name, sizeof(name), "eth%u", n);
+	xml_node_new_element("device", vlan, name);
+	snprintf(tag, sizeof(tag), "%u", 1 + n % 4094);
+	xml_node_new_element("tag", vlan, tag);
+	return ifnode;
+}
+
+static ni_dbus_object_t *
+netif_object(ni_netdev_t *dev)
+{
+	char path[128];
+
+	snprintf(path, sizeof(path), TEST_NETIF_PATH "/%u", dev->link.ifindex);
+	return ni_dbus_object_new(&ni_objectmodel_netif_class, path, dev);
+}
+
+/*
+ * Lookups of every name, ifindex and object path, twice with the
+ * unknown ones; with the index unset the fsm scans the workers.
+ */
+static unsigned int
+lookup_all(ni_ifworker_t **found, unsigned long long *msec)
+{
+	struct timeval beg, end;
+	char key[128];
+	unsigned int i, n = 0;
+
+	ni_timer_get_time(&beg);
+	for (i = 0; i < TEST_ETHERNETS * 2; ++i) {
+		snprintf(key, sizeof(key), "eth%u", i);
+		found[n++] = ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, key);
+		snprintf(key, sizeof(key), "vlan%u", i);
+		found[n++] = ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, key);
+		found[n++] = ni_fsm_ifworker_by_ifindex(fsm, TEST_FIRST_IFINDEX + i);
+		snprintf(key, sizeof(key), TEST_NETIF_PATH "/%u", TEST_FIRST_IFINDEX + i);
+		found[n++] = ni_fsm_ifworker_by_object_path(fsm, key);
+	}
+	ni_timer_get_time(&end);
+	*msec = ni_timeout_since(&beg, &end, NULL);
+	return n;
+}
+
+static unsigned int
+compare_lookups(unsigned long long *indexed, unsigned long long *linear)
+{
+	static ni_ifworker_t *a[TEST_ETHERNETS * 8], *b[TEST_ETHERNETS * 8];
+	struct ni_fsm_worker_index *index;
+	unsigned int i, n, mismatches = 0;
+
+	n = lookup_all(a, indexed);
+
+	index = fsm->worker_index;
+	fsm->worker_index = NULL;
+	lookup_all(b, linear);
+	fsm->worker_index = index;
+
+	for (i = 0; i < n; ++i) {
+		if (a[i] != b[i])
+			mismatches++;
+	}
+	return mismatches;
+}
+
+TESTCASE(fsm_index_setup)
+{
+	ni_global.initialized = 1;
+	ni_global.config = ni_config_new();
+	ni_string_dup(&ni_global.config->dbus_xml_schema_file, TEST_SCHEMA_FILE);
+	CHECK2(ni_objectmodel_init(NULL) != NULL, "object model initialized");
+
+	CHECK((fsm = ni_fsm_new()) != NULL);
+}
+
+TESTCASE(fsm_index_config)
+{
+	struct timeval beg, end;
+	xml_node_t *ifnode;
+	ni_ifworker_t *w;
+	unsigned int n, failed = 0;
+
+	/* the vlans first, their lower devices are referenced by name */
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_ETHERNETS; ++n) {
+		ifnode = vlan_config(n);
+		if (!(w = ni_fsm_workers_from_xml(fsm, ifnode, "test")))
+			failed++;
+		else
+			w->control.usercontrol = TRUE;
+		xml_node_free(ifnode);
+	}
+	for (n = 0; n < TEST_ETHERNETS; ++n) {
+		ifnode = ethernet_config(n);
+		if (!(w = ni_fsm_workers_from_xml(fsm, ifnode, "test")))
+			failed++;
+		else
+			w->control.usercontrol = TRUE;
+		xml_node_free(ifnode);
+	}
+	ni_timer_get_time(&end);
+
+	CHECK2(failed == 0 && fsm->workers.count == TEST_WORKERS,
+			"configured %u workers in %llu msec", fsm->workers.count,
+			ni_timeout_since(&beg, &end, NULL));
+
+	/* a second config of a name is applied to the same worker */
+	ifnode = ethernet_config(7);
+	CHECK(ni_fsm_workers_from_xml(fsm, ifnode, "test") ==
+		ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "eth7"));
+	CHECK(fsm->workers.count == TEST_WORKERS);
+	xml_node_free(ifnode);
+}
+
+TESTCASE(fsm_index_devices)
+{
+	char name[IFNAMSIZ];
+	ni_ifworker_t *w;
+	unsigned int n, failed = 0;
+
+	for (n = 0; n < TEST_ETHERNETS; ++n) {
+		snprintf(name, sizeof(name), "eth%u", n);
+		devs[n] = ni_netdev_new(name, TEST_FIRST_IFINDEX + n);
+		devs[n]->link.type = NI_IFTYPE_ETHERNET;
+		devs[n]->link.ifflags = NI_IFF_DEVICE_READY;
+
+		w = ni_fsm_recv_new_netif(fsm, netif_object(devs[n]), FALSE);
+		if (!w || !ni_string_eq(w->name, name) || w->ifindex != devs[n]->link.ifindex)
+			failed++;
+	}
+	CHECK2(failed == 0 && fsm->workers.count == TEST_WORKERS,
+			"bound %u devices", TEST_ETHERNETS);
+}
+
+TESTCASE(fsm_index_lookup)
+{
+	unsigned long long indexed, linear;
+	unsigned int mismatches;
+
+	mismatches = compare_lookups(&indexed, &linear);
+	CHECK2(mismatches == 0, "index matches linear scan: %llu msec, linear %llu msec",
+			indexed, linear);
+}
+
+TESTCASE(fsm_index_hierarchy)
+{
+	struct timeval beg, end;
+	ni_ifworker_t *vlan, *eth;
+	char name[IFNAMSIZ];
+	unsigned int n, failed = 0;
+
+	ni_timer_get_time(&beg);
+	CHECK(ni_fsm_build_hierarchy(fsm, FALSE) == 0);
+	ni_timer_get_time(&end);
+
+	for (n = 0; n < TEST_ETHERNETS; ++n) {
+		snprintf(name, sizeof(name), "vlan%u", n);
+		vlan = ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, name);
+		eth = ni_fsm_ifworker_by_ifindex(fsm, TEST_FIRST_IFINDEX + n);
+		if (!vlan || !eth || vlan->lowerdev != eth)
+			failed++;
+	}
+	CHECK2(failed == 0, "built hierarchy of %u workers in %llu msec",
+			fsm->workers.count, ni_timeout_since(&beg, &end, NULL));
+}
+
+TESTCASE(fsm_index_matching)
+{
+	ni_ifworker_array_t result = NI_IFWORKER_ARRAY_INIT;
+	ni_ifmatcher_t match;
+	struct timeval beg, end;
+	unsigned int n, failed = 0;
+	char name[IFNAMSIZ];
+
+	/* each vlan pulls in its lower device */
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_ETHERNETS; ++n) {
+		memset(&match, 0, sizeof(match));
+		snprintf(name, sizeof(name), "vlan%u", n);
+		match.name = name;
+		if (ni_fsm_get_matching_workers(fsm, &match, &result) != (n + 1) * 2)
+			failed++;
+	}
+	ni_timer_get_time(&end);
+	CHECK2(failed == 0, "matched %u workers by name in %llu msec",
+			result.count, ni_timeout_since(&beg, &end, NULL));
+	ni_ifworker_array_destroy(&result);
+
+	memset(&match, 0, sizeof(match));
+	match.name = "all";
+	ni_timer_get_time(&beg);
+	n = ni_fsm_get_matching_workers(fsm, &match, &result);
+	ni_timer_get_time(&end);
+	CHECK2(n == TEST_WORKERS, "matched all %u workers in %llu msec",
+			n, ni_timeout_since(&beg, &end, NULL));
+	ni_ifworker_array_destroy(&result);
+}
+
+TESTCASE(fsm_index_rename)
+{
+	unsigned long long indexed, linear;
+	ni_ifworker_t *w;
+
+	/* a refresh of a renamed device is found by object path */
+	w = ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "eth42");
+	ni_string_dup(&devs[42]->name, "lan42");
+	CHECK(ni_fsm_recv_new_netif(fsm, w->object, FALSE) == w);
+	CHECK(ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "lan42") == w);
+	CHECK(ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "eth42") == NULL);
+	CHECK2(compare_lookups(&indexed, &linear) == 0, "index matches linear scan after rename");
+}
+
+TESTCASE(fsm_index_destroy)
+{
+	unsigned long long indexed, linear;
+	char name[IFNAMSIZ];
+	ni_ifworker_t *w;
+	unsigned int n;
+
+	for (n = 0; n < TEST_ETHERNETS; n += 3) {
+		snprintf(name, sizeof(name), "vlan%u", n);
+		if ((w = ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, name)))
+			ni_fsm_destroy_worker(fsm, w);
+	}
+	CHECK2(fsm->workers.count == TEST_WORKERS - (TEST_ETHERNETS + 2) / 3,
+			"destroyed %u workers", (TEST_ETHERNETS + 2) / 3);
+	CHECK(ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "vlan0") == NULL);
+	CHECK2(compare_lookups(&indexed, &linear) == 0, "index matches linear scan after destroy");
+
+	/* a new worker is indexed when it is created */
+	w = ni_fsm_ifworker_new(fsm, NI_IFWORKER_TYPE_NETDEV, "vlan0");
+	CHECK(w && ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "vlan0") == w);
+}
+
+TESTCASE(fsm_index_remove_append)
+{
+	unsigned long long indexed, linear;
+	ni_ifworker_t *old, *w;
+	int i;
+
+	/* a removal followed by an append restores the worker count;
+	 * the reference keeps the removed worker valid to compare it */
+	CHECK((old = ni_fsm_ifworker_new(fsm, NI_IFWORKER_TYPE_NETDEV, "cfg-old")) != NULL);
+	ni_ifworker_get(old);
+	CHECK((i = ni_ifworker_array_index(&fsm->workers, old)) >= 0);
+	CHECK(ni_fsm_remove_worker_at(fsm, i));
+	CHECK((w = ni_fsm_ifworker_new(fsm, NI_IFWORKER_TYPE_NETDEV, "cfg-new")) != NULL);
+
+	CHECK2(ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "cfg-old") == NULL,
+			"removed worker not found");
+	CHECK(ni_fsm_ifworker_by_name(fsm, NI_IFWORKER_TYPE_NETDEV, "cfg-new") == w);
+	CHECK2(compare_lookups(&indexed, &linear) == 0, "index matches linear scan after remove");
+	ni_ifworker_release(old);
+}
+
+TESTCASE(fsm_index_cleanup)
+{
+	unsigned int n;
+
+	ni_fsm_free(fsm);
+	fsm = NULL;
+	for (n = 0; n < TEST_ETHERNETS; ++n)
+		ni_netdev_put(devs[n]);
+}
+
+TESTMAIN();
@@ -0,0 +1,344 @@
+/*
+ *	fsm incremental state refresh unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Refreshes the fsm state from a mocked server interface list
+ *		in src/fsm.c and counts the GetManagedObjects calls of the
+ *		full and of the incremental refresh.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <net/if.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/objectmodel.h>
+#include <wicked/fsm.h>
+#include <wicked/time.h>
+#include "dbus-objects/model.h"
+#include "appconfig.h"
+#include "wunit.h"
+
+#ifndef TEST_SCHEMA_FILE
+#define TEST_SCHEMA_FILE	"../schema/wicked.xml"
+#endif
+
+#define TEST_DEVICES		1000
+#define TEST_CHANGES		10
+#define TEST_FIRST_IFINDEX	100
+
+/*
+ * Mocked client calls: the server side state is a device table,
+ * GetManagedObjects of the list or of a single netif object copies
+ * it into the proxy objects.
+ */
+static struct {
+	struct {
+		ni_bool_t	alive;
+		unsigned int	mtu;
+	}		devs[TEST_DEVICES + 1];
+
+	ni_dbus_object_t *list;
+	unsigned int	lifetime;
+	unsigned int	list_calls;
+	unsigned int	object_calls;
+	unsigned int	pings;
+} mock;
+
+static ni_fsm_t *		fsm;
+
+static const char *
+netif_path(unsigned int n)
+{
+	static char path[128];
+
+	snprintf(path, sizeof(path), NI_OBJECTMODEL_NETIF_LIST_PATH "/%u",
+			TEST_FIRST_IFINDEX + n);
+	return path;
+}
+
+/*
+ * The server sends address lifetimes relative to the time of the
+ * fetch, so they count down between two fetches of the same address.
+ */
+static void
+mock_update_netdev(ni_netdev_t *dev, unsigned int n)
+{
+	char name[IFNAMSIZ];
+	ni_sockaddr_t local;
+	ni_address_t *ap;
+
+	snprintf(name, sizeof(name), "eth%u", n);
+	ni_string_dup(&dev->name, name);
+	dev->link.ifindex = TEST_FIRST_IFINDEX + n;
+	dev->link.type = NI_IFTYPE_ETHERNET;
+	dev->link.ifflags = NI_IFF_DEVICE_READY;
+	dev->link.mtu = mock.devs[n].mtu;
+
+	ni_address_list_destroy(&dev->addrs);
+	ni_sockaddr_parse(&local, "2001:db8::1", AF_INET6);
+	local.six.sin6_addr.s6_addr[15] = n;
+	if ((ap = ni_address_create(AF_INET6, 64, &local, &dev->addrs))) {
+		ni_timer_get_time(&ap->cache_info.acquired);
+		ap->cache_info.valid_lft = mock.lifetime--;
+		ap->cache_info.preferred_lft = ap->cache_info.valid_lft / 2;
+	}
+}
+
+static dbus_bool_t
+mock_refresh_list(ni_dbus_object_t *list)
+{
+	ni_dbus_object_t *object;
+	unsigned int n;
+
+	for (n = 0; n <= TEST_DEVICES; ++n) {
+		object = ni_dbus_object_lookup(list, netif_path(n));
+		if (!mock.devs[n].alive) {
+			if (object)
+				ni_dbus_object_free(object);
+			continue;
+		}
+		if (!object) {
+			object = ni_dbus_object_create(list, netif_path(n),
+					&ni_objectmodel_netif_class,
+					ni_netdev_new(NULL, TEST_FIRST_IFINDEX + n));
+			if (!object)
+				return FALSE;
+			ni_objectmodel_bind_compatible_interfaces(object);
+		}
+		mock_update_netdev(object->handle, n);
+	}
+	return TRUE;
+}
+
+ni_dbus_object_t *
+ni_call_get_netif_list_object(void)
+{
+	return mock.list;
+}
+
+int
+ni_dbus_object_call_simple(const ni_dbus_object_t *proxy,
+			const char *interface_name, const char *method,
+			int arg_type, void *arg_ptr,
+			int res_type, void *res_ptr)
+{
+	mock.pings++;
+	return 0;
+}
+
+dbus_bool_t
+ni_dbus_object_refresh_children(ni_dbus_object_t *proxy)
+{
+	unsigned int ifindex, n;
+	const char *suffix;
+
+	if (ni_string_eq(proxy->path, NI_OBJECTMODEL_NETIF_LIST_PATH)) {
+		mock.list_calls++;
+		return mock_refresh_list(proxy);
+	}
+
+	mock.object_calls++;
+	suffix = strrchr(proxy->path, '/');
+	if (!suffix || ni_parse_uint(suffix + 1, &ifindex, 10) < 0)
+		return FALSE;
+
+	n = ifindex - TEST_FIRST_IFINDEX;
+	if (ifindex < TEST_FIRST_IFINDEX || n > TEST_DEVICES || !mock.devs[n].alive)
+		return FALSE;
+
+	mock_update_netdev(proxy->handle, n);
+	return TRUE;
+}
+
+static void
+reset_counters(void)
+{
+	mock.list_calls = 0;
+	mock.object_calls = 0;
+	mock.pings = 0;
+}
+
+static unsigned int
+stale_workers(void)
+{
+	ni_ifworker_t *w;
+	unsigned int i, n, stale = 0;
+
+	for (i = 0; i < fsm->workers.count; ++i) {
+		w = fsm->workers.data[i];
+		n = w->ifindex - TEST_FIRST_IFINDEX;
+		if (!mock.devs[n].alive)
+			continue;
+		if (!w->object || !w->device || w->device->link.mtu != mock.devs[n].mtu)
+			stale++;
+	}
+	return stale;
+}
+
+TESTCASE(fsm_refresh_setup)
+{
+	unsigned int n;
+
+	ni_global.initialized = 1;
+	ni_global.config = ni_config_new();
+	ni_string_dup(&ni_global.config->dbus_xml_schema_file, TEST_SCHEMA_FILE);
+	CHECK2(ni_objectmodel_init(NULL) != NULL, "object model initialized");
+	CHECK(ni_global.config->fsm.refresh == NI_CONFIG_FSM_REFRESH_FULL);
+
+	/* the incremental refresh is opt-in */
+	ni_global.config->fsm.refresh = NI_CONFIG_FSM_REFRESH_INCREMENTAL;
+	CHECK((fsm = ni_fsm_new()) != NULL);
+	CHECK(fsm->refresh.incremental && !fsm->refresh.check);
+
+	mock.list = ni_dbus_client_object_new(NULL,
+			ni_objectmodel_get_class(NI_OBJECTMODEL_NETIF_LIST_CLASS),
+			NI_OBJECTMODEL_NETIF_LIST_PATH, NULL, NULL);
+	CHECK(mock.list != NULL);
+
+	for (n = 0; n < TEST_DEVICES; ++n) {
+		mock.devs[n].alive = TRUE;
+		mock.devs[n].mtu = 1500;
+	}
+	mock.lifetime = 86400;
+}
+
+TESTCASE(fsm_refresh_initial)
+{
+	reset_counters();
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK2(mock.list_calls == 1 && mock.object_calls == TEST_DEVICES,
+			"initial refresh: %u list and %u object calls",
+			mock.list_calls, mock.object_calls);
+	CHECK2(fsm->workers.count == TEST_DEVICES, "%u workers", fsm->workers.count);
+	CHECK(stale_workers() == 0);
+}
+
+TESTCASE(fsm_refresh_incremental)
+{
+	struct timeval beg, end;
+	unsigned long long full, incremental;
+	unsigned int n;
+
+	/* nothing signaled: the workers are rebound from the cached objects */
+	reset_counters();
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK2(mock.list_calls == 0 && mock.object_calls == 0 && mock.pings == 1,
+			"idle refresh: %u list and %u object calls",
+			mock.list_calls, mock.object_calls);
+	CHECK(stale_workers() == 0);
+
+	/* signaled changes are re-fetched, twice signaled ones only once */
+	for (n = 0; n < TEST_CHANGES; ++n) {
+		mock.devs[n * 7].mtu = 9000;
+		ni_fsm_refresh_mark_changed(fsm, netif_path(n * 7));
+		ni_fsm_refresh_mark_changed(fsm, netif_path(n * 7));
+	}
+	reset_counters();
+	ni_timer_get_time(&beg);
+	CHECK(ni_fsm_refresh_state(fsm));
+	ni_timer_get_time(&end);
+	incremental = ni_timeout_since(&beg, &end, NULL);
+	CHECK2(mock.list_calls == 0 && mock.object_calls == TEST_CHANGES,
+			"incremental refresh: %u list and %u object calls",
+			mock.list_calls, mock.object_calls);
+	CHECK(stale_workers() == 0);
+
+	/* the full refresh re-fetches every object */
+	fsm->refresh.incremental = FALSE;
+	reset_counters();
+	ni_timer_get_time(&beg);
+	CHECK(ni_fsm_refresh_state(fsm));
+	ni_timer_get_time(&end);
+	full = ni_timeout_since(&beg, &end, NULL);
+	fsm->refresh.incremental = TRUE;
+	CHECK2(mock.list_calls == 1 && mock.object_calls == TEST_DEVICES,
+			"full refresh: %u list and %u object calls",
+			mock.list_calls, mock.object_calls);
+	CHECK2(stale_workers() == 0, "%u changes: incremental %llu msec, full %llu msec",
+			TEST_CHANGES, incremental, full);
+
+	/* only the netif objects of the interface list are tracked */
+	ni_fsm_refresh_mark_changed(fsm, "/org/freedesktop/systemd1/unit/foo");
+	ni_fsm_refresh_mark_changed(fsm, NI_OBJECTMODEL_NETIF_LIST_PATH);
+	ni_fsm_refresh_mark_changed(fsm, NI_OBJECTMODEL_MODEM_LIST_PATH "/1");
+	ni_fsm_refresh_mark_changed(fsm, netif_path(1));
+	CHECK2(fsm->refresh.dirty.count == 1, "%u dirty paths", fsm->refresh.dirty.count);
+	reset_counters();
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK(mock.object_calls == 1 && fsm->refresh.dirty.count == 0);
+}
+
+TESTCASE(fsm_refresh_fallback)
+{
+	/* a new device is not in the cached list */
+	mock.devs[TEST_DEVICES].alive = TRUE;
+	mock.devs[TEST_DEVICES].mtu = 1500;
+	ni_fsm_refresh_mark_changed(fsm, netif_path(TEST_DEVICES));
+	reset_counters();
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK2(mock.list_calls == 1, "created device: %u list calls", mock.list_calls);
+	CHECK(ni_fsm_ifworker_by_ifindex(fsm, TEST_FIRST_IFINDEX + TEST_DEVICES) != NULL);
+	CHECK(stale_workers() == 0);
+
+	/* a deleted device fails to refresh */
+	mock.devs[TEST_DEVICES].alive = FALSE;
+	ni_fsm_refresh_mark_changed(fsm, netif_path(TEST_DEVICES));
+	reset_counters();
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK2(mock.list_calls == 1, "deleted device: %u list calls", mock.list_calls);
+	CHECK(ni_dbus_object_lookup(mock.list, netif_path(TEST_DEVICES)) == NULL);
+}
+
+TESTCASE(fsm_refresh_check)
+{
+	fsm->refresh.check = TRUE;
+
+	/* the check mode refresh compares with a full GetManagedObjects,
+	 * except for the address lifetimes counting down meanwhile */
+	reset_counters();
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK2(mock.list_calls == 1 && mock.object_calls == 0 && fsm->refresh.mismatches == 0,
+			"checked refresh: %u list and %u object calls",
+			mock.list_calls, mock.object_calls);
+
+	/* a change without signal is detected and refreshed in full */
+	mock.devs[3].mtu = 1280;
+	reset_counters();
+	CHECK(ni_fsm_refresh_state(fsm));
+	CHECK2(fsm->refresh.mismatches == 1, "%u mismatches", fsm->refresh.mismatches);
+	CHECK2(mock.list_calls == 2 && mock.object_calls == TEST_DEVICES,
+			"mismatch refresh: %u list and %u object calls",
+			mock.list_calls, mock.object_calls);
+	CHECK(stale_workers() == 0);
+
+	fsm->refresh.check = FALSE;
+}
+
+TESTCASE(fsm_refresh_cleanup)
+{
+	ni_fsm_free(fsm);
+	ni_dbus_object_free(mock.list);
+	ni_config_free(ni_global.config);
+	ni_global.config = NULL;
+}
+
+TESTMAIN();
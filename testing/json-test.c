@@ -24,9 +24,17 @@
 #include "config.h"
 #endif
 
+#include <unistd.h>
+#include <limits.h>
+#include <wicked/time.h>
 #include "json.h"
 #include "wunit.h"
 
+#define TEST_OBJECT_KEYS	100000
+#define TEST_LINEAR_KEYS	10
+#define TEST_PARSE_ENTRIES	20000
+#define TEST_PARSE_LONG_STR	200000
+
 static ni_json_t *
 init1_1(void)
 {
@@ -590,6 +598,103 @@ TESTCASE(ni_json_object_delete_at)
 	ni_json_free(json_object);
 }
 
+static const char *
+test_key_name(unsigned int n)
+{
+	static char name[32];
+
+	snprintf(name, sizeof(name), "Member%u", n);
+	return name;
+}
+
+static ni_json_pair_t *
+test_linear_get_pair(ni_json_t *json, const char *name)
+{
+	ni_json_pair_t *pair;
+	unsigned int i;
+
+	for (i = 0; (pair = ni_json_object_get_pair_at(json, i)); ++i) {
+		if (ni_string_eq(ni_json_pair_get_name(pair), name))
+			return pair;
+	}
+	return NULL;
+}
+
+TESTCASE(ni_json_object_index)
+{
+	ni_json_t *json, *value;
+	unsigned int n, failed = 0;
+	int64_t num;
+
+	CHECK((json = ni_json_new_object()));
+	for (n = 0; n < 100; ++n)
+		CHECK(ni_json_object_set(json, test_key_name(n), ni_json_new_int64(n)));
+
+	/* set replaces the value of an existing key */
+	CHECK(ni_json_object_set(json, test_key_name(42), ni_json_new_string("answer")));
+	CHECK(ni_json_object_entries(json) == 100);
+	CHECK(ni_json_type(ni_json_object_get_value(json, test_key_name(42))) == NI_JSON_TYPE_STRING);
+
+	/* removals move the following pairs */
+	CHECK(ni_json_object_delete(json, test_key_name(10)));
+	CHECK(ni_json_object_delete_at(json, 0));
+	CHECK(ni_json_object_get_value(json, test_key_name(10)) == NULL);
+	CHECK(ni_json_object_get_value(json, test_key_name(0)) == NULL);
+	for (n = 1; n < 100; ++n) {
+		if (n == 10 || n == 42)
+			continue;
+		value = ni_json_object_get_value(json, test_key_name(n));
+		if (!ni_json_int64_get(value, &num) || num != n)
+			failed++;
+	}
+	CHECK2(failed == 0, "%u lookups failed", failed);
+	CHECK(ni_json_object_set(json, test_key_name(0), ni_json_new_null()));
+	CHECK(ni_json_object_get_pair(json, test_key_name(0)) ==
+		ni_json_object_get_pair_at(json, ni_json_object_entries(json) - 1));
+
+	ni_json_free(json);
+}
+
+TESTCASE(ni_json_object_bench)
+{
+	unsigned long long build, indexed, linear;
+	struct timeval beg, end;
+	unsigned int n, found = 0, lfound = 0;
+	ni_json_t *json;
+
+	CHECK((json = ni_json_new_object()));
+
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_OBJECT_KEYS; ++n)
+		ni_json_object_set(json, test_key_name(n), ni_json_new_int64(n));
+	ni_timer_get_time(&end);
+	build = ni_timeout_since(&beg, &end, NULL);
+	CHECK(ni_json_object_entries(json) == TEST_OBJECT_KEYS);
+
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_OBJECT_KEYS; ++n) {
+		if (ni_json_object_get_value(json, test_key_name(n)))
+			found++;
+	}
+	ni_timer_get_time(&end);
+	indexed = ni_timeout_since(&beg, &end, NULL);
+
+	/* a linear scan of a few last keys for comparison, it is slow */
+	ni_timer_get_time(&beg);
+	for (n = TEST_OBJECT_KEYS - TEST_LINEAR_KEYS; n < TEST_OBJECT_KEYS; ++n) {
+		if (test_linear_get_pair(json, test_key_name(n)))
+			lfound++;
+	}
+	ni_timer_get_time(&end);
+	linear = ni_timeout_since(&beg, &end, NULL);
+
+	CHECK2(found == TEST_OBJECT_KEYS && lfound == TEST_LINEAR_KEYS,
+			"%u keys: set %llu, get %llu, get %u linear %llu msec",
+			TEST_OBJECT_KEYS, build, indexed, lfound, linear);
+
+	ni_json_free(json);
+}
+
 TESTCASE(ni_json_array_insert)
 {
 	ni_json_t *json_array, *value, *value2, *value3;
@@ -726,4 +831,79 @@ TESTCASE(ni_json_parse_file)
 	ni_json_free(json);
 }
 
+/*
+ * A document larger than the file reader chunks with strings, escapes
+ * and numbers crossing the chunk boundaries
+ */
+static void
+test_parse_document(ni_stringbuf_t *doc)
+{
+	unsigned int n;
+
+	ni_stringbuf_puts(doc, "[\n");
+	for (n = 0; n < TEST_PARSE_ENTRIES; ++n) {
+		ni_stringbuf_printf(doc, "  { \"name\": \"eth%u\", \"mtu\": %u, "
+				"\"ratio\": -%u.5e-3, \"up\": %s, \"addr\": null,\n"
+				"    \"desc\": \"port \\\"%u\\\"\\n\\u00e9\\ud834\\udd1e\" },\n",
+				n, 1500 + n, n, n % 2 ? "true" : "false", n);
+	}
+	ni_stringbuf_puts(doc, "  \"");
+	for (n = 0; n < TEST_PARSE_LONG_STR; ++n)
+		ni_stringbuf_putc(doc, 'a' + n % 26);
+	ni_stringbuf_puts(doc, "\"\n]\n");
+}
+
+TESTCASE(ni_json_parse_chunked)
+{
+	ni_json_format_options_t options = NI_JSON_OPTIONS_INIT;
+	ni_stringbuf_t doc = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t out1 = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t out2 = NI_STRINGBUF_INIT_DYNAMIC;
+	unsigned long long smsec, fmsec;
+	ni_json_t *json1, *json2, *entry;
+	struct timeval beg, end;
+	char path[PATH_MAX];
+	char *str = NULL;
+	FILE *fp;
+
+	test_parse_document(&doc);
+	snprintf(path, sizeof(path), "/tmp/json-test.%d", (int)getpid());
+	CHECK((fp = fopen(path, "w")) != NULL);
+	CHECK(fwrite(doc.string, 1, doc.len, fp) == doc.len);
+	fclose(fp);
+
+	ni_timer_get_time(&beg);
+	CHECK((json1 = ni_json_parse_string(doc.string)));
+	ni_timer_get_time(&end);
+	smsec = ni_timeout_since(&beg, &end, NULL);
+
+	ni_timer_get_time(&beg);
+	CHECK((json2 = ni_json_parse_file(path)));
+	ni_timer_get_time(&end);
+	fmsec = ni_timeout_since(&beg, &end, NULL);
+	unlink(path);
+
+	CHECK2(ni_json_array_entries(json1) == TEST_PARSE_ENTRIES + 1,
+			"%zu bytes: string %llu, file %llu msec",
+			doc.len, smsec, fmsec);
+
+	entry = ni_json_array_get(json1, 4242);
+	CHECK(ni_json_string_get(ni_json_object_get_value(entry, "desc"), &str));
+	CHECK(ni_string_eq(str, "port \"4242\"\n\xc3\xa9\xf0\x9d\x84\x9e"));
+	ni_string_free(&str);
+	CHECK(ni_json_string_get(ni_json_array_get(json2, TEST_PARSE_ENTRIES), &str));
+	CHECK(ni_string_len(str) == TEST_PARSE_LONG_STR);
+	ni_string_free(&str);
+
+	CHECK(ni_json_format_string(&out1, json1, &options));
+	CHECK(ni_json_format_string(&out2, json2, &options));
+	CHECK(ni_string_eq(out1.string, out2.string));
+
+	ni_stringbuf_destroy(&out1);
+	ni_stringbuf_destroy(&out2);
+	ni_stringbuf_destroy(&doc);
+	ni_json_free(json1);
+	ni_json_free(json2);
+}
+
 TESTMAIN();
@@ -0,0 +1,127 @@
+/*
+ *	interfaces list index unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Checks that the ni_netdev_by_* lookups in src/netinfo.c
+ *		follow device renames, ifindex reuse and removals.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <net/if_arp.h>
+
+#include <wicked/netinfo.h>
+#include "netinfo_priv.h"
+#include "wunit.h"
+
+static ni_netconfig_t *		nc;
+
+static ni_netdev_t *
+test_netdev_new(const char *name, unsigned int ifindex)
+{
+	ni_netdev_t *dev;
+
+	if (!(dev = ni_netdev_new(name, ifindex)))
+		return NULL;
+
+	dev->link.hwaddr.type = ARPHRD_ETHER;
+	dev->link.hwaddr.len = 6;
+	dev->link.hwaddr.data[0] = 0x02;
+	dev->link.hwaddr.data[5] = ifindex;
+	ni_netconfig_device_append(nc, dev);
+	return dev;
+}
+
+TESTCASE(netdev_index_append)
+{
+	ni_netdev_t *eth0, *eth1;
+
+	CHECK((nc = ni_netconfig_new()) != NULL);
+	CHECK((eth0 = test_netdev_new("eth0", 2)) != NULL);
+	CHECK((eth1 = test_netdev_new("eth1", 3)) != NULL);
+
+	CHECK(ni_netdev_by_name(nc, "eth0") == eth0);
+	CHECK(ni_netdev_by_index(nc, 2) == eth0);
+	CHECK(ni_netdev_by_hwaddr(nc, &eth0->link.hwaddr) == eth0);
+	CHECK(ni_netdev_by_name(nc, "eth1") == eth1);
+	CHECK(ni_netdev_by_index(nc, 3) == eth1);
+}
+
+TESTCASE(netdev_index_rename)
+{
+	ni_netdev_t *eth0 = ni_netdev_by_index(nc, 2);
+
+	CHECK(eth0 && ni_netdev_set_name(eth0, "lan0"));
+	CHECK(ni_netdev_by_name(nc, "eth0") == NULL);
+	CHECK(ni_netdev_by_name(nc, "lan0") == eth0);
+	CHECK(ni_netdev_by_index(nc, 2) == eth0);
+
+	/* a transiently duplicate name finds the first device */
+	CHECK(ni_netdev_set_name(ni_netdev_by_index(nc, 3), "lan0"));
+	CHECK(ni_netdev_by_name(nc, "lan0") == eth0);
+	CHECK(ni_netdev_set_name(ni_netdev_by_index(nc, 3), "eth1"));
+	CHECK(ni_netdev_by_name(nc, "eth1") == ni_netdev_by_index(nc, 3));
+}
+
+TESTCASE(netdev_index_reuse)
+{
+	ni_netdev_t *eth1, *eth2;
+	ni_hwaddr_t hwaddr;
+
+	/* the kernel reuses the ifindex of a removed device */
+	CHECK((eth1 = ni_netdev_get(ni_netdev_by_index(nc, 3))) != NULL);
+	hwaddr = eth1->link.hwaddr;
+	ni_netconfig_device_remove(nc, eth1);
+	CHECK(ni_netdev_by_index(nc, 3) == NULL);
+	CHECK(ni_netdev_by_name(nc, "eth1") == NULL);
+	CHECK(ni_netdev_by_hwaddr(nc, &hwaddr) == NULL);
+
+	CHECK((eth2 = test_netdev_new("eth2", 3)) != NULL);
+	CHECK(ni_netdev_by_index(nc, 3) == eth2);
+	CHECK(ni_netdev_by_hwaddr(nc, &hwaddr) == eth2);
+
+	/* a removed device does not modify the index any more */
+	CHECK(ni_netdev_set_name(eth1, "eth2"));
+	CHECK(ni_netdev_by_name(nc, "eth2") == eth2);
+	CHECK(ni_netdev_set_name(eth1, "eth1"));
+	CHECK(ni_netdev_by_name(nc, "eth1") == NULL);
+	ni_netdev_put(eth1);
+}
+
+TESTCASE(netdev_index_remove)
+{
+	ni_netdev_t *lan0 = ni_netdev_by_name(nc, "lan0");
+
+	CHECK(lan0 != NULL);
+	ni_netconfig_device_remove(nc, lan0);
+	CHECK(ni_netdev_by_name(nc, "lan0") == NULL);
+	CHECK(ni_netdev_by_index(nc, 2) == NULL);
+	CHECK(ni_netdev_by_index(nc, 3) == ni_netdev_by_name(nc, "eth2"));
+	CHECK(ni_netconfig_devlist(nc) == ni_netdev_by_name(nc, "eth2"));
+}
+
+TESTCASE(netdev_index_cleanup)
+{
+	ni_netconfig_free(nc);
+	nc = NULL;
+}
+
+TESTMAIN();
@@ -0,0 +1,317 @@
+/*
+ *	rtnetlink NEWLINK event unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Feeds bursts of RTM_NEWLINK messages as read from the event
+ *		socket using mocked socket calls to src/ifevent.c and counts
+ *		the interface name queries and the detected renames.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <linux/if.h>
+#include <net/if_arp.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/socket.h>
+#include <wicked/time.h>
+#include "netinfo_priv.h"
+#include "poll-mock.h"
+#include "wunit.h"
+
+#define TEST_DEVICES		1000
+#define TEST_FIRST_IFINDEX	100
+#define TEST_FLAPS		20
+#define TEST_CHUNK_SIZE		32768
+
+/*
+ * Mocked socket calls: the event socket returns the queued messages
+ * in chunks as the kernel does and if_indextoname resolves the current
+ * device names, poll-mock.c reports all sockets readable.
+ */
+static struct {
+	ni_bool_t	listening;
+	int		event_fd;
+
+	unsigned char	queue[TEST_DEVICES * 128];
+	size_t		queued;
+	size_t		offset;
+	size_t		chunk;
+
+	char		names[TEST_DEVICES][IFNAMSIZ];
+	unsigned int	name_queries;
+} mock = { .event_fd = -1 };
+
+static struct {
+	unsigned int	create;
+	unsigned int	rename;
+	unsigned int	link_up;
+	unsigned int	link_down;
+} events;
+
+int
+socket(int domain, int type, int protocol)
+{
+	int fd = syscall(SYS_socket, domain, type, protocol);
+
+	if (domain == AF_NETLINK && mock.listening && mock.event_fd < 0)
+		mock.event_fd = fd;
+	return fd;
+}
+
+/* the next chunk of whole messages, up to the chunk size */
+static size_t
+mock_chunk_len(void)
+{
+	const struct nlmsghdr *h;
+	size_t len = 0;
+
+	while (mock.offset + len < mock.queued) {
+		h = (const struct nlmsghdr *)(mock.queue + mock.offset + len);
+		if (len + NLMSG_ALIGN(h->nlmsg_len) > TEST_CHUNK_SIZE)
+			break;
+		len += NLMSG_ALIGN(h->nlmsg_len);
+	}
+	return len;
+}
+
+ssize_t
+recvmsg(int fd, struct msghdr *msg, int flags)
+{
+	struct sockaddr_nl *nla = msg->msg_name;
+	size_t len, full;
+
+	if (fd != mock.event_fd || mock.event_fd < 0)
+		return syscall(SYS_recvmsg, fd, msg, flags);
+
+	if (!mock.chunk)
+		mock.chunk = mock_chunk_len();
+	if (!mock.chunk) {
+		mock.queued = mock.offset = 0;
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (nla && msg->msg_namelen >= sizeof(*nla)) {
+		memset(nla, 0, sizeof(*nla));
+		nla->nl_family = AF_NETLINK;
+		msg->msg_namelen = sizeof(*nla);
+	}
+	msg->msg_controllen = 0;
+	msg->msg_flags = 0;
+
+	len = full = mock.chunk;
+	if (len > msg->msg_iov[0].iov_len) {
+		len = msg->msg_iov[0].iov_len;
+		msg->msg_flags |= MSG_TRUNC;
+	}
+	memcpy(msg->msg_iov[0].iov_base, mock.queue + mock.offset, len);
+
+	if (!(flags & MSG_PEEK)) {
+		mock.offset += mock.chunk;
+		mock.chunk = 0;
+	}
+
+	/* MSG_TRUNC returns the real length, used by libnl to peek */
+	return (flags & MSG_TRUNC) ? (ssize_t)full : (ssize_t)len;
+}
+
+char *
+if_indextoname(unsigned int ifindex, char ifname[IFNAMSIZ])
+{
+	unsigned int n = ifindex - TEST_FIRST_IFINDEX;
+
+	mock.name_queries++;
+	if (ifindex < TEST_FIRST_IFINDEX || n >= TEST_DEVICES || !mock.names[n][0]) {
+		errno = ENXIO;
+		return NULL;
+	}
+	return strcpy(ifname, mock.names[n]);
+}
+
+static void
+queue_attr(struct nlmsghdr *h, unsigned short type, const void *data, size_t len)
+{
+	struct rtattr *rta;
+
+	rta = (struct rtattr *)((unsigned char *)h + NLMSG_ALIGN(h->nlmsg_len));
+	rta->rta_type = type;
+	rta->rta_len = RTA_LENGTH(len);
+	memcpy(RTA_DATA(rta), data, len);
+	h->nlmsg_len = NLMSG_ALIGN(h->nlmsg_len) + RTA_ALIGN(rta->rta_len);
+}
+
+/*
+ * Queue a NEWLINK of an ethernet device as sent on carrier changes
+ */
+static void
+queue_newlink(unsigned int n, const char *name, ni_bool_t carrier)
+{
+	unsigned char hwaddr[6] = { 0x02, 0x00, 0x00, 0x00, n >> 8, n & 0xff };
+	unsigned char operstate = carrier ? IF_OPER_UP : IF_OPER_DOWN;
+	unsigned int mtu = 1500;
+	struct ifinfomsg *ifi;
+	struct nlmsghdr *h;
+
+	h = (struct nlmsghdr *)(mock.queue + mock.queued);
+	memset(h, 0, 128);
+	h->nlmsg_type = RTM_NEWLINK;
+	h->nlmsg_len = NLMSG_LENGTH(sizeof(*ifi));
+
+	ifi = NLMSG_DATA(h);
+	ifi->ifi_family = AF_UNSPEC;
+	ifi->ifi_type = ARPHRD_ETHER;
+	ifi->ifi_index = TEST_FIRST_IFINDEX + n;
+	ifi->ifi_flags = IFF_UP | IFF_BROADCAST | IFF_MULTICAST;
+	if (carrier)
+		ifi->ifi_flags |= IFF_RUNNING | IFF_LOWER_UP;
+
+	queue_attr(h, IFLA_IFNAME, name, strlen(name) + 1);
+	queue_attr(h, IFLA_MTU, &mtu, sizeof(mtu));
+	queue_attr(h, IFLA_OPERSTATE, &operstate, sizeof(operstate));
+	queue_attr(h, IFLA_ADDRESS, hwaddr, sizeof(hwaddr));
+
+	mock.queued += NLMSG_ALIGN(h->nlmsg_len);
+}
+
+static void
+process_queue(void)
+{
+	poll_mock_readable = TRUE;
+	while (mock.queued && ni_socket_wait(0) == 0)
+		;
+	poll_mock_readable = FALSE;
+}
+
+static void
+newlink_handler(ni_netdev_t *dev, ni_event_t event)
+{
+	switch (event) {
+	case NI_EVENT_DEVICE_CREATE:
+		events.create++;
+		break;
+	case NI_EVENT_DEVICE_RENAME:
+		events.rename++;
+		break;
+	case NI_EVENT_LINK_UP:
+		events.link_up++;
+		break;
+	case NI_EVENT_LINK_DOWN:
+		events.link_down++;
+		break;
+	default:
+		break;
+	}
+}
+
+TESTCASE(newlink_setup)
+{
+	ni_global.initialized = 1;
+	CHECK(ni_global_state_handle(0) != NULL);
+
+	mock.listening = TRUE;
+	CHECK2(ni_server_listen_interface_events(newlink_handler) == 0,
+			"listening to rtnetlink events");
+	mock.listening = FALSE;
+	CHECK2(mock.event_fd >= 0, "mocking event socket %d", mock.event_fd);
+}
+
+TESTCASE(newlink_create)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	unsigned int n;
+
+	for (n = 0; n < TEST_DEVICES; ++n) {
+		snprintf(mock.names[n], IFNAMSIZ, "sw%u", n);
+		queue_newlink(n, mock.names[n], FALSE);
+	}
+	process_queue();
+
+	CHECK2(events.create == TEST_DEVICES, "created %u devices", events.create);
+	CHECK(ni_netdev_by_name(nc, "sw0") && ni_netdev_by_name(nc, "sw999"));
+}
+
+TESTCASE(newlink_carrier_flaps)
+{
+	struct timeval beg, end;
+	ni_rtevent_stats_t stats;
+	unsigned int n, f;
+
+	mock.name_queries = 0;
+	events.link_up = events.link_down = 0;
+
+	ni_timer_get_time(&beg);
+	for (f = 0; f < TEST_FLAPS; ++f) {
+		for (n = 0; n < TEST_DEVICES; ++n)
+			queue_newlink(n, mock.names[n], !(f % 2));
+		process_queue();
+	}
+	ni_timer_get_time(&end);
+
+	ni_server_interface_event_stats(&stats);
+	CHECK2(events.link_up == TEST_DEVICES * TEST_FLAPS / 2 &&
+		events.link_down == TEST_DEVICES * TEST_FLAPS / 2,
+			"%u events in %llu msec", TEST_DEVICES * TEST_FLAPS,
+			ni_timeout_since(&beg, &end, NULL));
+	CHECK2(mock.name_queries == 0, "%u interface name queries", mock.name_queries);
+	CHECK2(stats.renames == 0 && events.rename == 0, "no renames");
+}
+
+TESTCASE(newlink_rename)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_rtevent_stats_t stats;
+	ni_netdev_t *dev;
+
+	/* a rename is detected from the name in the event */
+	mock.name_queries = 0;
+	snprintf(mock.names[5], IFNAMSIZ, "uplink5");
+	queue_newlink(5, mock.names[5], TRUE);
+	process_queue();
+
+	ni_server_interface_event_stats(&stats);
+	CHECK2(stats.renames == 1 && events.rename == 1, "renames: %u", stats.renames);
+	CHECK2(mock.name_queries == 1, "%u interface name query", mock.name_queries);
+	CHECK((dev = ni_netdev_by_name(nc, "uplink5")) && dev->link.ifindex == TEST_FIRST_IFINDEX + 5);
+	CHECK(ni_netdev_by_name(nc, "sw5") == NULL);
+
+	/* an obsolete name in the event does not rename the device back */
+	mock.name_queries = 0;
+	queue_newlink(5, "sw5", TRUE);
+	process_queue();
+
+	ni_server_interface_event_stats(&stats);
+	CHECK2(stats.renames == 1 && events.rename == 1, "obsolete name ignored");
+	CHECK2(mock.name_queries == 1, "%u interface name query", mock.name_queries);
+	CHECK(ni_netdev_by_name(nc, "uplink5") == dev);
+}
+
+TESTCASE(newlink_cleanup)
+{
+	ni_server_deactivate_interface_events();
+}
+
+TESTMAIN();
@@ -0,0 +1,234 @@
+/*
+ *	netlink batch unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Sends batched requests using the ni_nl_batch functions in
+ *		src/kernel.c to a mocked netlink socket, which acks them
+ *		with a per-request status, and checks that the ACKs are
+ *		collected across the chunks sent.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <netlink/socket.h>
+#include <netlink/msg.h>
+#include <netlink/errno.h>
+
+#include <wicked/netinfo.h>
+#include "netinfo_priv.h"
+#include "kernel.h"
+#include "wunit.h"
+
+#define TEST_REQUESTS		200
+#define TEST_FAILING		77
+#define TEST_MAX_ACKS		1024
+#define TEST_CHUNK_SIZE		32768
+
+/*
+ * Mocked netlink socket: every request sent on the global netlink
+ * socket is acked, the TEST_FAILING request with an EEXIST error.
+ * The ACKs are delivered in kernel sized chunks.
+ */
+static struct {
+	int		fd;
+	struct {
+		struct nlmsghdr	req;
+		int		error;
+	}		acks[TEST_MAX_ACKS];
+	unsigned int	head;		/* next ack to deliver */
+	unsigned int	tail;		/* next request to ack */
+	unsigned int	sends;
+	unsigned int	sends_before_recv;
+	unsigned int	max_inflight;
+	unsigned int	recvs;
+} mock = { .fd = -1 };
+
+static struct {
+	unsigned int	done;
+	unsigned int	failed;
+	int		result[TEST_REQUESTS];
+} test;
+
+ssize_t
+sendto(int fd, const void *buf, size_t len, int flags,
+		const struct sockaddr *addr, socklen_t alen)
+{
+	const struct nlmsghdr *h = buf;
+	size_t left = len;
+
+	if (fd != mock.fd)
+		return syscall(SYS_sendto, fd, buf, len, flags, addr, alen);
+
+	for (; NLMSG_OK(h, left); h = NLMSG_NEXT(h, left)) {
+		if (mock.tail >= TEST_MAX_ACKS) {
+			errno = ENOBUFS;
+			return -1;
+		}
+		mock.acks[mock.tail].req = *h;
+		mock.acks[mock.tail].error = mock.tail == TEST_FAILING ? -EEXIST : 0;
+		mock.tail++;
+	}
+
+	mock.sends++;
+	if (!mock.recvs)
+		mock.sends_before_recv++;
+	if (mock.tail - mock.head > mock.max_inflight)
+		mock.max_inflight = mock.tail - mock.head;
+	return len;
+}
+
+static size_t
+mock_fill_chunk(unsigned char *chunk, size_t size)
+{
+	struct nlmsghdr *h;
+	struct nlmsgerr *e;
+	size_t len = 0;
+
+	while (mock.head < mock.tail && len + NLMSG_SPACE(sizeof(*e)) <= size) {
+		h = (struct nlmsghdr *)(chunk + len);
+		memset(h, 0, NLMSG_SPACE(sizeof(*e)));
+		h->nlmsg_type = NLMSG_ERROR;
+		h->nlmsg_len = NLMSG_LENGTH(sizeof(*e));
+		h->nlmsg_seq = mock.acks[mock.head].req.nlmsg_seq;
+		h->nlmsg_pid = mock.acks[mock.head].req.nlmsg_pid;
+		e = NLMSG_DATA(h);
+		e->error = mock.acks[mock.head].error;
+		e->msg = mock.acks[mock.head].req;
+		len += NLMSG_ALIGN(h->nlmsg_len);
+		mock.head++;
+	}
+	return len;
+}
+
+ssize_t
+recvmsg(int fd, struct msghdr *msg, int flags)
+{
+	static unsigned char chunk[TEST_CHUNK_SIZE];
+	static size_t pending;
+	struct sockaddr_nl *nla = msg->msg_name;
+	size_t len, full;
+
+	if (fd != mock.fd)
+		return syscall(SYS_recvmsg, fd, msg, flags);
+
+	if (!pending)
+		pending = mock_fill_chunk(chunk, sizeof(chunk));
+	if (!pending) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (nla && msg->msg_namelen >= sizeof(*nla)) {
+		memset(nla, 0, sizeof(*nla));
+		nla->nl_family = AF_NETLINK;
+		msg->msg_namelen = sizeof(*nla);
+	}
+	msg->msg_controllen = 0;
+	msg->msg_flags = 0;
+
+	len = full = pending;
+	if (len > msg->msg_iov[0].iov_len) {
+		len = msg->msg_iov[0].iov_len;
+		msg->msg_flags |= MSG_TRUNC;
+	}
+	memcpy(msg->msg_iov[0].iov_base, chunk, len);
+
+	if (!(flags & MSG_PEEK)) {
+		pending = 0;
+		mock.recvs++;
+	}
+
+	/* MSG_TRUNC returns the real length, used by libnl to peek */
+	return (flags & MSG_TRUNC) ? (ssize_t)full : (ssize_t)len;
+}
+
+static void
+test_request_done(ni_nl_batch_t *batch, int err, void *user_data)
+{
+	unsigned int *n = user_data;
+
+	test.result[*n] = err;
+	test.done++;
+	if (err < 0)
+		test.failed++;
+}
+
+TESTCASE(nlbatch_setup)
+{
+	ni_global.initialized = 1;
+
+	CHECK(ni_global_state_handle(0) != NULL);
+	CHECK(__ni_global_netlink && __ni_global_netlink->nl_sock);
+	mock.fd = nl_socket_get_fd(__ni_global_netlink->nl_sock);
+	CHECK2(mock.fd >= 0, "mocking global netlink socket %d", mock.fd);
+}
+
+TESTCASE(nlbatch_acks)
+{
+	static unsigned int index[TEST_REQUESTS];
+	struct rtmsg rtm;
+	struct nl_msg *msg;
+	ni_nl_batch_t *batch;
+	unsigned int n, added = 0, ok = 0;
+
+	CHECK((batch = ni_nl_batch_new()) != NULL);
+	memset(&rtm, 0, sizeof(rtm));
+	rtm.rtm_family = AF_INET;
+	for (n = 0; n < TEST_REQUESTS; ++n) {
+		index[n] = n;
+		test.result[n] = 1;
+		msg = nlmsg_alloc_simple(RTM_NEWROUTE, NLM_F_CREATE | NLM_F_EXCL);
+		if (!msg || nlmsg_append(msg, &rtm, sizeof(rtm), NLMSG_ALIGNTO) < 0)
+			break;
+		if (ni_nl_batch_add(batch, msg, test_request_done, &index[n]) == 0)
+			added++;
+	}
+	CHECK2(added == TEST_REQUESTS, "%u requests queued", added);
+
+	CHECK(ni_nl_batch_flush(batch) == 1);
+	ni_nl_batch_free(batch);
+	CHECK2(test.done == TEST_REQUESTS && test.failed == 1,
+			"%u requests done, %u failed", test.done, test.failed);
+
+	for (n = 0; n < TEST_REQUESTS; ++n) {
+		if (n == TEST_FAILING)
+			CHECK2(test.result[n] == -NLE_EXIST, "request %u: %d", n, test.result[n]);
+		else if (test.result[n] == 0)
+			ok++;
+	}
+	CHECK2(ok == TEST_REQUESTS - 1, "%u requests acked", ok);
+
+	/* the next chunk is sent before the ACKs of the previous arrived */
+	CHECK2(mock.sends > 1 && mock.sends_before_recv > 1,
+			"%u chunks, %u sent before the first recv, at most %u in flight",
+			mock.sends, mock.sends_before_recv, mock.max_inflight);
+	CHECK(mock.max_inflight < TEST_REQUESTS);
+	CHECK(mock.head == mock.tail);
+}
+
+TESTMAIN();
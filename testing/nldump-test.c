@@ -0,0 +1,322 @@
+/*
+ *	netlink dump unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Feeds a generated route dump using mocked netlink socket
+ *		calls to the dump functions in src/kernel.c and to the
+ *		route refresh in src/iflist.c.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <netlink/socket.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/route.h>
+#include <wicked/time.h>
+#include "netinfo_priv.h"
+#include "kernel.h"
+#include "wunit.h"
+
+#define TEST_DUMP_ROUTES	1000000
+#define TEST_REFRESH_ROUTES	100000
+#define TEST_IFINDEX		4242
+#define TEST_CHUNK_SIZE		32768
+
+/*
+ * Mocked netlink socket: the dump request sent on the global netlink
+ * socket is answered with generated RTM_NEWROUTE messages, delivered
+ * in kernel sized chunks.
+ */
+static struct {
+	int		fd;
+	uint32_t	seq;
+	uint32_t	pid;
+	unsigned int	total;		/* routes to dump */
+	unsigned int	next;		/* next route to generate */
+	ni_bool_t	done;		/* NLMSG_DONE sent */
+	unsigned char	chunk[TEST_CHUNK_SIZE];
+	size_t		len;		/* pending chunk length */
+} mock = { .fd = -1 };
+
+static size_t
+mock_route_msg(unsigned char *buf, unsigned int n)
+{
+	struct nlmsghdr *h = (struct nlmsghdr *)buf;
+	struct rtmsg *rtm;
+	struct rtattr *rta;
+	uint32_t u32, dst, gw;
+
+	memset(buf, 0, NLMSG_SPACE(sizeof(*rtm)));
+	h->nlmsg_type = RTM_NEWROUTE;
+	h->nlmsg_flags = NLM_F_MULTI;
+	h->nlmsg_seq = mock.seq;
+	h->nlmsg_pid = mock.pid;
+	h->nlmsg_len = NLMSG_LENGTH(sizeof(*rtm));
+
+	rtm = NLMSG_DATA(h);
+	rtm->rtm_family = AF_INET;
+	rtm->rtm_dst_len = 24;
+	rtm->rtm_table = RT_TABLE_MAIN;
+	rtm->rtm_protocol = RTPROT_BGP;
+	rtm->rtm_scope = RT_SCOPE_UNIVERSE;
+	rtm->rtm_type = RTN_UNICAST;
+
+#define add_attr(type, value) do { \
+		rta = (struct rtattr *)(buf + NLMSG_ALIGN(h->nlmsg_len)); \
+		rta->rta_type = type; \
+		rta->rta_len = RTA_LENGTH(sizeof(value)); \
+		memcpy(RTA_DATA(rta), &value, sizeof(value)); \
+		h->nlmsg_len = NLMSG_ALIGN(h->nlmsg_len) + RTA_ALIGN(rta->rta_len); \
+	} while (0)
+
+	u32 = RT_TABLE_MAIN;
+	add_attr(RTA_TABLE, u32);
+	dst = htonl(0x0a000000 | (n << 8));
+	add_attr(RTA_DST, dst);
+	gw = htonl(0xc0a80101);
+	add_attr(RTA_GATEWAY, gw);
+	u32 = TEST_IFINDEX;
+	add_attr(RTA_OIF, u32);
+#undef add_attr
+
+	return NLMSG_ALIGN(h->nlmsg_len);
+}
+
+static size_t
+mock_done_msg(unsigned char *buf)
+{
+	struct nlmsghdr *h = (struct nlmsghdr *)buf;
+
+	memset(buf, 0, NLMSG_SPACE(sizeof(int)));
+	h->nlmsg_type = NLMSG_DONE;
+	h->nlmsg_flags = NLM_F_MULTI;
+	h->nlmsg_seq = mock.seq;
+	h->nlmsg_pid = mock.pid;
+	h->nlmsg_len = NLMSG_LENGTH(sizeof(int));
+	return NLMSG_ALIGN(h->nlmsg_len);
+}
+
+static void
+mock_fill_chunk(void)
+{
+	unsigned char msg[256];
+	size_t len;
+
+	mock.len = 0;
+	while (mock.next < mock.total) {
+		len = mock_route_msg(msg, mock.next);
+		if (mock.len + len > sizeof(mock.chunk))
+			return;
+		memcpy(mock.chunk + mock.len, msg, len);
+		mock.len += len;
+		mock.next++;
+	}
+	if (!mock.done && mock.len + NLMSG_SPACE(sizeof(int)) <= sizeof(mock.chunk)) {
+		mock.len += mock_done_msg(mock.chunk + mock.len);
+		mock.done = TRUE;
+	}
+}
+
+ssize_t
+sendmsg(int fd, const struct msghdr *msg, int flags)
+{
+	const struct nlmsghdr *h;
+
+	if (fd != mock.fd || !msg->msg_iovlen)
+		return syscall(SYS_sendmsg, fd, msg, flags);
+
+	h = msg->msg_iov[0].iov_base;
+	mock.seq = h->nlmsg_seq;
+	mock.pid = h->nlmsg_pid;
+	mock.next = 0;
+	mock.done = FALSE;
+	mock.len = 0;
+	return msg->msg_iov[0].iov_len;
+}
+
+ssize_t
+recvmsg(int fd, struct msghdr *msg, int flags)
+{
+	struct sockaddr_nl *nla = msg->msg_name;
+	size_t len, full;
+
+	if (fd != mock.fd)
+		return syscall(SYS_recvmsg, fd, msg, flags);
+
+	if (!mock.len)
+		mock_fill_chunk();
+	if (!mock.len) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (nla && msg->msg_namelen >= sizeof(*nla)) {
+		memset(nla, 0, sizeof(*nla));
+		nla->nl_family = AF_NETLINK;
+		msg->msg_namelen = sizeof(*nla);
+	}
+	msg->msg_controllen = 0;
+	msg->msg_flags = 0;
+
+	len = full = mock.len;
+	if (len > msg->msg_iov[0].iov_len) {
+		len = msg->msg_iov[0].iov_len;
+		msg->msg_flags |= MSG_TRUNC;
+	}
+	memcpy(msg->msg_iov[0].iov_base, mock.chunk, len);
+
+	if (!(flags & MSG_PEEK))
+		mock.len = 0;
+
+	/* MSG_TRUNC returns the real length, used by libnl to peek */
+	return (flags & MSG_TRUNC) ? (ssize_t)full : (ssize_t)len;
+}
+
+static void
+count_route(struct nlmsghdr *h, void *user_data)
+{
+	unsigned int *count = user_data;
+
+	if (ni_rtnl_rtmsg(h, RTM_NEWROUTE))
+		(*count)++;
+}
+
+TESTCASE(nldump_setup)
+{
+	ni_global.initialized = 1;
+
+	CHECK(ni_global_state_handle(0) != NULL);
+	CHECK(__ni_global_netlink && __ni_global_netlink->nl_sock);
+	mock.fd = nl_socket_get_fd(__ni_global_netlink->nl_sock);
+	CHECK2(mock.fd >= 0, "mocking global netlink socket %d", mock.fd);
+}
+
+TESTCASE(nldump_store_vs_foreach)
+{
+	struct ni_nlmsg_list list;
+	struct ni_nlmsg *entry;
+	struct timeval beg, end;
+	unsigned int count;
+	size_t bytes;
+
+	/* store every reply in a list, then parse */
+	mock.total = TEST_DUMP_ROUTES;
+	ni_nlmsg_list_init(&list);
+	count = 0;
+	bytes = 0;
+	ni_timer_get_time(&beg);
+	CHECK(ni_nl_dump_store(AF_INET, RTM_GETROUTE, &list) == 0);
+	for (entry = list.head; entry; entry = entry->next) {
+		bytes += entry->h.nlmsg_len;
+		count_route(&entry->h, &count);
+	}
+	ni_nlmsg_list_destroy(&list);
+	ni_timer_get_time(&end);
+	CHECK2(count == TEST_DUMP_ROUTES, "stored %u routes (%zu MB) in %llu msec",
+			count, bytes >> 20, ni_timeout_since(&beg, &end, NULL));
+
+	/* parse each reply in place */
+	count = 0;
+	ni_timer_get_time(&beg);
+	CHECK(ni_nl_dump_foreach(AF_INET, RTM_GETROUTE, count_route, &count) == 0);
+	ni_timer_get_time(&end);
+	CHECK2(count == TEST_DUMP_ROUTES, "streamed %u routes in %llu msec",
+			count, ni_timeout_since(&beg, &end, NULL));
+}
+
+TESTCASE(nldump_refresh_routes)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	struct timeval beg, end;
+	ni_route_table_t *tab;
+	unsigned int count;
+	ni_netdev_t *dev;
+
+	CHECK((dev = ni_netdev_new("nldump0", TEST_IFINDEX)) != NULL);
+	ni_netconfig_device_append(nc, dev);
+
+	mock.total = TEST_REFRESH_ROUTES;
+	ni_timer_get_time(&beg);
+	CHECK(__ni_system_refresh_routes(nc) == 0);
+	ni_timer_get_time(&end);
+
+	count = 0;
+	for (tab = dev->routes; tab; tab = tab->next)
+		count += tab->routes.count;
+	CHECK2(count == TEST_REFRESH_ROUTES, "refreshed %u device routes in %llu msec",
+			count, ni_timeout_since(&beg, &end, NULL));
+
+	/* routes vanished from the dump are dropped, the others replaced */
+	mock.total = TEST_REFRESH_ROUTES / 2;
+	ni_timer_get_time(&beg);
+	CHECK(__ni_system_refresh_routes(nc) == 0);
+	ni_timer_get_time(&end);
+
+	count = 0;
+	for (tab = dev->routes; tab; tab = tab->next)
+		count += tab->routes.count;
+	CHECK2(count == TEST_REFRESH_ROUTES / 2, "%u device routes after refresh in %llu msec",
+			count, ni_timeout_since(&beg, &end, NULL));
+}
+
+TESTCASE(route_table_delete_keeps_order)
+{
+	ni_route_table_t *list = NULL;
+	ni_route_t *rp, *dup;
+	ni_sockaddr_t dest;
+	unsigned char *octet;
+	unsigned int i;
+	char buf[32];
+
+	for (i = 0; i < 64; ++i) {
+		snprintf(buf, sizeof(buf), "10.0.%u.0", i);
+		CHECK(ni_sockaddr_parse(&dest, buf, AF_INET) == 0);
+		CHECK(ni_route_create(24, &dest, NULL, RT_TABLE_MAIN, &list) != NULL);
+	}
+	CHECK(list && list->routes.count == 64);
+
+	/* a second route with the key of the 6th one, appended */
+	rp = list->routes.data[5];
+	CHECK((dup = ni_route_clone(rp)) && ni_route_tables_add_route(&list, dup));
+	CHECK(ni_route_tables_find_match(list, dup, ni_route_equal_destination) == rp);
+
+	/* indexed delete preserves the array order and the first match */
+	CHECK(ni_route_tables_del_route(list, rp));
+	CHECK(ni_route_tables_find_match(list, dup, ni_route_equal_destination) == dup);
+	CHECK(list->routes.count == 64);
+	CHECK(list->routes.data[63] == dup);
+	for (i = 0; i < 63; ++i) {
+		octet = (unsigned char *)&list->routes.data[i]->destination.sin.sin_addr;
+		CHECK2(octet[2] == (i < 5 ? i : i + 1), "route %u in order", i);
+	}
+
+	ni_route_tables_destroy(&list);
+}
+
+TESTMAIN();
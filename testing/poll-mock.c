@@ -0,0 +1,61 @@
+/*
+ *	Shared poll mock for the unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#ifdef NI_SOCKET_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include "poll-mock.h"
+
+ni_bool_t	poll_mock_readable = FALSE;
+
+/*
+ * glibc declares the poll fds write only, so the mock does not read
+ * the requested events (-Wmaybe-uninitialized), the tests wait for
+ * input on all sockets anyway.
+ */
+int
+poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	nfds_t i;
+
+	if (!poll_mock_readable)
+		return syscall(SYS_poll, fds, nfds, timeout);
+
+	for (i = 0; i < nfds; ++i)
+		fds[i].revents = POLLIN;
+	return nfds;
+}
+
+#ifdef NI_SOCKET_EPOLL
+int
+epoll_create1(int flags)
+{
+	/* use the poll backend to be able to fake readable sockets */
+	errno = ENOSYS;
+	return -1;
+}
+#endif
@@ -0,0 +1,31 @@
+/*
+ *	Shared poll mock for the unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WICKED_TESTING_POLL_MOCK_H
+#define WICKED_TESTING_POLL_MOCK_H
+
+#include <wicked/types.h>
+
+/*
+ * Linking poll-mock.c forces the poll socket backend. While readable
+ * is set, poll reports all sockets waiting for input as readable,
+ * otherwise it calls the real poll.
+ */
+extern ni_bool_t	poll_mock_readable;
+
+#endif /* WICKED_TESTING_POLL_MOCK_H */
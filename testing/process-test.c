@@ -0,0 +1,199 @@
+/*
+ *	subprocess runner unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Runs short-lived processes using src/process.c and checks
+ *		that no descriptors or children leak.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include <wicked/util.h>
+#include <wicked/time.h>
+#include "buffer.h"
+#include "process.h"
+#include "wunit.h"
+
+#define TEST_PROCESS_COUNT	1000
+#define TEST_EXEC_COUNT		100
+
+static int	canary_fd = -1;
+
+static unsigned int
+open_fd_count(void)
+{
+	unsigned int count = 0;
+	struct dirent *d;
+	DIR *dir;
+
+	if (!(dir = opendir("/proc/self/fd")))
+		return 0;
+
+	while ((d = readdir(dir)) != NULL) {
+		if (d->d_name[0] != '.')
+			count++;
+	}
+	closedir(dir);
+	return count - 1;	/* the dir fd */
+}
+
+static ni_bool_t
+no_zombies(void)
+{
+	return waitpid(-1, NULL, WNOHANG) < 0 && errno == ECHILD;
+}
+
+/*
+ * Open a descriptor without close-on-exec at the top of the
+ * descriptor table; the children must not inherit it.
+ */
+static int
+open_canary_fd(void)
+{
+	struct rlimit rlim;
+	int fd, top;
+
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur < rlim.rlim_max) {
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+
+	top = getdtablesize() - 1;
+	if ((fd = open("/dev/null", O_RDONLY)) < 0)
+		return -1;
+	if (dup2(fd, top) < 0) {
+		close(fd);
+		return -1;
+	}
+	close(fd);
+	return top;
+}
+
+static ni_process_t *
+canary_check_process(void)
+{
+	ni_string_array_t argv = NI_STRING_ARRAY_INIT;
+	ni_shellcmd_t *cmd;
+	ni_process_t *pi;
+	char path[64];
+
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", canary_fd);
+	ni_string_array_append(&argv, "/usr/bin/test");
+	ni_string_array_append(&argv, "!");
+	ni_string_array_append(&argv, "-e");
+	ni_string_array_append(&argv, path);
+
+	cmd = ni_shellcmd_new(&argv);
+	ni_string_array_destroy(&argv);
+	if (!cmd)
+		return NULL;
+
+	pi = ni_process_new(cmd);
+	ni_shellcmd_free(cmd);
+	return pi;
+}
+
+static int
+canary_check_exec(int argc, char *const argv[], char *const envp[])
+{
+	return fcntl(canary_fd, F_GETFD) < 0 && errno == EBADF ? 0 : 1;
+}
+
+TESTCASE(process_run_no_leaks)
+{
+	unsigned int i, fds, failed = 0;
+	struct timeval beg, end;
+	ni_buffer_t out;
+	ni_process_t *pi;
+	int rv;
+
+	canary_fd = open_canary_fd();
+	CHECK2(canary_fd > 2, "canary descriptor %d", canary_fd);
+	fds = open_fd_count();
+
+	ni_buffer_init_dynamic(&out, 256);
+	ni_timer_get_time(&beg);
+	for (i = 0; i < TEST_PROCESS_COUNT; ++i) {
+		if (!(pi = canary_check_process())) {
+			failed++;
+			continue;
+		}
+
+		/* alternate between the plain and the output capture runner */
+		if (i % 2)
+			rv = ni_process_run_and_capture_output(pi, &out);
+		else
+			rv = ni_process_run_and_wait(pi);
+		if (rv != 0)
+			failed++;
+
+		ni_process_free(pi);
+	}
+	ni_timer_get_time(&end);
+	ni_buffer_destroy(&out);
+
+	CHECK2(failed == 0, "%u of %u processes ok in %llu msec",
+			TEST_PROCESS_COUNT - failed, TEST_PROCESS_COUNT,
+			ni_timeout_since(&beg, &end, NULL));
+	CHECK2(open_fd_count() == fds, "no descriptors leaked (%u open)", fds);
+	CHECK2(no_zombies(), "all processes reaped");
+}
+
+TESTCASE(process_exec_no_leaks)
+{
+	unsigned int i, fds, failed = 0;
+	ni_process_t *pi;
+
+	CHECK(canary_fd > 2);
+	fds = open_fd_count();
+
+	/* the forked children exit() and would flush our output again */
+	fflush(NULL);
+
+	for (i = 0; i < TEST_EXEC_COUNT; ++i) {
+		if (!(pi = canary_check_process())) {
+			failed++;
+			continue;
+		}
+
+		pi->exec = canary_check_exec;
+		if (ni_process_run_and_wait(pi) != 0)
+			failed++;
+
+		ni_process_free(pi);
+	}
+
+	CHECK2(failed == 0, "%u of %u exec callbacks without inherited descriptor",
+			TEST_EXEC_COUNT - failed, TEST_EXEC_COUNT);
+	CHECK2(open_fd_count() == fds, "no descriptors leaked (%u open)", fds);
+	CHECK2(no_zombies(), "all processes reaped");
+
+	close(canary_fd);
+}
+
+TESTMAIN();
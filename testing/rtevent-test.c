@@ -0,0 +1,209 @@
+/*
+ *	rtnetlink event overrun unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Injects an ENOBUFS event socket overrun using mocked socket
+ *		calls and checks the device and address events of the state
+ *		resync in src/ifevent.c
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/if_addr.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/socket.h>
+#include <wicked/time.h>
+#include "netinfo_priv.h"
+#include "appconfig.h"
+#include "poll-mock.h"
+#include "wunit.h"
+
+static struct {
+	unsigned int	inject_enobufs;
+	unsigned int	netlink_sockets;
+} mock;
+
+static struct {
+	unsigned int	create;
+	unsigned int	delete;
+	ni_bool_t	loopback;
+	unsigned int	addr_update;
+	unsigned int	addr_delete;
+	unsigned int	addr_flags;
+} events;
+
+/*
+ * Mocked socket calls: recvmsg fails with ENOBUFS while there are
+ * overruns to inject, poll-mock.c reports all sockets readable.
+ */
+ssize_t
+recvmsg(int fd, struct msghdr *msg, int flags)
+{
+	if (mock.inject_enobufs) {
+		mock.inject_enobufs--;
+		errno = ENOBUFS;
+		return -1;
+	}
+	return syscall(SYS_recvmsg, fd, msg, flags);
+}
+
+int
+socket(int domain, int type, int protocol)
+{
+	if (domain == AF_NETLINK)
+		mock.netlink_sockets++;
+	return syscall(SYS_socket, domain, type, protocol);
+}
+
+static void
+rtevent_handler(ni_netdev_t *dev, ni_event_t event)
+{
+	switch (event) {
+	case NI_EVENT_DEVICE_CREATE:
+		events.create++;
+		if (ni_string_eq(dev->name, "lo"))
+			events.loopback = TRUE;
+		break;
+	case NI_EVENT_DEVICE_DELETE:
+		events.delete++;
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+rtevent_addr_handler(ni_netdev_t *dev, ni_event_t event, const ni_address_t *ap)
+{
+	switch (event) {
+	case NI_EVENT_ADDRESS_UPDATE:
+		events.addr_update++;
+		events.addr_flags = ap->flags;
+		break;
+	case NI_EVENT_ADDRESS_DELETE:
+		events.addr_delete++;
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+inject_overrun(void)
+{
+	mock.inject_enobufs = 1;
+	poll_mock_readable = TRUE;
+	ni_socket_wait(0);
+	poll_mock_readable = FALSE;
+	ni_timer_next_timeout();
+}
+
+TESTCASE(rtevent_overrun_resync)
+{
+	ni_rtevent_stats_t stats;
+	ni_netconfig_t *nc;
+	unsigned int sockets;
+
+	ni_global.initialized = 1;
+
+	CHECK2(ni_server_listen_interface_events(rtevent_handler) == 0,
+			"listening to rtnetlink events");
+	CHECK(ni_server_enable_interface_addr_events(rtevent_addr_handler) == 0);
+	CHECK((nc = ni_global_state_handle(0)) != NULL);
+	CHECK(ni_netconfig_devlist(nc) == NULL);
+
+	/* two overruns before the main loop runs timers */
+	sockets = mock.netlink_sockets;
+	mock.inject_enobufs = 2;
+	poll_mock_readable = TRUE;
+	CHECK(ni_socket_wait(0) == 0);
+	CHECK(ni_socket_wait(0) == 0);
+	poll_mock_readable = FALSE;
+
+	ni_server_interface_event_stats(&stats);
+	CHECK2(stats.overruns == 2, "overruns: %u", stats.overruns);
+	CHECK2(stats.resyncs == 0, "resyncs: %u", stats.resyncs);
+	CHECK2(mock.netlink_sockets == sockets, "event socket not reopened");
+
+	/* both overruns coalesce into a single resync */
+	ni_timer_next_timeout();
+	ni_timer_next_timeout();
+
+	ni_server_interface_event_stats(&stats);
+	CHECK2(stats.resyncs == 1, "resyncs: %u", stats.resyncs);
+	CHECK2(events.loopback, "loopback create event after resync");
+	CHECK(events.create > 0 && events.delete == 0);
+	CHECK(ni_netdev_by_name(nc, "lo") != NULL);
+
+	/* nothing changed, so a second resync emits no further events */
+	events.create = 0;
+	mock.inject_enobufs = 1;
+	poll_mock_readable = TRUE;
+	CHECK(ni_socket_wait(0) == 0);
+	poll_mock_readable = FALSE;
+	ni_timer_next_timeout();
+
+	ni_server_interface_event_stats(&stats);
+	CHECK2(stats.overruns == 3, "overruns: %u", stats.overruns);
+	CHECK2(stats.resyncs == 2, "resyncs: %u", stats.resyncs);
+	CHECK2(events.create == 0 && events.delete == 0, "no events without changes");
+}
+
+TESTCASE(rtevent_resync_addr_flags)
+{
+	ni_rtevent_stats_t stats;
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+	ni_address_t *ap;
+	unsigned int flags;
+
+	nc = ni_global_state_handle(0);
+	CHECK((dev = ni_netdev_by_name(nc, "lo")) != NULL);
+	CHECK((ap = dev->addrs) != NULL);
+
+	/* nothing changed: no address events */
+	memset(&events, 0, sizeof(events));
+	inject_overrun();
+	CHECK2(events.addr_update == 0 && events.addr_delete == 0,
+			"%u address updates without changes", events.addr_update);
+
+	/* the address became valid while the events were lost */
+	flags = ap->flags;
+	ap->flags |= IFA_F_TENTATIVE;
+	memset(&events, 0, sizeof(events));
+	inject_overrun();
+
+	ni_server_interface_event_stats(&stats);
+	CHECK2(stats.resyncs == 4, "resyncs: %u", stats.resyncs);
+	CHECK2(events.addr_update == 1 && events.addr_delete == 0,
+			"%u address updates after flag change", events.addr_update);
+	CHECK2(events.addr_flags == flags && ap->flags == flags, "address flags 0x%x",
+			events.addr_flags);
+
+	ni_server_deactivate_interface_events();
+}
+
+TESTMAIN();
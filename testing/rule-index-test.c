@@ -0,0 +1,209 @@
+/*
+ *	routing policy rule index unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Compares the indexed rule lookups in src/netinfo.c
+ *		against a linear scan of the rule array.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/route.h>
+#include <wicked/time.h>
+#include "netinfo_priv.h"
+#include "wunit.h"
+
+#define TEST_TENANTS		2000
+#define TEST_RULES		(TEST_TENANTS * 2)
+
+static ni_netconfig_t *		nc;
+
+/*
+ * Per tenant rules: "from 10.x.y.0/24 lookup <table>" and
+ * "fwmark <tenant> lookup <table>", with prefs in reverse
+ * order and some tenants sharing the pref.
+ */
+static ni_rule_t *
+tenant_rule(unsigned int tenant, ni_bool_t mark, ni_bool_t pref)
+{
+	ni_rule_t *rule;
+
+	rule = ni_rule_new();
+	rule->family = AF_INET;
+	rule->action = NI_RULE_ACTION_TO_TBL;
+	rule->table = 1000 + tenant;
+	if (mark) {
+		rule->fwmark = tenant + 1;
+		rule->fwmask = -1U;
+	} else {
+		rule->src.len = 24;
+		rule->src.addr.sin.sin_family = AF_INET;
+		rule->src.addr.sin.sin_addr.s_addr = htonl(0x0a000000 | (tenant << 8));
+	}
+	if (pref) {
+		rule->set |= NI_RULE_SET_PREF;
+		rule->pref = 30000 - (tenant / 2) * 2 - (mark ? 1 : 0);
+	}
+	return rule;
+}
+
+static unsigned int
+compare_lookups(ni_bool_t pref)
+{
+	ni_rule_t *rule, *found, *linear;
+	unsigned int t, m, mismatches = 0;
+
+	for (t = 0; t < TEST_TENANTS + 10; ++t) {
+		for (m = 0; m < 2; ++m) {
+			rule = tenant_rule(t, m, pref);
+			found = ni_netconfig_rule_find(nc, rule);
+			linear = ni_rule_array_find_match(ni_netconfig_rule_array(nc),
+							rule, ni_rule_equal);
+			if (found != linear)
+				mismatches++;
+			ni_rule_free(rule);
+		}
+	}
+	return mismatches;
+}
+
+static ni_bool_t
+rules_sorted(void)
+{
+	ni_rule_array_t *rules = ni_netconfig_rule_array(nc);
+	unsigned int i;
+
+	for (i = 1; i < rules->count; ++i) {
+		if (rules->data[i - 1]->pref > rules->data[i]->pref)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+TESTCASE(rule_index_add)
+{
+	struct timeval beg, end;
+	ni_rule_t *rule;
+	unsigned int t, m, failed = 0;
+
+	CHECK((nc = ni_netconfig_new()) != NULL);
+
+	ni_timer_get_time(&beg);
+	for (t = 0; t < TEST_TENANTS; ++t) {
+		for (m = 0; m < 2; ++m) {
+			rule = tenant_rule(t, m, TRUE);
+			rule->seq = t % 2;
+			if (ni_netconfig_rule_find(nc, rule) || ni_netconfig_rule_add(nc, rule))
+				failed++;
+			ni_rule_free(rule);
+		}
+	}
+	ni_timer_get_time(&end);
+
+	CHECK2(failed == 0 && ni_netconfig_rule_array(nc)->count == TEST_RULES,
+			"added %u rules in %llu msec", ni_netconfig_rule_array(nc)->count,
+			ni_timeout_since(&beg, &end, NULL));
+	CHECK2(rules_sorted(), "rules sorted by pref");
+}
+
+TESTCASE(rule_index_find)
+{
+	CHECK2(compare_lookups(TRUE) == 0, "index matches linear scan with pref");
+	CHECK2(compare_lookups(FALSE) == 0, "index matches linear scan without pref");
+}
+
+TESTCASE(rule_index_del)
+{
+	ni_rule_t *rule, *old;
+	unsigned int t, failed = 0;
+
+	/* delete the mark rules of every third tenant, matching any pref */
+	for (t = 0; t < TEST_TENANTS; t += 3) {
+		rule = tenant_rule(t, TRUE, FALSE);
+		old = NULL;
+		if (ni_netconfig_rule_del(nc, rule, &old) != 0 || !old || !ni_rule_equal(old, rule))
+			failed++;
+		ni_rule_free(old);
+		if (ni_netconfig_rule_find(nc, rule))
+			failed++;
+		ni_rule_free(rule);
+	}
+	CHECK2(failed == 0, "deleted %u rules", (TEST_TENANTS + 2) / 3);
+	CHECK2(rules_sorted(), "rules sorted by pref");
+	CHECK2(compare_lookups(TRUE) == 0, "index matches linear scan after delete");
+	CHECK2(compare_lookups(FALSE) == 0, "index matches linear scan without pref");
+}
+
+TESTCASE(rule_index_drop_by_seq)
+{
+	ni_rule_array_t *rules = ni_netconfig_rule_array(nc);
+	unsigned int i, count = rules->count, dropped;
+
+	dropped = ni_netconfig_rules_drop_by_seq(nc, 1);
+	for (i = 0; i < rules->count; ++i) {
+		if (rules->data[i]->seq != 1)
+			break;
+	}
+	CHECK2(dropped && i == rules->count && count == rules->count + dropped,
+			"dropped %u rules with other seq", dropped);
+	CHECK2(rules_sorted(), "rules sorted by pref");
+	CHECK2(compare_lookups(TRUE) == 0, "index matches linear scan after drop");
+	CHECK2(compare_lookups(FALSE) == 0, "index matches linear scan without pref");
+}
+
+TESTCASE(rule_index_replace)
+{
+	ni_rule_array_t *rules = ni_netconfig_rule_array(nc);
+	ni_rule_t *rule, *old;
+	unsigned int t, count = rules->count, failed = 0;
+
+	/* replace rules by new ones, as the rule events do, with an
+	 * unchanged rule count and the index following each change */
+	for (t = 1; t < 10; t += 2) {
+		rule = tenant_rule(t, FALSE, FALSE);
+		old = NULL;
+		if (ni_netconfig_rule_del(nc, rule, &old) != 0 || !old)
+			failed++;
+		ni_rule_free(old);
+		ni_rule_free(rule);
+
+		rule = tenant_rule(TEST_TENANTS + t, FALSE, TRUE);
+		rule->seq = 1;
+		if (ni_netconfig_rule_add(nc, rule) || ni_netconfig_rule_find(nc, rule) != rule)
+			failed++;
+		ni_rule_free(rule);
+	}
+	CHECK2(failed == 0 && rules->count == count, "replaced 5 rules");
+	CHECK2(rules_sorted(), "rules sorted by pref");
+	CHECK2(compare_lookups(TRUE) == 0, "index matches linear scan after replace");
+	CHECK2(compare_lookups(FALSE) == 0, "index matches linear scan without pref");
+}
+
+TESTCASE(rule_index_cleanup)
+{
+	ni_netconfig_free(nc);
+	nc = NULL;
+}
+
+TESTMAIN();
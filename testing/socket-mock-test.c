@@ -20,10 +20,18 @@
  *	Description:
  *		Unit tests for src/socket.c
  */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdlib.h>
 #include <poll.h>
 #include <errno.h>
 #include <limits.h>
+#include <sys/time.h>
+#ifdef NI_SOCKET_EPOLL
+#include <sys/epoll.h>
+#endif
 
 #include <wicked/time.h>
 #include <wicked/logging.h>
@@ -37,6 +45,18 @@
 		ni_socket_deactivate_all();						\
 	} while (0)
 
+/*
+ * Socket timeouts are in the timer heap: run the timers and wait
+ * for the next timeout at most, as the main loops are doing it.
+ */
+static int
+socket_timer_wait(ni_timeout_t timeout)
+{
+	ni_timeout_t next = ni_timer_next_timeout();
+
+	return ni_socket_wait(next < timeout ? next : timeout);
+}
+
 struct s_testdata {
 	unsigned int close_cnt;
 	unsigned int receive_cnt;
@@ -57,6 +77,145 @@ int poll(struct pollfd *fds, nfds_t nfds, int timeout)
 	return -1;
 }
 
+#ifdef NI_SOCKET_EPOLL
+/*
+ * Mocked epoll set on top of the poll mock: epoll_wait passes the
+ * registered fds in registration order to poll() and reports the
+ * returned revents, so every testcase can run with both backends.
+ */
+#define MOCK_EPOLL_FD		666
+#define MOCK_EPOLL_SIZE		128
+
+ni_bool_t mock_epoll_enabled = FALSE;
+struct {
+	unsigned int count;
+	struct {
+		int fd;
+		struct epoll_event ev;
+	} entry[MOCK_EPOLL_SIZE];
+	unsigned int add_cnt;
+	unsigned int mod_cnt;
+	unsigned int del_cnt;
+	unsigned int wait_cnt;
+} mock_epoll;
+
+int epoll_create1(int flags)
+{
+	if (!mock_epoll_enabled) {
+		errno = ENOSYS;
+		return -1;
+	}
+	memset(&mock_epoll, 0, sizeof(mock_epoll));
+	return MOCK_EPOLL_FD;
+}
+
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event *ev)
+{
+	unsigned int i;
+
+	ni_assert(epfd == MOCK_EPOLL_FD);
+	for (i = 0; i < mock_epoll.count; ++i) {
+		if (mock_epoll.entry[i].fd == fd)
+			break;
+	}
+
+	switch (op) {
+	case EPOLL_CTL_ADD:
+		if (i < mock_epoll.count) {
+			errno = EEXIST;
+			return -1;
+		}
+		ni_assert(mock_epoll.count < MOCK_EPOLL_SIZE);
+		mock_epoll.entry[i].fd = fd;
+		mock_epoll.entry[i].ev = *ev;
+		mock_epoll.count++;
+		mock_epoll.add_cnt++;
+		return 0;
+
+	case EPOLL_CTL_MOD:
+		if (i == mock_epoll.count) {
+			errno = ENOENT;
+			return -1;
+		}
+		mock_epoll.entry[i].ev = *ev;
+		mock_epoll.mod_cnt++;
+		return 0;
+
+	case EPOLL_CTL_DEL:
+		if (i == mock_epoll.count) {
+			errno = ENOENT;
+			return -1;
+		}
+		mock_epoll.count--;
+		memmove(&mock_epoll.entry[i], &mock_epoll.entry[i + 1],
+			(mock_epoll.count - i) * sizeof(mock_epoll.entry[0]));
+		mock_epoll.del_cnt++;
+		return 0;
+
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+}
+
+int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+	struct pollfd fds[MOCK_EPOLL_SIZE];
+	unsigned int i, nfds = mock_epoll.count;
+	int ret, n = 0;
+
+	ni_assert(epfd == MOCK_EPOLL_FD);
+	mock_epoll.wait_cnt++;
+	for (i = 0; i < nfds; ++i) {
+		fds[i].fd = mock_epoll.entry[i].fd;
+		fds[i].events = mock_epoll.entry[i].ev.events;
+		fds[i].revents = 0;
+	}
+
+	if ((ret = poll(fds, nfds, timeout)) < 0)
+		return ret;
+
+	for (i = 0; i < nfds && n < maxevents; ++i) {
+		if (!fds[i].revents)
+			continue;
+		events[n].events = fds[i].revents;
+		events[n].data = mock_epoll.entry[i].ev.data;
+		n++;
+	}
+	return n;
+}
+
+static void socket_backend_poll(void)
+{
+	ni_socket_deactivate_all();
+	mock_epoll_enabled = FALSE;
+}
+
+static void socket_backend_epoll(void)
+{
+	ni_socket_deactivate_all();
+	mock_epoll_enabled = TRUE;
+}
+
+/* Run a testcase once with the poll and once with the epoll backend */
+#define SOCKET_TESTCASE(ts_name)					\
+	static void socket_testcase_##ts_name(void);			\
+	TESTCASE(ts_name##_poll)					\
+	{								\
+		socket_backend_poll();					\
+		socket_testcase_##ts_name();				\
+	}								\
+	TESTCASE(ts_name##_epoll)					\
+	{								\
+		socket_backend_epoll();					\
+		socket_testcase_##ts_name();				\
+		mock_epoll_enabled = FALSE;				\
+	}								\
+	static void socket_testcase_##ts_name(void)
+#else
+#define SOCKET_TESTCASE(ts_name)	TESTCASE(ts_name)
+#endif
+
 static void cb_receive(ni_socket_t *s)
 {
 	struct s_testdata *td = (struct s_testdata *) s->user_data;
@@ -241,7 +400,7 @@ TESTCASE(empty_socket_array)
 	CLEANUP();
 }
 
-TESTCASE(test_call_POLLOUT)
+SOCKET_TESTCASE(test_call_POLLOUT)
 {
 	ni_socket_t *sock = NULL;
 	struct s_testdata *td;
@@ -280,7 +439,7 @@ TESTCASE(test_call_POLLOUT)
 }
 
 
-TESTCASE(test_call_POLLIN)
+SOCKET_TESTCASE(test_call_POLLIN)
 {
 	ni_socket_t *sock = NULL;
 	struct s_testdata *td;
@@ -319,7 +478,7 @@ TESTCASE(test_call_POLLIN)
 	CLEANUP();
 }
 
-TESTCASE(test_call_POLLERR)
+SOCKET_TESTCASE(test_call_POLLERR)
 {
 	ni_socket_t *sock = NULL;
 	struct s_testdata *td;
@@ -353,7 +512,7 @@ TESTCASE(test_call_POLLERR)
 	CLEANUP();
 }
 
-TESTCASE(test_call_POLLHUP)
+SOCKET_TESTCASE(test_call_POLLHUP)
 {
 	ni_socket_t *sock = NULL;
 	struct s_testdata *td;
@@ -396,7 +555,7 @@ TESTCASE(test_call_POLLHUP)
 	CLEANUP();
 }
 
-TESTCASE(close_and_other_get_called)
+SOCKET_TESTCASE(close_and_other_get_called)
 {
 	/* test a fixed bug to skip processing (the receive call) of poll
 	 * results on next/2nd socket when the socket before/1st calls close
@@ -430,7 +589,7 @@ TESTCASE(close_and_other_get_called)
 	CLEANUP();
 }
 
-TESTCASE(deactivate_and_other_get_called)
+SOCKET_TESTCASE(deactivate_and_other_get_called)
 {
 	/* test a fixed bug to skip processing (the receive call) of poll
 	 * results on next/2nd socket when the socket before/1st deactivates
@@ -470,7 +629,7 @@ TESTCASE(deactivate_and_other_get_called)
 	CLEANUP();
 }
 
-TESTCASE(timeout_and_expire)
+SOCKET_TESTCASE(timeout_and_expire)
 {
 	ni_socket_t *sock = NULL, *sock2 = NULL;
 
@@ -479,96 +638,98 @@ TESTCASE(timeout_and_expire)
 	ni_socket_activate(sock);
 
 	mock_poll = mock_poll_collect_args;
-	CHECK(ni_socket_wait(1) == 0);
+	CHECK(socket_timer_wait(1) == 0);
 	CHECK(poll_args.timeout == 1);
 
-	CHECK(ni_socket_wait(20000) == 0);
+	CHECK(socket_timer_wait(20000) == 0);
 	CHECK(poll_args.timeout <= 5000);
 
-	CHECK(ni_socket_wait(-1) == 0);
+	CHECK(socket_timer_wait(-1) == 0);
 	CHECK(poll_args.timeout <= 50000);
 
-	CHECK(ni_socket_wait(NI_TIMEOUT_INFINITE) == 0);
+	CHECK(socket_timer_wait(NI_TIMEOUT_INFINITE) == 0);
 	CHECK(poll_args.timeout <= 50000);
 
-	CHECK(ni_socket_wait(0) == 0);
+	CHECK(socket_timer_wait(0) == 0);
 	CHECK(poll_args.timeout == 0);
 	/* If there are more then one sockets with get_timeout(), take the lower one. */
 	sock2 = ni_socket_wrap(10, 0);
 	sock2->get_timeout = cb_get_timeout_expire_in_10;
 	ni_socket_activate(sock2);
 
-	CHECK(ni_socket_wait(20000) == 0);
+	CHECK(socket_timer_wait(20000) == 0);
 	CHECK(poll_args.timeout <= 5000);
 
 	ni_socket_close(sock);
-	CHECK(ni_socket_wait(20000) == 0);
+	CHECK(socket_timer_wait(20000) == 0);
 	CHECK(poll_args.timeout <= 10000);
 
 	ni_socket_close(sock2);
 
 	/* If there are no sockets, it's like a high resolution sleep() */
-	CHECK(ni_socket_wait(20000) == 0);
+	CHECK(socket_timer_wait(20000) == 0);
 	CHECK(poll_args.timeout == 20000);
 
-	CHECK(ni_socket_wait(INT_MAX + 1L) == 0);
+	CHECK(socket_timer_wait(INT_MAX + 1L) == 0);
 	CHECK(poll_args.timeout == INT_MAX);
 	/* If no socket has get_timeout(), the given timeout is simply taken */
 	sock = ni_socket_wrap(10, 0);
 	ni_socket_activate(sock);
 
-	CHECK(ni_socket_wait(NI_TIMEOUT_INFINITE) == 0);
+	CHECK(socket_timer_wait(NI_TIMEOUT_INFINITE) == 0);
 	CHECK(poll_args.timeout == -1);
 
-	CHECK(ni_socket_wait(INT_MAX + 1L) == 0);
+	CHECK(socket_timer_wait(INT_MAX + 1L) == 0);
 	CHECK(poll_args.timeout == INT_MAX);
 
-	CHECK(ni_socket_wait(1000) == 0);
+	CHECK(socket_timer_wait(1000) == 0);
 	CHECK(poll_args.timeout == 1000);
 	ni_socket_close(sock);
 
-	/* Check if there is an expired socket, poll timeout should be 0 */
+	/* Check if there is an expired socket, its timer expires at once,
+	 * a deadline check_timeout() did not advance is not retried */
 	sock = ni_socket_wrap(10, 0);
 	sock->get_timeout = cb_get_timeout_expired;
 	ni_socket_activate(sock);
 
-	CHECK(ni_socket_wait(NI_TIMEOUT_INFINITE) == 0);
-	CHECK(poll_args.timeout == 0);
-
-	CHECK(ni_socket_wait(1000) == 0);
-	CHECK(poll_args.timeout == 0);
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+	CHECK(socket_timer_wait(1000) == 0);
+	CHECK(poll_args.timeout == 1000);
 	ni_socket_close(sock);
 
 	CLEANUP();
 }
 
-TESTCASE(check_timeout)
+SOCKET_TESTCASE(check_timeout)
 {
 	ni_socket_t *sock = NULL, *sock2 = NULL;
 	struct s_testdata *td = NULL, *td2 = NULL;
 
 	mock_poll = mock_poll_noop;
 
-	/* Simple check, if check_timeout() callback was called */
+	/* Simple check, if check_timeout() callback was called
+	 * when the socket timer armed at the deadline expired */
 	sock = ni_socket_wrap(10, 0);
+	sock->get_timeout = cb_get_timeout_expired;
 	sock->check_timeout = cb_check_timeout;
 	td = sock->user_data = xcalloc(1, sizeof(struct s_testdata));
 	ni_socket_activate(sock);
 
-	CHECK(ni_socket_wait(0) == 0);
+	CHECK(socket_timer_wait(0) == 0);
 	CHECK2(td->check_timeout_cnt == 1, "Simple check, if check_timeout() cb is called");
 	ni_socket_close(sock);
 	free(td);
 
 	/*  Close the socket, while we are in check_timeout() callback */
 	sock = ni_socket_wrap(10, 0);
+	sock->get_timeout = cb_get_timeout_expired;
 	sock->check_timeout = cb_check_timeout;
 	td = sock->user_data = xcalloc(1, sizeof(struct s_testdata));
 	ni_socket_activate(sock);
 
 	sock->check_timeout = cb_check_timeout_close_socket;
 	sock->release_user_data = cb_release_user_data;
-	CHECK(ni_socket_wait(0) == 0);
+	CHECK(socket_timer_wait(0) == 0);
 	CHECK(td->release_user_data_cnt == 1);
 	free(td);
 
@@ -576,17 +737,19 @@ TESTCASE(check_timeout)
 	 * check_timeout() callback. This test a fixed bug.
 	 */
 	sock = ni_socket_wrap(10, 0);
+	sock->get_timeout = cb_get_timeout_expired;
 	sock->check_timeout = cb_check_timeout_close_socket;
 	sock->release_user_data = cb_release_user_data;
 	td = sock->user_data = xcalloc(1, sizeof(struct s_testdata));
 	ni_socket_activate(sock);
 
 	sock2 = ni_socket_wrap(10, 0);
+	sock2->get_timeout = cb_get_timeout_expired;
 	sock2->check_timeout = cb_check_timeout;
 	td2 = sock2->user_data = xcalloc(1, sizeof(struct s_testdata));
 	ni_socket_activate(sock2);
 
-	CHECK(ni_socket_wait(0) == 0);
+	CHECK(socket_timer_wait(0) == 0);
 	CHECK(td->release_user_data_cnt == 1);
 	CHECK(td2->check_timeout_cnt == 1); /* failed in former bug */
 	CHECK(sock2->refcount == 2);
@@ -597,6 +760,90 @@ TESTCASE(check_timeout)
 	CLEANUP();
 }
 
+static struct timeval	timer_deadline;
+static unsigned int	timer_get_timeout_cnt;
+
+static int cb_get_timeout_deadline(const ni_socket_t *s, struct timeval *ret)
+{
+	timer_get_timeout_cnt++;
+	*ret = timer_deadline;
+	return timerisset(ret) ? 0 : -1;
+}
+
+SOCKET_TESTCASE(timeout_update)
+{
+	/* Socket timeouts are kept in the timer heap: a wakeup does
+	 * not query the deadline, the owner updates it on changes. */
+
+	ni_socket_t *sock = NULL;
+	struct s_testdata *td;
+	unsigned int i;
+
+	ni_timer_get_time(&timer_deadline);
+	timer_deadline.tv_sec += 5;
+	timer_get_timeout_cnt = 0;
+
+	sock = ni_socket_wrap(10, 0);
+	td = sock->user_data = xcalloc(1, sizeof(struct s_testdata));
+	sock->get_timeout = cb_get_timeout_deadline;
+	sock->check_timeout = cb_check_timeout;
+	sock->receive = cb_receive;
+	ni_socket_activate(sock);
+	CHECK(timer_get_timeout_cnt == 1);
+
+	mock_poll = mock_poll_collect_args;
+	for (i = 0; i < 100; ++i)
+		CHECK2(socket_timer_wait(20000) == 0, "wait %u", i);
+	CHECK(poll_args.timeout > 1000 && poll_args.timeout <= 5000);
+	CHECK2(timer_get_timeout_cnt == 1, "Deadline not queried on wakeups");
+	CHECK(td->check_timeout_cnt == 0);
+
+	mock_poll = mock_poll_set_all_POLLIN;
+	for (i = 0; i < 100; ++i)
+		CHECK2(socket_timer_wait(20000) == 0, "receive %u", i);
+	CHECK(td->receive_cnt == 100);
+	CHECK2(timer_get_timeout_cnt == 1, "Deadline not queried on events");
+	mock_poll = mock_poll_collect_args;
+
+	/* an earlier deadline applies after the update */
+	ni_timer_get_time(&timer_deadline);
+	timer_deadline.tv_sec += 1;
+	ni_socket_update_timeout(sock);
+	CHECK(socket_timer_wait(20000) == 0);
+	CHECK(poll_args.timeout <= 1000);
+
+	/* a cleared deadline disarms the timer */
+	timerclear(&timer_deadline);
+	ni_socket_update_timeout(sock);
+	CHECK(socket_timer_wait(20000) == 0);
+	CHECK(poll_args.timeout == 20000);
+
+	/* an expired deadline calls check_timeout once */
+	ni_timer_get_time(&timer_deadline);
+	timer_deadline.tv_sec -= 1;
+	ni_socket_update_timeout(sock);
+	timerclear(&timer_deadline);
+	mock_poll = mock_poll_noop;
+	CHECK(socket_timer_wait(0) == 0);
+	CHECK(socket_timer_wait(0) == 0);
+	CHECK(td->check_timeout_cnt == 1);
+
+	/* also when check_timeout does not advance it */
+	ni_timer_get_time(&timer_deadline);
+	timer_deadline.tv_sec -= 1;
+	ni_socket_update_timeout(sock);
+	mock_poll = mock_poll_collect_args;
+	CHECK(socket_timer_wait(20000) == 0);
+	CHECK(socket_timer_wait(20000) == 0);
+	CHECK(poll_args.timeout == 20000);
+	CHECK(td->check_timeout_cnt == 2);
+
+	ni_socket_close(sock);
+	free(td);
+
+	CLEANUP();
+}
+
 static int remove_and_add_poll_mock(struct pollfd *fds, nfds_t nfds, int timeout)
 {
 	fds[0].revents = POLLERR;
@@ -622,7 +869,7 @@ static void remove_and_add_equal_fd_number(ni_socket_t *sock)
 	ni_socket_activate(remove_and_add_faulty_sock);
 }
 
-TESTCASE(remove_and_add_in_error_handler)
+SOCKET_TESTCASE(remove_and_add_in_error_handler)
 {
 	/* If the handle_error() callback removes the erroneous socket, but also
 	 * add a new socket, the new socket should not get called during this
@@ -664,7 +911,7 @@ static void remove_and_add_different_fd(ni_socket_t *sock)
 	ni_socket_activate(remove_and_add_faulty_sock);
 }
 
-TESTCASE(remove_and_add_in_error_handler2)
+SOCKET_TESTCASE(remove_and_add_in_error_handler2)
 {
 	/* Similar to remove_and_add_in_error_handler but the new socket will get
 	 * a different file-descriptor number. */
@@ -691,7 +938,7 @@ TESTCASE(remove_and_add_in_error_handler2)
 	CLEANUP();
 }
 
-TESTCASE(close_callback)
+SOCKET_TESTCASE(close_callback)
 {
 	struct s_testdata *td;
 	ni_socket_t *sock = NULL;
@@ -707,7 +954,7 @@ TESTCASE(close_callback)
 	CLEANUP();
 }
 
-TESTCASE(activate_socket)
+SOCKET_TESTCASE(activate_socket)
 {
 	/* Check sanity checks of `ni_socket_activte(). E.g. that an already
 	 * activated socket did not get add twice. */
@@ -729,6 +976,114 @@ TESTCASE(activate_socket)
 	CLEANUP();
 }
 
+#ifdef NI_SOCKET_EPOLL
+TESTCASE(epoll_register_once)
+{
+	/* Check that the epoll backend registers a socket once on
+	 * activation and modifies it only on poll_flags changes. */
+
+	ni_socket_t *sock = NULL;
+	struct s_testdata *td;
+	unsigned int i;
+
+	socket_backend_epoll();
+
+	sock = ni_socket_wrap(10, 0);
+	td = sock->user_data = xcalloc(1, sizeof(struct s_testdata));
+	sock->receive = cb_receive;
+	sock->transmit = cb_transmit;
+	CHECK(ni_socket_activate(sock) == TRUE);
+	CHECK(mock_epoll.add_cnt == 1);
+	CHECK(mock_epoll.count == 1);
+
+	mock_poll = mock_poll_set_all_POLLIN;
+	for (i = 0; i < 100; ++i)
+		CHECK2(ni_socket_wait(1) == 0, "epoll wait %u", i);
+	CHECK(td->receive_cnt == 100);
+	CHECK(mock_epoll.wait_cnt == 100);
+	CHECK2(mock_epoll.add_cnt == 1 && mock_epoll.mod_cnt == 0,
+			"Socket registered once, not modified");
+
+	/* poll_flags change is applied at once via the setter */
+	ni_socket_set_poll_flags(sock, POLLIN | POLLOUT);
+	CHECK(mock_epoll.mod_cnt == 1);
+	ni_socket_set_poll_flags(sock, POLLIN | POLLOUT);
+	mock_poll = mock_poll_collect_args;
+	CHECK(ni_socket_wait(1) == 0);
+	CHECK(ni_socket_wait(1) == 0);
+	CHECK(mock_epoll.mod_cnt == 1);
+	CHECK(poll_args.nfds == 1);
+	CHECK(poll_args.fds[0].events == (POLLIN | POLLOUT));
+
+	ni_socket_close(sock);
+	CHECK2(mock_epoll.del_cnt == 1 && mock_epoll.count == 0,
+			"Socket unregistered on close");
+	free(td);
+
+	CLEANUP();
+	mock_epoll_enabled = FALSE;
+}
+
+TESTCASE(epoll_errors)
+{
+	ni_socket_t *sock = NULL;
+
+	socket_backend_epoll();
+
+	sock = ni_socket_wrap(10, 0);
+	ni_socket_activate(sock);
+
+	/* NULL mock_poll sets errno 666 + return -1 in epoll_wait -- logs error */
+	mock_poll = NULL;
+	CHECK2(ni_socket_wait(1) == -1, "Undefined error return -1");
+	CHECK(sock->refcount == 2);
+
+	/* ni_socket_wait does not report interrupted epoll_wait errors */
+	mock_poll = mock_poll_EINTR;
+	CHECK2(ni_socket_wait(1) == 0, "EINTR return 0");
+	CHECK(sock->refcount == 2);
+
+	ni_socket_close(sock);
+	CLEANUP();
+	mock_epoll_enabled = FALSE;
+}
+
+TESTCASE(epoll_fallback_to_poll)
+{
+	/* A socket epoll refuses to add, switches the array to poll */
+
+	ni_socket_t *sock[2];
+	struct s_testdata *td[2];
+	int i;
+
+	socket_backend_epoll();
+
+	for (i = 0; i < 2; i++) {
+		sock[i] = ni_socket_wrap(10, 0);
+		sock[i]->receive = cb_receive;
+		td[i] = sock[i]->user_data = xcalloc(1, sizeof(struct s_testdata));
+	}
+
+	ni_socket_activate(sock[0]);
+	CHECK(mock_epoll.count == 1);
+	ni_socket_activate(sock[1]);
+	CHECK2(mock_epoll.add_cnt == 1, "Duplicate fd refused by epoll");
+
+	mock_poll = mock_poll_set_all_POLLIN;
+	CHECK(ni_socket_wait(1) == 0);
+	CHECK2(mock_epoll.wait_cnt == 0, "Using poll after fallback");
+	CHECK(td[0]->receive_cnt == 1);
+	CHECK(td[1]->receive_cnt == 1);
+
+	for (i = 0; i < 2; i++) {
+		ni_socket_close(sock[i]);
+		free(td[i]);
+	}
+	CLEANUP();
+	mock_epoll_enabled = FALSE;
+}
+#endif
+
 TESTCASE(socket_arrays_remove)
 {
 	/* Check ni_socket_array function without using global
@@ -0,0 +1,201 @@
+/*
+ *	Timer unit tests and micro benchmark
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Unit tests for the timers in src/timer.c
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <wicked/time.h>
+#include "wunit.h"
+
+#define TIMER_ORDER_COUNT	20
+#define TIMER_BENCH_COUNT	100000
+
+struct timer_order {
+	unsigned int		fired;
+	unsigned int		order[TIMER_ORDER_COUNT];
+};
+
+static struct timer_order	timer_order;
+
+static void
+timer_order_callback(void *user_data, const ni_timer_t *timer)
+{
+	unsigned int id = (unsigned long)user_data;
+
+	if (timer_order.fired < TIMER_ORDER_COUNT)
+		timer_order.order[timer_order.fired] = id;
+	timer_order.fired++;
+}
+
+static void
+timer_cancel_self_callback(void *user_data, const ni_timer_t *timer)
+{
+	/* a fired timer is not armed any more */
+	*(void **)user_data = ni_timer_cancel(timer);
+}
+
+static void
+timer_run_until(unsigned int fired)
+{
+	ni_timeout_t timeout;
+
+	while (timer_order.fired < fired) {
+		timeout = ni_timer_next_timeout();
+		if (timeout == NI_TIMEOUT_INFINITE)
+			break;
+		usleep(timeout * 1000);
+	}
+}
+
+TESTCASE(register_cancel)
+{
+	const ni_timer_t *timer;
+	void *data;
+
+	timer = ni_timer_register(NI_TIMEOUT_FROM_SEC(100), timer_order_callback, (void *)42UL);
+	CHECK(timer != NULL);
+	CHECK(ni_timer_next_timeout() > NI_TIMEOUT_FROM_SEC(99));
+
+	data = ni_timer_cancel(timer);
+	CHECK2(data == (void *)42UL, "cancel returns the timer user data");
+	CHECK2(ni_timer_cancel(timer) == NULL, "canceled timer handle is not found");
+	CHECK2(ni_timer_rearm(timer, 100) == NULL, "canceled timer is not rearmed");
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+}
+
+TESTCASE(fire_order)
+{
+	unsigned int i, ok;
+
+	/* shuffled timeouts 2ms apart; fire order is by timeout */
+	memset(&timer_order, 0, sizeof(timer_order));
+	for (i = 0; i < TIMER_ORDER_COUNT; ++i) {
+		unsigned int id = (i * 7) % TIMER_ORDER_COUNT;
+
+		CHECK(ni_timer_register(id * 2, timer_order_callback,
+					(void *)(unsigned long)id) != NULL);
+	}
+	timer_run_until(TIMER_ORDER_COUNT);
+
+	CHECK(timer_order.fired == TIMER_ORDER_COUNT);
+	for (ok = 1, i = 0; i < TIMER_ORDER_COUNT; ++i) {
+		if (timer_order.order[i] != i)
+			ok = 0;
+	}
+	CHECK2(ok, "timers fired in timeout order");
+
+	/* equal timeouts fire in the order they were armed */
+	memset(&timer_order, 0, sizeof(timer_order));
+	for (i = 0; i < TIMER_ORDER_COUNT; ++i)
+		ni_timer_register(0, timer_order_callback, (void *)(unsigned long)i);
+	timer_run_until(TIMER_ORDER_COUNT);
+	for (ok = 1, i = 0; i < TIMER_ORDER_COUNT; ++i) {
+		if (timer_order.order[i] != i)
+			ok = 0;
+	}
+	CHECK2(ok, "timers with equal timeout fired in arm order");
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+}
+
+TESTCASE(cancel_rearm_order)
+{
+	const ni_timer_t *timers[TIMER_ORDER_COUNT];
+	unsigned int i, ok;
+
+	/* cancel odd timers, rearm the first one to fire last */
+	memset(&timer_order, 0, sizeof(timer_order));
+	for (i = 0; i < TIMER_ORDER_COUNT; ++i)
+		timers[i] = ni_timer_register(i * 2, timer_order_callback,
+						(void *)(unsigned long)i);
+	for (i = 1; i < TIMER_ORDER_COUNT; i += 2)
+		CHECK(ni_timer_cancel(timers[i]) == (void *)(unsigned long)i);
+	CHECK(ni_timer_rearm(timers[0], TIMER_ORDER_COUNT * 2) == timers[0]);
+
+	timer_run_until(TIMER_ORDER_COUNT / 2);
+	CHECK(timer_order.fired == TIMER_ORDER_COUNT / 2);
+	for (ok = 1, i = 0; i + 1 < TIMER_ORDER_COUNT / 2; ++i) {
+		if (timer_order.order[i] != (i + 1) * 2)
+			ok = 0;
+	}
+	CHECK2(ok && timer_order.order[i] == 0, "canceled timers did not fire");
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+}
+
+TESTCASE(cancel_in_callback)
+{
+	void *data = (void *)1UL;
+
+	ni_timer_register(0, timer_cancel_self_callback, &data);
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+	CHECK2(data == NULL, "timer is not found in own callback");
+}
+
+TESTCASE(benchmark)
+{
+	const ni_timer_t **timers;
+	struct timeval beg, end;
+	unsigned int i, ok;
+
+	timers = calloc(TIMER_BENCH_COUNT, sizeof(*timers));
+	ni_assert(timers != NULL);
+
+	ni_timer_get_time(&beg);
+	for (ok = 1, i = 0; i < TIMER_BENCH_COUNT; ++i) {
+		ni_timeout_t timeout = NI_TIMEOUT_FROM_SEC(100) + random() % 100000;
+
+		if (!(timers[i] = ni_timer_register(timeout, timer_order_callback, &timers[i])))
+			ok = 0;
+	}
+	ni_timer_get_time(&end);
+	CHECK2(ok, "registered %u timers in %llu msec", TIMER_BENCH_COUNT,
+			ni_timeout_since(&beg, &end, NULL));
+
+	ni_timer_get_time(&beg);
+	for (ok = 1, i = 0; i < TIMER_BENCH_COUNT; ++i) {
+		ni_timeout_t timeout = NI_TIMEOUT_FROM_SEC(100) + random() % 100000;
+
+		if (ni_timer_rearm(timers[i], timeout) != timers[i])
+			ok = 0;
+	}
+	ni_timer_get_time(&end);
+	CHECK2(ok, "rearmed %u timers in %llu msec", TIMER_BENCH_COUNT,
+			ni_timeout_since(&beg, &end, NULL));
+
+	ni_timer_get_time(&beg);
+	for (ok = 1, i = 0; i < TIMER_BENCH_COUNT; ++i) {
+		unsigned int n = (i * 7919) % TIMER_BENCH_COUNT;
+
+		if (ni_timer_cancel(timers[n]) != &timers[n])
+			ok = 0;
+	}
+	ni_timer_get_time(&end);
+	CHECK2(ok, "canceled %u timers in %llu msec", TIMER_BENCH_COUNT,
+			ni_timeout_since(&beg, &end, NULL));
+
+	CHECK(ni_timer_next_timeout() == NI_TIMEOUT_INFINITE);
+	free(timers);
+}
+
+TESTMAIN();
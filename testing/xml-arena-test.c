@@ -0,0 +1,227 @@
+/*
+ *	xml document arena unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Builds and frees documents with and without the node arena
+ *		of src/xml.c and verifies that nodes referenced, detached or
+ *		reparented out of an arena document outlive the document.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/util.h>
+#include <wicked/xml.h>
+#include <wicked/time.h>
+#include "wunit.h"
+
+#define TEST_INTERFACES		500
+#define TEST_ROUNDS		10
+
+static const char *		test_config =
+	"<interface>\n"
+	"  <name>eth0</name>\n"
+	"  <ethernet>\n"
+	"    <wake-on-lan><options>magic</options></wake-on-lan>\n"
+	"    <ring><rx>512</rx><tx>512</tx></ring>\n"
+	"  </ethernet>\n"
+	"  <ipv4:static>\n"
+	"    <address family=\"ipv4\"><local>192.168.1.1/24</local></address>\n"
+	"  </ipv4:static>\n"
+	"</interface>\n";
+
+/*
+ * Build the interface config nodes as the dbus serialization does
+ */
+static void
+build_interfaces(xml_node_t *root)
+{
+	xml_node_t *ifnode, *node;
+	char name[32];
+	unsigned int i;
+
+	for (i = 0; i < TEST_INTERFACES; ++i) {
+		ifnode = xml_node_new("interface", root);
+		snprintf(name, sizeof(name), "eth%u", i);
+		xml_node_new_element("name", ifnode, name);
+		xml_node_add_attr(ifnode, "origin", "test");
+
+		node = xml_node_new("ethernet", ifnode);
+		xml_node_new_element("autoneg", node, "true");
+		xml_node_new_element_uint("speed", node, 1000);
+		xml_node_new_element("duplex", node, "full");
+
+		node = xml_node_new("ipv4", ifnode);
+		xml_node_new_element("enabled", node, "true");
+		xml_node_new_element("arp-verify", node, "true");
+		node = xml_node_new("ipv6", ifnode);
+		xml_node_new_element("enabled", node, "true");
+		xml_node_new_element_uint("accept-ra", node, 1);
+	}
+}
+
+static unsigned long long
+build_documents(xml_document_t *(*new_doc)(void), char **text)
+{
+	struct timeval beg, end;
+	xml_document_t *doc;
+	unsigned int n;
+
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_ROUNDS; ++n) {
+		doc = new_doc();
+		build_interfaces(xml_document_root(doc));
+		if (n == 0)
+			*text = xml_document_sprint(doc);
+		xml_document_free(doc);
+	}
+	ni_timer_get_time(&end);
+	return ni_timeout_since(&beg, &end, NULL);
+}
+
+static xml_document_t *
+new_heap_document(void)
+{
+	return xml_document_new();
+}
+
+TESTCASE(xml_arena_build)
+{
+	unsigned long long heap, arena;
+	char *heap_text = NULL, *arena_text = NULL;
+
+	heap = build_documents(new_heap_document, &heap_text);
+	arena = build_documents(xml_document_new_arena, &arena_text);
+
+	CHECK(heap_text && arena_text);
+	CHECK2(ni_string_eq(heap_text, arena_text),
+			"%u x %u interfaces: heap %llu msec, arena %llu msec",
+			TEST_ROUNDS, TEST_INTERFACES, heap, arena);
+
+	ni_string_free(&heap_text);
+	ni_string_free(&arena_text);
+}
+
+TESTCASE(xml_arena_parse)
+{
+	xml_document_t *doc;
+	xml_node_t *ifnode, *name;
+	char *text;
+
+	CHECK((doc = xml_document_from_string(test_config, "test")) != NULL);
+	CHECK(doc->arena != NULL);
+	CHECK((ifnode = xml_node_get_child(doc->root, "interface")) != NULL);
+	CHECK(ifnode->arena == doc->arena);
+
+	/* names and cdata are modified through the node functions */
+	CHECK((name = xml_node_get_child(ifnode, "name")) != NULL);
+	xml_node_set_cdata(name, "eth1");
+	xml_node_set_name(name, "device");
+	xml_node_add_attr(name, "namespace", "ifname");
+	CHECK(ni_string_eq(xml_node_get_attr(name, "namespace"), "ifname"));
+
+	/* new children are allocated in the arena of their parent */
+	name = xml_node_new_element("alias", ifnode, "uplink");
+	CHECK(name->arena == doc->arena);
+
+	CHECK((text = xml_node_sprint(ifnode)) != NULL);
+	CHECK(strstr(text, "<device namespace=\"ifname\">eth1</device>") != NULL);
+	CHECK(strstr(text, "<alias>uplink</alias>") != NULL);
+	free(text);
+
+	xml_document_free(doc);
+}
+
+TESTCASE(xml_arena_references)
+{
+	xml_document_t *doc;
+	xml_node_t *ifnode, *ring, *detached;
+
+	CHECK((doc = xml_document_from_string(test_config, "test")) != NULL);
+	ifnode = xml_node_get_child(doc->root, "interface");
+	ring = xml_node_get_child(xml_node_get_child(ifnode, "ethernet"), "ring");
+	CHECK(ring != NULL);
+
+	/* referenced and detached nodes outlive the document */
+	ring = xml_node_clone_ref(ring);
+	detached = xml_node_get_child(ifnode, "ipv4:static");
+	xml_node_detach(detached);
+	xml_document_free(doc);
+
+	CHECK(ni_string_eq(ring->name, "ring") && ring->parent == NULL);
+	CHECK(ni_string_eq(xml_node_get_child(ring, "rx")->cdata, "512"));
+	CHECK(ni_string_eq(detached->name, "ipv4:static"));
+	CHECK(xml_node_get_child(detached, "address") != NULL);
+
+	xml_node_free(ring);
+	xml_node_free(detached);
+}
+
+TESTCASE(xml_arena_reparent)
+{
+	xml_document_t *doc, *other;
+	xml_node_t *ethtool, *ethernet, *node, *moved;
+
+	CHECK((doc = xml_document_from_string(test_config, "test")) != NULL);
+	ethernet = xml_node_get_child(xml_node_get_child(doc->root, "interface"), "ethernet");
+
+	/* within the document, the node itself is moved */
+	ethtool = xml_node_new("ethtool", xml_node_get_child(doc->root, "interface"));
+	node = xml_node_get_child(ethernet, "ring");
+	CHECK(xml_node_reparent(ethtool, node) == node);
+	CHECK(node->parent == ethtool && !xml_node_get_child(ethernet, "ring"));
+
+	/* into a heap node, the arena node is linked in place */
+	ethtool = xml_node_new("ethtool", NULL);
+	node = xml_node_get_child(ethernet, "wake-on-lan");
+	moved = xml_node_reparent(ethtool, node);
+	CHECK(moved == node && moved->arena == doc->arena);
+	CHECK(moved->parent == ethtool && !xml_node_get_child(ethernet, "wake-on-lan"));
+
+	/* and new children are allocated in its arena */
+	xml_node_new_element("options", moved, "phy");
+	CHECK(xml_node_get_next_child(moved, "options",
+				xml_node_get_child(moved, "options"))->arena == doc->arena);
+
+	/* into another arena document as well */
+	other = xml_document_new_arena();
+	node = xml_node_get_child(xml_document_root(doc), "interface");
+	moved = xml_node_reparent(xml_document_root(other), node);
+	CHECK(moved == node && moved->arena == doc->arena);
+	CHECK(xml_node_get_child(xml_document_root(doc), "interface") == NULL);
+	CHECK(xml_node_get_child(xml_document_root(other), "interface") == node);
+
+	/* a referenced node stays valid for the other holder */
+	node = xml_node_clone_ref(xml_node_get_child(moved, "name"));
+	moved = xml_node_reparent(ethtool, node);
+	CHECK(moved == node && node->refcount == 2 && node->parent == ethtool);
+	xml_node_free(node);
+
+	/* the moved nodes outlive the document they were parsed into */
+	xml_document_free(doc);
+	CHECK(ni_string_eq(xml_node_get_child(ethtool, "name")->cdata, "eth0"));
+	CHECK(ni_string_eq(xml_node_get_child(xml_node_get_child(ethtool, "wake-on-lan"),
+					"options")->cdata, "magic"));
+	xml_document_free(other);
+	xml_node_free(ethtool);
+}
+
+TESTMAIN();
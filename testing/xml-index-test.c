@@ -0,0 +1,228 @@
+/*
+ *	xml node child and attribute index unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Looks up the ports of a bridge config with thousands of
+ *		ports using the node index of src/xml.c and verifies the
+ *		lookups against a linear scan while the ports change.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <wicked/util.h>
+#include <wicked/xml.h>
+#include <wicked/time.h>
+#include "wunit.h"
+
+#define TEST_PORTS		4000
+#define TEST_ATTRS		64
+
+static xml_document_t *		doc;
+static xml_node_t *		ports;
+
+static const char *
+port_name(unsigned int n)
+{
+	static char name[32];
+
+	snprintf(name, sizeof(name), "port%u", n);
+	return name;
+}
+
+static xml_node_t *
+linear_get_child(const xml_node_t *node, const char *name)
+{
+	xml_node_t *child;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, name))
+			return child;
+	}
+	return NULL;
+}
+
+/* returns the number of ports found */
+static unsigned int
+lookup_ports(xml_node_t *(*get)(const xml_node_t *, const char *), unsigned long long *msec)
+{
+	struct timeval beg, end;
+	unsigned int n, found = 0;
+
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_PORTS + 10; ++n) {
+		if (get(ports, port_name(n)))
+			found++;
+	}
+	ni_timer_get_time(&end);
+	*msec = ni_timeout_since(&beg, &end, NULL);
+	return found;
+}
+
+/* returns the number of lookups differing from a linear scan */
+static unsigned int
+verify_ports(void)
+{
+	unsigned int n, failed = 0;
+
+	for (n = 0; n < TEST_PORTS * 2; ++n) {
+		if (xml_node_get_child(ports, port_name(n)) != linear_get_child(ports, port_name(n)))
+			failed++;
+	}
+	return failed;
+}
+
+TESTCASE(xml_index_setup)
+{
+	struct timeval beg, end;
+	xml_node_t *port;
+	unsigned int n;
+
+	doc = xml_document_new_arena();
+	ports = xml_node_new("ports", xml_node_new("bridge", xml_document_root(doc)));
+
+	ni_timer_get_time(&beg);
+	for (n = 0; n < TEST_PORTS; ++n) {
+		port = xml_node_new(port_name(n), ports);
+		xml_node_new_element("priority", port, "32");
+		xml_node_new_element("path-cost", port, "100");
+
+		/* the first lookup indexes the ports, then they are appended in O(1) */
+		if (n == TEST_PORTS / 2)
+			CHECK(xml_node_get_child(ports, "none") == NULL);
+	}
+	ni_timer_get_time(&end);
+	CHECK2(ports->index != NULL, "%u ports added in %llu msec", TEST_PORTS,
+			ni_timeout_since(&beg, &end, NULL));
+}
+
+TESTCASE(xml_index_lookup)
+{
+	unsigned long long indexed, linear;
+	unsigned int a, b;
+
+	a = lookup_ports(xml_node_get_child, &indexed);
+	b = lookup_ports(linear_get_child, &linear);
+	CHECK2(a == TEST_PORTS && b == TEST_PORTS,
+			"%u lookups: indexed %llu msec, linear %llu msec",
+			TEST_PORTS + 10, indexed, linear);
+	CHECK(verify_ports() == 0);
+}
+
+TESTCASE(xml_index_update)
+{
+	xml_node_t *port, *dup, *moved, *other;
+	char name[32];
+
+	/* duplicates are found in list order */
+	dup = xml_node_new(port_name(7), ports);
+	port = xml_node_get_child(ports, port_name(7));
+	CHECK(port != dup && xml_node_get_next_child(ports, port_name(7), port) == dup);
+
+	/* removing the first one makes the duplicate the first */
+	xml_node_detach(port);
+	CHECK(xml_node_get_child(ports, port_name(7)) == dup);
+	xml_node_free(port);
+	CHECK(xml_node_delete_child(ports, port_name(7)));
+	CHECK(xml_node_get_child(ports, port_name(7)) == NULL);
+
+	/* deleting the last child keeps appending at the tail */
+	CHECK(xml_node_delete_child_node(ports, xml_node_get_child(ports, port_name(TEST_PORTS - 1))));
+	port = xml_node_new(port_name(TEST_PORTS - 1), ports);
+	CHECK(port->next == NULL && xml_node_get_child(ports, port_name(TEST_PORTS - 1)) == port);
+
+	/* renamed and replaced children */
+	snprintf(name, sizeof(name), "port%u", TEST_PORTS + 3);
+	xml_node_set_name(xml_node_get_child(ports, port_name(3)), name);
+	CHECK(xml_node_get_child(ports, port_name(3)) == NULL);
+	CHECK(xml_node_get_child(ports, port_name(TEST_PORTS + 3)) != NULL);
+	CHECK(xml_node_replace_child(ports, xml_node_new(port_name(5), NULL)));
+	port = xml_node_get_child(ports, port_name(5));
+	CHECK(port != NULL && port->next == NULL && !port->children);
+
+	/* reparented children */
+	other = xml_node_new("ports", NULL);
+	moved = xml_node_reparent(other, xml_node_get_child(ports, port_name(9)));
+	CHECK(xml_node_get_child(ports, port_name(9)) == NULL);
+	CHECK(xml_node_get_child(other, port_name(9)) == moved);
+	xml_node_reparent(ports, moved);
+	CHECK(xml_node_get_child(ports, port_name(9)) != NULL);
+	xml_node_free(other);
+
+	/* merging does not add existing names */
+	other = xml_node_new("ports", NULL);
+	xml_node_new(port_name(11), other);
+	xml_node_new(port_name(TEST_PORTS + 11), other);
+	xml_node_merge(ports, other);
+	CHECK(xml_node_get_next_child(ports, port_name(11),
+				xml_node_get_child(ports, port_name(11))) == NULL);
+	CHECK(xml_node_get_child(ports, port_name(TEST_PORTS + 11)) != NULL);
+	xml_node_free(other);
+
+	CHECK(verify_ports() == 0);
+}
+
+TESTCASE(xml_index_attrs)
+{
+	xml_node_t *node;
+	unsigned int n, failed = 0;
+	const char *value;
+	char name[32];
+
+	node = xml_node_new("bridge", NULL);
+	for (n = 0; n < TEST_ATTRS; ++n) {
+		snprintf(name, sizeof(name), "attr%u", n);
+		xml_node_add_attr_uint(node, name, n);
+	}
+	for (n = 0; n < TEST_ATTRS * 2; ++n) {
+		snprintf(name, sizeof(name), "attr%u", n);
+		value = xml_node_get_attr(node, name);
+		if (n < TEST_ATTRS ? !value || strtoul(value, NULL, 10) != n : !!value)
+			failed++;
+	}
+	CHECK2(failed == 0 && node->index != NULL, "%u attribute lookups", TEST_ATTRS * 2);
+
+	/* changed, added and deleted attributes */
+	xml_node_add_attr(node, "attr1", "one");
+	xml_node_add_attr(node, "stp", "on");
+	CHECK(ni_string_eq(xml_node_get_attr(node, "attr1"), "one"));
+	CHECK(ni_string_eq(xml_node_get_attr(node, "stp"), "on"));
+	CHECK(xml_node_del_attr(node, "attr2"));
+	CHECK(!xml_node_has_attr(node, "attr2"));
+	CHECK(ni_string_eq(xml_node_get_attr(node, "attr3"), "3"));
+
+	/* attributes replaced without the node functions */
+	ni_var_array_destroy(&node->attrs);
+	for (n = 0; n < TEST_ATTRS / 2; ++n) {
+		snprintf(name, sizeof(name), "new%u", n);
+		xml_node_add_attr(node, name, "x");
+	}
+	CHECK(!xml_node_has_attr(node, "attr3") && xml_node_has_attr(node, "new20"));
+
+	xml_node_free(node);
+}
+
+TESTCASE(xml_index_cleanup)
+{
+	xml_document_free(doc);
+}
+
+TESTMAIN();
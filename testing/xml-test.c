@@ -8,7 +8,44 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #include <wicked/xml.h>
+#include <wicked/time.h>
+
+/*
+ * Parse the file @rounds times and report the reader throughput
+ */
+static int
+xml_test_bench(const char *filename, unsigned int rounds)
+{
+	unsigned long long msec;
+	struct timeval beg, end;
+	xml_document_t *doc;
+	struct stat stb;
+	unsigned int i;
+
+	if (stat(filename, &stb) < 0) {
+		fprintf(stderr, "Cannot stat %s: %m\n", filename);
+		return 1;
+	}
+
+	ni_timer_get_time(&beg);
+	for (i = 0; i < rounds; ++i) {
+		if (!(doc = xml_document_read(filename))) {
+			fprintf(stderr, "Error parsing %s\n", filename);
+			return 1;
+		}
+		xml_document_free(doc);
+	}
+	ni_timer_get_time(&end);
+	msec = ni_timeout_since(&beg, &end, NULL);
+
+	printf("%s: %u x %llu bytes in %llu msec, %.1f MB/s\n", filename, rounds,
+			(unsigned long long)stb.st_size, msec, msec ?
+			(double)stb.st_size * rounds / 1000.0 / msec : 0.0);
+	return 0;
+}
 
 int
 main(int argc, char **argv)
@@ -16,8 +53,11 @@ main(int argc, char **argv)
 	const char *filename;
 	xml_document_t *doc;
 
+	if (argc == 4 && !strcmp(argv[1], "--bench"))
+		return xml_test_bench(argv[3], strtoul(argv[2], NULL, 0));
+
 	if (argc != 2) {
-		fprintf(stderr, "Usage: xml-test filename\n");
+		fprintf(stderr, "Usage: xml-test [--bench rounds] filename\n");
 		return 1;
 	}
 	filename = argv[1];
@@ -32,4 +72,3 @@ main(int argc, char **argv)
 	xml_document_free(doc);
 	return 0;
 }
-
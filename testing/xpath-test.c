@@ -12,25 +12,72 @@
 #include <wicked/netinfo.h>
 #include <wicked/xpath.h>
 #include <wicked/logging.h>
+#include <wicked/time.h>
 
 enum {
 	OPT_DEBUG,
 	OPT_REFERENCE,
+	OPT_BENCH,
 };
 
 static struct option	options[] = {
 	{ "debug",		required_argument,	NULL,	OPT_DEBUG },
 	{ "reference",		required_argument,	NULL,	OPT_REFERENCE },
+	{ "bench",		required_argument,	NULL,	OPT_BENCH },
 
 	{ NULL }
 };
 
+/*
+ * Compare parse+eval of the expression on every evaluation
+ * with evaluations using the compiled expression cache.
+ */
+static int
+xpath_bench(const char *expression, xml_node_t *refnode, unsigned int count)
+{
+	struct timeval begin, end;
+	xpath_cache_stats_t stats;
+	xpath_result_t *result;
+	xpath_enode_t *enode;
+	unsigned int i;
+
+	ni_timer_get_time(&begin);
+	for (i = 0; i < count; ++i) {
+		if (!(enode = xpath_expression_parse(expression)))
+			return 1;
+		result = xpath_expression_eval(enode, refnode);
+		xpath_result_free(result);
+		xpath_expression_free(enode);
+	}
+	ni_timer_get_time(&end);
+	printf("parse+eval: %u evaluations in %llu msec\n", count,
+			ni_timeout_since(&begin, &end, NULL));
+
+	ni_timer_get_time(&begin);
+	for (i = 0; i < count; ++i) {
+		if (!(result = xpath_expression_eval_cached(expression, refnode)))
+			return 1;
+		xpath_result_free(result);
+	}
+	ni_timer_get_time(&end);
+	printf("cached:     %u evaluations in %llu msec\n", count,
+			ni_timeout_since(&begin, &end, NULL));
+
+	xpath_cache_get_stats(&stats);
+	printf("cache: %lu hits, %lu misses, %lu evictions, %u/%u entries\n",
+			stats.hits, stats.misses, stats.evictions,
+			stats.count, stats.limit);
+
+	xpath_cache_flush();
+	return 0;
+}
 
 int
 main(int argc, char **argv)
 {
 	const char *opt_reference = NULL;
 	const char *expression = NULL, *filename = "-";
+	unsigned int opt_bench = 0;
 	xml_document_t *doc;
 	xml_node_t *refnode;
 	xpath_enode_t *enode;
@@ -42,7 +89,7 @@ main(int argc, char **argv)
 		default:
 		usage:
 			fprintf(stderr,
-				"./xpath-test [--reference <expression>] <expression> [filename]\n"
+				"./xpath-test [--reference <expression>] [--bench <count>] <expression> [filename]\n"
 			       );
 			return 1;
 
@@ -57,6 +104,13 @@ main(int argc, char **argv)
 			opt_reference = optarg;
 			break;
 
+		case OPT_BENCH:
+			if (ni_parse_uint(optarg, &opt_bench, 10) < 0 || !opt_bench) {
+				fprintf(stderr, "Bad benchmark count \"%s\"\n", optarg);
+				return 1;
+			}
+			break;
+
 		}
 	}
 
@@ -104,6 +158,9 @@ main(int argc, char **argv)
 		xpath_expression_free(enode);
 	}
 
+	if (opt_bench)
+		return xpath_bench(expression, refnode, opt_bench);
+
 	enode = xpath_expression_parse(expression);
 	if (!enode) {
 		fprintf(stderr, "Error parsing XPATH expression %s\n", expression);
@@ -0,0 +1,389 @@
+/*
+ *	Schema cache unit tests
+ *
+ *	Copyright (C) 2026 SUSE LLC
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	Description:
+ *		Round-trip tests of the binary schema cache in src/xml-schema.c
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/time.h>
+#include <wicked/dbus.h>
+#include "xml-schema.h"
+#include "hashmap_priv.h"
+#include "wunit.h"
+
+#ifndef TEST_SCHEMA_FILE
+#define TEST_SCHEMA_FILE	"../schema/wicked.xml"
+#endif
+
+/*
+ * Objects of the original and the loaded schema are paired on first
+ * comparison, so shared (refcounted) objects have to be shared in the
+ * same way in both schemas.
+ */
+typedef struct xs_pair {
+	const void *	a;
+	const void *	b;
+} xs_pair_t;
+
+static ni_hashmap_t	xs_pairs_a;
+static ni_hashmap_t	xs_pairs_b;
+
+static ni_bool_t
+xs_pair_find(const ni_hashmap_t *map, const void *ptr, const xs_pair_t **pair, ni_bool_t b)
+{
+	ni_hashmap_entry_t *entry;
+	const xs_pair_t *p;
+
+	ni_hashmap_foreach(map, ni_hashmap_hash_ptr(ptr), entry) {
+		p = entry->item;
+		if ((b ? p->b : p->a) == ptr) {
+			*pair = p;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/* returns 1 when already paired, 0 when paired now, -1 on mismatch */
+static int
+xs_pair(const void *a, const void *b)
+{
+	const xs_pair_t *pa = NULL, *pb = NULL;
+	xs_pair_t *pair;
+
+	xs_pair_find(&xs_pairs_a, a, &pa, FALSE);
+	xs_pair_find(&xs_pairs_b, b, &pb, TRUE);
+	if (pa || pb)
+		return pa && pa == pb ? 1 : -1;
+
+	pair = calloc(1, sizeof(*pair));
+	pair->a = a;
+	pair->b = b;
+	ni_hashmap_insert(&xs_pairs_a, ni_hashmap_hash_ptr(a), pair);
+	ni_hashmap_insert(&xs_pairs_b, ni_hashmap_hash_ptr(b), pair);
+	return 0;
+}
+
+static ni_bool_t
+xs_vars_equal(const ni_var_array_t *a, const ni_var_array_t *b)
+{
+	unsigned int i;
+
+	if (a->count != b->count)
+		return FALSE;
+	for (i = 0; i < a->count; ++i) {
+		if (!ni_string_eq(a->data[i].name, b->data[i].name) ||
+		    !ni_string_eq(a->data[i].value, b->data[i].value))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+xs_xml_equal(const xml_node_t *a, const xml_node_t *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	if (!ni_string_eq(a->name, b->name) || !ni_string_eq(a->cdata, b->cdata) ||
+	    !xs_vars_equal(&a->attrs, &b->attrs))
+		return FALSE;
+
+	for (a = a->children, b = b->children; a && b; a = a->next, b = b->next) {
+		if (!xs_xml_equal(a, b))
+			return FALSE;
+	}
+	return a == b;
+}
+
+static ni_bool_t
+xs_intmap_equal(const ni_xs_intmap_t *a, const ni_xs_intmap_t *b)
+{
+	const ni_intmap_t *ma, *mb;
+	int paired;
+
+	if (!a || !b)
+		return a == b;
+	if ((paired = xs_pair(a, b)))
+		return paired > 0;
+
+	for (ma = a->bits, mb = b->bits; ma->name && mb->name; ++ma, ++mb) {
+		if (!ni_string_eq(ma->name, mb->name) || ma->value != mb->value)
+			return FALSE;
+	}
+	return !ma->name && !mb->name;
+}
+
+static ni_bool_t
+xs_range_equal(const ni_xs_range_t *a, const ni_xs_range_t *b)
+{
+	int paired;
+
+	if (!a || !b)
+		return a == b;
+	if ((paired = xs_pair(a, b)))
+		return paired > 0;
+	return a->min == b->min && a->max == b->max;
+}
+
+static ni_bool_t
+xs_group_equal(const ni_xs_group_t *a, const ni_xs_group_t *b)
+{
+	int paired;
+
+	if (!a || !b)
+		return a == b;
+	if ((paired = xs_pair(a, b)))
+		return paired > 0;
+	return a->relation == b->relation && ni_string_eq(a->name, b->name);
+}
+
+static ni_bool_t	xs_name_types_equal(const ni_xs_name_type_array_t *, const ni_xs_name_type_array_t *);
+
+static ni_bool_t
+xs_type_equal(const ni_xs_type_t *a, const ni_xs_type_t *b)
+{
+	unsigned int i;
+	int paired;
+
+	if (!a || !b)
+		return a == b;
+	if ((paired = xs_pair(a, b)))
+		return paired > 0;
+
+	if (a->class != b->class ||
+	    !ni_string_eq(a->name, b->name) ||
+	    !ni_string_eq(a->description, b->description) ||
+	    a->constraint.mandatory != b->constraint.mandatory ||
+	    !xs_group_equal(a->constraint.group, b->constraint.group) ||
+	    !ni_string_eq(a->origdef.name, b->origdef.name) ||
+	    !a->origdef.scope != !b->origdef.scope ||
+	    !xs_xml_equal(a->meta, b->meta))
+		return FALSE;
+
+	if (a->origdef.scope && !ni_string_eq(a->origdef.scope->name, b->origdef.scope->name))
+		return FALSE;
+
+	switch (a->class) {
+	case NI_XS_TYPE_SCALAR:
+		return ni_string_eq(a->u.scalar_info->basic_name, b->u.scalar_info->basic_name) &&
+			a->u.scalar_info->type == b->u.scalar_info->type &&
+			xs_intmap_equal(a->u.scalar_info->constraint.enums, b->u.scalar_info->constraint.enums) &&
+			xs_range_equal(a->u.scalar_info->constraint.range, b->u.scalar_info->constraint.range) &&
+			xs_intmap_equal(a->u.scalar_info->constraint.bitmap, b->u.scalar_info->constraint.bitmap) &&
+			xs_intmap_equal(a->u.scalar_info->constraint.bitmask, b->u.scalar_info->constraint.bitmask);
+
+	case NI_XS_TYPE_STRUCT:
+		return xs_name_types_equal(&a->u.struct_info->children, &b->u.struct_info->children);
+
+	case NI_XS_TYPE_UNION:
+		return ni_string_eq(a->u.union_info->discriminant, b->u.union_info->discriminant) &&
+			xs_name_types_equal(&a->u.union_info->children, &b->u.union_info->children);
+
+	case NI_XS_TYPE_DICT:
+		if (!xs_name_types_equal(&a->u.dict_info->children, &b->u.dict_info->children) ||
+		    a->u.dict_info->groups.count != b->u.dict_info->groups.count)
+			return FALSE;
+		for (i = 0; i < a->u.dict_info->groups.count; ++i) {
+			if (!xs_group_equal(a->u.dict_info->groups.data[i], b->u.dict_info->groups.data[i]))
+				return FALSE;
+		}
+		return TRUE;
+
+	case NI_XS_TYPE_ARRAY:
+		return xs_type_equal(a->u.array_info->element_type, b->u.array_info->element_type) &&
+			ni_string_eq(a->u.array_info->element_name, b->u.array_info->element_name) &&
+			a->u.array_info->minlen == b->u.array_info->minlen &&
+			a->u.array_info->maxlen == b->u.array_info->maxlen &&
+			a->u.array_info->notation == b->u.array_info->notation;
+
+	default:
+		return TRUE;
+	}
+}
+
+static ni_bool_t
+xs_name_types_equal(const ni_xs_name_type_array_t *a, const ni_xs_name_type_array_t *b)
+{
+	unsigned int i;
+
+	if (a->count != b->count)
+		return FALSE;
+	for (i = 0; i < a->count; ++i) {
+		if (!ni_string_eq(a->data[i].name, b->data[i].name) ||
+		    !ni_string_eq(a->data[i].description, b->data[i].description) ||
+		    !xs_type_equal(a->data[i].type, b->data[i].type))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static ni_bool_t
+xs_methods_equal(const ni_xs_method_t *a, const ni_xs_method_t *b)
+{
+	for ( ; a && b; a = a->next, b = b->next) {
+		if (!ni_string_eq(a->name, b->name) ||
+		    !ni_string_eq(a->description, b->description) ||
+		    !xs_name_types_equal(&a->arguments, &b->arguments) ||
+		    !xs_type_equal(a->retval, b->retval) ||
+		    !xs_xml_equal(a->meta, b->meta))
+			return FALSE;
+	}
+	return a == b;
+}
+
+static ni_bool_t
+xs_scope_equal(const ni_xs_scope_t *a, const ni_xs_scope_t *b)
+{
+	const ni_xs_service_t *sa, *sb;
+	const ni_xs_class_t *ca, *cb;
+
+	if (!ni_string_eq(a->name, b->name) ||
+	    !xs_name_types_equal(&a->types, &b->types) ||
+	    !xs_vars_equal(&a->constants, &b->constants))
+		return FALSE;
+
+	for (ca = a->classes, cb = b->classes; ca && cb; ca = ca->next, cb = cb->next) {
+		if (!ni_string_eq(ca->name, cb->name) || !ni_string_eq(ca->base_name, cb->base_name))
+			return FALSE;
+	}
+	if (ca || cb)
+		return FALSE;
+
+	for (sa = a->services, sb = b->services; sa && sb; sa = sa->next, sb = sb->next) {
+		if (!ni_string_eq(sa->name, sb->name) ||
+		    !ni_string_eq(sa->interface, sb->interface) ||
+		    !ni_string_eq(sa->description, sb->description) ||
+		    !xs_vars_equal(&sa->attributes, &sb->attributes) ||
+		    !xs_methods_equal(sa->methods, sb->methods) ||
+		    !xs_methods_equal(sa->signals, sb->signals))
+			return FALSE;
+	}
+	if (sa || sb)
+		return FALSE;
+
+	if (!a->defined_by.service != !b->defined_by.service)
+		return FALSE;
+	if (a->defined_by.service &&
+	    !ni_string_eq(a->defined_by.service->name, b->defined_by.service->name))
+		return FALSE;
+
+	for (a = a->children, b = b->children; a && b; a = a->next, b = b->next) {
+		if (a->parent == NULL || b->parent == NULL || !xs_scope_equal(a, b))
+			return FALSE;
+	}
+	return a == b;
+}
+
+static unsigned int
+xs_scope_count(const ni_xs_scope_t *scope)
+{
+	unsigned int count = 1;
+
+	for (scope = scope->children; scope; scope = scope->next)
+		count += xs_scope_count(scope);
+	return count;
+}
+
+static char	xs_cache_file[PATH_MAX];
+
+TESTCASE(schema_cache_roundtrip)
+{
+	unsigned char key[NI_XS_CACHE_KEY_SIZE];
+	ni_xs_scope_t *parsed, *loaded;
+	struct timeval beg, end;
+	unsigned int builtins;
+
+	snprintf(xs_cache_file, sizeof(xs_cache_file), "/tmp/xs-cache-test.%d", (int)getpid());
+
+	CHECK2(ni_xs_schema_cache_key(TEST_SCHEMA_FILE, key, sizeof(key)) == NI_XS_CACHE_KEY_SIZE,
+			"schema cache key of %s", TEST_SCHEMA_FILE);
+
+	parsed = ni_dbus_xml_init();
+	builtins = parsed->types.count;
+	ni_timer_get_time(&beg);
+	CHECK(ni_xs_process_schema_file(TEST_SCHEMA_FILE, parsed) == 0);
+	ni_timer_get_time(&end);
+	CHECK2(parsed->services != NULL, "parsed schema with %u scopes in %llu msec",
+			xs_scope_count(parsed), ni_timeout_since(&beg, &end, NULL));
+
+	CHECK(ni_xs_scope_cache_save(parsed, builtins, xs_cache_file, key, sizeof(key)) == 0);
+
+	loaded = ni_dbus_xml_init();
+	ni_timer_get_time(&beg);
+	CHECK(ni_xs_scope_cache_load(loaded, xs_cache_file, key, sizeof(key)));
+	ni_timer_get_time(&end);
+	CHECK2(xs_scope_count(loaded) == xs_scope_count(parsed),
+			"loaded schema with %u scopes in %llu msec",
+			xs_scope_count(loaded), ni_timeout_since(&beg, &end, NULL));
+
+	ni_hashmap_init(&xs_pairs_a);
+	ni_hashmap_init(&xs_pairs_b);
+	CHECK2(xs_scope_equal(parsed, loaded), "loaded schema is equivalent to the parsed one");
+	CHECK2(ni_xs_scope_lookup(loaded, "ipv4-address") != NULL,
+			"loaded schema type lookup");
+
+	ni_xs_scope_free(loaded);
+	ni_xs_scope_free(parsed);
+}
+
+TESTCASE(schema_cache_mismatch)
+{
+	unsigned char key[NI_XS_CACHE_KEY_SIZE];
+	ni_xs_scope_t *scope;
+	unsigned int builtins;
+	FILE *fp;
+	long size = 0;
+
+	CHECK(ni_xs_schema_cache_key(TEST_SCHEMA_FILE, key, sizeof(key)) == NI_XS_CACHE_KEY_SIZE);
+
+	/* outdated key */
+	key[0] ^= 0xff;
+	scope = ni_dbus_xml_init();
+	builtins = scope->types.count;
+	CHECK2(!ni_xs_scope_cache_load(scope, xs_cache_file, key, sizeof(key)),
+			"cache with other key is not used");
+	CHECK(scope->types.count == builtins && !scope->services && !scope->children);
+	key[0] ^= 0xff;
+
+	/* corrupt (truncated) cache */
+	CHECK((fp = fopen(xs_cache_file, "r+")) != NULL);
+	CHECK(fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) > 0);
+	CHECK(ftruncate(fileno(fp), size / 2) == 0);
+	fclose(fp);
+
+	CHECK2(!ni_xs_scope_cache_load(scope, xs_cache_file, key, sizeof(key)),
+			"truncated cache is not used");
+	CHECK(scope->types.count == builtins && !scope->services && !scope->children);
+
+	/* missing cache */
+	unlink(xs_cache_file);
+	CHECK(!ni_xs_scope_cache_load(scope, xs_cache_file, key, sizeof(key)));
+
+	ni_xs_scope_free(scope);
+}
+
+TESTMAIN();